@@ -58,12 +58,20 @@ namespace applications {
 MNISTPatchReconstructionApplication::MNISTPatchReconstructionApplication(std::string node_name_) : OpenGLContinuousLearningApplication(node_name_),
 		mlnn_filename("mlnn_filename", "mlnn.txt"),
 		mlnn_save("mlnn_save", false),
-		mlnn_load("mlnn_load", false)
+		mlnn_load("mlnn_load", false),
+		batch_size("batch_size", 1),
+		headless("headless", false),
+		headless_iterations("headless_iterations", 0),
+		statistics_filename("statistics_filename", "mnist_patch_autoencoder_reconstruction.csv")
 	{
 	// Register properties - so their values can be overridden (read from the configuration file).
 	registerProperty(mlnn_filename);
 	registerProperty(mlnn_save);
 	registerProperty(mlnn_load);
+	registerProperty(batch_size);
+	registerProperty(headless);
+	registerProperty(headless_iterations);
+	registerProperty(statistics_filename);
 
 	LOG(LINFO) << "Properties registered";
 
@@ -78,7 +86,18 @@ MNISTPatchReconstructionApplication::~MNISTPatchReconstructionApplication() {
 	delete(test_dataset_importer);
 }
 
-void MNISTPatchReconstructionApplication::initialize(int argc, char* argv[]) {
+void MNISTPatchReconstructionApplication::initialize(int argc_, char* argv_[]) {
+	// Remember parameters - windows will be created when it is known whether the application is headless.
+	argc = argc_;
+	argv = argv_;
+
+	collector_ptr = std::make_shared < mic::data_io::DataCollector<std::string, float> >( );
+	// Add containers to collector.
+	collector_ptr->createContainer("training_loss",  mic::types::color_rgba(0, 0, 255, 180));
+	collector_ptr->createContainer("test_loss",  mic::types::color_rgba(0, 255, 0, 180));
+}
+
+void MNISTPatchReconstructionApplication::initializeWindows() {
 
 	// Initialize GLUT! :]
 	VGL_MANAGER->initializeGLUT(argc, argv);
@@ -87,15 +106,13 @@ void MNISTPatchReconstructionApplication::initialize(int argc, char* argv[]) {
 	w2d_input = new WindowMatrix2D("Input matrix", 0, 0, 256, 256);
 	w2d_reconstruction = new WindowMatrix2D("Reconstructed matrix", 320, 0, 256, 256);
 
-	collector_ptr = std::make_shared < mic::data_io::DataCollector<std::string, float> >( );
-	// Add containers to collector.
-	collector_ptr->createContainer("training_loss",  mic::types::color_rgba(0, 0, 255, 180));
-	collector_ptr->createContainer("test_loss",  mic::types::color_rgba(0, 255, 0, 180));
-
 	// Create the visualization windows - must be created in the same, main thread :]
 	w_chart = new WindowCollectorChart<float>("MNISTPatchReconstruction", 0, 310, 512, 256);
 	w_chart->setDataCollectorPtr(collector_ptr);
 
+	// Set displayed matrix pointers.
+	w2d_input->setMatrixPointerSynchronized(input_image);
+	w2d_reconstruction->setMatrixPointerSynchronized(reconstructed_image);
 }
 
 void MNISTPatchReconstructionApplication::initializePropertyDependentVariables() {
@@ -108,9 +125,12 @@ void MNISTPatchReconstructionApplication::initializePropertyDependentVariables()
 	input_image = std::make_shared<mic::types::MatrixXf >(patch_size, patch_size);
 	reconstructed_image = std::make_shared<mic::types::MatrixXf >(patch_size, patch_size);
 
-	// Set displayed matrix pointers.
-	w2d_input->setMatrixPointerSynchronized(input_image);
-	w2d_reconstruction->setMatrixPointerSynchronized(reconstructed_image);
+	// Allocate memory for batches.
+	encoded_batch = std::make_shared<mic::types::MatrixXf >(patch_size*patch_size, batch_size);
+
+	// Create windows - main thread.
+	if (!headless)
+		initializeWindows();
 
 	// Load datasets.
 	if (!training_dataset_importer->importData())
@@ -140,57 +160,89 @@ void MNISTPatchReconstructionApplication::initializePropertyDependentVariables()
 		LOG(LINFO) << "Generated new neural network";
 	}//: else
 
+	// Batches will be assembled directly in the input matrix of the network.
+	neural_net.bindInput(encoded_batch);
 }
 
 
-bool MNISTPatchReconstructionApplication::performLearningStep() {
+void MNISTPatchReconstructionApplication::run() {
+	// Run with visualization.
+	if (!headless) {
+		OpenGLContinuousLearningApplication::run();
+		return;
+	}//: if
+
+	LOG(LINFO) << "Running in headless mode";
+	size_t test_steps = 0;
+	while (!APP_STATE->Quit()) {
+		iteration++;
+		// Learning and testing steps.
+		performLearningStep();
+		if (iteration % learning_iterations_to_test_ratio == 0) {
+			collectTestStatistics();
+			test_steps++;
+			if (test_steps % number_of_averaged_test_measures == 0) {
+				populateTestStatistics();
+				// Export the statistics collected so far - they are not lost when the run is killed.
+				collector_ptr->exportDataToCsv(statistics_filename);
+			}//: if
+		}//: if
+		if ((headless_iterations > 0) && (iteration >= headless_iterations))
+			break;
+	}//: while
+
+	// Export all the statistics.
+	collector_ptr->exportDataToCsv(statistics_filename);
+	LOG(LINFO) << "Headless mode finished after " << iteration << " iterations";
+}
+
+
+void MNISTPatchReconstructionApplication::assembleBatch(mic::data_io::MNISTPatchImporter* importer_) {
+	size_t length = patch_size*patch_size;
+	for (size_t ib = 0; ib < (size_t)encoded_batch->cols(); ib++) {
+		// Random select sample from dataset.
+		mic::types::MNISTSample<float> sample = importer_->getRandomSample();
+		// Copy sample data to the column of batch - i.e. reshape it.
+		encoded_batch->col(ib) = Eigen::Map<const Eigen::Matrix<float, Eigen::Dynamic, 1> >(sample.data()->data(), length);
+	}//: for
+}
 
-	// Random select sample from training dataset.
-	mic::types::MNISTSample<float> sample = training_dataset_importer->getRandomSample();
 
-	// Copy sample data to input matrix - for visualization.
-	(*input_image) = (*sample.data());
-	//std::cout << " input: \n" << *(input_image) << std::endl;
+bool MNISTPatchReconstructionApplication::performLearningStep() {
 
-	// Encode sample data....
-	mic::types::MatrixXfPtr encoded_patch (new mic::types::MatrixXf(*sample.data()));
-	// ... i.e. reshape it.
-	encoded_patch->resize(patch_size*patch_size, 1);
+	// Random select samples from training dataset.
+	assembleBatch(training_dataset_importer);
 
 	// Train the autoencoder.
-	float loss = neural_net.train (encoded_patch, encoded_patch, 0.005);
+	float loss = neural_net.train (encoded_batch, encoded_batch, 0.005);
 	//std::cout << loss << std::endl;
 	collector_ptr->addDataToContainer("training_loss", loss);
 
-	// Get reconstruction.
-	mic::types::MatrixXfPtr encoded_reconstruction = neural_net.getPredictions();
-
-	(*reconstructed_image) = (*encoded_reconstruction);
-	reconstructed_image->resize(patch_size, patch_size);
+	if (!headless) {
+		// Copy the first sample and its reconstruction - for visualization.
+		(*input_image) = encoded_batch->col(0);
+		input_image->resize(patch_size, patch_size);
+		(*reconstructed_image) = neural_net.getPredictions()->col(0);
+		reconstructed_image->resize(patch_size, patch_size);
+	}//: if
 	return true;
 }
 
 
 void MNISTPatchReconstructionApplication::collectTestStatistics() {
-	// Random select sample from test dataset.
-	mic::types::MNISTSample<float> sample = test_dataset_importer->getRandomSample();
-
-	// Copy sample data to input matrix - for visualization.
-	(*input_image) = (*sample.data());
-
-	// Encode sample data....
-	mic::types::MatrixXfPtr encoded_patch (new mic::types::MatrixXf(*sample.data()));
-	// ... i.e. reshape it.
-	encoded_patch->resize(patch_size*patch_size, 1);
-
-	// Train the autoencoder.
-	float loss = neural_net.test (encoded_patch, encoded_patch);
-
-	// Get reconstruction.
-	mic::types::MatrixXfPtr decoded_reconstruction = neural_net.getPredictions();
-
-	(*reconstructed_image) = (*decoded_reconstruction);
-	reconstructed_image->resize(patch_size, patch_size);
+	// Random select samples from test dataset.
+	assembleBatch(test_dataset_importer);
+
+	// Test the autoencoder.
+	float loss = neural_net.test (encoded_batch, encoded_batch);
+
+	if (!headless) {
+		// Copy the first sample and its reconstruction - for visualization.
+		(*input_image) = encoded_batch->col(0);
+		input_image->resize(patch_size, patch_size);
+		(*reconstructed_image) = neural_net.getPredictions()->col(0);
+		reconstructed_image->resize(patch_size, patch_size);
+	}//: if
 
 	// Collect statistics.
 	collector_ptr->addDataToContainer("test_loss", loss);
@@ -60,7 +60,11 @@ MNISTPatchSoftmaxApplication::MNISTPatchSoftmaxApplication(std::string node_name
 		autoencoder_layers_to_be_removed("autoencoder_layers_to_be_removed", 0),
 		softmax_filename("softmax_filename", "softmax.txt"),
 		softmax_save("softmax_save", false),
-		softmax_load("softmax_load", false)
+		softmax_load("softmax_load", false),
+		batch_size("batch_size", 1),
+		headless("headless", false),
+		headless_iterations("headless_iterations", 0),
+		statistics_filename("statistics_filename", "mnist_patch_autoencoder_softmax.csv")
 	{
 	// Register properties - so their values can be overridden (read from the configuration file).
 	registerProperty(autoencoder_filename);
@@ -68,6 +72,10 @@ MNISTPatchSoftmaxApplication::MNISTPatchSoftmaxApplication(std::string node_name
 	registerProperty(softmax_filename);
 	registerProperty(softmax_save);
 	registerProperty(softmax_load);
+	registerProperty(batch_size);
+	registerProperty(headless);
+	registerProperty(headless_iterations);
+	registerProperty(statistics_filename);
 
 	// Create importers.
 	training_dataset_importer = new mic::data_io::MNISTPatchImporter("mnist_training_dataset_importer");
@@ -81,7 +89,18 @@ MNISTPatchSoftmaxApplication::~MNISTPatchSoftmaxApplication() {
 	delete(test_dataset_importer);
 }
 
-void MNISTPatchSoftmaxApplication::initialize(int argc, char* argv[]) {
+void MNISTPatchSoftmaxApplication::initialize(int argc_, char* argv_[]) {
+	// Remember parameters - windows will be created when it is known whether the application is headless.
+	argc = argc_;
+	argv = argv_;
+
+	collector_ptr = std::make_shared < mic::data_io::DataCollector<std::string, float> >( );
+	// Add containers to collector.
+	collector_ptr->createContainer("training_loss",  mic::types::color_rgba(0, 0, 255, 180));
+	collector_ptr->createContainer("test_loss",  mic::types::color_rgba(0, 255, 0, 180));
+}
+
+void MNISTPatchSoftmaxApplication::initializeWindows() {
 
 	// Initialize GLUT! :]
 	VGL_MANAGER->initializeGLUT(argc, argv);
@@ -91,15 +110,14 @@ void MNISTPatchSoftmaxApplication::initialize(int argc, char* argv[]) {
 
 	w_prob = new WindowProbability("Probabilty", 128, 256, 320, 0);
 
-	collector_ptr = std::make_shared < mic::data_io::DataCollector<std::string, float> >( );
-	// Add containers to collector.
-	collector_ptr->createContainer("training_loss",  mic::types::color_rgba(0, 0, 255, 180));
-	collector_ptr->createContainer("test_loss",  mic::types::color_rgba(0, 255, 0, 180));
-
 	// Create the visualization windows - must be created in the same, main thread :]
 	w_chart = new WindowCollectorChart<float>("MNISTPatchReconstruction", 0, 310, 512, 256);
 	w_chart->setDataCollectorPtr(collector_ptr);
 
+	// Set displayed matrix pointers.
+	w2d_input->setMatrixPointerSynchronized(input_image);
+	w_prob->setMatrixPointer1(input_target);
+	w_prob->setMatrixPointer2(decoded_prediction);
 }
 
 void MNISTPatchSoftmaxApplication::initializePropertyDependentVariables() {
@@ -113,10 +131,13 @@ void MNISTPatchSoftmaxApplication::initializePropertyDependentVariables() {
 	input_target = std::make_shared<mic::types::MatrixXf >(10,1);
 	decoded_prediction = std::make_shared<mic::types::MatrixXf >(10,1);
 
-	// Set displayed matrix pointers.
-	w2d_input->setMatrixPointerSynchronized(input_image);
-	w_prob->setMatrixPointer1(input_target);
-	w_prob->setMatrixPointer2(decoded_prediction);
+	// Allocate memory for batches.
+	encoded_batch = std::make_shared<mic::types::MatrixXf >(patch_size*patch_size, batch_size);
+	encoded_targets = std::make_shared<mic::types::MatrixXf >(10, batch_size);
+
+	// Create windows - main thread.
+	if (!headless)
+		initializeWindows();
 
 	// Load datasets.
 	if (!training_dataset_importer->importData())
@@ -125,10 +146,6 @@ void MNISTPatchSoftmaxApplication::initializePropertyDependentVariables() {
 	if (!test_dataset_importer->importData())
 		return;
 
-	// Initialize the encoders.
-	mnist_encoder = new mic::encoders::MatrixXfMatrixXfEncoder(patch_size, patch_size);
-	label_encoder = new mic::encoders::UIntMatrixXfEncoder(10);
-
 	// Try to load autoencoder from file.
 	if ((!softmax_load) && (neural_net.load(autoencoder_filename))) {
 		LOG(LINFO) << "Loaded the autoencoder network";
@@ -151,28 +168,72 @@ void MNISTPatchSoftmaxApplication::initializePropertyDependentVariables() {
 		exit(1);
 	}//: else
 
+	// Batches will be assembled directly in the input matrix of the network.
+	neural_net.bindInput(encoded_batch);
 }
 
 
-bool MNISTPatchSoftmaxApplication::performLearningStep() {
+void MNISTPatchSoftmaxApplication::run() {
+	// Run with visualization.
+	if (!headless) {
+		OpenGLContinuousLearningApplication::run();
+		return;
+	}//: if
+
+	LOG(LINFO) << "Running in headless mode";
+	size_t test_steps = 0;
+	while (!APP_STATE->Quit()) {
+		iteration++;
+		// Learning and testing steps.
+		performLearningStep();
+		if (iteration % learning_iterations_to_test_ratio == 0) {
+			collectTestStatistics();
+			test_steps++;
+			if (test_steps % number_of_averaged_test_measures == 0) {
+				populateTestStatistics();
+				// Export the statistics collected so far - they are not lost when the run is killed.
+				collector_ptr->exportDataToCsv(statistics_filename);
+			}//: if
+		}//: if
+		if ((headless_iterations > 0) && (iteration >= headless_iterations))
+			break;
+	}//: while
+
+	// Export all the statistics.
+	collector_ptr->exportDataToCsv(statistics_filename);
+	LOG(LINFO) << "Headless mode finished after " << iteration << " iterations";
+}
 
-	// Random select sample from training dataset.
-	mic::types::MNISTSample<float> sample = training_dataset_importer->getRandomSample();
 
-	// Copy sample data to input matrix - for visualization.
-	(*input_image) = (*sample.data());
-	//std::cout << " input: \n" << *(input_image) << std::endl;
+void MNISTPatchSoftmaxApplication::assembleBatch(mic::data_io::MNISTPatchImporter* importer_) {
+	size_t length = patch_size*patch_size;
+	for (size_t ib = 0; ib < (size_t)encoded_batch->cols(); ib++) {
+		// Random select sample from dataset.
+		mic::types::MNISTSample<float> sample = importer_->getRandomSample();
+		// Copy sample data to the column of batch - i.e. reshape it.
+		encoded_batch->col(ib) = Eigen::Map<const Eigen::Matrix<float, Eigen::Dynamic, 1> >(sample.data()->data(), length);
+		// Encode label (1 hot) - directly in the column of targets.
+		encoded_targets->col(ib).setZero();
+		(*encoded_targets)(*sample.label(), ib) = 1.0f;
+	}//: for
+}
 
-	// Encode data.
-	mic::types::MatrixXfPtr encoded_patch = mnist_encoder->encodeSample(sample.data());
-	mic::types::MatrixXfPtr encoded_label = label_encoder->encodeSample(sample.label());
 
-	// Train the autoencoder.
-	float loss = neural_net.train (encoded_patch, encoded_label, 0.005);
+bool MNISTPatchSoftmaxApplication::performLearningStep() {
 
-	// Copy encoded and label prediction - for visualization.
-	(*input_target) = (*encoded_label);
-	(*decoded_prediction) = (*neural_net.getPredictions());
+	// Random select samples from training dataset.
+	assembleBatch(training_dataset_importer);
+
+	// Train the network.
+	float loss = neural_net.train (encoded_batch, encoded_targets, 0.005);
+
+	if (!headless) {
+		// Copy the first sample, its label and prediction - for visualization.
+		(*input_image) = encoded_batch->col(0);
+		input_image->resize(patch_size, patch_size);
+		(*input_target) = encoded_targets->col(0);
+		(*decoded_prediction) = neural_net.getPredictions()->col(0);
+	}//: if
 
 	// Collect statistics.
 	collector_ptr->addDataToContainer("training_loss", loss);
@@ -182,18 +243,17 @@ bool MNISTPatchSoftmaxApplication::performLearningStep() {
 
 
 void MNISTPatchSoftmaxApplication::collectTestStatistics() {
-	// Random select sample from test dataset.
-	mic::types::MNISTSample<float> sample = test_dataset_importer->getRandomSample();
-
-	// Copy sample data to input matrix - for visualization.
-	(*input_image) = (*sample.data());
+	// Random select samples from test dataset.
+	assembleBatch(test_dataset_importer);
 
-	// Encode data.
-	mic::types::MatrixXfPtr encoded_patch = mnist_encoder->encodeSample(sample.data());
-	mic::types::MatrixXfPtr encoded_label = label_encoder->encodeSample(sample.label());
+	// Test the network.
+	float loss = neural_net.test (encoded_batch, encoded_targets);
 
-	// Train the autoencoder.
-	float loss = neural_net.test (encoded_patch, encoded_label);
+	if (!headless) {
+		// Copy the first sample - for visualization.
+		(*input_image) = encoded_batch->col(0);
+		input_image->resize(patch_size, patch_size);
+	}//: if
 
 	// Collect statistics.
 	collector_ptr->addDataToContainer("test_loss", loss);
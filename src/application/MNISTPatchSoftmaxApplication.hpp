@@ -38,9 +38,6 @@ using namespace mic::opengl::visualization;
 #include <mlnn/BackpropagationNeuralNetwork.hpp>
 using namespace mic::mlnn;
 
-#include <encoders/MatrixXfMatrixXfEncoder.hpp>
-#include <encoders/UIntMatrixXfEncoder.hpp>
-
 
 namespace mic {
 namespace applications {
@@ -69,12 +66,28 @@ protected:
 	virtual void initializePropertyDependentVariables();
 
 	/*!
-	 * Method initializes GLUT and OpenGL windows.
+	 * Method remembers the application parameters - GLUT and OpenGL windows are initialized after loading the configuration, unless in headless mode.
 	 * @param argc Number of application parameters.
 	 * @param argv Array of application parameters.
 	 */
 	virtual void initialize(int argc, char* argv[]);
 
+	/*!
+	 * Initializes GLUT and creates the OpenGL windows.
+	 */
+	void initializeWindows();
+
+	/*!
+	 * Runs the application - with visualization or, in headless mode, in a loop performing learning and testing steps as fast as possible.
+	 */
+	virtual void run();
+
+	/*!
+	 * Assembles a batch of random patches (along with the encoded labels) directly in the preallocated matrices.
+	 * @param importer_ Importer from which the samples will be drawn.
+	 */
+	void assembleBatch(mic::data_io::MNISTPatchImporter* importer_);
+
 	/*!
 	 * Performs learning step.
 	 */
@@ -98,12 +111,6 @@ private:
 	/// Importer responsible for loading testing dataset.
 	mic::data_io::MNISTPatchImporter* test_dataset_importer;
 
-	/// MNIST matrix encoder.
-	mic::encoders::MatrixXfMatrixXfEncoder* mnist_encoder;
-
-	/// Label 2 matrix encoder (1 hot).
-	mic::encoders::UIntMatrixXfEncoder* label_encoder;
-
 	/// Window for displaying the input image.
 	WindowMatrix2D* w2d_input;
 
@@ -125,6 +132,30 @@ private:
 	/// Size of the patch - copied from importers.
 	size_t patch_size;
 
+	/// Batch of encoded patches - bound as the input of the network.
+	mic::types::MatrixXfPtr encoded_batch;
+
+	/// Batch of encoded targets.
+	mic::types::MatrixXfPtr encoded_targets;
+
+	/// Number of application parameters - used for initialization of GLUT.
+	int argc;
+
+	/// Array of application parameters - used for initialization of GLUT.
+	char** argv;
+
+	/// Property: size of the (mini)batch.
+	mic::configuration::Property<size_t> batch_size;
+
+	/// Property: flag denoting whether the application should run without visualization (GLUT/OpenGL), only collecting statistics.
+	mic::configuration::Property<bool> headless;
+
+	/// Property: number of iterations after which the application will quit in headless mode (0 - never).
+	mic::configuration::Property<size_t> headless_iterations;
+
+	/// Property: name of the file to which the statistics will be exported in headless mode.
+	mic::configuration::Property<std::string> statistics_filename;
+
 	/// Data collector.
 	mic::data_io::DataCollectorPtr<std::string, float> collector_ptr;
 
@@ -45,14 +45,15 @@ public:
 	/*!
 	 * \brief Calculates cross entropy(using log)	 and returns cross-entropy error (CE).
 	 */
-	dtype calculateLoss (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_) {
+	dtype calculateLoss (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_, size_t batch_size_) {
 		// Sizes must match.
-		assert(predicted_y_->size() == target_y_->size());
+		assert(predicted_y_->rows() == target_y_->rows());
+		assert(((size_t)predicted_y_->cols() >= batch_size_) && ((size_t)target_y_->cols() >= batch_size_));
 
-		// Calculate loss (negative log probability).
+		// Calculate loss (negative log probability) - the leading columns are stored in the leading elements.
 		dtype loss =0;
 		dtype eps = 1e-15;
-		for (size_t i=0; i <(size_t)predicted_y_->size(); i++) {
+		for (size_t i=0; i < predicted_y_->rows() * batch_size_; i++) {
 			// -t * log (y + eps!)
 			loss -= (*target_y_)[i] * std::log2((*predicted_y_)[i] + eps);
 		}
@@ -65,16 +66,32 @@ public:
 	/*!
 	 * \brief Gradient calculation for cross-entropy.
 	 */
-	mic::types::MatrixPtr<dtype> calculateGradient (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_) {
+	void calculateGradient (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_, mic::types::MatrixPtr<dtype> dy_, size_t batch_size_) {
 		// Sizes must match.
-		assert(predicted_y_->size() == target_y_->size());
+		assert(predicted_y_->rows() == target_y_->rows());
+		assert(predicted_y_->rows() == dy_->rows());
+		assert(((size_t)predicted_y_->cols() >= batch_size_) && ((size_t)target_y_->cols() >= batch_size_) && ((size_t)dy_->cols() >= batch_size_));
 
 		// Calculate gradient.
-		mic::types::MatrixPtr<dtype> dy = MAKE_MATRIX_PTR(dtype, predicted_y_->rows(), predicted_y_->cols());
-		for (size_t i=0; i <(size_t)predicted_y_->size(); i++) {
+		for (size_t i=0; i < predicted_y_->rows() * batch_size_; i++) {
 			// y - t
-			(*dy)[i] = (*predicted_y_)[i] - (*target_y_)[i];
+			(*dy_)[i] = (*predicted_y_)[i] - (*target_y_)[i];
 		}
+	}
+
+	/*!
+	 * \brief Function calculating loss of all samples of the batches.
+	 */
+	dtype calculateLoss (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_) {
+		return calculateLoss(target_y_, predicted_y_, predicted_y_->cols());
+	}
+
+	/*!
+	 * \brief Function calculating gradient of all samples of the batches.
+	 */
+	mic::types::MatrixPtr<dtype> calculateGradient (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_) {
+		mic::types::MatrixPtr<dtype> dy = MAKE_MATRIX_PTR(dtype, predicted_y_->rows(), predicted_y_->cols());
+		calculateGradient(target_y_, predicted_y_, dy, predicted_y_->cols());
 		return dy;
 	}
 
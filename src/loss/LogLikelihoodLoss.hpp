@@ -48,20 +48,21 @@ public:
 	/*!
 	 * \brief Calculates log-likelihood cost.
 	 */
-	dtype calculateLoss (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_) {
+	dtype calculateLoss (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_, size_t batch_size_) {
 		// Sizes must match.
-		assert(predicted_y_->size() == target_y_->size());
+		assert(predicted_y_->rows() == target_y_->rows());
+		assert(((size_t)predicted_y_->cols() >= batch_size_) && ((size_t)target_y_->cols() >= batch_size_));
 
-		size_t ind;
+		typename mic::types::Matrix<dtype>::Index ind;
 		// Calculate loss.
 		dtype loss =0;
 		// For each column (sample from batch).
-		for (size_t i=0; i <(size_t)predicted_y_->cols(); i++) {
+		for (size_t i=0; i < batch_size_; i++) {
 			// Get index of max coefficient in given column.
-			target_y_.col(i).maxCoeff(ind);
+			target_y_->col(i).maxCoeff(&ind);
 
 			// Add loss.
-			loss -= std::log((*predicted_y_)[ind]);
+			loss -= std::log((*predicted_y_)(ind, i));
 		}//: for
 		// Return sum of log-likelihood cost.
 		return loss;
@@ -71,15 +72,30 @@ public:
 	/*!
 	 * \brief Gradient calculation for log-likelihood cost. NOT FINISHED!!
 	 */
-	mic::types::MatrixPtr<dtype> calculateGradient (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_) {
+	void calculateGradient (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_, mic::types::MatrixPtr<dtype> dy_, size_t batch_size_) {
 		// Sizes must match.
-		assert(predicted_y_->size() == target_y_->size());
+		assert(predicted_y_->rows() == target_y_->rows());
+		assert(predicted_y_->rows() == dy_->rows());
 
 		// Calculate gradient.
-		mic::types::MatrixPtr<dtype> dy = MAKE_MATRIX_PTR(dtype, predicted_y_->rows(), predicted_y_->cols());
-		for (size_t i=0; i <(size_t)predicted_y_->size(); i++) {
-			(*dy)[i] = 0.0;
+		for (size_t i=0; i < predicted_y_->rows() * batch_size_; i++) {
+			(*dy_)[i] = 0.0;
 		}
+	}
+
+	/*!
+	 * \brief Function calculating loss of all samples of the batches.
+	 */
+	dtype calculateLoss (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_) {
+		return calculateLoss(target_y_, predicted_y_, predicted_y_->cols());
+	}
+
+	/*!
+	 * \brief Function calculating gradient of all samples of the batches.
+	 */
+	mic::types::MatrixPtr<dtype> calculateGradient (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_) {
+		mic::types::MatrixPtr<dtype> dy = MAKE_MATRIX_PTR(dtype, predicted_y_->rows(), predicted_y_->cols());
+		calculateGradient(target_y_, predicted_y_, dy, predicted_y_->cols());
 		return dy;
 	}
 
@@ -45,6 +45,18 @@ public:
 	 */
 	virtual dtype calculateLoss (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_) = 0;
 
+	/*!
+	 * \brief Function calculating loss of the leading columns (samples) of the batches.
+	 * The batches might be buffers of a bigger capacity (e.g. outputs of the network processing a smaller batch).
+	 * By default copies the leading columns of such buffers and calls the abstract method - loss functions should override it, computing the loss in place.
+	 * @param target_y_ Targets [label_size x (at least) batch_size_].
+	 * @param predicted_y_ Predictions [label_size x (at least) batch_size_].
+	 * @param batch_size_ Number of samples.
+	 */
+	virtual dtype calculateLoss (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_, size_t batch_size_) {
+		return calculateLoss(leadingColumns(target_y_, batch_size_), leadingColumns(predicted_y_, batch_size_));
+	}
+
 	/*!
 	 * \brief Calculates mean loss (i.e. divides the loss by the size of batch) - ACE for cross-entropy or MSE for regression.
 	 */
@@ -52,11 +64,44 @@ public:
 		return calculateLoss(target_y_, predicted_y_) / predicted_y_->cols();
 	}
 
+	/*!
+	 * \brief Calculates mean loss of the leading columns (samples) of the batches.
+	 */
+	virtual dtype calculateMeanLoss (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_, size_t batch_size_) {
+		return calculateLoss(target_y_, predicted_y_, batch_size_) / batch_size_;
+	}
+
 	/*!
 	 * \brief Function calculating gradient - abstract.
 	 */
 	virtual mic::types::MatrixPtr<dtype> calculateGradient (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_) = 0;
 
+	/*!
+	 * \brief Function calculating gradient of the leading columns (samples) of the batches.
+	 * By default copies the leading columns of buffers of a bigger capacity and calls the abstract method - loss functions should override it, computing the gradient in place.
+	 * @param target_y_ Targets [label_size x (at least) batch_size_].
+	 * @param predicted_y_ Predictions [label_size x (at least) batch_size_].
+	 * @param dy_ Gradient [label_size x (at least) batch_size_] - only its leading columns are overwritten.
+	 * @param batch_size_ Number of samples.
+	 */
+	virtual void calculateGradient (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_, mic::types::MatrixPtr<dtype> dy_, size_t batch_size_) {
+		dy_->leftCols(batch_size_) = (*calculateGradient(leadingColumns(target_y_, batch_size_), leadingColumns(predicted_y_, batch_size_)));
+	}
+
+protected:
+	/*!
+	 * Returns a given batch if it has a given number of columns, otherwise a copy of its leading columns.
+	 * @param batch_ Pointer to the batch.
+	 * @param batch_size_ Number of columns.
+	 */
+	static mic::types::MatrixPtr<dtype> leadingColumns(mic::types::MatrixPtr<dtype> batch_, size_t batch_size_) {
+		if ((size_t)batch_->cols() == batch_size_)
+			return batch_;
+		mic::types::MatrixPtr<dtype> columns = MAKE_MATRIX_PTR(dtype, batch_->rows(), batch_size_);
+		(*columns) = batch_->leftCols(batch_size_);
+		return columns;
+	}
+
 };
 
 } //: loss
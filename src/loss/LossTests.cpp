@@ -254,6 +254,60 @@ TEST_F(Vectors3x2Float, CrossEntropyGradient) {
 }
 
 
+/*!
+ * \brief Loss function implementing only the abstract methods (e.g. defined outside of the library) - absolute error.
+ */
+class AbsoluteErrorLoss : public mic::neural_nets::loss::Loss<float> {
+public:
+	float calculateLoss (mic::types::MatrixPtr<float> target_y_, mic::types::MatrixPtr<float> predicted_y_) {
+		return ((*predicted_y_) - (*target_y_)).cwiseAbs().sum();
+	}
+
+	mic::types::MatrixPtr<float> calculateGradient (mic::types::MatrixPtr<float> target_y_, mic::types::MatrixPtr<float> predicted_y_) {
+		mic::types::MatrixPtr<float> dy = MAKE_MATRIX_PTR(float, predicted_y_->rows(), predicted_y_->cols());
+		for (size_t i=0; i < (size_t)dy->size(); i++)
+			(*dy)[i] = ((*predicted_y_)[i] > (*target_y_)[i]) ? 1.0f : -1.0f;
+		return dy;
+	}
+
+	// Unhide the overloaded methods inherited from the template class Loss via "using" statement.
+	using mic::neural_nets::loss::Loss<float>::calculateLoss;
+	using mic::neural_nets::loss::Loss<float>::calculateGradient;
+};
+
+/*!
+ * Tests whether the losses and gradients of the leading column (sample) of the batches are the same as the ones of a batch consisting of that column only - also for loss functions implementing only the abstract methods.
+ */
+TEST_F(Vectors3x2Float, LeadingColumns) {
+	mic::neural_nets::loss::SquaredErrorLoss<float> se_loss;
+	mic::neural_nets::loss::CrossEntropyLoss<float> ce_loss;
+	AbsoluteErrorLoss ae_loss;
+	mic::neural_nets::loss::Loss<float>* losses[] = { &se_loss, &ce_loss, &ae_loss };
+	float eps = 1e-5;
+
+	// Batches consisting of the first columns only.
+	mic::types::MatrixPtr<float> target_col = MAKE_MATRIX_PTR(float, 3, 1);
+	mic::types::MatrixPtr<float> predicted_col = MAKE_MATRIX_PTR(float, 3, 1);
+	(*target_col) = target_y->leftCols(1);
+	(*predicted_col) = predicted_y->leftCols(1);
+
+	for (auto loss : losses) {
+		EXPECT_LE(fabs(loss->calculateLoss(target_y, predicted_y, 1) - loss->calculateLoss(target_col, predicted_col)), eps);
+		EXPECT_LE(fabs(loss->calculateMeanLoss(target_y, predicted_y, 1) - loss->calculateMeanLoss(target_col, predicted_col)), eps);
+
+		// Only the leading column of the gradient is overwritten.
+		mic::types::MatrixPtr<float> dy = MAKE_MATRIX_PTR(float, 3, 2);
+		dy->setConstant(7.0);
+		loss->calculateGradient(target_y, predicted_y, dy, 1);
+		mic::types::MatrixPtr<float> dy_col = loss->calculateGradient(target_col, predicted_col);
+		for (size_t i=0; i<3; i++) {
+			EXPECT_LE(fabs((*dy)(i,0) - (*dy_col)(i,0)), eps) << "Gradient error at position (" << i << ",0)";
+			EXPECT_EQ((*dy)(i,1), 7.0);
+		}//: for
+	}//: for
+}
+
+
 
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
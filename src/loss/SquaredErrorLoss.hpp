@@ -43,13 +43,14 @@ public:
 	/*!
 	 * \brief Function calculates squared difference loss (regression) and returns squared error (SE).
 	 */
-	dtype calculateLoss (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_) {
+	dtype calculateLoss (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_, size_t batch_size_) {
 		// Sizes must match.
-		assert(predicted_y_->size() == target_y_->size());
+		assert(predicted_y_->rows() == target_y_->rows());
+		assert(((size_t)predicted_y_->cols() >= batch_size_) && ((size_t)target_y_->cols() >= batch_size_));
 
-		// Calculate loss.
+		// Calculate loss - the leading columns are stored in the leading elements.
 		dtype loss =0;
-		for (size_t i=0; i <(size_t)predicted_y_->size(); i++) {
+		for (size_t i=0; i < predicted_y_->rows() * batch_size_; i++) {
 			loss += ((*target_y_)[i] - (*predicted_y_)[i])*((*target_y_)[i] - (*predicted_y_)[i]);
 		}
 		// Return squared error (SE).
@@ -60,20 +61,35 @@ public:
 	/*!
 	 * \brief Function calculating gradient - for squared difference (regression).
 	 */
-	mic::types::MatrixPtr<dtype> calculateGradient (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_) {
+	void calculateGradient (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_, mic::types::MatrixPtr<dtype> dy_, size_t batch_size_) {
 		// Sizes must match.
-		assert(predicted_y_->size() == target_y_->size());
+		assert(predicted_y_->rows() == target_y_->rows());
+		assert(predicted_y_->rows() == dy_->rows());
+		assert(((size_t)predicted_y_->cols() >= batch_size_) && ((size_t)target_y_->cols() >= batch_size_) && ((size_t)dy_->cols() >= batch_size_));
 
 		// Calculate gradient.
-		mic::types::MatrixPtr<dtype> dy = MAKE_MATRIX_PTR(dtype, predicted_y_->rows(), predicted_y_->cols());
-		for (size_t i=0; i <(size_t)predicted_y_->size(); i++) {
-			(*dy)[i] = -((*target_y_)[i] - (*predicted_y_)[i]);
+		for (size_t i=0; i < predicted_y_->rows() * batch_size_; i++) {
+			(*dy_)[i] = -((*target_y_)[i] - (*predicted_y_)[i]);
 		}
 
 		/*std::cout << " predicted_y_ = " << (*predicted_y_) << std::endl;
 		std::cout << " target_y_ = " << (*target_y_) << std::endl;
-		std::cout << " dy = (p-t) = " << (*dy) << std::endl;*/
+		std::cout << " dy = (p-t) = " << (*dy_) << std::endl;*/
+	}
 
+	/*!
+	 * \brief Function calculating loss of all samples of the batches.
+	 */
+	dtype calculateLoss (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_) {
+		return calculateLoss(target_y_, predicted_y_, predicted_y_->cols());
+	}
+
+	/*!
+	 * \brief Function calculating gradient of all samples of the batches.
+	 */
+	mic::types::MatrixPtr<dtype> calculateGradient (mic::types::MatrixPtr<dtype> target_y_, mic::types::MatrixPtr<dtype> predicted_y_) {
+		mic::types::MatrixPtr<dtype> dy = MAKE_MATRIX_PTR(dtype, predicted_y_->rows(), predicted_y_->cols());
+		calculateGradient(target_y_, predicted_y_, dy, predicted_y_->cols());
 		return dy;
 	}
 
@@ -27,6 +27,11 @@
 
 #include <mlnn/MultiLayerNeuralNetwork.hpp>
 
+#include <cmath>
+#include <map>
+#include <set>
+#include <typeinfo>
+
 namespace mic {
 namespace mlnn {
 
@@ -44,7 +49,12 @@ public:
 	 * Constructor. Sets the neural network name.
 	 * @param name_ Name of the network.
 	 */
-	BackpropagationNeuralNetwork(std::string name_ = "bp_net") : MultiLayerNeuralNetwork<eT> (name_)
+	BackpropagationNeuralNetwork(std::string name_ = "bp_net") : MultiLayerNeuralNetwork<eT> (name_),
+		fusion_enabled(false),
+		checkpointing_enabled(false),
+		checkpoint_interval(0),
+		dropout_skipped(false),
+		accumulated_samples(0)
 	{
 		// Set default cross entropy loss function.
 		setLoss <mic::neural_nets::loss::CrossEntropyLoss<eT> >();
@@ -68,57 +78,44 @@ public:
 	}
 
 
+	/*!
+	 * Enables (or disables) the fusion of Linear layers followed by activation layers (ELU/ReLU/Sigmoid), optionally followed by Dropout.
+	 * Each fused group is executed as a single layer: bias and activation are applied in one pass over W*x, written directly to the output of the activation (and dropout) layer,
+	 * whereas the activation derivative is applied to the gradient right before computing dW, db and dx of the linear layer.
+	 * Note: the outputs (s['y']) of fused linear layers are not computed (see outputStored()).
+	 * @param fuse_ Fusion flag (DEFAULT=true).
+	 */
+	void fuseLayers(bool fuse_ = true) {
+		fusion_enabled = fuse_;
+		// Groups will be found during the next (re)connection of the layers.
+		connected = false;
+	}
+
+	/*!
+	 * Enables (or disables) checkpointing of activations during training.
+	 * Layers are divided into segments (fused groups are never split) and only the outputs of the last layers of segments (checkpoints) and of the layers of the last segment are stored,
+	 * whereas the outputs inside the remaining segments are kept in a pool of buffers shared by the segments and recomputed from the preceding checkpoint, segment by segment, during the backward pass.
+	 * The pool holds (at the capacity of the batch) the outputs of the largest segment - buffers are shared by the outputs of the same size, so stacks of similar layers benefit the most.
+	 * The dropout masks are replayed, so the recomputed activations are identical to the original ones.
+	 * Note: the pooled outputs are overwritten by the other segments, so they cannot be read after the forward/backward pass (see outputStored()) - this concerns also their activations and snapshots.
+	 * @param checkpoint_ Checkpointing flag (DEFAULT=true).
+	 * @param interval_ Number of layers in a segment (DEFAULT=0 - square root of the number of layers, i.e. O(sqrt(depth)) of activations are stored).
+	 */
+	void enableCheckpointing(bool checkpoint_ = true, size_t interval_ = 0) {
+		checkpointing_enabled = checkpoint_;
+		checkpoint_interval = interval_;
+		// Segments will be found during the next (re)connection of the layers.
+		connected = false;
+	}
+
 	/*!
 	 * Passes the data in a feed-forward manner through all consecutive layers, from the input to the output layer.
+	 * Data are copied to the input of the first layer, unless input_data was previously bound with bindInput().
 	 * @param input_data Input data - a matrix containing [sample_size x batch_size].
 	 * @param skip_dropout Flag for skipping dropouts - which should be set to true during testing.
 	 */
 	void forward(mic::types::MatrixPtr<eT> input_data, bool skip_dropout = false)  {
-		// Make sure that there are some layers in the nn!
-		assert(layers.size() != 0);
-
-		// Boost::Matrix is col major!
-		LOG(LDEBUG) << "Inputs size: " << input_data->rows() << "x" << input_data->cols();
-		LOG(LDEBUG) << "First layer input matrix size: " <<  layers[0]->s['x']->rows() << "x" << layers[0]->s['x']->cols();
-
-		// Make sure that the dimensions are ok.
-		// Check only rows, as cols determine the batch size - and we allow them to be dynamically changing!.
-		assert((layers[0]->s['x'])->rows() == input_data->rows());
-		//LOG(LDEBUG) <<" input_data: " << input_data.transpose();
-
-		// Connect layers by setting the input matrices pointers to point the output matrices.
-		// There will not need to be copy data between layers anymore.
-		if (!connected) {
-			// Verify structure of the network.
-			verify();
-			// Set pointers - pass result to the next layer: x(next layer) = y(current layer).
-			if (layers.size() > 1)
-				for (size_t i = 0; i < layers.size()-1; i++) {
-					// Connect pointers.
-					layers[i+1]->s['x'] = layers[i]->s['y'];
-					layers[i]->g['y'] = layers[i+1]->g['x'];
-				}//: for
-			connected = true;
-		}
-
-		//assert((layers[0]->s['x'])->cols() == input_data->cols());
-		// Change the size of batch - if required.
-		resizeBatch(input_data->cols());
-
-		// Copy inputs to the lowest point in the network.
-		(*(layers[0]->s['x'])) = (*input_data);
-
-		// Compute the forward activations.
-		for (size_t i = 0; i < layers.size(); i++) {
-			LOG(LDEBUG) << "Layer [" << i << "] " << layers[i]->name() << ": (" <<
-					layers[i]->inputSize() << "x" << layers[i]->batchSize() << ") -> (" <<
-					layers[i]->outputSize() << "x" << layers[i]->batchSize() << ")";
-
-			// Perform the forward computation: y = f(x).
-			layers[i]->forward(skip_dropout);
-
-		}
-		//LOG(LDEBUG) <<" predictions: " << getPredictions()->transpose();
+		forwardBatch(input_data, input_data->cols(), skip_dropout);
 	}
 
 
@@ -166,17 +163,14 @@ public:
 		LOG(LDEBUG) << "Passed target matrix size: " <<  gradients_->cols() << "x" << gradients_->rows();
 
 		// Make sure that the dimensions are ok.
-		assert((layers.back()->g['y'])->cols() == gradients_->cols());
+		assert(layers.back()->batchSize() == (size_t)gradients_->cols());
 		assert((layers.back()->g['y'])->rows() == gradients_->rows());
 
 		// Set gradient of the last layer - COPY data.
-		(*(layers.back()->g['y'])) = (*gradients_);
+		layers.back()->g['y']->leftCols(gradients_->cols()) = (*gradients_);
 
 		// Back-propagate the gradients.
-		for (int i = layers.size() - 1; i >= 0; i--) {
-			layers[i]->backward();
-		}//: for
-
+		propagateGradients();
 	}
 
 
@@ -193,20 +187,21 @@ public:
 		// Forward propagate the activations from first layer to the last.
 		forward(encoded_batch_);
 
-		// Get predictions.
-		mic::types::MatrixPtr<eT> encoded_predictions = getPredictions();
+		// Get predictions - the leading columns of the outputs of the last layer, which might hold more columns than the batch.
+		mic::types::MatrixPtr<eT> encoded_predictions = layers.back()->s['y'];
+		size_t batch_size = layers.back()->batchSize();
 
-		// Calculate gradient according to the loss function.
-		mic::types::MatrixPtr<eT> dy = loss->calculateGradient(encoded_targets_, encoded_predictions);
+		// Calculate gradient according to the loss function - directly in the output gradient of the last layer.
+		loss->calculateGradient(encoded_targets_, encoded_predictions, layers.back()->g['y'], batch_size);
 
 		// Backpropagate the gradients from last layer to the first.
-		backward(dy);
+		propagateGradients();
 
 		// Apply the changes - according to the optimization function.
 		update(learning_rate_, decay_);
 
 		// Calculate mean value of the loss function (i.e. loss divided by the batch size).
-		eT loss_value = loss->calculateMeanLoss(encoded_targets_, encoded_predictions);
+		eT loss_value = loss->calculateMeanLoss(encoded_targets_, encoded_predictions, batch_size);
 
 		// Return loss.
 		return loss_value;
@@ -225,11 +220,23 @@ public:
 
 		forward(encoded_batch_, skip_dropout);
 
-		// Get predictions.
-		mic::types::MatrixPtr<eT> encoded_predictions = getPredictions();
+		// Calculate the mean loss - of the leading columns of the outputs of the last layer.
+		return loss->calculateMeanLoss(encoded_targets_, layers.back()->s['y'], layers.back()->batchSize());
+	}
+
+
+	/*!
+	 * Tests the neural network with the leading columns of a given batch - so the batches can be assembled in reused buffers of a bigger capacity.
+	 * @param encoded_batch_ Batch encoded in the form of matrix of size [sample_size x capacity] (might be bound as the input with bindInput()).
+	 * @param encoded_targets_ Targets (labels) encoded in the form of matrix of size [label_size x capacity].
+	 * @param batch_size_ Number of leading columns forming the batch.
+	 * @return Mean loss of the batch.
+	 */
+	eT test(mic::types::MatrixPtr<eT> encoded_batch_, mic::types::MatrixPtr<eT> encoded_targets_, size_t batch_size_) {
+		forwardBatch(encoded_batch_, batch_size_, true);
 
-		// Calculate the mean loss.
-		return loss->calculateMeanLoss(encoded_targets_, encoded_predictions);
+		// Calculate the mean loss - of the leading columns of the outputs of the last layer.
+		return loss->calculateMeanLoss(encoded_targets_, layers.back()->s['y'], batch_size_);
 	}
 
 
@@ -244,6 +251,110 @@ public:
 		return loss->calculateMeanLoss(encoded_targets_, encoded_predictions_);
 	}
 
+
+	/*!
+	 * Propagates a (micro-)batch forward and backward and adds the resulting gradients of parameters to the accumulated ones - parameters are not updated.
+	 * The gradients are summed over samples, so the accumulated gradients correspond to one big batch consisting of all the accumulated micro-batches.
+	 * @param encoded_batch_ Batch encoded in the form of matrix of size [sample_size x batch_size].
+	 * @param encoded_targets_ Targets (labels) encoded in the form of matrix of size [label_size x batch_size].
+	 * @return Mean loss of the micro-batch.
+	 */
+	eT accumulateGradients(mic::types::MatrixPtr<eT> encoded_batch_, mic::types::MatrixPtr<eT> encoded_targets_) {
+		return accumulateBatch(encoded_batch_, encoded_targets_, encoded_batch_->cols());
+	}
+
+
+	/*!
+	 * Updates the parameters with the accumulated gradients, normalized by the total number of accumulated samples, and resets the accumulation.
+	 * @param learning_rate_ The learning rate.
+	 * @param decay_ Weight decay rate (determining that the "unused/unupdated" weights will decay to 0) (DEFAULT=0.0 - no decay).
+	 */
+	void applyAccumulatedGradients(eT learning_rate_, eT decay_ = 0.0f) {
+		if (accumulated_samples == 0)
+			return;
+
+		// Pass the accumulated gradients to the layers.
+		std::vector<mic::types::MatrixPtr<eT> > grads = MultiLayerNeuralNetwork<eT>::getParameterGradients();
+		assert(grads.size() == accumulated_gradients.size());
+		for (size_t i = 0; i < grads.size(); i++)
+			(*grads[i]) = (*accumulated_gradients[i]);
+
+		// The gradients are cumulated for all samples, reduce the alpha rate.
+		eT alpha_samples = learning_rate_ / accumulated_samples;
+		for (size_t i = 0; i < layers.size(); i++)
+			layers[i]->update(alpha_samples, decay_);
+
+		resetAccumulatedGradients();
+	}
+
+
+	/*!
+	 * Resets the accumulated gradients (and the number of accumulated samples).
+	 */
+	void resetAccumulatedGradients() {
+		for (size_t i = 0; i < accumulated_gradients.size(); i++)
+			accumulated_gradients[i]->setZero();
+		accumulated_samples = 0;
+	}
+
+
+	/// Returns the number of samples whose gradients were accumulated since the last update.
+	size_t accumulatedSamples() {
+		return accumulated_samples;
+	}
+
+
+	/*!
+	 * Trains the neural network with a given batch, processed in micro-batches - so the memory required by the activations is limited by the size of a micro-batch.
+	 * The result (up to the rounding errors) is the same as in the case of training with the whole batch at once.
+	 * @param encoded_batch_ Batch encoded in the form of matrix of size [sample_size x batch_size].
+	 * @param encoded_targets_ Targets (labels) encoded in the form of matrix of size [label_size x batch_size].
+	 * @param micro_batch_size_ Maximal size of the micro-batch.
+	 * @param learning_rate_ The learning rate.
+	 * @param decay_ Weight decay rate (determining that the "unused/unupdated" weights will decay to 0) (DEFAULT=0.0 - no decay).
+	 * @return Mean loss of the whole batch.
+	 */
+	eT trainAccumulated(mic::types::MatrixPtr<eT> encoded_batch_, mic::types::MatrixPtr<eT> encoded_targets_, size_t micro_batch_size_, eT learning_rate_, eT decay_ = 0.0f) {
+		assert(micro_batch_size_ > 0);
+		assert(encoded_batch_->cols() == encoded_targets_->cols());
+		size_t samples = encoded_batch_->cols();
+
+		// Buffers for the micro-batches - enlarged (if required) once, the (smaller) last micro-batch uses their leading columns.
+		if (!micro_batch || (micro_batch->rows() != encoded_batch_->rows()))
+			micro_batch = MAKE_MATRIX_PTR(eT, encoded_batch_->rows(), micro_batch_size_);
+		if (!micro_targets || (micro_targets->rows() != encoded_targets_->rows()))
+			micro_targets = MAKE_MATRIX_PTR(eT, encoded_targets_->rows(), micro_batch_size_);
+		Layer<eT>::reserveColumns(micro_batch, micro_batch_size_);
+		Layer<eT>::reserveColumns(micro_targets, micro_batch_size_);
+
+		eT loss_sum = 0;
+		for (size_t first = 0; first < samples; first += micro_batch_size_) {
+			size_t size = std::min(micro_batch_size_, samples - first);
+			micro_batch->leftCols(size) = encoded_batch_->middleCols(first, size);
+			micro_targets->leftCols(size) = encoded_targets_->middleCols(first, size);
+			loss_sum += accumulateBatch(micro_batch, micro_targets, size) * size;
+		}//: for
+
+		applyAccumulatedGradients(learning_rate_, decay_);
+
+		return loss_sum / samples;
+	}
+
+	/*!
+	 * Returns true if the output of a given layer is stored after the forward/backward pass, i.e. it is neither the (not computed) output of a fused linear layer nor kept in the pool shared by the checkpointed segments.
+	 * @param index_ Index of the layer.
+	 */
+	virtual bool outputStored(size_t index_) {
+		assert(index_ < layers.size());
+		if (fusion_enabled && (index_ < fused_heads.size()) && (fused_heads[index_] == (int)index_))
+			return false;
+		for (auto& buffers: activation_pool)
+			for (auto& buffer: buffers.second)
+				if (buffer == layers[index_]->s['y'])
+					return false;
+		return true;
+	}
+
 	// Unhide the overloaded public methods & fields inherited from the template class MultiLayerNeuralNetwork fields via "using" statement.
 	using MultiLayerNeuralNetwork<eT>::getPredictions;
 	using MultiLayerNeuralNetwork<eT>::update;
@@ -254,12 +365,451 @@ protected:
 	// Unhide the overloaded protected methods & fields inherited from the template class MultiLayerNeuralNetwork fields via "using" statement.
 	using MultiLayerNeuralNetwork<eT>::layers;
 	using MultiLayerNeuralNetwork<eT>::connected;
+	using MultiLayerNeuralNetwork<eT>::setInputs;
+
+	/*!
+	 * Connects the layers by setting the input matrices pointers to point the output matrices (and the output gradients to point the input gradients) of the neighboring layers.
+	 * Finds also the fused groups of layers and the checkpoints.
+	 * @return True if the verification of the network succeeded.
+	 */
+	virtual bool connectLayers() {
+		// Verify structure of the network.
+		bool ok = verify();
+		// The outputs pooled during the previous connection must not be shared anymore.
+		separateOutputs();
+		// Set pointers - pass result to the next layer: x(next layer) = y(current layer).
+		if (layers.size() > 1)
+			for (size_t i = 0; i < layers.size()-1; i++) {
+				// Connect pointers.
+				layers[i+1]->s['x'] = layers[i]->s['y'];
+				layers[i]->g['y'] = layers[i+1]->g['x'];
+			}//: for
+		// Find groups of layers that will be executed as one.
+		findFusedLayers();
+		// Find the segments of layers separated by the checkpoints and share the buffers of outputs inside them.
+		findCheckpoints();
+		poolActivations();
+		connected = true;
+		return ok;
+	}
+
+	/*!
+	 * Passes the leading columns of the data in a feed-forward manner through all consecutive layers - so the (micro-)batches can be stored in reused buffers of a bigger capacity.
+	 * @param input_data Input data - a matrix containing [sample_size x capacity].
+	 * @param batch_size_ Number of leading columns forming the batch.
+	 * @param skip_dropout Flag for skipping dropouts.
+	 */
+	void forwardBatch(mic::types::MatrixPtr<eT> input_data, size_t batch_size_, bool skip_dropout)  {
+		// Make sure that there are some layers in the nn!
+		assert(layers.size() != 0);
+
+		// Boost::Matrix is col major!
+		LOG(LDEBUG) << "Inputs size: " << input_data->rows() << "x" << input_data->cols();
+		LOG(LDEBUG) << "First layer input matrix size: " <<  layers[0]->s['x']->rows() << "x" << layers[0]->s['x']->cols();
+
+		// Make sure that the dimensions are ok.
+		// Check only rows, as cols determine the batch size - and we allow them to be dynamically changing!.
+		assert((layers[0]->s['x'])->rows() == input_data->rows());
+		//LOG(LDEBUG) <<" input_data: " << input_data.transpose();
+
+		// Connect layers by setting the input matrices pointers to point the output matrices.
+		// There will not need to be copy data between layers anymore.
+		if (!connected)
+			connectLayers();
+
+		//assert((layers[0]->s['x'])->cols() == input_data->cols());
+		// Pass inputs to the lowest point in the network - copy is skipped if input_data was bound with bindInput().
+		setInputs(input_data, batch_size_);
+
+		// Compute the forward activations - the pooled outputs inside the checkpointed segments are overwritten by the consecutive segments.
+		forwardLayers(0, layers.size(), skip_dropout);
+		dropout_skipped = skip_dropout;
+		//LOG(LDEBUG) <<" predictions: " << getPredictions()->transpose();
+	}
+
+	/*!
+	 * Back-propagates the gradient set in the (leading columns of the) output gradient of the last layer, from the last layer to the first.
+	 */
+	void propagateGradients() {
+		if (segment_heads.size() < 2) {
+			backwardLayers(0, layers.size());
+			return;
+		}//: if
+
+		// Segment by segment - recompute the pooled activations from the preceding checkpoint, replaying the dropout masks.
+		for (int k = segment_heads.size() - 1; k >= 0; k--) {
+			size_t first = segment_heads[k];
+			size_t last = segmentEnd(k);
+			if ((size_t)k + 1 < segment_heads.size()) {
+				size_t end = recomputationEnd(k);
+				if (!dropout_skipped)
+					replayDropoutMasks(first, end, true);
+				forwardLayers(first, end, dropout_skipped);
+				if (!dropout_skipped)
+					replayDropoutMasks(first, end, false);
+			}//: if
+			backwardLayers(first, last);
+		}//: for
+	}
+
+	/*!
+	 * Propagates the leading columns of a (micro-)batch forward and backward and adds the resulting gradients of parameters to the accumulated ones.
+	 * @param encoded_batch_ Batch encoded in the form of matrix of size [sample_size x capacity].
+	 * @param encoded_targets_ Targets (labels) encoded in the form of matrix of size [label_size x capacity].
+	 * @param batch_size_ Number of leading columns forming the batch.
+	 * @return Mean loss of the batch.
+	 */
+	eT accumulateBatch(mic::types::MatrixPtr<eT> encoded_batch_, mic::types::MatrixPtr<eT> encoded_targets_, size_t batch_size_) {
+		// Forward and backward pass - layers overwrite their gradients.
+		forwardBatch(encoded_batch_, batch_size_, false);
+		mic::types::MatrixPtr<eT> encoded_predictions = layers.back()->s['y'];
+		loss->calculateGradient(encoded_targets_, encoded_predictions, layers.back()->g['y'], batch_size_);
+		propagateGradients();
+
+		// Add the gradients to the accumulated ones - allocated during the first call.
+		std::vector<mic::types::MatrixPtr<eT> > grads = MultiLayerNeuralNetwork<eT>::getParameterGradients();
+		if (accumulated_gradients.size() != grads.size()) {
+			accumulated_gradients.clear();
+			for (size_t i = 0; i < grads.size(); i++)
+				accumulated_gradients.push_back(MAKE_MATRIX_PTR(eT, grads[i]->rows(), grads[i]->cols()));
+			resetAccumulatedGradients();
+		}//: if
+		for (size_t i = 0; i < grads.size(); i++)
+			(*accumulated_gradients[i]) += (*grads[i]);
+		accumulated_samples += batch_size_;
+
+		return loss->calculateMeanLoss(encoded_targets_, encoded_predictions, batch_size_);
+	}
+
+	/*!
+	 * Performs the forward (skipping the dropouts) and backward passes of a batch, so all buffers allocated on demand are created - used during the compilation.
+	 * @param batch_ Batch of the maximal size.
+	 */
+	virtual void warmUp(mic::types::MatrixPtr<eT> batch_) {
+		forward(batch_, true);
+		mic::types::MatrixPtr<eT> gradients = MAKE_MATRIX_PTR(eT, layers.back()->outputSize(), batch_->cols());
+		gradients->setZero();
+		backward(gradients);
+	}
 
 	/*!
 	 * Pointer to loss function.
 	 */
 	std::shared_ptr<mic::neural_nets::loss::Loss<eT> > loss;
 
+	/// Flag denoting whether the Linear+activation(+Dropout) groups of layers should be fused.
+	bool fusion_enabled;
+
+	/// Vector storing for each layer the index of the first layer of its fused group (or -1 if the layer is not fused).
+	std::vector<int> fused_heads;
+
+	/// Flag denoting whether the activations should be checkpointed.
+	bool checkpointing_enabled;
+
+	/// Number of layers in a segment (0 - square root of the number of layers).
+	size_t checkpoint_interval;
+
+	/// Indices of the first layers of segments (empty if checkpointing is disabled).
+	std::vector<size_t> segment_heads;
+
+	/// Buffers of the outputs inside the checkpointed segments (all but the last one), shared by the segments - grouped by the number of rows.
+	std::map<size_t, std::vector<mic::types::MatrixPtr<eT> > > activation_pool;
+
+	/// Flag denoting whether the dropouts were skipped during the last forward pass - the segments are recomputed in the same way.
+	bool dropout_skipped;
+
+	/// Gradients of parameters accumulated over micro-batches - in the same order as getParameterGradients().
+	std::vector<mic::types::MatrixPtr<eT> > accumulated_gradients;
+
+	/// Number of samples whose gradients were accumulated.
+	size_t accumulated_samples;
+
+	/// Buffer for the micro-batches used by trainAccumulated().
+	mic::types::MatrixPtr<eT> micro_batch;
+
+	/// Buffer for the targets of micro-batches used by trainAccumulated().
+	mic::types::MatrixPtr<eT> micro_targets;
+
+	/*!
+	 * Finds groups of layers that can be fused: Linear followed by ELU, ReLU or Sigmoid, optionally followed by Dropout.
+	 */
+	void findFusedLayers() {
+		fused_heads.assign(layers.size(), -1);
+		if (!fusion_enabled)
+			return;
+
+		for (size_t i = 0; i+1 < layers.size(); i++) {
+			// Only "pure" linear layers (derived layers differ in behaviour, besides Linear does not report its own type).
+			if (typeid(*layers[i]) != typeid(Linear<eT>))
+				continue;
+			LayerTypes lt = layers[i+1]->layer_type;
+			if ((lt != LayerTypes::ELU) && (lt != LayerTypes::ReLU) && (lt != LayerTypes::Sigmoid))
+				continue;
+
+			// Group linear and activation - plus the dropout, if present.
+			size_t length = 2;
+			if ((i+2 < layers.size()) && (layers[i+2]->layer_type == LayerTypes::Dropout))
+				length = 3;
+			for (size_t j = i; j < i + length; j++)
+				fused_heads[j] = i;
+			LOG(LDEBUG) << "Fused layers [" << i << ".." << i + length - 1 << "]";
+
+			i += length - 1;
+		}//: for
+	}
+
+	/*!
+	 * Finds the segments of layers separated by the checkpoints - the segment boundaries are moved, so the fused groups are not split.
+	 */
+	void findCheckpoints() {
+		segment_heads.clear();
+		if (!checkpointing_enabled)
+			return;
+
+		size_t interval = checkpoint_interval ? checkpoint_interval : (size_t)std::ceil(std::sqrt((double)layers.size()));
+		for (size_t head = 0; head < layers.size(); ) {
+			segment_heads.push_back(head);
+			head = std::min(head + interval, layers.size());
+			while ((head < layers.size()) && (fused_heads[head] >= 0) && (fused_heads[head] != (int)head))
+				head++;
+		}//: for
+		LOG(LDEBUG) << "Found " << segment_heads.size() << " checkpointed segments";
+	}
+
+	/*!
+	 * Gives own buffers to the outputs shared by several layers (i.e. pooled during the previous connection of the layers) - so they can be (re)connected and pooled again.
+	 */
+	void separateOutputs() {
+		activation_pool.clear();
+		std::set<mic::types::Matrix<eT>*> owned;
+		for (size_t i = 0; i < layers.size(); i++) {
+			mic::types::MatrixPtr<eT> y = layers[i]->s['y'];
+			if (!owned.insert(y.get()).second)
+				layers[i]->s['y'] = MAKE_MATRIX_PTR(eT, y->rows(), y->cols());
+		}//: for
+	}
+
+	/*!
+	 * Shares the buffers of the outputs inside the checkpointed segments (the outputs of the last layers of segments and of the last segment are not shared).
+	 * The i-th output of a given size inside a segment reuses the i-th pooled buffer of that size, enlarged to the biggest capacity - the remaining buffers are released.
+	 */
+	void poolActivations() {
+		for (size_t k = 0; k + 1 < segment_heads.size(); k++) {
+			std::map<size_t, size_t> used;
+			for (size_t i = segment_heads[k]; i + 1 < segmentEnd(k); i++) {
+				mic::types::MatrixPtr<eT> y = layers[i]->s['y'];
+				std::vector<mic::types::MatrixPtr<eT> > & buffers = activation_pool[y->rows()];
+				size_t index = used[y->rows()]++;
+				if (index == buffers.size()) {
+					buffers.push_back(y);
+					continue;
+				}//: if
+				Layer<eT>::reserveColumns(buffers[index], y->cols());
+				layers[i]->s['y'] = buffers[index];
+				layers[i+1]->s['x'] = buffers[index];
+			}//: for
+		}//: for
+		LOG(LDEBUG) << "Pooled activations of " << activation_pool.size() << " sizes";
+	}
+
+	/*!
+	 * Returns the index of the layer following a given segment.
+	 * @param k_ Index of the segment.
+	 */
+	size_t segmentEnd(size_t k_) {
+		return (k_ + 1 < segment_heads.size()) ? segment_heads[k_ + 1] : layers.size();
+	}
+
+	/*!
+	 * Returns the index of the layer following the last one recomputed in a given checkpointed segment.
+	 * The output of the checkpoint is stored, so it is not recomputed - unless it is the dropout of a fused group, whose backward pass needs the (pooled) output of the activation.
+	 * @param k_ Index of the segment.
+	 */
+	size_t recomputationEnd(size_t k_) {
+		size_t checkpoint = segmentEnd(k_) - 1;
+		int head = fused_heads[checkpoint];
+		if (head < 0)
+			return checkpoint;
+		return ((size_t)head + 1 == checkpoint) ? head : checkpoint + 1;
+	}
+
+	/*!
+	 * Performs the forward computation of a range of layers.
+	 * @param first_ Index of the first layer.
+	 * @param last_ Index of the layer following the last one.
+	 * @param skip_dropout_ Flag for skipping dropouts.
+	 */
+	void forwardLayers(size_t first_, size_t last_, bool skip_dropout_) {
+		for (size_t i = first_; i < last_; i++) {
+			LOG(LDEBUG) << "Layer [" << i << "] " << layers[i]->name() << ": (" <<
+					layers[i]->inputSize() << "x" << layers[i]->batchSize() << ") -> (" <<
+					layers[i]->outputSize() << "x" << layers[i]->batchSize() << ")";
+
+			// Fused group - perform the forward computation of all its layers at once.
+			if (fused_heads[i] == (int)i) {
+				i += forwardFused(i, skip_dropout_) - 1;
+				continue;
+			}//: if
+
+			// Perform the forward computation: y = f(x).
+			layers[i]->forward(skip_dropout_);
+		}//: for
+	}
+
+	/*!
+	 * Back-propagates the gradients through a range of layers, from the last to the first one.
+	 * @param first_ Index of the first layer.
+	 * @param last_ Index of the layer following the last one.
+	 */
+	void backwardLayers(size_t first_, size_t last_) {
+		for (int i = last_ - 1; i >= (int)first_; i--) {
+			// Fused group - back-propagate through all its layers at once and jump to the layer preceding the group.
+			if (((size_t)i < fused_heads.size()) && (fused_heads[i] >= 0)) {
+				backwardFused(fused_heads[i]);
+				i = fused_heads[i];
+				continue;
+			}//: if
+			layers[i]->backward();
+		}//: for
+	}
+
+	/*!
+	 * Sets the replay mode of the dropout layers in a range of layers.
+	 * @param first_ Index of the first layer.
+	 * @param last_ Index of the layer following the last one.
+	 * @param replay_ Replay flag.
+	 */
+	void replayDropoutMasks(size_t first_, size_t last_, bool replay_) {
+		for (size_t i = first_; i < last_; i++)
+			if (layers[i]->layer_type == LayerTypes::Dropout)
+				std::static_pointer_cast<Dropout<eT> >(layers[i])->replayMask(replay_);
+	}
+
+	/*!
+	 * Performs the forward computation of a fused group.
+	 * @param head_ Index of the linear layer starting the group.
+	 * @param skip_dropout_ Flag for skipping dropouts.
+	 * @return Number of layers in the group.
+	 */
+	size_t forwardFused(size_t head_, bool skip_dropout_) {
+		switch(layers[head_+1]->layer_type) {
+		case(LayerTypes::ELU):
+			return forwardFused<ELU<eT> >(head_, skip_dropout_);
+		case(LayerTypes::ReLU):
+			return forwardFused<ReLU<eT> >(head_, skip_dropout_);
+		default:
+			return forwardFused<Sigmoid<eT> >(head_, skip_dropout_);
+		}//: switch
+	}
+
+	/*!
+	 * Performs the forward computation of a fused group: y = f(W*x+b), optionally followed by the dropout.
+	 * @param head_ Index of the linear layer starting the group.
+	 * @param skip_dropout_ Flag for skipping dropouts.
+	 * @tparam ActivationType Type of the activation layer.
+	 * @return Number of layers in the group.
+	 */
+	template <typename ActivationType>
+	size_t forwardFused(size_t head_, bool skip_dropout_) {
+		std::shared_ptr<Layer<eT> > lin = layers[head_];
+		std::shared_ptr<Layer<eT> > act = layers[head_+1];
+		std::shared_ptr<Dropout<eT> > drop;
+		if ((head_+2 < layers.size()) && (fused_heads[head_+2] == (int)head_))
+			drop = std::dynamic_pointer_cast<Dropout<eT> >(layers[head_+2]);
+
+		// Get pointers to data matrices.
+		mic::types::MatrixPtr<eT> x = lin->s['x'];
+		mic::types::MatrixPtr<eT> W = lin->p['W'];
+		mic::types::MatrixPtr<eT> b = lin->p['b'];
+		mic::types::MatrixPtr<eT> y = act->s['y'];
+
+		// Multiply straight to the output of the activation layer.
+		y->leftCols(lin->batchSize()).noalias() = (*W) * x->leftCols(lin->batchSize());
+
+		// Get the dropout mask - if required.
+		eT* mask = nullptr;
+		eT* dropout_y = nullptr;
+		eT keep_ratio = 1.0f;
+		if (drop) {
+			dropout_y = layers[head_+2]->s['y']->data();
+			if (!skip_dropout_) {
+				if (!drop->replaysMask())
+					drop->generateMask();
+				mask = layers[head_+2]->m["dropout_mask"]->data();
+				keep_ratio = drop->keepRatio();
+			}//: if
+		}//: if
+
+		// Apply bias, activation and dropout in a single pass.
+		size_t rows = y->rows();
+		size_t cols = lin->batchSize();
+		eT* yd = y->data();
+		eT* bd = b->data();
+		#pragma omp parallel for
+		for (size_t j = 0; j < cols; j++) {
+			for (size_t i = j*rows; i < (j+1)*rows; i++) {
+				yd[i] = ActivationType::activation(yd[i] + bd[i - j*rows]);
+				if (mask)
+					dropout_y[i] = mask[i] * yd[i] / keep_ratio;
+				else if (dropout_y)
+					dropout_y[i] = yd[i];
+			}//: for
+		}//: for
+
+		return (drop ? 3 : 2);
+	}
+
+	/*!
+	 * Performs the backward computation of a fused group.
+	 * @param head_ Index of the linear layer starting the group.
+	 */
+	void backwardFused(size_t head_) {
+		switch(layers[head_+1]->layer_type) {
+		case(LayerTypes::ELU):
+			backwardFused<ELU<eT> >(head_);
+			break;
+		case(LayerTypes::ReLU):
+			backwardFused<ReLU<eT> >(head_);
+			break;
+		default:
+			backwardFused<Sigmoid<eT> >(head_);
+		}//: switch
+	}
+
+	/*!
+	 * Performs the backward computation of a fused group: applies the (dropout and) activation derivative to the gradient and back-propagates it through the linear layer.
+	 * @param head_ Index of the linear layer starting the group.
+	 * @tparam ActivationType Type of the activation layer.
+	 */
+	template <typename ActivationType>
+	void backwardFused(size_t head_) {
+		std::shared_ptr<Layer<eT> > lin = layers[head_];
+		std::shared_ptr<Layer<eT> > act = layers[head_+1];
+		std::shared_ptr<Dropout<eT> > drop;
+		if ((head_+2 < layers.size()) && (fused_heads[head_+2] == (int)head_))
+			drop = std::dynamic_pointer_cast<Dropout<eT> >(layers[head_+2]);
+
+		// Gradient of the last layer of the group.
+		eT* gy = layers[head_ + (drop ? 2 : 1)]->g['y']->data();
+		eT* mask = (drop ? layers[head_+2]->m["dropout_mask"]->data() : nullptr);
+		eT keep_ratio = (drop ? drop->keepRatio() : 1.0f);
+		// Output of the activation.
+		eT* y = act->s['y']->data();
+		// Gradient of the linear layer output.
+		eT* gz = lin->g['y']->data();
+
+		// Apply the derivatives.
+		size_t size = lin->g['y']->rows() * lin->batchSize();
+		#pragma omp parallel for
+		for (size_t i = 0; i < size; i++) {
+			eT dy = (mask ? mask[i] * gy[i] / keep_ratio : gy[i]);
+			gz[i] = ActivationType::derivative(y[i]) * dy;
+		}//: for
+
+		// Compute dW, db and dx.
+		lin->backward();
+	}
+
 };
 
 } /* namespace mlnn */
@@ -0,0 +1,369 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file GradientChecker.hpp
+ * \brief Parallel verification of gradients computed by back-propagation against numerical ones.
+ * \date Oct 18, 2026
+ */
+
+#ifndef SRC_MLNN_GRADIENTCHECKER_HPP_
+#define SRC_MLNN_GRADIENTCHECKER_HPP_
+
+#include <mlnn/BackpropagationNeuralNetwork.hpp>
+#include <optimization/Hash.hpp>
+
+#include <cmath>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace mic {
+namespace mlnn {
+
+/*!
+ * \brief Results of a gradient check.
+ * \author tkornuta
+ */
+struct GradientCheckResults {
+	/// Number of performed checks (directions or coordinates).
+	size_t checks = 0;
+
+	/// Number of checks with the error exceeding the tolerance.
+	size_t failures = 0;
+
+	/// Maximal error.
+	double max_error = 0.0;
+
+	/// Mean error.
+	double mean_error = 0.0;
+
+	/// Upper bound (95% Wilson score interval) of the fraction of failing checks in the whole population, estimated from the checked subset.
+	double failure_rate_bound = 1.0;
+
+	/// Returns true if none of the checks failed.
+	bool passed() const {
+		return (checks > 0) && (failures == 0);
+	}
+};
+
+
+/*!
+ * \brief Class verifying gradients of a network (or a single layer, pushed as a one-layer network) by comparing them with the central differences of the loss.
+ * Instead of perturbing every parameter one by one, it checks random directions (directional derivatives along all parameters at once) or random subsets of coordinates.
+ * The checks are distributed over threads, each with its own copy of the network, built with the same architecture by a user provided function.
+ * Perturbations are generated from a seed and the indices of checks only, so the results do not depend on the number of threads.
+ * Error of a single check is |a-n|/max(1,|a|,|n|), i.e. absolute for small and relative for large derivatives.
+ * Note: the forward passes skip dropouts.
+ * \author tkornuta
+ * \tparam eT Template parameter denoting precision of variables (double is recommended).
+ * \tparam LossFunction Loss function used by the checks (DEFAULT=SquaredErrorLoss).
+ */
+template <typename eT=double, typename LossFunction=mic::neural_nets::loss::SquaredErrorLoss<eT> >
+class GradientChecker {
+public:
+	/// Type of the function building the network - it must push the same layers as in the checked network.
+	typedef std::function<void (BackpropagationNeuralNetwork<eT> &)> NetworkBuilder;
+
+	/*!
+	 * Constructor. Remembers the parameters - copies of the network will be built during the first check.
+	 * @param builder_ Function building the network.
+	 * @param delta_ Step of the central differences (DEFAULT=1e-5).
+	 * @param tolerance_ Maximal allowed error (DEFAULT=1e-6).
+	 * @param check_inputs_ Flag denoting whether the gradients of inputs (dx) will also be checked (DEFAULT=true).
+	 * @param workers_ Number of threads (DEFAULT=0 - number of hardware threads).
+	 * @param seed_ Seed of random directions and coordinates (DEFAULT=0).
+	 */
+	GradientChecker(NetworkBuilder builder_, eT delta_ = 1e-5, eT tolerance_ = 1e-6, bool check_inputs_ = true, size_t workers_ = 0, uint64_t seed_ = 0) :
+		builder(builder_),
+		delta(delta_),
+		tolerance(tolerance_),
+		check_inputs(check_inputs_),
+		workers_number(workers_ ? workers_ : std::max<size_t>(1, std::thread::hardware_concurrency())),
+		seed(seed_)
+	{
+
+	}
+
+	/*!
+	 * Checks directional derivatives along random (normally distributed) directions in the space of all parameters (and inputs).
+	 * Each check costs two forward passes, regardless of the number of parameters.
+	 * @param net_ Checked network.
+	 * @param x_ Input batch.
+	 * @param target_y_ Target outputs.
+	 * @param directions_ Number of directions.
+	 * @return Results of the check.
+	 * Throws std::invalid_argument if the copies of network differ from the checked one.
+	 */
+	GradientCheckResults checkDirections(BackpropagationNeuralNetwork<eT> & net_, mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> target_y_, size_t directions_) {
+		prepare(net_, x_, target_y_);
+
+		std::vector<double> errors(directions_, 0.0);
+		run([&](size_t w) {
+			Worker & wk = workers[w];
+			for (size_t d = w; d < directions_; d += workers_number) {
+				// Directional derivative computed by back-propagation.
+				double analytic = 0.0;
+				for (size_t b = 0; b < references.size(); b++) {
+					eT* v = wk.direction[b]->data();
+					for (size_t i = 0; i < (size_t)references[b]->size(); i++) {
+						v[i] = gaussian(d, offsets[b] + i);
+						analytic += (double)v[i] * (double)(*gradients[b])[i];
+					}//: for
+				}//: for
+
+				// Central difference.
+				for (size_t b = 0; b < references.size(); b++)
+					(*wk.values[b]) = (*references[b]) + delta * (*wk.direction[b]);
+				double plus = loss(wk);
+				for (size_t b = 0; b < references.size(); b++)
+					(*wk.values[b]) = (*references[b]) - delta * (*wk.direction[b]);
+				double minus = loss(wk);
+				for (size_t b = 0; b < references.size(); b++)
+					(*wk.values[b]) = (*references[b]);
+
+				errors[d] = error(analytic, (plus - minus) / (2.0 * delta));
+			}//: for
+		});
+
+		return reduce(errors);
+	}
+
+	/*!
+	 * Checks partial derivatives with respect to a random subset of coordinates (drawn with replacement from all parameters and inputs).
+	 * The bound of the fraction of failing coordinates allows to verify realistic-size layers with a fraction of the cost.
+	 * @param net_ Checked network.
+	 * @param x_ Input batch.
+	 * @param target_y_ Target outputs.
+	 * @param coordinates_ Number of checked coordinates.
+	 * @return Results of the check.
+	 * Throws std::invalid_argument if the copies of network differ from the checked one.
+	 */
+	GradientCheckResults checkCoordinates(BackpropagationNeuralNetwork<eT> & net_, mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> target_y_, size_t coordinates_) {
+		prepare(net_, x_, target_y_);
+
+		std::vector<double> errors(coordinates_, 0.0);
+		run([&](size_t w) {
+			Worker & wk = workers[w];
+			for (size_t c = w; c < coordinates_; c += workers_number) {
+				// Find the block (matrix) containing the coordinate.
+				size_t index = mic::neural_nets::optimization::hash(seed, c, 0) % total_size;
+				size_t b = 0;
+				while (index >= offsets[b] + (size_t)references[b]->size())
+					b++;
+				eT & value = (*wk.values[b])[index - offsets[b]];
+				eT original = value;
+
+				// Central difference - the original value is restored exactly.
+				value = original + delta;
+				double plus = loss(wk);
+				value = original - delta;
+				double minus = loss(wk);
+				value = original;
+
+				errors[c] = error((*gradients[b])[index - offsets[b]], (plus - minus) / (2.0 * delta));
+			}//: for
+		});
+
+		return reduce(errors);
+	}
+
+	/// Returns the number of threads.
+	size_t workersNumber() {
+		return workers_number;
+	}
+
+private:
+	/*!
+	 * \brief Structure containing the workspace of a thread.
+	 */
+	struct Worker {
+		/// Copy of the network.
+		std::shared_ptr<BackpropagationNeuralNetwork<eT> > net;
+		/// Input batch (perturbed copy).
+		mic::types::MatrixPtr<eT> x;
+		/// Pointers to perturbed matrices - parameters of the copy of network, followed by the input.
+		std::vector<mic::types::MatrixPtr<eT> > values;
+		/// Current direction - one matrix for every perturbed matrix.
+		std::vector<mic::types::MatrixPtr<eT> > direction;
+	};
+
+	/// Function building the copies of network.
+	NetworkBuilder builder;
+
+	/// Step of the central differences.
+	eT delta;
+
+	/// Maximal allowed error.
+	eT tolerance;
+
+	/// Flag denoting whether the gradients of inputs will also be checked.
+	bool check_inputs;
+
+	/// Number of threads.
+	size_t workers_number;
+
+	/// Seed of random directions and coordinates.
+	uint64_t seed;
+
+	/// Workspaces of threads.
+	std::vector<Worker> workers;
+
+	/// Loss function.
+	LossFunction loss_function;
+
+	/// Targets of the current check.
+	mic::types::MatrixPtr<eT> target_y;
+
+	/// Unperturbed values of matrices - parameters of the checked network, followed by the input.
+	std::vector<mic::types::MatrixPtr<eT> > references;
+
+	/// Gradients computed by back-propagation - copies, in the same order as references.
+	std::vector<mic::types::MatrixPtr<eT> > gradients;
+
+	/// Offsets of the matrices in the space of all coordinates.
+	std::vector<size_t> offsets;
+
+	/// Number of all coordinates.
+	size_t total_size = 0;
+
+	/*!
+	 * Computes the gradients of the checked network and synchronizes the copies.
+	 * Throws std::invalid_argument if the copies differ from the checked network.
+	 */
+	void prepare(BackpropagationNeuralNetwork<eT> & net_, mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> target_y_) {
+		target_y = target_y_;
+
+		// Back-propagation.
+		net_.resetGrads();
+		net_.forward(x_, true);
+		net_.backward(loss_function.calculateGradient(target_y_, net_.getPredictions()));
+
+		// Remember the (copies of) gradients and values.
+		references = net_.getParameters();
+		gradients.clear();
+		for (auto & g : net_.getParameterGradients())
+			gradients.push_back(MAKE_MATRIX_PTR(eT, *g));
+		if (check_inputs) {
+			references.push_back(x_);
+			gradients.push_back(MAKE_MATRIX_PTR(eT, *net_.getLayer(0)->getGradient("x")));
+		}//: if
+		offsets.clear();
+		total_size = 0;
+		for (auto & r : references) {
+			offsets.push_back(total_size);
+			total_size += r->size();
+		}//: for
+
+		// Build the workspaces - in the calling thread.
+		while (workers.size() < workers_number) {
+			Worker wk;
+			wk.net = std::make_shared<BackpropagationNeuralNetwork<eT> >("gradient_checker");
+			builder(*wk.net);
+			workers.push_back(wk);
+		}//: while
+
+		// Synchronize the copies.
+		for (auto & wk : workers) {
+			wk.net->copyParameters(net_);
+			wk.x = MAKE_MATRIX_PTR(eT, *x_);
+			wk.values = wk.net->getParameters();
+			if (check_inputs)
+				wk.values.push_back(wk.x);
+			wk.direction.clear();
+			for (auto & r : references)
+				wk.direction.push_back(MAKE_MATRIX_PTR(eT, r->rows(), r->cols()));
+		}//: for
+	}
+
+	/*!
+	 * Runs a given function for every workspace, each on a separate thread - the last one on the calling thread.
+	 * @param function_ Function processing the workspace of a given index.
+	 */
+	void run(const std::function<void (size_t)> & function_) {
+		std::vector<std::thread> threads;
+		for (size_t w = 0; w + 1 < workers_number; w++)
+			threads.push_back(std::thread([&, w]() {
+#ifdef _OPENMP
+				// Workspaces already run in parallel - their layers do not start teams of OpenMP threads.
+				omp_set_num_threads(1);
+#endif
+				function_(w);
+			}));
+		function_(workers_number - 1);
+		for (auto& thread: threads)
+			thread.join();
+	}
+
+	/*!
+	 * Computes the loss of the (perturbed) copy of network.
+	 */
+	double loss(Worker & wk_) {
+		wk_.net->invalidateCaches();
+		wk_.net->forward(wk_.x, true);
+		return (double)loss_function.calculateLoss(target_y, wk_.net->getOutputs(), wk_.x->cols());
+	}
+
+	/*!
+	 * Computes the error of a single check.
+	 */
+	static double error(double analytic_, double numerical_) {
+		return fabs(analytic_ - numerical_) / std::max(1.0, std::max(fabs(analytic_), fabs(numerical_)));
+	}
+
+	/*!
+	 * Reduces the errors of checks - in the order of checks.
+	 * @param errors_ Errors.
+	 */
+	GradientCheckResults reduce(const std::vector<double> & errors_) {
+		GradientCheckResults results;
+		results.checks = errors_.size();
+		for (double e : errors_) {
+			results.max_error = std::max(results.max_error, e);
+			results.mean_error += e;
+			if (!(e <= tolerance))
+				results.failures++;
+		}//: for
+		if (results.checks == 0)
+			return results;
+		results.mean_error /= results.checks;
+
+		// Wilson score interval (z = 1.96).
+		double n = results.checks;
+		double p = results.failures / n;
+		double z2 = 1.96 * 1.96;
+		results.failure_rate_bound = std::min(1.0, (p + z2 / (2 * n) + 1.96 * sqrt(p * (1 - p) / n + z2 / (4 * n * n))) / (1 + z2 / n));
+		return results;
+	}
+
+	/*!
+	 * Returns a normally distributed value (Box-Muller transform) determined by the index of check and the index of coordinate.
+	 */
+	eT gaussian(size_t check_, size_t index_) {
+		double u1 = ((mic::neural_nets::optimization::hash(seed, check_, 2 * index_) >> 11) + 1.0) / 9007199254740993.0;
+		double u2 = (mic::neural_nets::optimization::hash(seed, check_, 2 * index_ + 1) >> 11) / 9007199254740992.0;
+		return (eT)(sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2));
+	}
+
+};
+
+} /* namespace mlnn */
+} /* namespace mic */
+
+#endif /* SRC_MLNN_GRADIENTCHECKER_HPP_ */
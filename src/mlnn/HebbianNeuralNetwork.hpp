@@ -59,6 +59,7 @@ public:
 
 	/*!
 	 * Passes the data in a feed-forward manner through all consecutive layers, from the input to the output layer.
+	 * Data are copied to the input of the first layer, unless input_data was previously bound with bindInput().
 	 * @param input_data Input data - a matrix containing [sample_size x batch_size].
 	 * @param skip_dropout Flag for skipping dropouts - which should be set to true during testing.
 	 */
@@ -78,23 +79,13 @@ public:
 		// Connect layers by setting the input matrices pointers to point the output matrices.
 		// There will not need to be copy data between layers anymore.
 		if (!connected) {
-			// Set pointers - pass result to the next layer: x(next layer) = y(current layer).
-			if (layers.size() > 1)
-				for (size_t i = 0; i < layers.size()-1; i++) {
-					// Assert sizes.
-					assert(layers[i+1]->s['x']->rows() == layers[i]->s['y']->rows());
-					// Connect pointers.
-					layers[i+1]->s['x'] = layers[i]->s['y'];
-				}//: for
-			connected = true;
+			bool ok = connectLayers();
+			assert(ok);
 		}
 
 		//assert((layers[0]->s['x'])->cols() == input_data->cols());
-		// Change the size of batch - if required.
-		resizeBatch(input_data->cols());
-
-		// Copy inputs to the lowest point in the network.
-		(*(layers[0]->s['x'])) = (*input_data);
+		// Pass inputs to the lowest point in the network - copy is skipped if input_data was bound with bindInput().
+		setInputs(input_data);
 
 		// Compute the forward activations.
 		for (size_t i = 0; i < layers.size(); i++) {
@@ -156,6 +147,8 @@ protected:
 	// Unhide the overloaded protected methods & fields inherited from the template class MultiLayerNeuralNetwork fields via "using" statement.
 	using MultiLayerNeuralNetwork<eT>::layers;
 	using MultiLayerNeuralNetwork<eT>::connected;
+	using MultiLayerNeuralNetwork<eT>::setInputs;
+	using MultiLayerNeuralNetwork<eT>::connectLayers;
 
 };
 
@@ -27,7 +27,10 @@
 #include <mlnn/layer/LayerTypes.hpp>
 #include <loss/LossTypes.hpp>
 
+#include <algorithm>
 #include <fstream>
+#include <stdexcept>
+#include <typeinfo>
 // Include headers that implement a archive in simple text format
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
@@ -49,6 +52,15 @@ using namespace fully_connected;
 using namespace convolution;
 using namespace regularisation;
 
+/*!
+ * \brief Criteria used for ranking neurons of linear layers and filters of convolutional layers during structured pruning.
+ */
+enum class PruningCriterion : short
+{
+	WeightNorm = 0, ///< L2 norm of the incoming weights of the neuron/filter.
+	MeanActivation ///< Mean absolute activation of the neuron/filter in the last forward pass.
+};
+
 /*!
  * \brief Class representing a multi-layer neural network.
  * \author tkornuta/kmrocki
@@ -64,7 +76,9 @@ public:
 	 */
 	MultiLayerNeuralNetwork(std::string name_ = "mlnn") :
 		name(name_),
-		connected(false) // Initially the network is not connected.
+		connected(false), // Initially the network is not connected.
+		input_bound(false),
+		compiled_batch_size(0)
 	{
 
 	}
@@ -114,6 +128,9 @@ public:
 	 */
 	void popLayer(size_t number_of_layers_ = 1){
 		assert(number_of_layers_ <= layers.size());
+		// The bound input belongs to the first layer - release it if that layer is removed.
+		if (number_of_layers_ == layers.size())
+			input_bound = false;
 		//layers.erase(layers.back() - number_of_layers_, layers.back());
 		for (size_t i=0; i <number_of_layers_; i++)
 			layers.pop_back();
@@ -196,35 +213,497 @@ public:
 			layers[i]->resetGrads();
 	}
 
+	/*!
+	 * Invalidates caches of all layers - must be called when parameters are modified outside of update().
+	 */
+	void invalidateCaches() {
+		for (size_t i = 0; i < layers.size(); i++)
+			layers[i]->invalidateCaches();
+	}
+
+	/*!
+	 * Returns pointers to parameters of all layers - layer by layer, in the order of names of parameters.
+	 */
+	std::vector<mic::types::MatrixPtr<eT> > getParameters() {
+		std::vector<mic::types::MatrixPtr<eT> > params;
+		for (size_t i = 0; i < layers.size(); i++)
+			for (auto& key: layers[i]->p.keys())
+				params.push_back(layers[i]->p[key.second]);
+		return params;
+	}
+
+	/*!
+	 * Returns pointers to gradients of parameters of all layers - in the same order as getParameters().
+	 */
+	std::vector<mic::types::MatrixPtr<eT> > getParameterGradients() {
+		std::vector<mic::types::MatrixPtr<eT> > grads;
+		for (size_t i = 0; i < layers.size(); i++)
+			for (auto& key: layers[i]->p.keys())
+				grads.push_back(layers[i]->g[key.first]);
+		return grads;
+	}
+
 	/*!
 	 * Changes the size of the batch.
 	 * @param New size of the batch.
 	 */
 	void resizeBatch(size_t batch_size_) {
 		// If current batch size is ok.
-		if ((size_t)(layers[0]->s['x'])->cols() == batch_size_)
+		// (Checked on the layer field, as the bound input matrix might have been resized by its owner.)
+		if (layers[0]->batch_size == batch_size_)
 			return;
 
+		// Batches larger than the one the network was compiled for reallocate the buffers - thus the layout is not frozen anymore.
+		if (isCompiled() && (batch_size_ > compiled_batch_size)) {
+			LOG(LWARNING) << "Batch of size " << batch_size_ << " exceeds the maximal batch size " << compiled_batch_size
+					<< " the network was compiled for - buffers will be reallocated";
+			compiled_batch_size = 0;
+		}//: if
+
 		// Else - resize.
 		for (size_t i = 0; i < layers.size(); i++) {
 			layers[i]->resizeBatch(batch_size_);
 		}//: for
 	}
 
+	/*!
+	 * Prepares the network for processing batches of up to a given size, so the first forward pass is as fast as the consecutive ones:
+	 * connects (and verifies) the layers, allocates the buffers for the maximal batch, creates all memory matrices allocated on demand
+	 * by performing a forward (and backward) pass of a zero batch and touches the pages of all buffers.
+	 * Buffers are never shrunk, so batches smaller than the maximal one are processed in their leading columns, without reallocation.
+	 * Any change of the structure of the network (or a larger batch) invalidates the compilation.
+	 * Note: the input matrix bound with bindInput() is released, as the pass of the zero batch would overwrite its data.
+	 * @param max_batch_size_ Maximal size of the batch.
+	 * @return True if the network was compiled, false if its layers do not fit each other.
+	 */
+	bool compile(size_t max_batch_size_) {
+		// Make sure that there are some layers in the nn!
+		assert(layers.size() != 0);
+		assert(max_batch_size_ > 0);
+
+		// Infer and verify the shapes of the connected layers.
+		if (!connectLayers())
+			return false;
+
+		// Allocate the buffers for the maximal batch and pass a zero batch through the network.
+		unbindInput();
+		compiled_batch_size = 0;
+		resizeBatch(max_batch_size_);
+		mic::types::MatrixPtr<eT> zero_batch = MAKE_MATRIX_PTR(eT, layers[0]->inputSize(), max_batch_size_);
+		zero_batch->setZero();
+		warmUp(zero_batch);
+
+		// Touch the pages of the batches and gradients - removing the values left by the pass of the zero batch.
+		for (size_t i = 0; i < layers.size(); i++) {
+			for (auto& key: layers[i]->s.keys())
+				layers[i]->s[key.second]->setZero();
+			for (auto& key: layers[i]->g.keys())
+				layers[i]->g[key.second]->setZero();
+		}//: for
+
+		compiled_batch_size = max_batch_size_;
+		return true;
+	}
+
+	/*!
+	 * Returns true if the network was compiled and its structure has not changed since then.
+	 */
+	bool isCompiled() {
+		return connected && (compiled_batch_size > 0);
+	}
+
+	/*!
+	 * Returns the maximal size of the batch the network was compiled for (0 if it was not compiled).
+	 */
+	size_t compiledBatchSize() {
+		return (isCompiled() ? compiled_batch_size : 0);
+	}
+
+	/*!
+	 * Absorbs Padding and Cropping layers into the directly following Convolution layers, which then handle the borders inside their kernels - so the batches are not copied.
+	 * The layouts set by setInterleavedLayout() are reset, so it should be called afterwards.
+	 * @return Number of absorbed (i.e. removed) layers.
+	 */
+	size_t absorbBorders() {
+		// The bound input might belong to the absorbed layer.
+		mic::types::MatrixPtr<eT> bound_input = (input_bound ? layers[0]->s['x'] : nullptr);
+		unbindInput();
+
+		size_t absorbed = 0;
+		for (size_t i = 0; i + 1 < layers.size(); ) {
+			std::shared_ptr<Convolution<eT> > conv = std::dynamic_pointer_cast<Convolution<eT> >(layers[i+1]);
+			std::shared_ptr<Padding<eT> > pad = std::dynamic_pointer_cast<Padding<eT> >(layers[i]);
+			std::shared_ptr<Cropping<eT> > crop = std::dynamic_pointer_cast<Cropping<eT> >(layers[i]);
+			if ((conv == nullptr) || ((pad == nullptr) && (crop == nullptr))) {
+				i++;
+				continue;
+			}//: if
+
+			LOG(LINFO) << "Absorbing layer " << layers[i]->name() << " into " << conv->name();
+			conv->absorbBorder(pad != nullptr ? (int)pad->padding : -(int)crop->cropping);
+			layers.erase(layers.begin() + i);
+			absorbed++;
+		}//: for
+
+		if (absorbed > 0) {
+			connected = false;
+			setInterleavedLayout(false);
+		}//: if
+		if (bound_input != nullptr)
+			bindInput(bound_input);
+		return absorbed;
+	}
+
+	/*!
+	 * Replaces all (pure) linear layers with their magnitude-pruned counterparts, keeping the given fraction of weights with the biggest magnitudes.
+	 * The pruned layers use the default optimization function (gradient descent) - set it again if the network is going to be fine-tuned.
+	 * @param density_ Fraction of weights that will be kept (0..1].
+	 * @return Number of pruned layers.
+	 */
+	size_t pruneLinearLayers(eT density_) {
+		// The bound input might belong to the replaced layer.
+		mic::types::MatrixPtr<eT> bound_input = (input_bound ? layers[0]->s['x'] : nullptr);
+		unbindInput();
+
+		size_t pruned = 0;
+		for (size_t i = 0; i < layers.size(); i++) {
+			// Derived layers (e.g. SparseLinear) differ in behaviour.
+			if (typeid(*layers[i]) != typeid(Linear<eT>))
+				continue;
+			std::shared_ptr<Linear<eT> > linear = std::dynamic_pointer_cast<Linear<eT> >(layers[i]);
+			std::shared_ptr<PrunedLinear<eT> > pruned_layer = std::make_shared<PrunedLinear<eT> >(*linear, density_, linear->name());
+			pruned_layer->resizeBatch(layers[i]->batch_size);
+			LOG(LINFO) << "Pruning layer " << linear->name() << " to " << pruned_layer->nonzeros() << " weights";
+			layers[i] = pruned_layer;
+			pruned++;
+		}//: for
+
+		if (pruned > 0)
+			connected = false;
+		if (bound_input != nullptr)
+			bindInput(bound_input);
+		return pruned;
+	}
+
+	/*!
+	 * Calculates scores of the output units of a layer - neurons of a (pure) linear layer or filters of a convolutional layer.
+	 * @param index_ Index of the layer.
+	 * @param criterion_ Ranking criterion - MeanActivation uses the outputs of the last forward pass (in the planar or channel-interleaved layout), so the network should process a representative batch first.
+	 * @return Vector of scores (empty if the layer is neither Linear nor Convolution, or if MeanActivation is requested for a layer whose output is not stored - see outputStored()).
+	 */
+	std::vector<eT> rankUnits(size_t index_, PruningCriterion criterion_ = PruningCriterion::WeightNorm) {
+		assert(index_ < layers.size());
+		std::shared_ptr<Layer<eT> > layer = layers[index_];
+		bool linear = (typeid(*layer) == typeid(Linear<eT>));
+		if (!linear && (typeid(*layer) != typeid(Convolution<eT>)))
+			return std::vector<eT>();
+
+		// Neurons are treated as 1x1 "planes".
+		size_t units = (linear ? layer->outputSize() : layer->output_depth);
+		size_t plane = layer->outputSize() / units;
+		std::vector<eT> scores(units, 0);
+
+		if (criterion_ == PruningCriterion::MeanActivation) {
+			if (!outputStored(index_)) {
+				LOG(LERROR) << "Cannot rank units of layer " << layer->name() << " by their activations: its output is not stored";
+				return std::vector<eT>();
+			}//: if
+			// Every sample is a [plane x units] matrix - or its transposition in the channel-interleaved layout.
+			mic::types::MatrixPtr<eT> y = layer->s['y'];
+			bool interleaved = (layer->outputLayout() == TensorLayout::NHWC);
+			for (size_t ib = 0; ib < layer->batch_size; ib++) {
+				Eigen::Map<const Eigen::Matrix<eT, Eigen::Dynamic, Eigen::Dynamic> > sample(y->data() + ib * y->rows(), interleaved ? units : plane, interleaved ? plane : units);
+				for (size_t u = 0; u < units; u++)
+					scores[u] += (interleaved ? sample.row(u).cwiseAbs().sum() : sample.col(u).cwiseAbs().sum());
+			}//: for
+			for (size_t u = 0; u < units; u++)
+				scores[u] /= (eT)(plane * layer->batch_size);
+		} else if (linear) {
+			for (size_t u = 0; u < units; u++)
+				scores[u] = layer->p['W']->row(u).norm();
+		} else {
+			for (size_t u = 0; u < units; u++) {
+				for (size_t ic = 0; ic < layer->input_depth; ic++)
+					scores[u] += layer->p["W"+std::to_string(u)+"x"+std::to_string(ic)]->squaredNorm();
+				scores[u] = sqrt(scores[u]);
+			}//: for
+		}//: else
+		return scores;
+	}
+
+	/*!
+	 * Structured pruning - removes the lowest ranked neurons of a linear layer (or filters of a convolutional layer) and physically shrinks the network.
+	 * The layer is replaced by a smaller dense one, as are the following element-wise, dropout, pooling, padding and cropping layers,
+	 * up to the next linear/convolutional layer, from which the inputs (columns of W/input channels) corresponding to the removed units are removed.
+	 * The new layers use the default optimization function (gradient descent) - set it again if the network is going to be fine-tuned.
+	 * @param index_ Index of the pruned layer.
+	 * @param keep_ Number of units that will be kept.
+	 * @param criterion_ Ranking criterion.
+	 * @return Number of removed units (0 if the layer could not be pruned).
+	 */
+	size_t pruneUnits(size_t index_, size_t keep_, PruningCriterion criterion_ = PruningCriterion::WeightNorm) {
+		std::vector<eT> scores = rankUnits(index_, criterion_);
+		if (scores.empty() || (keep_ == 0) || (keep_ >= scores.size()))
+			return 0;
+		bool linear = (typeid(*layers[index_]) == typeid(Linear<eT>));
+
+		// Find the consumer of the pruned units - only shape-preserving layers can lie in between.
+		size_t consumer = index_ + 1;
+		for (; consumer < layers.size(); consumer++) {
+			LayerTypes lt = layers[consumer]->layer_type;
+			if ((typeid(*layers[consumer]) == typeid(Linear<eT>)) || (typeid(*layers[consumer]) == typeid(Convolution<eT>)))
+				break;
+			bool elementwise = (lt == LayerTypes::ELU) || (lt == LayerTypes::ReLU) || (lt == LayerTypes::Sigmoid) || (lt == LayerTypes::Dropout);
+			bool spatial = (lt == LayerTypes::MaxPooling) || (lt == LayerTypes::Padding) || (lt == LayerTypes::Cropping);
+			if (!elementwise && !(spatial && !linear)) {
+				LOG(LERROR) << "Cannot prune layer " << layers[index_]->name() << ": its outputs are processed by " << layers[consumer]->name();
+				return 0;
+			}//: if
+		}//: for
+		if (consumer == layers.size()) {
+			LOG(LERROR) << "Cannot prune layer " << layers[index_]->name() << ": its outputs are the outputs of the network";
+			return 0;
+		}//: if
+
+		// Keep the units with the highest scores, in the original order.
+		std::vector<size_t> kept(scores.size());
+		for (size_t u = 0; u < kept.size(); u++)
+			kept[u] = u;
+		std::stable_sort(kept.begin(), kept.end(), [&scores](size_t a_, size_t b_) { return scores[a_] > scores[b_]; });
+		kept.resize(keep_);
+		std::sort(kept.begin(), kept.end());
+
+		// The bound input might belong to the replaced layer.
+		mic::types::MatrixPtr<eT> bound_input = (input_bound ? layers[0]->s['x'] : nullptr);
+		unbindInput();
+		size_t batch_size = layers[0]->batch_size;
+
+		// Shrink the pruned layer.
+		std::shared_ptr<Layer<eT> > old = layers[index_];
+		if (linear) {
+			std::shared_ptr<Linear<eT> > layer = std::make_shared<Linear<eT> >(old->input_height, old->input_width, old->input_depth, keep_, 1, 1, old->name());
+			for (size_t u = 0; u < keep_; u++) {
+				layer->p['W']->row(u) = old->p['W']->row(kept[u]);
+				(*layer->p['b'])[u] = (*old->p['b'])[kept[u]];
+			}//: for
+			layers[index_] = layer;
+		} else {
+			std::shared_ptr<Convolution<eT> > conv = std::dynamic_pointer_cast<Convolution<eT> >(old);
+			std::shared_ptr<Convolution<eT> > layer = std::make_shared<Convolution<eT> >(old->input_height, old->input_width, old->input_depth,
+					keep_, conv->filter_size, conv->stride, conv->padding, old->name());
+			layer->setAlgorithm(conv->algorithm);
+			for (size_t u = 0; u < keep_; u++) {
+				for (size_t ic = 0; ic < old->input_depth; ic++)
+					(*layer->p["W"+std::to_string(u)+"x"+std::to_string(ic)]) = (*old->p["W"+std::to_string(kept[u])+"x"+std::to_string(ic)]);
+				(*layer->p['b'])[u] = (*old->p['b'])[kept[u]];
+			}//: for
+			layers[index_] = layer;
+		}//: else
+
+		// Shrink the layers in between.
+		for (size_t i = index_ + 1; i < consumer; i++) {
+			old = layers[i];
+			// Element-wise layers might be created with "flat" sizes, then the kept planes are simply concatenated.
+			bool planar = (!linear) && (old->input_depth == scores.size());
+			size_t h = (planar ? old->input_height : keep_ * old->inputSize() / scores.size());
+			size_t w = (planar ? old->input_width : 1);
+			size_t d = (planar ? keep_ : 1);
+			switch(old->layer_type) {
+			case(LayerTypes::ELU):
+				layers[i] = std::make_shared<ELU<eT> >(h, w, d, old->name());
+				break;
+			case(LayerTypes::ReLU):
+				layers[i] = std::make_shared<ReLU<eT> >(h, w, d, old->name());
+				break;
+			case(LayerTypes::Sigmoid):
+				layers[i] = std::make_shared<Sigmoid<eT> >(h, w, d, old->name());
+				break;
+			case(LayerTypes::Dropout):
+				layers[i] = std::make_shared<Dropout<eT> >(h*w*d, std::dynamic_pointer_cast<Dropout<eT> >(old)->keep_ratio, old->name());
+				break;
+			case(LayerTypes::MaxPooling): {
+				std::shared_ptr<MaxPooling<eT> > pool = std::dynamic_pointer_cast<MaxPooling<eT> >(old);
+				layers[i] = std::make_shared<MaxPooling<eT> >(h, w, keep_, pool->window_size, pool->stride, old->name());
+				break;
+			}
+			case(LayerTypes::Padding):
+				layers[i] = std::make_shared<Padding<eT> >(h, w, keep_, std::dynamic_pointer_cast<Padding<eT> >(old)->padding, old->name());
+				break;
+			default: // Cropping.
+				layers[i] = std::make_shared<Cropping<eT> >(h, w, keep_, std::dynamic_pointer_cast<Cropping<eT> >(old)->cropping, old->name());
+			}//: switch
+		}//: for
+
+		// Remove the corresponding inputs of the consumer.
+		old = layers[consumer];
+		if (typeid(*old) == typeid(Linear<eT>)) {
+			// Inputs of the consumer are planes of the (spatial) outputs of the previous layer - it keeps the spatial shape only if it was created with one (i.e. not with "flat" sizes).
+			size_t plane = old->inputSize() / scores.size();
+			bool planar = (!linear) && (old->input_depth == scores.size());
+			std::shared_ptr<Linear<eT> > layer = (planar ?
+					std::make_shared<Linear<eT> >(old->input_height, old->input_width, keep_, old->output_height, old->output_width, old->output_depth, old->name()) :
+					std::make_shared<Linear<eT> >(keep_ * plane, 1, 1, old->output_height, old->output_width, old->output_depth, old->name()));
+			for (size_t u = 0; u < keep_; u++)
+				layer->p['W']->block(0, u*plane, old->outputSize(), plane) = old->p['W']->block(0, kept[u]*plane, old->outputSize(), plane);
+			(*layer->p['b']) = (*old->p['b']);
+			layers[consumer] = layer;
+		} else {
+			std::shared_ptr<Convolution<eT> > conv = std::dynamic_pointer_cast<Convolution<eT> >(old);
+			std::shared_ptr<Convolution<eT> > layer = std::make_shared<Convolution<eT> >(old->input_height, old->input_width, keep_,
+					old->output_depth, conv->filter_size, conv->stride, conv->padding, old->name());
+			layer->setAlgorithm(conv->algorithm);
+			for (size_t fi = 0; fi < old->output_depth; fi++)
+				for (size_t u = 0; u < keep_; u++)
+					(*layer->p["W"+std::to_string(fi)+"x"+std::to_string(u)]) = (*old->p["W"+std::to_string(fi)+"x"+std::to_string(kept[u])]);
+			(*layer->p['b']) = (*old->p['b']);
+			layers[consumer] = layer;
+		}//: else
+
+		LOG(LINFO) << "Pruned layer " << layers[index_]->name() << " from " << scores.size() << " to " << keep_ << " units";
+		for (size_t i = index_; i <= consumer; i++)
+			layers[i]->resizeBatch(batch_size);
+		connected = false;
+		setInterleavedLayout(false);
+		if (bound_input != nullptr)
+			bindInput(bound_input);
+		return scores.size() - keep_;
+	}
+
+	/*!
+	 * Switches segments of consecutive convolutional layers (i.e. layers supporting the channel-interleaved layout, possibly separated by element-wise activation and dropout layers)
+	 * to the channel-interleaved (NHWC) layout. Batches are converted only at the segment boundaries - on input of the first and output of the last layer of every segment.
+	 * Segments containing a single convolutional layer are left in the planar layout, as the conversions would not pay off.
+	 * Note that visualization of activations of layers inside segments (e.g. getOutputActivations()) assumes the planar layout.
+	 * @param interleaved_ If false, all layers are switched back to the planar (NCHW) layout.
+	 * @return Number of interleaved segments.
+	 */
+	size_t setInterleavedLayout(bool interleaved_ = true) {
+		// Reset all layouts.
+		for (size_t i = 0; i < layers.size(); i++)
+			layers[i]->setLayouts(TensorLayout::NCHW, TensorLayout::NCHW);
+		if (!interleaved_)
+			return 0;
+
+		size_t segments = 0;
+		size_t i = 0;
+		while (i < layers.size()) {
+			// Find the first layer of the segment.
+			if (!layers[i]->supportsInterleavedLayout()) {
+				i++;
+				continue;
+			}//: if
+			size_t first = i, last = i, convolutional = 1;
+
+			// Extend the segment - it cannot end with an element-wise layer.
+			for (size_t j = i + 1; j < layers.size(); j++) {
+				if (layers[j]->supportsInterleavedLayout()) {
+					last = j;
+					convolutional++;
+				} else if ((layers[j]->layer_type != LayerTypes::ELU) && (layers[j]->layer_type != LayerTypes::ReLU) &&
+						(layers[j]->layer_type != LayerTypes::Sigmoid) && (layers[j]->layer_type != LayerTypes::Dropout))
+					break;
+			}//: for
+			i = last + 1;
+			if (convolutional < 2)
+				continue;
+
+			// Convert at the boundaries only.
+			for (size_t j = first; j <= last; j++)
+				layers[j]->setLayouts((j == first) ? TensorLayout::NCHW : TensorLayout::NHWC, (j == last) ? TensorLayout::NCHW : TensorLayout::NHWC);
+			segments++;
+			LOG(LINFO) << "Layers [" << first << ".." << last << "] switched to the channel-interleaved layout";
+		}//: while
+
+		return segments;
+	}
+
+	/*!
+	 * Binds an externally owned matrix as the input of the first layer, so the consecutive forward passes will read the data directly from it, without copying.
+	 * The owner can refill (or resize the batch of) the matrix in place between the calls.
+	 * @param input_data_ Input data - a matrix containing [sample_size x batch_size].
+	 * @return True if the matrix was bound, false if its number of rows does not fit the input size of the first layer.
+	 */
+	bool bindInput(mic::types::MatrixPtr<eT> input_data_) {
+		// Make sure that there are some layers in the nn!
+		assert(layers.size() != 0);
+
+		// Validate the sample size - cols determine the batch size, which we allow to be dynamically changing.
+		if ((size_t)input_data_->rows() != layers[0]->inputSize()) {
+			LOG(LERROR) << "Could not bind input matrix of size " << input_data_->rows() << "x" << input_data_->cols()
+					<< " as the input of layer " << layers[0]->name() << " expecting samples of size " << layers[0]->inputSize();
+			return false;
+		}//: if
+
+		// Nothing to do.
+		if (input_data_ == layers[0]->s['x'])
+			return true;
+
+		// Remember the matrix allocated by the layer, so it can be restored.
+		if (!input_bound)
+			unbound_input = layers[0]->s['x'];
+
+		// Resize the network to the batch size of the bound matrix and replace the input pointer.
+		resizeBatch(input_data_->cols());
+		layers[0]->s['x'] = input_data_;
+		input_bound = true;
+
+		return true;
+	}
+
+	/*!
+	 * Releases the externally owned input matrix, restoring the one allocated by the first layer.
+	 */
+	void unbindInput() {
+		if (!input_bound)
+			return;
+		// Restore the original matrix, enlarging it to the current batch (if required).
+		Layer<eT>::reserveColumns(unbound_input, layers[0]->batch_size);
+		layers[0]->s['x'] = unbound_input;
+		unbound_input.reset();
+		input_bound = false;
+	}
+
+	/*!
+	 * Returns true if the output of a given layer is stored after the forward pass, so it can be read (e.g. by getPredictions()).
+	 * Virtual method - all outputs are stored, the inherited classes may share the buffers of outputs of several layers.
+	 * @param index_ Index of the layer.
+	 */
+	virtual bool outputStored(size_t index_) {
+		assert(index_ < layers.size());
+		return true;
+	}
+
+	/*!
+	 * Returns true if the input of the first layer is bound to an externally owned matrix.
+	 */
+	bool isInputBound() {
+		return input_bound;
+	}
+
 	/*!
 	 * Returns the predictions (output of the forward processing) of the last layer in the form of a matrix of size [output_size x batch_size].
+	 * The predictions are always copied (see Layer::copyBatch()) - use getOutputs() to read them without copying.
 	 */
 	mic::types::MatrixPtr<eT> getPredictions() {
+		return layers.back()->copyBatch(layers.back()->s['y']);
+	}
+
+	/*!
+	 * Returns the outputs of the last layer without copying them - a buffer that might hold more columns than the current batch, whose samples are stored in its leading columns.
+	 */
+	mic::types::MatrixPtr<eT> getOutputs() {
 		return layers.back()->s['y'];
 	}
 
 	/*!
 	 * Returns the predictions (output of the forward processing) of a given layer in the form of a matrix of size [output_size x batch_size].
+	 * The predictions are always copied (see Layer::copyBatch()).
 	 * @param layer_nr_ Layer number.
 	 */
 	mic::types::MatrixPtr<eT> getPredictions(size_t layer_nr_) {
 		assert(layer_nr_ < layers.size());
-		return layers[layer_nr_]->s['y'];
+		assert(outputStored(layer_nr_));
+		return layers[layer_nr_]->copyBatch(layers[layer_nr_]->s['y']);
 	}
 
 	/*!
@@ -236,25 +715,55 @@ public:
 	 * @return
 	 */
 	size_t countCorrectPredictions(mic::types::MatrixPtr<eT> targets_, mic::types::MatrixPtr<eT> predictions_)  {
-
-		// Get vectors of indices denoting classes (type of 1-ouf-of-k dencoding).
-		mic::types::Matrix<eT> predicted_classes = predictions_->colwiseReturnMaxIndices();
-		mic::types::Matrix<eT> target_classes = targets_->colwiseReturnMaxIndices();
-
-		// Get direct pointers to data.
-		eT *p = predicted_classes.data();
-		eT *t = target_classes.data();
+		assert(targets_->cols() == predictions_->cols());
 
 		size_t correct=0;
-		size_t i;
-		for(i=0; i< (size_t) predicted_classes.size(); i++) {
-			if (p[i] == t[i])
+		for(size_t i=0; i< (size_t) predictions_->cols(); i++) {
+			// Compare indices of classes (type of 1-ouf-of-k dencoding) - without converting them to eT.
+			typename mic::types::Matrix<eT>::Index predicted, target;
+			predictions_->col(i).maxCoeff(&predicted);
+			targets_->col(i).maxCoeff(&target);
+			if (predicted == target)
 				correct++;
 		}//: for
 
 		return correct;
 	}
 
+	/*!
+	 * Copies values of parameters of all layers from another network of the same architecture, e.g. in order to evaluate it in parallel.
+	 * Throws std::invalid_argument (and changes nothing) if the architectures differ: in the number, types, dimensions or hyper-parameters of layers
+	 * (e.g. padding, stride and algorithm of convolutions or sparsity patterns of pruned layers) or in the sizes of their parameters.
+	 * @param source_ Network with the parameters to be copied.
+	 */
+	void copyParameters(MultiLayerNeuralNetwork<eT> & source_) {
+		if (layers.size() != source_.layers.size())
+			throw std::invalid_argument("Could not copy parameters of network " + source_.name + " with " + std::to_string(source_.layers.size()) +
+					" layers to network " + name + " with " + std::to_string(layers.size()) + " layers");
+
+		// Verify the structures of layers and sizes of parameters first, so nothing is changed if the networks differ.
+		for (size_t i = 0; i < layers.size(); i++) {
+			bool ok = layers[i]->sameStructure(*source_.layers[i]);
+			for (auto& key: source_.layers[i]->p.keys()) {
+				if (!ok)
+					break;
+				ok = layers[i]->p.keyExists(key.first) &&
+					(layers[i]->p[key.first]->rows() == source_.layers[i]->p[key.second]->rows()) &&
+					(layers[i]->p[key.first]->cols() == source_.layers[i]->p[key.second]->cols());
+			}//: for keys
+			if (!ok)
+				throw std::invalid_argument("Could not copy parameters of layer " + source_.layers[i]->name() + " to layer " + layers[i]->name() +
+						" - they differ in type, dimensions, hyper-parameters or sizes of parameters");
+		}//: for
+
+		// Copy the values and invalidate caches computed on the basis of the previous ones.
+		for (size_t i = 0; i < layers.size(); i++) {
+			for (auto& key: source_.layers[i]->p.keys())
+				(*layers[i]->p[key.first]) = (*source_.layers[i]->p[key.second]);
+			layers[i]->invalidateCaches();
+		}//: for
+	}
+
 
 	/*!
 	 * Stream operator enabling to print neural network.
@@ -338,6 +847,72 @@ protected:
     /// Flag denoting whether the layers are interconnected, thus no copying between inputs and outputs of the neighboring layers will be required.
     bool connected;
 
+    /// Flag denoting whether the input of the first layer is bound to an externally owned matrix.
+    bool input_bound;
+
+    /// Input matrix originally allocated by the first layer - stored when the external matrix is bound.
+    mic::types::MatrixPtr<eT> unbound_input;
+
+    /// Maximal size of the batch the network was compiled for (0 if it was not compiled).
+    size_t compiled_batch_size;
+
+	/*!
+	 * Connects the layers by setting the input matrices pointers to point the output matrices of the previous layers.
+	 * Virtual method - the inherited classes connect also the gradients and prepare the structures used by their passes.
+	 * @return True if the sizes of the inputs and outputs of the neighboring layers fit each other.
+	 */
+	virtual bool connectLayers() {
+		bool ok = true;
+		// Set pointers - pass result to the next layer: x(next layer) = y(current layer).
+		if (layers.size() > 1)
+			for (size_t i = 0; i < layers.size()-1; i++) {
+				if (layers[i+1]->s['x']->rows() != layers[i]->s['y']->rows()) {
+					LOG(LERROR) << "Layer["<<i<<"].y differs from " << "Layer["<<i+1<<"].x";
+					ok = false;
+				}//: if
+				// Connect pointers.
+				layers[i+1]->s['x'] = layers[i]->s['y'];
+			}//: for
+		connected = true;
+		return ok;
+	}
+
+	/*!
+	 * Passes a batch through the network, so all buffers allocated on demand are created - used during the compilation.
+	 * Virtual method - performs the forward pass of all layers, the inherited classes perform also the backward pass.
+	 * @param batch_ Batch of the maximal size.
+	 */
+	virtual void warmUp(mic::types::MatrixPtr<eT> batch_) {
+		setInputs(batch_);
+		for (size_t i = 0; i < layers.size(); i++)
+			layers[i]->forward(true);
+	}
+
+	/*!
+	 * Passes the input data to the first layer - copies them, unless the matrix is already bound as the input.
+	 * @param input_data_ Input data - a matrix containing [sample_size x batch_size].
+	 * @param batch_size_ Number of leading columns of input_data_ forming the batch (DEFAULT=0 - all columns).
+	 */
+	void setInputs(mic::types::MatrixPtr<eT> input_data_, size_t batch_size_ = 0) {
+		size_t cols = (batch_size_ > 0) ? batch_size_ : input_data_->cols();
+		assert(cols <= (size_t)input_data_->cols());
+
+		// The bound matrix is already the input - only adjust the batch size of the layers.
+		if (input_data_ == layers[0]->s['x']) {
+			resizeBatch(cols);
+			return;
+		}//: if
+
+		// Other data - release the bound matrix first, so its owner's data won't be overwritten.
+		unbindInput();
+
+		// Change the size of batch - if required.
+		resizeBatch(cols);
+
+		// Copy inputs to the lowest point in the network.
+		layers[0]->s['x']->leftCols(cols) = input_data_->leftCols(cols);
+	}
+
 
 private:
 	// Friend class - required for using boost serialization.
@@ -364,6 +939,10 @@ private:
 
 			// Serialize the layer.
 			ar & (*layers[i]);
+
+			// Pruned layers store also their sparsity patterns.
+			if (layers[i]->layer_type == LayerTypes::PrunedLinear)
+				std::static_pointer_cast<PrunedLinear<eT> >(layers[i])->serializeSparsityPattern(ar);
 		}//: for
 
     }
@@ -378,6 +957,9 @@ private:
     	// Clear the layers vector - just in case.
     	layers.clear();
     	connected = false;
+    	input_bound = false;
+    	unbound_input.reset();
+    	compiled_batch_size = 0;
 
     	// Deserialize name.
 		ar & name;
@@ -442,6 +1024,10 @@ private:
 				layer_ptr = std::make_shared<SparseLinear<eT> >(SparseLinear<eT>());
 				LOG(LDEBUG) <<  "SparseLinear";
 				break;
+			case(LayerTypes::PrunedLinear):
+				layer_ptr = std::make_shared<PrunedLinear<eT> >(PrunedLinear<eT>());
+				LOG(LDEBUG) <<  "PrunedLinear";
+				break;
 			case(LayerTypes::HebbianLinear):
 				layer_ptr = std::make_shared<HebbianLinear<eT> >(HebbianLinear<eT>());
 				LOG(LDEBUG) <<  "HebbianLinear";
@@ -463,6 +1049,8 @@ private:
 			}//: switch
 
 			ar & (*layer_ptr);
+			if (lt == LayerTypes::PrunedLinear)
+				std::static_pointer_cast<PrunedLinear<eT> >(layer_ptr)->serializeSparsityPattern(ar);
 			layers.push_back(layer_ptr);
 		}//: for
 
@@ -24,6 +24,11 @@
 
 #include <mlnn/MultiLayerNeuralNetworkTests.hpp>
 
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <set>
+
 namespace mic { namespace neural_nets { namespace unit_tests {
 
 /*!
@@ -197,8 +202,1192 @@ TEST_F(Tutorial2LayerNN, TrainSingleStep) {
 
 }
 
+
+/*!
+ * Tests forward pass with the input matrix bound to the first layer (without copying).
+ */
+TEST_F(Tutorial2LayerNN, BoundInputForward) {
+	double eps = 1e-5;
+
+	// Matrix of wrong sample size cannot be bound.
+	mic::types::MatrixPtr<double> wrong_x = MAKE_MATRIX_PTR(double, 3, 1);
+	ASSERT_FALSE(nn.bindInput(wrong_x));
+	ASSERT_FALSE(nn.isInputBound());
+
+	// Bind the input - the first layer must use the very same matrix.
+	ASSERT_TRUE(nn.bindInput(input_x));
+	ASSERT_TRUE(nn.isInputBound());
+	ASSERT_EQ(nn.layers[0]->s["x"]->data(), input_x->data());
+
+	// Forward pass.
+	nn.forward(input_x);
+	ASSERT_EQ(nn.layers[0]->s["x"]->data(), input_x->data());
+
+	// Sig2 layer output.
+	ASSERT_LE( fabs( (*nn.layers[3]->s["y"])[0] - (*ffpass1_sig2_y)[0]), eps);
+	ASSERT_LE( fabs( (*nn.layers[3]->s["y"])[1] - (*ffpass1_sig2_y)[1]), eps);
+
+	// Passing other data must release the bound matrix and leave its content untouched.
+	mic::types::MatrixPtr<double> other_x = MAKE_MATRIX_PTR(double, 2, 1);
+	(*other_x) << 1.0, 2.0;
+	nn.forward(other_x);
+	ASSERT_FALSE(nn.isInputBound());
+	ASSERT_NE(nn.layers[0]->s["x"]->data(), input_x->data());
+	ASSERT_EQ((*input_x)[0], 0.05);
+	ASSERT_EQ((*input_x)[1], 0.1);
+}
+
+
+/*!
+ * Tests a single iteration of a backpropagation algorithm with fused Linear+Sigmoid layers.
+ */
+TEST_F(Tutorial2LayerNN, FusedTrainSingleStep) {
+	double eps = 1e-5;
+
+	// Fuse layers and perform a single training step.
+	nn.fuseLayers();
+	double loss = nn.train(input_x, target_y, 0.5);
+
+	// Both pairs should be fused.
+	ASSERT_EQ(nn.fused_heads[1], 0);
+	ASSERT_EQ(nn.fused_heads[3], 2);
+
+	// Check loss
+	ASSERT_LE( fabs( loss - ffpass1_loss), eps);
+
+	// Sig1 layer output.
+	ASSERT_LE( fabs( (*nn.layers[1]->s["y"])[0] - (*ffpass1_sig1_y)[0]), eps);
+	ASSERT_LE( fabs( (*nn.layers[1]->s["y"])[1] - (*ffpass1_sig1_y)[1]), eps);
+	// Sig2 layer output.
+	ASSERT_LE( fabs( (*nn.layers[3]->s["y"])[0] - (*ffpass1_sig2_y)[0]), eps);
+	ASSERT_LE( fabs( (*nn.layers[3]->s["y"])[1] - (*ffpass1_sig2_y)[1]), eps);
+
+	// Check weights after the update.
+	for (size_t i=0; i<4; i++) {
+		ASSERT_LE( fabs( (*nn.layers[2]->p["W"])[i] - (*bwpass1_lin2_pW_updated)[i]), eps);
+		ASSERT_LE( fabs( (*nn.layers[0]->p["W"])[i] - (*bwpass1_lin1_pW_updated)[i]), eps);
+	}//: for
+}
+
+
+/*!
+ * Tests whether fused Linear+ELU+Dropout and Linear+ReLU groups produce the same results as separate layers.
+ */
+TEST(FusedLayers, EquivalenceWithSeparateLayers) {
+	double eps = 1e-10;
+	mic::mlnn::BackpropagationNeuralNetwork<double> nets[2];
+	for (size_t n=0; n<2; n++) {
+		nets[n].pushLayer(new mic::mlnn::fully_connected::Linear<double>(10, 20));
+		nets[n].pushLayer(new mic::mlnn::activation_function::ELU<double>(20));
+		// Keep all activations, so the results are deterministic.
+		nets[n].pushLayer(new mic::mlnn::regularisation::Dropout<double>(20, 1.0));
+		nets[n].pushLayer(new mic::mlnn::fully_connected::Linear<double>(20, 4));
+		nets[n].pushLayer(new mic::mlnn::activation_function::ReLU<double>(4));
+		nets[n].setLoss< mic::neural_nets::loss::SquaredErrorLoss<double> >();
+	}//: for
+	// Use the same weights.
+	(*nets[1].layers[0]->p["W"]) = (*nets[0].layers[0]->p["W"]);
+	(*nets[1].layers[3]->p["W"]) = (*nets[0].layers[3]->p["W"]);
+	(*nets[0].layers[0]->p["b"]).setConstant(0.1);
+	(*nets[1].layers[0]->p["b"]).setConstant(0.1);
+	nets[1].fuseLayers();
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 10, 3);
+	mic::types::MatrixPtr<double> target = MAKE_MATRIX_PTR(double, 4, 3);
+	x->rand(-1.0, 1.0);
+	target->rand(0.0, 1.0);
+
+	// Train both networks twice.
+	for (size_t it=0; it<2; it++) {
+		double loss0 = nets[0].train(x, target, 0.1);
+		double loss1 = nets[1].train(x, target, 0.1);
+		ASSERT_LE( fabs(loss0 - loss1), eps);
+	}//: for
+
+	// Compare outputs and weights.
+	for (size_t i=0; i< (size_t)nets[0].getPredictions()->size(); i++)
+		ASSERT_LE( fabs( (*nets[0].getPredictions())[i] - (*nets[1].getPredictions())[i]), eps);
+	for (size_t i=0; i< (size_t)nets[0].layers[0]->p["W"]->size(); i++)
+		ASSERT_LE( fabs( (*nets[0].layers[0]->p["W"])[i] - (*nets[1].layers[0]->p["W"])[i]), eps);
+	for (size_t i=0; i< (size_t)nets[0].layers[0]->p["b"]->size(); i++)
+		ASSERT_LE( fabs( (*nets[0].layers[0]->p["b"])[i] - (*nets[1].layers[0]->p["b"])[i]), eps);
+
+	// Outputs of the fused linear layers are not computed.
+	for (size_t i=0; i<5; i++) {
+		ASSERT_TRUE(nets[0].outputStored(i));
+		ASSERT_EQ(nets[1].outputStored(i), (i != 0) && (i != 3));
+	}//: for
+
+	// ... so their neurons can be ranked by weights, but not by activations.
+	ASSERT_EQ(nets[0].rankUnits(0, mic::mlnn::PruningCriterion::MeanActivation).size(), 20);
+	ASSERT_TRUE(nets[1].rankUnits(0, mic::mlnn::PruningCriterion::MeanActivation).empty());
+	ASSERT_EQ(nets[1].rankUnits(0).size(), 20);
+}
+
+
+/*!
+ * Checks whether training a convolutional network with the channel-interleaved layout gives the same results as with the planar one.
+ */
+TEST(InterleavedLayout, EquivalenceWithPlanarLayout) {
+	double eps = 1e-10;
+	mic::mlnn::BackpropagationNeuralNetwork<double> nets[2];
+	for (size_t n=0; n<2; n++) {
+		nets[n].pushLayer(new mic::mlnn::convolution::Padding<double>(8, 8, 1, 1));
+		nets[n].pushLayer(new mic::mlnn::convolution::Convolution<double>(10, 10, 1, 4, 3, 1));
+		nets[n].pushLayer(new mic::mlnn::activation_function::ReLU<double>(8*8*4));
+		nets[n].pushLayer(new mic::mlnn::convolution::MaxPooling<double>(8, 8, 4, 2));
+		nets[n].pushLayer(new mic::mlnn::convolution::Convolution<double>(4, 4, 4, 3, 2, 2));
+		nets[n].pushLayer(new mic::mlnn::fully_connected::Linear<double>(2*2*3, 5));
+		nets[n].setLoss< mic::neural_nets::loss::SquaredErrorLoss<double> >();
+	}//: for
+	// Use the same parameters.
+	for (size_t l=0; l<6; l++)
+		for (auto& key: nets[0].layers[l]->p.keys())
+			(*nets[1].layers[l]->p[key.first]) = (*nets[0].layers[l]->p[key.first]);
+	ASSERT_EQ(nets[1].setInterleavedLayout(), 1);
+	ASSERT_EQ(nets[1].layers[0]->inputLayout(), mic::mlnn::TensorLayout::NCHW);
+	ASSERT_EQ(nets[1].layers[0]->outputLayout(), mic::mlnn::TensorLayout::NHWC);
+	ASSERT_EQ(nets[1].layers[4]->outputLayout(), mic::mlnn::TensorLayout::NCHW);
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 8*8, 3);
+	mic::types::MatrixPtr<double> target = MAKE_MATRIX_PTR(double, 5, 3);
+	x->rand(-1.0, 1.0);
+	target->rand(0.0, 1.0);
+
+	// Train both networks twice.
+	for (size_t it=0; it<2; it++) {
+		double loss0 = nets[0].train(x, target, 0.1);
+		double loss1 = nets[1].train(x, target, 0.1);
+		ASSERT_LE( fabs(loss0 - loss1), eps);
+	}//: for
+
+	// Compare outputs and parameters.
+	for (size_t i=0; i< (size_t)nets[0].getPredictions()->size(); i++)
+		ASSERT_LE( fabs( (*nets[0].getPredictions())[i] - (*nets[1].getPredictions())[i]), eps);
+	for (size_t l=0; l<6; l++)
+		for (auto& key: nets[0].layers[l]->p.keys())
+			for (size_t i=0; i< (size_t)nets[0].layers[l]->p[key.first]->size(); i++)
+				ASSERT_LE( fabs( (*nets[0].layers[l]->p[key.first])[i] - (*nets[1].layers[l]->p[key.first])[i]), eps);
+
+	// Ranking of filters by their activations does not depend on the layout of the (interleaved) output.
+	ASSERT_EQ(nets[1].layers[1]->outputLayout(), mic::mlnn::TensorLayout::NHWC);
+	std::vector<double> scores[2];
+	for (size_t n=0; n<2; n++)
+		scores[n] = nets[n].rankUnits(1, mic::mlnn::PruningCriterion::MeanActivation);
+	ASSERT_EQ(scores[0].size(), 4);
+	ASSERT_EQ(scores[1].size(), 4);
+	for (size_t u=0; u<4; u++)
+		ASSERT_LE( fabs(scores[0][u] - scores[1][u]), eps);
+	// The filters differ, so must their scores.
+	ASSERT_NE(scores[0][0], scores[0][1]);
+}
+
+
+/*!
+ * Checks whether absorbing Padding and Cropping layers into convolutions (also in the channel-interleaved layout) does not change the results.
+ */
+TEST(AbsorbedBorders, EquivalenceWithBorderLayers) {
+	double eps = 1e-10;
+	mic::mlnn::BackpropagationNeuralNetwork<double> nets[3];
+	for (size_t n=0; n<3; n++) {
+		nets[n].pushLayer(new mic::mlnn::convolution::Padding<double>(8, 8, 1, 2));
+		nets[n].pushLayer(new mic::mlnn::convolution::Convolution<double>(12, 12, 1, 4, 3, 1));
+		nets[n].pushLayer(new mic::mlnn::activation_function::ReLU<double>(10*10*4));
+		nets[n].pushLayer(new mic::mlnn::convolution::MaxPooling<double>(10, 10, 4, 2));
+		nets[n].pushLayer(new mic::mlnn::convolution::Convolution<double>(5, 5, 4, 1, 3, 1, 1));
+		nets[n].pushLayer(new mic::mlnn::convolution::Cropping<double>(5, 5, 1, 1));
+		nets[n].pushLayer(new mic::mlnn::convolution::Convolution<double>(3, 3, 1, 2, 2, 1));
+		nets[n].pushLayer(new mic::mlnn::fully_connected::Linear<double>(2*2*2, 5));
+		nets[n].setLoss< mic::neural_nets::loss::SquaredErrorLoss<double> >();
+	}//: for
+	// Use the same parameters.
+	for (size_t l=0; l<8; l++)
+		for (auto& key: nets[0].layers[l]->p.keys())
+			for (size_t n=1; n<3; n++)
+				(*nets[n].layers[l]->p[key.first]) = (*nets[0].layers[l]->p[key.first]);
+	ASSERT_EQ(nets[1].absorbBorders(), 2);
+	ASSERT_EQ(nets[2].absorbBorders(), 2);
+	ASSERT_EQ(nets[2].setInterleavedLayout(), 1);
+	ASSERT_EQ(nets[1].layers.size(), 6);
+	ASSERT_EQ(nets[1].layers[0]->inputSize(), 8*8);
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 8*8, 3);
+	mic::types::MatrixPtr<double> target = MAKE_MATRIX_PTR(double, 5, 3);
+	x->rand(-1.0, 1.0);
+	target->rand(0.0, 1.0);
+
+	// Train all networks twice.
+	for (size_t it=0; it<2; it++) {
+		double loss0 = nets[0].train(x, target, 0.1);
+		for (size_t n=1; n<3; n++)
+			ASSERT_LE( fabs(loss0 - nets[n].train(x, target, 0.1)), eps);
+	}//: for
+
+	// Compare outputs.
+	for (size_t n=1; n<3; n++)
+		for (size_t i=0; i< (size_t)nets[0].getPredictions()->size(); i++)
+			ASSERT_LE( fabs( (*nets[0].getPredictions())[i] - (*nets[n].getPredictions())[i]), eps);
+}
+
+/*!
+ * \brief Tests whether the pruning of linear layers at full density preserves training of the network.
+ */
+TEST(PrunedLinearLayers, EquivalenceAtFullDensity) {
+	double eps = 1e-10;
+	mic::mlnn::BackpropagationNeuralNetwork<double> nets[2];
+	for (size_t n=0; n<2; n++) {
+		nets[n].pushLayer(new mic::mlnn::fully_connected::Linear<double>(10, 8));
+		nets[n].pushLayer(new mic::mlnn::activation_function::ReLU<double>(8));
+		nets[n].pushLayer(new mic::mlnn::fully_connected::Linear<double>(8, 4));
+		nets[n].setLoss< mic::neural_nets::loss::SquaredErrorLoss<double> >();
+	}//: for
+	for (size_t l=0; l<3; l++)
+		for (auto& key: nets[0].layers[l]->p.keys())
+			(*nets[1].layers[l]->p[key.first]) = (*nets[0].layers[l]->p[key.first]);
+	ASSERT_EQ(nets[1].pruneLinearLayers(1.0), 2);
+	ASSERT_EQ(nets[1].layers[2]->layer_type, mic::mlnn::LayerTypes::PrunedLinear);
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 10, 3);
+	mic::types::MatrixPtr<double> target = MAKE_MATRIX_PTR(double, 4, 3);
+	x->rand(-1.0, 1.0);
+	target->rand(0.0, 1.0);
+
+	for (size_t it=0; it<2; it++)
+		ASSERT_LE( fabs(nets[0].train(x, target, 0.1) - nets[1].train(x, target, 0.1)), eps);
+	for (size_t i=0; i< (size_t)nets[0].getPredictions()->size(); i++)
+		ASSERT_LE( fabs( (*nets[0].getPredictions())[i] - (*nets[1].getPredictions())[i]), eps);
+}
+
+/*!
+ * \brief Tests whether the pruned network (including the sparsity patterns) can be saved and loaded.
+ */
+TEST(PrunedLinearLayers, Serialization) {
+	double eps = 1e-10;
+	mic::mlnn::BackpropagationNeuralNetwork<double> nn;
+	nn.pushLayer(new mic::mlnn::fully_connected::Linear<double>(10, 8));
+	nn.pushLayer(new mic::mlnn::activation_function::ReLU<double>(8));
+	nn.pushLayer(new mic::mlnn::fully_connected::Linear<double>(8, 4));
+	ASSERT_EQ(nn.pruneLinearLayers(0.4), 2);
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 10, 3);
+	x->rand(-1.0, 1.0);
+	nn.forward(x);
+	mic::types::Matrix<double> predictions = (*nn.getPredictions());
+
+	const char* fileName = "saved_pruned.txt";
+	ASSERT_TRUE(nn.save(fileName));
+	mic::mlnn::BackpropagationNeuralNetwork<double> restored_nn;
+	ASSERT_TRUE(restored_nn.load(fileName));
+	ASSERT_EQ(restored_nn.layers.size(), 3);
+
+	for (size_t l=0; l<3; l+=2) {
+		ASSERT_EQ(restored_nn.layers[l]->layer_type, mic::mlnn::LayerTypes::PrunedLinear);
+		std::shared_ptr<mic::mlnn::fully_connected::PrunedLinear<double> > original = nn.getLayer<mic::mlnn::fully_connected::PrunedLinear<double> >(l);
+		std::shared_ptr<mic::mlnn::fully_connected::PrunedLinear<double> > restored = restored_nn.getLayer<mic::mlnn::fully_connected::PrunedLinear<double> >(l);
+		ASSERT_EQ(restored->nonzeros(), original->nonzeros());
+		ASSERT_LE((restored->denseWeights() - original->denseWeights()).norm(), eps);
+	}//: for
+
+	restored_nn.forward(x);
+	for (size_t i=0; i< (size_t)predictions.size(); i++)
+		ASSERT_LE( fabs(predictions(i) - (*restored_nn.getPredictions())[i]), eps);
+}
+
+/*!
+ * \brief Tests whether removing filters/neurons that do not contribute to the outputs preserves the predictions of a convolutional network.
+ */
+TEST(StructuredPruning, RemovesUnusedUnits) {
+	double eps = 1e-10;
+	mic::mlnn::BackpropagationNeuralNetwork<double> nn;
+	nn.pushLayer(new mic::mlnn::convolution::Convolution<double>(8, 8, 1, 4, 3, 1));
+	nn.pushLayer(new mic::mlnn::activation_function::ELU<double>(6, 6, 4));
+	nn.pushLayer(new mic::mlnn::convolution::MaxPooling<double>(6, 6, 4, 2));
+	nn.pushLayer(new mic::mlnn::convolution::Convolution<double>(3, 3, 4, 3, 2, 1));
+	nn.pushLayer(new mic::mlnn::activation_function::ReLU<double>(2*2*3));
+	nn.pushLayer(new mic::mlnn::fully_connected::Linear<double>(2, 2, 3, 6, 1, 1));
+	nn.pushLayer(new mic::mlnn::activation_function::Sigmoid<double>(6));
+	nn.pushLayer(new mic::mlnn::regularisation::Dropout<double>(6, 0.5));
+	nn.pushLayer(new mic::mlnn::fully_connected::Linear<double>(6, 2));
+	nn.setLoss< mic::neural_nets::loss::SquaredErrorLoss<double> >();
+
+	// Filter 1 of the first convolution, filter 2 of the second one and neuron 4 of the first linear layer do not contribute to the outputs.
+	nn.layers[0]->p["W1x0"]->setZero();
+	(*nn.layers[0]->p["b"])[1] = 0.0;
+	for (size_t ic=0; ic<4; ic++)
+		nn.layers[3]->p["W2x"+std::to_string(ic)]->setZero();
+	(*nn.layers[3]->p["b"])[2] = 0.0;
+	nn.layers[8]->p["W"]->col(4).setZero();
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 8*8, 3);
+	x->rand(-1.0, 1.0);
+	nn.forward(x, true);
+	mic::types::Matrix<double> predictions = (*nn.getPredictions());
+
+	// Neurons are ranked by mean activations, filters by weights.
+	nn.forward(x, true);
+	std::vector<double> scores = nn.rankUnits(5, mic::mlnn::PruningCriterion::MeanActivation);
+	ASSERT_EQ(scores.size(), 6);
+	// The last linear layer cannot be pruned, neither can the activation functions.
+	ASSERT_EQ(nn.pruneUnits(8, 1), 0);
+	ASSERT_EQ(nn.pruneUnits(1, 1), 0);
+	ASSERT_EQ(nn.pruneUnits(0, 3), 1);
+	ASSERT_EQ(nn.pruneUnits(3, 2), 1);
+	// Make neuron 4 the weakest one.
+	nn.layers[5]->p["W"]->row(4) *= 1e-3;
+	nn.forward(x, true);
+	ASSERT_EQ(nn.pruneUnits(5, 5, mic::mlnn::PruningCriterion::MeanActivation), 1);
+
+	// Check the shapes.
+	ASSERT_EQ(nn.layers[0]->outputSize(), 6*6*3);
+	ASSERT_EQ(nn.layers[2]->outputSize(), 3*3*3);
+	ASSERT_EQ(nn.layers[3]->inputSize(), 3*3*3);
+	ASSERT_EQ(nn.layers[4]->inputSize(), 2*2*2);
+	ASSERT_EQ(nn.layers[5]->inputSize(), 2*2*2);
+	ASSERT_EQ(nn.layers[7]->inputSize(), 5);
+	ASSERT_EQ(nn.layers[8]->inputSize(), 5);
+	ASSERT_TRUE(nn.verify());
+
+	// Compare predictions.
+	nn.forward(x, true);
+	for (size_t i=0; i< (size_t)predictions.size(); i++)
+		ASSERT_LE( fabs(predictions(i) - (*nn.getPredictions())[i]), eps);
+
+	// The pruned network can be trained.
+	mic::types::MatrixPtr<double> target = MAKE_MATRIX_PTR(double, 2, 3);
+	target->rand(0.0, 1.0);
+	nn.train(x, target, 0.1);
+}
+
+/*!
+ * \brief Tests whether removing filters of a convolution preserves the predictions when the following linear layer was created with "flat" sizes.
+ */
+TEST(StructuredPruning, ShrinksFlatConsumer) {
+	double eps = 1e-10;
+	mic::mlnn::BackpropagationNeuralNetwork<double> nn;
+	nn.pushLayer(new mic::mlnn::convolution::Convolution<double>(6, 6, 1, 4, 3, 1));
+	nn.pushLayer(new mic::mlnn::activation_function::ReLU<double>(4*4*4));
+	nn.pushLayer(new mic::mlnn::fully_connected::Linear<double>(4*4*4, 5));
+	nn.setLoss< mic::neural_nets::loss::SquaredErrorLoss<double> >();
+
+	// Filter 2 does not contribute to the outputs.
+	nn.layers[0]->p["W2x0"]->setZero();
+	(*nn.layers[0]->p["b"])[2] = 0.0;
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 6*6, 3);
+	x->rand(-1.0, 1.0);
+	nn.forward(x, true);
+	mic::types::Matrix<double> predictions = (*nn.getPredictions());
+
+	ASSERT_EQ(nn.pruneUnits(0, 3), 1);
+
+	// The consumer keeps three planes of inputs, still "flat".
+	ASSERT_EQ(nn.layers[1]->inputSize(), 4*4*3);
+	ASSERT_EQ(nn.layers[2]->inputSize(), 4*4*3);
+	ASSERT_EQ(nn.layers[2]->input_depth, 1);
+	ASSERT_TRUE(nn.verify());
+
+	nn.forward(x, true);
+	for (size_t i=0; i< (size_t)predictions.size(); i++)
+		ASSERT_LE( fabs(predictions(i) - (*nn.getPredictions())[i]), eps);
+}
+
+/*!
+ * \brief Tests whether snapshots published by a layer are kept unchanged as long as they are read, and refreshed at the requested rate.
+ */
+TEST(LayerSnapshots, PublishAndRead) {
+	mic::mlnn::fully_connected::Linear<double> layer(5, 3);
+	layer.setSnapshots({mic::mlnn::SnapshotKind::Weight, mic::mlnn::SnapshotKind::Output}, 2);
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 5, 1);
+	x->rand(-1.0, 1.0);
+	layer.forward(x);
+
+	// Nothing was published yet.
+	ASSERT_EQ(layer.getSnapshot(mic::mlnn::SnapshotKind::Weight).size(), 0);
+	ASSERT_TRUE(layer.publishSnapshots());
+	ASSERT_EQ(layer.getSnapshot(mic::mlnn::SnapshotKind::Input).size(), 0);
+	std::vector<mic::types::MatrixPtr<double> > weights = layer.getSnapshot(mic::mlnn::SnapshotKind::Weight);
+	ASSERT_EQ(weights.size(), 1);
+	ASSERT_EQ(layer.getSnapshot(mic::mlnn::SnapshotKind::Output).size(), 1);
+	mic::types::Matrix<double> W = (*layer.p["W"]);
+	for (size_t i=0; i<3; i++)
+		for (size_t j=0; j<5; j++)
+			ASSERT_EQ((*weights[0])(i, j), W(i, j));
+
+	// Every second call publishes snapshots - the ones kept by the reader are not overwritten.
+	for (size_t step=0; step<10; step++) {
+		layer.p["W"]->setConstant(step);
+		ASSERT_EQ(layer.publishSnapshots(), (step % 2 == 1));
+		std::vector<mic::types::MatrixPtr<double> > & latest = layer.getSnapshot(mic::mlnn::SnapshotKind::Weight);
+		ASSERT_EQ((*latest[0])[0], (step % 2 == 1) ? step : ((step == 0) ? W(0, 0) : step - 1));
+	}//: for
+	for (size_t i=0; i<3; i++)
+		for (size_t j=0; j<5; j++)
+			ASSERT_EQ((*weights[0])(i, j), W(i, j));
+}
+
+/*!
+ * \brief Tests whether snapshots read by another thread are always complete.
+ */
+TEST(LayerSnapshots, ConcurrentReadsAreConsistent) {
+	mic::mlnn::SnapshotBuffer<double> buffer;
+	std::vector<mic::types::MatrixPtr<double> > source;
+	for (size_t i=0; i<4; i++)
+		source.push_back(MAKE_MATRIX_PTR(double, 50, 50));
+	std::atomic<bool> done(false);
+
+	std::thread writer([&]() {
+		for (size_t step=0; step<2000; step++) {
+			for (auto & m : source)
+				m->setConstant(step);
+			buffer.publish(source);
+		}//: for
+		done = true;
+	});
+
+	std::vector<mic::types::MatrixPtr<double> > snapshot;
+	size_t reads = 0;
+	double last = -1;
+	while (!done || (reads == 0)) {
+		if (!buffer.read(snapshot))
+			continue;
+		reads++;
+		// All matrices come from the same step, and steps do not go back.
+		double value = (*snapshot[0])[0];
+		ASSERT_GE(value, last);
+		for (auto & m : snapshot) {
+			ASSERT_EQ(m->minCoeff(), value);
+			ASSERT_EQ(m->maxCoeff(), value);
+		}//: for
+		last = value;
+	}//: while
+	writer.join();
+	ASSERT_EQ(buffer.version(), 2000);
+}
+
 } } }//: namespaces
 
+/*!
+ * \brief Linear layer recording the threads that performed its forward passes - used by the tests of sharded evaluation and gradient checks.
+ */
+class ThreadRecordingLinear : public mic::mlnn::fully_connected::Linear<double> {
+public:
+	ThreadRecordingLinear(size_t inputs_, size_t outputs_) : mic::mlnn::fully_connected::Linear<double>(inputs_, outputs_) { }
+
+	void forward(bool test_ = false) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			threads.insert(std::this_thread::get_id());
+		}
+		mic::mlnn::fully_connected::Linear<double>::forward(test_);
+	}
+
+	/// Identifiers of the threads that performed the forward passes of all layers of this type.
+	static std::set<std::thread::id> threads;
+
+	/// Mutex protecting the set of threads.
+	static std::mutex mutex;
+};
+
+std::set<std::thread::id> ThreadRecordingLinear::threads;
+std::mutex ThreadRecordingLinear::mutex;
+
+/*!
+ * Builds a small classification network - used by the tests of sharded evaluation.
+ */
+void buildClassifier(mic::mlnn::BackpropagationNeuralNetwork<double> & net_) {
+	net_.pushLayer(new mic::mlnn::fully_connected::Linear<double>(6, 8));
+	net_.pushLayer(new mic::mlnn::activation_function::ReLU<double>(8));
+	net_.pushLayer(new mic::mlnn::fully_connected::Linear<double>(8, 4));
+	net_.pushLayer(new mic::mlnn::cost_function::Softmax<double>(4));
+}
+
+/*!
+ * Checks whether the sharded evaluation gives the same results as the evaluation of samples one by one, regardless of the number of shards.
+ */
+TEST(ShardedEvaluation, EquivalenceWithSerialEvaluation) {
+	double eps = 1e-10;
+	mic::mlnn::BackpropagationNeuralNetwork<double> net;
+	buildClassifier(net);
+	(*net.layers[0]->p["b"]).setConstant(0.1);
+
+	// Dataset - 23 samples, so the last batch is smaller.
+	size_t samples = 23;
+	std::vector<mic::types::MatrixPtr<double> > data;
+	std::vector<std::shared_ptr<unsigned int> > labels;
+	for (size_t i=0; i<samples; i++) {
+		data.push_back(MAKE_MATRIX_PTR(double, 6, 1));
+		data.back()->rand(-1.0, 1.0);
+		labels.push_back(std::make_shared<unsigned int>(i % 4));
+	}//: for
+
+	// Evaluate samples one by one.
+	size_t correct = 0, correct_top_2 = 0;
+	double loss = 0;
+	mic::mlnn::EvaluationResults::ConfusionMatrix confusion = mic::mlnn::EvaluationResults::ConfusionMatrix::Zero(4, 4);
+	mic::types::MatrixPtr<double> target = MAKE_MATRIX_PTR(double, 4, 1);
+	for (size_t i=0; i<samples; i++) {
+		target->setZero();
+		(*target)(*labels[i], 0) = 1;
+		loss += net.test(data[i], target);
+		mic::types::MatrixPtr<double> predictions = net.getPredictions();
+		correct += net.countCorrectPredictions(target, predictions);
+		mic::types::Matrix<double>::Index predicted;
+		predictions->col(0).maxCoeff(&predicted);
+		confusion(*labels[i], predicted)++;
+		size_t greater = 0;
+		for (size_t c=0; c<4; c++)
+			if ((*predictions)(c, 0) > (*predictions)(*labels[i], 0))
+				greater++;
+		if (greater < 2)
+			correct_top_2++;
+	}//: for
+	loss /= samples;
+
+	mic::mlnn::EvaluationResults results[2];
+	for (size_t n=0; n<2; n++) {
+		mic::mlnn::ShardedEvaluator<double> evaluator(buildClassifier, 4, 5, 1 + 2*n, 2);
+		results[n] = evaluator.evaluate(net, data, labels);
+
+		ASSERT_EQ(results[n].samples, samples);
+		ASSERT_EQ(results[n].correct, correct);
+		ASSERT_EQ(results[n].correct_top_k, correct_top_2);
+		ASSERT_LE( fabs(results[n].loss - loss), eps);
+		ASSERT_EQ(results[n].confusion, confusion);
+		ASSERT_EQ((size_t)results[n].confusion.sum(), samples);
+	}//: for
+	// The losses are reduced in the order of batches.
+	ASSERT_EQ(results[0].loss, results[1].loss);
+}
+
+/*!
+ * Checks whether the sharded evaluation follows the changes of parameters and refuses to evaluate a network of different architecture.
+ */
+TEST(ShardedEvaluation, CopiesParameters) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> net;
+	buildClassifier(net);
+
+	std::vector<mic::types::MatrixPtr<double> > data(1, MAKE_MATRIX_PTR(double, 6, 1));
+	std::vector<std::shared_ptr<unsigned int> > labels(1, std::make_shared<unsigned int>(2));
+	data[0]->setConstant(1.0);
+
+	mic::mlnn::ShardedEvaluator<double> evaluator(buildClassifier, 4, 5, 2, 1);
+	// Make the label the only possible prediction.
+	net.layers[2]->p["W"]->setZero();
+	(*net.layers[2]->p["b"]).setZero();
+	(*net.layers[2]->p["b"])(2, 0) = 10.0;
+	ASSERT_EQ(evaluator.evaluate(net, data, labels).correct, 1);
+	// ... and impossible.
+	(*net.layers[2]->p["b"])(2, 0) = -10.0;
+	ASSERT_EQ(evaluator.evaluate(net, data, labels).correct, 0);
+
+	// Network with a different architecture.
+	net.popLayer();
+	net.pushLayer(new mic::mlnn::fully_connected::Linear<double>(4, 4));
+	ASSERT_THROW(evaluator.evaluate(net, data, labels), std::invalid_argument);
+}
+
+/*!
+ * Checks whether copying of parameters refuses layers with parameters of the same sizes, but different hyper-parameters or sparsity patterns.
+ */
+TEST(ParameterCopies, RefuseDifferentHyperParameters) {
+	using mic::mlnn::convolution::Convolution;
+	// Convolutions with different stride and padding - with outputs and filters of the same sizes.
+	mic::mlnn::BackpropagationNeuralNetwork<double> conv[3];
+	conv[0].pushLayer(new Convolution<double>(7, 7, 1, 2, 3, 1, 0));
+	conv[1].pushLayer(new Convolution<double>(7, 7, 1, 2, 3, 2, 2));
+	conv[2].pushLayer(new Convolution<double>(7, 7, 1, 2, 3, 1, 0));
+	ASSERT_EQ(conv[1].layers[0]->outputSize(), conv[0].layers[0]->outputSize());
+	ASSERT_THROW(conv[1].copyParameters(conv[0]), std::invalid_argument);
+	ASSERT_NO_THROW(conv[2].copyParameters(conv[0]));
+	// ... and with different algorithms.
+	conv[2].getLayer<Convolution<double> >(0)->setAlgorithm(mic::mlnn::convolution::ConvolutionAlgorithm::FFT);
+	ASSERT_THROW(conv[2].copyParameters(conv[0]), std::invalid_argument);
+
+	// Pruned layers with the same number of nonzeros, but (random) different patterns.
+	mic::mlnn::BackpropagationNeuralNetwork<double> pruned[2];
+	for (size_t n=0; n<2; n++)
+		pruned[n].pushLayer(new mic::mlnn::fully_connected::PrunedLinear<double>(10, 8, 0.5));
+	ASSERT_EQ(pruned[1].getLayer<mic::mlnn::fully_connected::PrunedLinear<double> >(0)->nonzeros(),
+			pruned[0].getLayer<mic::mlnn::fully_connected::PrunedLinear<double> >(0)->nonzeros());
+	mic::types::Matrix<double> W = (*pruned[1].layers[0]->p["W"]);
+	ASSERT_THROW(pruned[1].copyParameters(pruned[0]), std::invalid_argument);
+	// Nothing was copied.
+	ASSERT_EQ((*pruned[1].layers[0]->p["W"]), W);
+}
+
+
+/*!
+ * Builds the small classification network with a first layer recording the threads - used by the tests of sharded evaluation.
+ */
+void buildRecordingClassifier(mic::mlnn::BackpropagationNeuralNetwork<double> & net_) {
+	net_.pushLayer(new ThreadRecordingLinear(6, 8));
+	net_.pushLayer(new mic::mlnn::activation_function::ReLU<double>(8));
+	net_.pushLayer(new mic::mlnn::fully_connected::Linear<double>(8, 4));
+	net_.pushLayer(new mic::mlnn::cost_function::Softmax<double>(4));
+}
+
+/*!
+ * Checks whether the shards run on separate threads and the smaller last batch is assembled in the buffers of the whole capacity.
+ */
+TEST(ShardedEvaluation, RunsShardsOnThreadsWithoutReallocation) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> net;
+	buildRecordingClassifier(net);
+
+	// Dataset - 13 samples, so the last of 3 batches is smaller.
+	std::vector<mic::types::MatrixPtr<double> > data;
+	std::vector<std::shared_ptr<unsigned int> > labels;
+	for (size_t i=0; i<13; i++) {
+		data.push_back(MAKE_MATRIX_PTR(double, 6, 1));
+		data.back()->rand(-1.0, 1.0);
+		labels.push_back(std::make_shared<unsigned int>(i % 4));
+	}//: for
+
+	mic::mlnn::ShardedEvaluator<double> evaluator(buildRecordingClassifier, 4, 5, 3, 1);
+	ASSERT_EQ(evaluator.evaluate(net, data, labels).samples, 13);
+
+	// Remember the buffers of the workers.
+	std::vector<double*> buffers;
+	for (size_t w=0; w<3; w++) {
+		buffers.push_back(evaluator.inputs[w]->data());
+		buffers.push_back(evaluator.targets[w]->data());
+		buffers.push_back(evaluator.workers[w]->getOutputs()->data());
+	}//: for
+
+	ThreadRecordingLinear::threads.clear();
+	ASSERT_EQ(evaluator.evaluate(net, data, labels).samples, 13);
+
+	// Every shard was processed by a different thread.
+	ASSERT_EQ(ThreadRecordingLinear::threads.size(), 3);
+
+	// The buffers kept their capacity.
+	for (size_t w=0; w<3; w++) {
+		ASSERT_EQ(evaluator.inputs[w]->cols(), 5);
+		ASSERT_EQ(evaluator.targets[w]->cols(), 5);
+		ASSERT_EQ(evaluator.inputs[w]->data(), buffers[3*w]);
+		ASSERT_EQ(evaluator.targets[w]->data(), buffers[3*w + 1]);
+		ASSERT_EQ(evaluator.workers[w]->getOutputs()->data(), buffers[3*w + 2]);
+	}//: for
+}
+
+
+/*!
+ * Builds a single, realistic-size linear layer - used by the tests of gradient checks.
+ */
+void buildLinear784x100(mic::mlnn::BackpropagationNeuralNetwork<double> & net_) {
+	net_.pushLayer(new mic::mlnn::fully_connected::Linear<double>(784, 100));
+}
+
+/*!
+ * Checks gradients of a realistic-size linear layer along random directions and on a random subset of coordinates.
+ */
+TEST(GradientChecks, Linear784x100) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> net;
+	buildLinear784x100(net);
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 784, 4);
+	mic::types::MatrixPtr<double> target = MAKE_MATRIX_PTR(double, 100, 4);
+	x->rand(-1.0, 1.0);
+	target->rand(-1.0, 1.0);
+
+	mic::mlnn::GradientChecker<double> checker(buildLinear784x100, 1e-5, 1e-6, true, 2);
+	mic::mlnn::GradientCheckResults directions = checker.checkDirections(net, x, target, 8);
+	ASSERT_TRUE(directions.passed()) << "Max error: " << directions.max_error;
+
+	mic::mlnn::GradientCheckResults coordinates = checker.checkCoordinates(net, x, target, 200);
+	ASSERT_TRUE(coordinates.passed()) << "Max error: " << coordinates.max_error;
+	// With 200 passed checks the fraction of failing coordinates is below 2% (at 95% confidence).
+	ASSERT_LE(coordinates.failure_rate_bound, 0.02);
+}
+
+/*!
+ * Builds a small regression network - used by the tests of gradient checks.
+ */
+void buildRegressor(mic::mlnn::BackpropagationNeuralNetwork<double> & net_) {
+	net_.pushLayer(new mic::mlnn::fully_connected::Linear<double>(6, 8));
+	net_.pushLayer(new mic::mlnn::activation_function::ELU<double>(8));
+	net_.pushLayer(new mic::mlnn::fully_connected::Linear<double>(8, 4));
+	net_.pushLayer(new mic::mlnn::activation_function::Sigmoid<double>(4));
+}
+
+/*!
+ * Checks gradients of a whole network - the results should not depend on the number of threads.
+ */
+TEST(GradientChecks, WholeNetwork) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> net;
+	buildRegressor(net);
+	(*net.layers[0]->p["b"]).setConstant(0.1);
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 6, 3);
+	mic::types::MatrixPtr<double> target = MAKE_MATRIX_PTR(double, 4, 3);
+	x->rand(-1.0, 1.0);
+	target->rand(0.0, 1.0);
+
+	mic::mlnn::GradientCheckResults results[2];
+	for (size_t n=0; n<2; n++) {
+		mic::mlnn::GradientChecker<double> checker(buildRegressor, 1e-5, 1e-6, true, 1 + 2*n, 7);
+		results[n] = checker.checkDirections(net, x, target, 10);
+		ASSERT_TRUE(results[n].passed()) << "Max error: " << results[n].max_error;
+		results[n] = checker.checkCoordinates(net, x, target, 50);
+		ASSERT_TRUE(results[n].passed()) << "Max error: " << results[n].max_error;
+	}//: for
+	ASSERT_EQ(results[0].max_error, results[1].max_error);
+
+	// Copies of a different architecture cannot be checked.
+	mic::mlnn::GradientChecker<double> wrong_checker(buildClassifier, 1e-5, 1e-6, true, 2, 7);
+	ASSERT_THROW(wrong_checker.checkDirections(net, x, target, 10), std::invalid_argument);
+}
+
+/*!
+ * \brief Linear layer with a broken back-propagation - doubles the gradients of weights (and records the threads performing its forward passes).
+ */
+class BrokenLinear : public ThreadRecordingLinear {
+public:
+	BrokenLinear(size_t inputs_, size_t outputs_) : ThreadRecordingLinear(inputs_, outputs_) { }
+
+	void backward() {
+		ThreadRecordingLinear::backward();
+		(*g["W"]) *= 2.0;
+	}
+};
+
+/*!
+ * Builds the regressor with a broken first layer - used by the tests of gradient checks.
+ */
+void buildBrokenRegressor(mic::mlnn::BackpropagationNeuralNetwork<double> & net_) {
+	net_.pushLayer(new BrokenLinear(6, 8));
+	net_.pushLayer(new mic::mlnn::activation_function::ELU<double>(8));
+	net_.pushLayer(new mic::mlnn::fully_connected::Linear<double>(8, 4));
+	net_.pushLayer(new mic::mlnn::activation_function::Sigmoid<double>(4));
+}
+
+/*!
+ * Checks whether the checks (run on separate threads) detect corrupted gradients.
+ */
+TEST(GradientChecks, DetectsCorruptedGradients) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> net;
+	buildBrokenRegressor(net);
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 6, 3);
+	mic::types::MatrixPtr<double> target = MAKE_MATRIX_PTR(double, 4, 3);
+	x->rand(-1.0, 1.0);
+	target->rand(0.0, 1.0);
+
+	mic::mlnn::GradientChecker<double> checker(buildBrokenRegressor, 1e-5, 1e-6, true, 3, 7);
+	ThreadRecordingLinear::threads.clear();
+	mic::mlnn::GradientCheckResults directions = checker.checkDirections(net, x, target, 10);
+	ASSERT_EQ(directions.checks, 10);
+	ASSERT_GT(directions.failures, 0);
+
+	// Every workspace was used by a different thread.
+	ASSERT_EQ(ThreadRecordingLinear::threads.size(), 3);
+
+	mic::mlnn::GradientCheckResults coordinates = checker.checkCoordinates(net, x, target, 50);
+	ASSERT_EQ(coordinates.checks, 50);
+	ASSERT_GT(coordinates.failures, 0);
+}
+
+
+/*!
+ * Checks whether training with gradients accumulated over micro-batches gives the same results as training with the whole batch.
+ */
+TEST(GradientAccumulation, EquivalenceWithWholeBatch) {
+	double eps = 1e-10;
+	mic::mlnn::BackpropagationNeuralNetwork<double> net, accumulating_net;
+	buildRegressor(net);
+	buildRegressor(accumulating_net);
+	net.setLoss<mic::neural_nets::loss::SquaredErrorLoss<double> >();
+	accumulating_net.setLoss<mic::neural_nets::loss::SquaredErrorLoss<double> >();
+	net.setOptimization<mic::neural_nets::optimization::Adam<double> >();
+	accumulating_net.setOptimization<mic::neural_nets::optimization::Adam<double> >();
+	// Fused layers accumulate the gradients in the same way.
+	accumulating_net.fuseLayers();
+	ASSERT_NO_THROW(accumulating_net.copyParameters(net));
+
+	// Batch of 10 samples - processed in micro-batches of 4, 4 and 2 samples.
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 6, 10);
+	mic::types::MatrixPtr<double> target = MAKE_MATRIX_PTR(double, 4, 10);
+	x->rand(-1.0, 1.0);
+	target->rand(0.0, 1.0);
+
+	for (size_t step=0; step<3; step++) {
+		double loss = net.train(x, target, 0.01);
+		double accumulated_loss = accumulating_net.trainAccumulated(x, target, 4, 0.01);
+		ASSERT_LE( fabs(loss - accumulated_loss), eps);
+		ASSERT_EQ(accumulating_net.accumulatedSamples(), 0);
+
+		std::vector<mic::types::MatrixPtr<double> > params = net.getParameters();
+		std::vector<mic::types::MatrixPtr<double> > accumulated_params = accumulating_net.getParameters();
+		for (size_t i=0; i<params.size(); i++)
+			for (size_t j=0; j<(size_t)params[i]->size(); j++)
+				ASSERT_LE( fabs((*params[i])[j] - (*accumulated_params[i])[j]), eps) << "Step " << step << ", parameter " << i;
+	}//: for
+
+	// Buffers of the micro-batches are reused - the last micro-batch (of 2 samples) is stored in their leading columns.
+	double* micro_batch = accumulating_net.micro_batch->data();
+	double* micro_targets = accumulating_net.micro_targets->data();
+	accumulating_net.trainAccumulated(x, target, 4, 0.01);
+	ASSERT_EQ(accumulating_net.micro_batch->data(), micro_batch);
+	ASSERT_EQ(accumulating_net.micro_targets->data(), micro_targets);
+	ASSERT_EQ(accumulating_net.micro_batch->cols(), 4);
+	ASSERT_EQ(accumulating_net.getPredictions()->cols(), 2);
+
+	// Accumulation with explicit micro-batches.
+	accumulating_net.accumulateGradients(x, target);
+	ASSERT_EQ(accumulating_net.accumulatedSamples(), 10);
+	accumulating_net.accumulateGradients(x, target);
+	ASSERT_EQ(accumulating_net.accumulatedSamples(), 20);
+	accumulating_net.resetAccumulatedGradients();
+	ASSERT_EQ(accumulating_net.accumulatedSamples(), 0);
+}
+
+
+/*!
+ * Returns the data pointers of all batches, gradients and memory matrices of the network - used for checking whether the buffers were reallocated.
+ */
+std::vector<double*> bufferPointers(mic::mlnn::BackpropagationNeuralNetwork<double> & net_) {
+	std::vector<double*> pointers;
+	for (size_t i=0; i<net_.layers.size(); i++) {
+		for (auto& key: net_.layers[i]->s.keys())
+			pointers.push_back(net_.layers[i]->s[key.second]->data());
+		for (auto& key: net_.layers[i]->g.keys())
+			pointers.push_back(net_.layers[i]->g[key.second]->data());
+		for (auto& key: net_.layers[i]->m.keys())
+			pointers.push_back(net_.layers[i]->m[key.second]->data());
+	}//: for
+	return pointers;
+}
+
+/*!
+ * Builds a small convolutional classification network (optionally with dropout after the hidden linear layer) - used by the tests of checkpointing and of the buffers.
+ */
+void buildConvClassifier(mic::mlnn::BackpropagationNeuralNetwork<double> & net_, bool dropout_ = false) {
+	net_.pushLayer(new mic::mlnn::convolution::Convolution<double>(6, 6, 1, 2, 3, 1));
+	net_.pushLayer(new mic::mlnn::activation_function::ReLU<double>(4, 4, 2));
+	net_.pushLayer(new mic::mlnn::convolution::MaxPooling<double>(4, 4, 2, 2));
+	net_.pushLayer(new mic::mlnn::fully_connected::Linear<double>(8, 6));
+	net_.pushLayer(new mic::mlnn::activation_function::ReLU<double>(6));
+	if (dropout_)
+		net_.pushLayer(new mic::mlnn::regularisation::Dropout<double>(6, 0.5));
+	net_.pushLayer(new mic::mlnn::fully_connected::Linear<double>(6, 4));
+	net_.pushLayer(new mic::mlnn::cost_function::Softmax<double>(4));
+}
+
+/*!
+ * Checks whether the gradients computed with checkpointed (pooled and recomputed) activations are the same as the ones computed with all activations stored.
+ */
+TEST(Checkpointing, EquivalenceWithStoredActivations) {
+	double eps = 1e-12;
+	for (size_t fuse=0; fuse<2; fuse++) {
+		mic::mlnn::BackpropagationNeuralNetwork<double> net;
+		buildConvClassifier(net, true);
+		net.setLoss<mic::neural_nets::loss::CrossEntropyLoss<double> >();
+		net.fuseLayers(fuse == 1);
+		net.enableCheckpointing();
+
+		mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 36, 5);
+		mic::types::MatrixPtr<double> target = MAKE_MATRIX_PTR(double, 4, 5);
+		x->rand(-1.0, 1.0);
+		target->rand(0.0, 1.0);
+
+		// Checkpointed pass - the outputs inside all segments but the last one are pooled.
+		net.forward(x);
+		ASSERT_EQ(net.segment_heads.size(), 3);
+		ASSERT_FALSE(net.outputStored(0));
+		ASSERT_TRUE(net.outputStored(2));
+		ASSERT_TRUE(net.outputStored(6));
+		ASSERT_EQ(net.getPredictions()->cols(), 5);
+		mic::types::MatrixPtr<double> predictions = MAKE_MATRIX_PTR(double, 4, 5);
+		(*predictions) = (*net.getPredictions());
+		net.backward(net.loss->calculateGradient(target, predictions));
+		std::vector<mic::types::MatrixPtr<double> > grads;
+		for (auto& grad: net.getParameterGradients())
+			grads.push_back(std::make_shared<mic::types::Matrix<double> >(*grad));
+		mic::types::Matrix<double> dx = (*net.layers[0]->g['x']);
+
+		// The same pass with all activations stored - using the same dropout mask.
+		net.enableCheckpointing(false);
+		std::static_pointer_cast<mic::mlnn::regularisation::Dropout<double> >(net.layers[5])->replayMask();
+		net.forward(x);
+		for (size_t i=0; i<(size_t)predictions->size(); i++)
+			ASSERT_LE( fabs((*predictions)[i] - (*net.getPredictions())[i]), eps);
+		net.backward(net.loss->calculateGradient(target, net.getPredictions()));
+
+		std::vector<mic::types::MatrixPtr<double> > stored_grads = net.getParameterGradients();
+		ASSERT_EQ(grads.size(), stored_grads.size());
+		for (size_t i=0; i<grads.size(); i++)
+			for (size_t j=0; j<(size_t)grads[i]->size(); j++)
+				ASSERT_LE( fabs((*grads[i])[j] - (*stored_grads[i])[j]), eps) << "Fused: " << fuse << ", parameter " << i;
+		for (size_t i=0; i<(size_t)dx.size(); i++)
+			ASSERT_LE( fabs(dx(i) - (*net.layers[0]->g['x'])(i)), eps);
+
+		// Outputs have their own buffers again - only the outputs of fused linear layers are not computed.
+		ASSERT_TRUE(net.activation_pool.empty());
+		for (size_t i=0; i<net.layers.size(); i++)
+			ASSERT_EQ(net.outputStored(i), net.fused_heads[i] != (int)i);
+	}//: for
+}
+
+/*!
+ * Checks whether the outputs of the same size inside checkpointed segments share buffers, which are not reallocated during the training of the compiled network.
+ */
+TEST(Checkpointing, SharesPooledBuffers) {
+	double eps = 1e-12;
+	mic::mlnn::BackpropagationNeuralNetwork<double> nets[2];
+	for (size_t n=0; n<2; n++) {
+		for (size_t l=0; l<4; l++) {
+			nets[n].pushLayer(new mic::mlnn::fully_connected::Linear<double>(6, 6));
+			nets[n].pushLayer(new mic::mlnn::activation_function::ReLU<double>(6));
+		}//: for
+		nets[n].pushLayer(new mic::mlnn::fully_connected::Linear<double>(6, 4));
+		nets[n].pushLayer(new mic::mlnn::cost_function::Softmax<double>(4));
+		nets[n].setLoss<mic::neural_nets::loss::CrossEntropyLoss<double> >();
+	}//: for
+	ASSERT_NO_THROW(nets[1].copyParameters(nets[0]));
+	nets[1].enableCheckpointing();
+	ASSERT_TRUE(nets[1].compile(5));
+
+	// Segments of 4 layers - the (three) outputs inside the first two segments share three buffers.
+	ASSERT_EQ(nets[1].segment_heads.size(), 3);
+	ASSERT_EQ(nets[1].layers[0]->s['y'], nets[1].layers[4]->s['y']);
+	ASSERT_EQ(nets[1].layers[2]->s['y'], nets[1].layers[6]->s['y']);
+	ASSERT_NE(nets[1].layers[3]->s['y'], nets[1].layers[7]->s['y']);
+	for (size_t i=0; i<nets[1].layers.size(); i++)
+		ASSERT_EQ(nets[1].outputStored(i), (i % 4 == 3) || (i >= 8)) << "Layer " << i;
+	std::vector<double*> pointers = bufferPointers(nets[1]);
+
+	size_t batch_sizes[] = { 5, 3, 5 };
+	for (auto batch_size : batch_sizes) {
+		mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 6, batch_size);
+		mic::types::MatrixPtr<double> target = MAKE_MATRIX_PTR(double, 4, batch_size);
+		x->rand(-1.0, 1.0);
+		target->setZero();
+		for (size_t i=0; i<batch_size; i++)
+			(*target)(i % 4, i) = 1.0;
+
+		double loss = nets[0].train(x, target, 0.1);
+		ASSERT_LE(fabs(loss - nets[1].train(x, target, 0.1)), eps) << "Batch of size " << batch_size;
+	}//: for
+	std::vector<double*> trained_pointers = bufferPointers(nets[1]);
+	ASSERT_EQ(pointers.size(), trained_pointers.size());
+	for (size_t i=0; i<pointers.size(); i++)
+		ASSERT_EQ(pointers[i], trained_pointers[i]) << "Buffer " << i;
+
+	// Stored outputs can be read after the training.
+	std::vector<double> scores = nets[1].rankUnits(8, mic::mlnn::PruningCriterion::MeanActivation);
+	std::vector<double> reference_scores = nets[0].rankUnits(8, mic::mlnn::PruningCriterion::MeanActivation);
+	for (size_t u=0; u<scores.size(); u++)
+		ASSERT_LE(fabs(scores[u] - reference_scores[u]), eps);
+}
+
+
+/*!
+ * \brief ReLU layer counting its forward passes.
+ */
+class CountingReLU : public mic::mlnn::activation_function::ReLU<double> {
+public:
+	CountingReLU(size_t size_) : mic::mlnn::activation_function::ReLU<double>(size_), forward_passes(0) { }
+
+	void forward(bool test_ = false) {
+		forward_passes++;
+		mic::mlnn::activation_function::ReLU<double>::forward(test_);
+	}
+
+	/// Number of forward passes.
+	size_t forward_passes;
+};
+
+/*!
+ * Checks whether only the layers inside checkpointed segments are recomputed during the backward pass - the (stored) checkpoints are not.
+ */
+TEST(Checkpointing, DoesNotRecomputeCheckpoints) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> net;
+	std::vector<CountingReLU*> relus;
+	for (size_t l=0; l<4; l++) {
+		net.pushLayer(new mic::mlnn::fully_connected::Linear<double>(6, 6));
+		relus.push_back(new CountingReLU(6));
+		net.pushLayer(relus.back());
+	}//: for
+	net.pushLayer(new mic::mlnn::fully_connected::Linear<double>(6, 4));
+	net.pushLayer(new mic::mlnn::cost_function::Softmax<double>(4));
+	net.setLoss<mic::neural_nets::loss::CrossEntropyLoss<double> >();
+	net.enableCheckpointing();
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 6, 5);
+	mic::types::MatrixPtr<double> target = MAKE_MATRIX_PTR(double, 4, 5);
+	x->rand(-1.0, 1.0);
+	target->setZero();
+	for (size_t i=0; i<5; i++)
+		(*target)(i % 4, i) = 1.0;
+	net.train(x, target, 0.1);
+
+	// Segments of 4 layers - the second and fourth ReLUs are the checkpoints of the first two segments.
+	ASSERT_EQ(net.segment_heads.size(), 3);
+	ASSERT_EQ(relus[0]->forward_passes, 2);
+	ASSERT_EQ(relus[1]->forward_passes, 1);
+	ASSERT_EQ(relus[2]->forward_passes, 2);
+	ASSERT_EQ(relus[3]->forward_passes, 1);
+}
+
+/*!
+ * Checks whether training of the compiled network neither allocates nor reallocates any buffers and gives the same results as training of the not compiled one.
+ */
+TEST(Compilation, PreallocatesBuffers) {
+	double eps = 1e-12;
+	mic::mlnn::BackpropagationNeuralNetwork<double> nets[2];
+	for (size_t n=0; n<2; n++) {
+		buildConvClassifier(nets[n]);
+		nets[n].setLoss<mic::neural_nets::loss::CrossEntropyLoss<double> >();
+	}//: for
+	ASSERT_NO_THROW(nets[1].copyParameters(nets[0]));
+
+	// Compile the second network.
+	ASSERT_FALSE(nets[1].isCompiled());
+	ASSERT_TRUE(nets[1].compile(5));
+	ASSERT_TRUE(nets[1].isCompiled());
+	ASSERT_EQ(nets[1].compiledBatchSize(), 5);
+	std::vector<double*> pointers = bufferPointers(nets[1]);
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 36, 5);
+	mic::types::MatrixPtr<double> target = MAKE_MATRIX_PTR(double, 4, 5);
+	x->rand(-1.0, 1.0);
+	target->setZero();
+	for (size_t i=0; i<5; i++)
+		(*target)(i % 4, i) = 1.0;
+
+	for (size_t step=0; step<3; step++) {
+		double losses[2];
+		for (size_t n=0; n<2; n++)
+			losses[n] = nets[n].train(x, target, 0.1);
+		ASSERT_LE(fabs(losses[0] - losses[1]), eps);
+	}//: for
+	for (size_t i=0; i<(size_t)nets[0].getPredictions()->size(); i++)
+		ASSERT_LE(fabs((*nets[0].getPredictions())[i] - (*nets[1].getPredictions())[i]), eps);
+
+	// No buffer was added nor reallocated.
+	std::vector<double*> trained_pointers = bufferPointers(nets[1]);
+	ASSERT_EQ(pointers.size(), trained_pointers.size());
+	for (size_t i=0; i<pointers.size(); i++)
+		ASSERT_EQ(pointers[i], trained_pointers[i]) << "Buffer " << i;
+
+	// A larger batch or a change of the structure invalidates the compilation.
+	nets[1].resizeBatch(6);
+	ASSERT_FALSE(nets[1].isCompiled());
+	ASSERT_TRUE(nets[1].compile(6));
+	nets[1].popLayer();
+	ASSERT_FALSE(nets[1].isCompiled());
+	ASSERT_EQ(nets[1].compiledBatchSize(), 0);
+}
+
+
+/*!
+ * Checks whether batches smaller than the capacity of the buffers are processed in their leading columns - without reallocation,
+ * giving the same results as a network with buffers of the exact size.
+ */
+TEST(CapacityBuffers, SmallerBatchesDoNotReallocate) {
+	double eps = 1e-12;
+	mic::mlnn::BackpropagationNeuralNetwork<double> net;
+	buildConvClassifier(net);
+	net.setLoss<mic::neural_nets::loss::CrossEntropyLoss<double> >();
+	ASSERT_TRUE(net.compile(5));
+	std::vector<double*> pointers = bufferPointers(net);
+
+	size_t batch_sizes[] = { 5, 3, 5, 2, 3 };
+	for (auto batch_size : batch_sizes) {
+		// Reference network - with buffers allocated for the current batch.
+		mic::mlnn::BackpropagationNeuralNetwork<double> reference;
+		buildConvClassifier(reference);
+		reference.setLoss<mic::neural_nets::loss::CrossEntropyLoss<double> >();
+		ASSERT_NO_THROW(reference.copyParameters(net));
+
+		mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 36, batch_size);
+		mic::types::MatrixPtr<double> target = MAKE_MATRIX_PTR(double, 4, batch_size);
+		x->rand(-1.0, 1.0);
+		target->setZero();
+		for (size_t i=0; i<batch_size; i++)
+			(*target)(i % 4, i) = 1.0;
+
+		double loss = net.train(x, target, 0.1);
+		ASSERT_LE(fabs(loss - reference.train(x, target, 0.1)), eps) << "Batch of size " << batch_size;
+
+		// Predictions contain only the samples of the current batch.
+		mic::types::MatrixPtr<double> predictions = net.getPredictions();
+		ASSERT_EQ((size_t)predictions->cols(), batch_size);
+		for (size_t i=0; i<(size_t)predictions->size(); i++)
+			ASSERT_LE(fabs((*predictions)[i] - (*reference.getPredictions())[i]), eps) << "Batch of size " << batch_size;
+
+		// Parameters after the update.
+		for (size_t l=0; l<net.layers.size(); l++)
+			for (auto& key: net.layers[l]->p.keys())
+				for (size_t i=0; i<(size_t)net.layers[l]->p[key.second]->size(); i++)
+					ASSERT_LE(fabs((*net.layers[l]->p[key.second])[i] - (*reference.layers[l]->p[key.second])[i]), eps)
+						<< "Batch of size " << batch_size << ", layer " << l << ", parameter " << key.first;
+	}//: for
+
+	// Predictions are copies - neither aliasing the outputs nor changed by the next passes, whatever the size of the batch.
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 36, 2);
+	x->rand(-1.0, 1.0);
+	for (size_t batch_size = 2; batch_size <= 5; batch_size += 3) {
+		mic::types::MatrixPtr<double> batch = MAKE_MATRIX_PTR(double, 36, batch_size);
+		batch->rand(-1.0, 1.0);
+		net.forward(batch);
+		mic::types::MatrixPtr<double> predictions = net.getPredictions();
+		mic::types::Matrix<double> copy = (*predictions);
+		ASSERT_NE(predictions, net.getOutputs());
+		ASSERT_NE(predictions->data(), net.getOutputs()->data());
+		net.forward(x);
+		for (size_t i=0; i<(size_t)copy.size(); i++)
+			ASSERT_EQ(copy(i), (*predictions)[i]) << "Batch of size " << batch_size;
+	}//: for
+
+	// Neither buffer was reallocated and the network remains compiled.
+	ASSERT_TRUE(net.isCompiled());
+	std::vector<double*> trained_pointers = bufferPointers(net);
+	ASSERT_EQ(pointers.size(), trained_pointers.size());
+	for (size_t i=0; i<pointers.size(); i++)
+		ASSERT_EQ(pointers[i], trained_pointers[i]) << "Buffer " << i;
+}
+
+/*!
+ * Checks whether alternating sizes of smaller batches (during training, testing and training with micro-batches) neither copies the predictions nor reallocates any buffer.
+ */
+TEST(CapacityBuffers, AlternatingBatchSizesDoNotReallocate) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> net;
+	buildConvClassifier(net);
+	net.setLoss<mic::neural_nets::loss::CrossEntropyLoss<double> >();
+	ASSERT_TRUE(net.compile(5));
+
+	// Batches of 10 samples - processed in micro-batches of 4, 4 and 2 samples.
+	mic::types::MatrixPtr<double> batch = MAKE_MATRIX_PTR(double, 36, 10);
+	mic::types::MatrixPtr<double> batch_target = MAKE_MATRIX_PTR(double, 4, 10);
+	batch->rand(-1.0, 1.0);
+	batch_target->setZero();
+	for (size_t i=0; i<10; i++)
+		(*batch_target)(i % 4, i) = 1.0;
+	net.trainAccumulated(batch, batch_target, 4, 0.1);
+
+	std::vector<double*> pointers = bufferPointers(net);
+	double* micro_batch = net.micro_batch->data();
+	double* micro_targets = net.micro_targets->data();
+
+	for (size_t step=0; step<4; step++) {
+		size_t batch_size = (step % 2) ? 2 : 3;
+		mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 36, batch_size);
+		mic::types::MatrixPtr<double> target = MAKE_MATRIX_PTR(double, 4, batch_size);
+		(*x) = batch->leftCols(batch_size);
+		(*target) = batch_target->leftCols(batch_size);
+
+		net.train(x, target, 0.1);
+		net.test(x, target);
+		net.trainAccumulated(batch, batch_target, 4, 0.1);
+
+		// The loss was computed on the leading columns of the outputs - without copying them into new buffers.
+		ASSERT_EQ(net.micro_batch->data(), micro_batch);
+		ASSERT_EQ(net.micro_targets->data(), micro_targets);
+		std::vector<double*> trained_pointers = bufferPointers(net);
+		ASSERT_EQ(pointers.size(), trained_pointers.size());
+		for (size_t i=0; i<pointers.size(); i++)
+			ASSERT_EQ(pointers[i], trained_pointers[i]) << "Step " << step << ", buffer " << i;
+	}//: for
+}
+
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -32,6 +32,8 @@
 #define private public
 #define protected public
 #include <mlnn/BackpropagationNeuralNetwork.hpp>
+#include <mlnn/ShardedEvaluator.hpp>
+#include <mlnn/GradientChecker.hpp>
 
 
 namespace mic { namespace neural_nets { namespace unit_tests {
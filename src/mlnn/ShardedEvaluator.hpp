@@ -0,0 +1,269 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file ShardedEvaluator.hpp
+ * \brief Evaluation of classification networks on whole datasets, sharded across threads.
+ * \date Oct 18, 2026
+ */
+
+#ifndef SRC_MLNN_SHARDEDEVALUATOR_HPP_
+#define SRC_MLNN_SHARDEDEVALUATOR_HPP_
+
+#include <mlnn/BackpropagationNeuralNetwork.hpp>
+
+#include <functional>
+#include <thread>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace mic {
+namespace mlnn {
+
+/*!
+ * \brief Results of evaluation of a classification network on a dataset.
+ * \author tkornuta
+ */
+struct EvaluationResults {
+	/// Type of the confusion matrix - rows correspond to the target classes, cols to the predicted ones.
+	typedef Eigen::Matrix<size_t, Eigen::Dynamic, Eigen::Dynamic> ConfusionMatrix;
+
+	/// Number of evaluated samples.
+	size_t samples = 0;
+
+	/// Number of samples with the target class predicted as the most probable one.
+	size_t correct = 0;
+
+	/// Number of samples with the target class among the top_k most probable ones.
+	size_t correct_top_k = 0;
+
+	/// Number of the most probable classes taken into account by correct_top_k.
+	size_t top_k = 0;
+
+	/// Mean value of the loss function (i.e. loss divided by the number of samples).
+	double loss = 0.0;
+
+	/// Confusion matrix [classes x classes].
+	ConfusionMatrix confusion;
+
+	/// Returns the fraction of correctly classified samples.
+	double accuracy() const {
+		return (samples ? (double)correct / (double)samples : 0.0);
+	}
+
+	/// Returns the fraction of samples with the target class among the top_k most probable ones.
+	double topKAccuracy() const {
+		return (samples ? (double)correct_top_k / (double)samples : 0.0);
+	}
+};
+
+
+/*!
+ * \brief Class evaluating a classification network on a whole dataset - the dataset is split into batches, which are sharded across threads.
+ * Each shard runs on its own thread and processes its batches with its own copy of the network (i.e. inference workspace), built with the same architecture by a user provided function,
+ * whereas the parameters are copied from the evaluated network at the beginning of every evaluation.
+ * The results do not depend on the number of shards: counts are integers and losses of batches are summed in the order of batches.
+ * \author tkornuta
+ * \tparam eT Template parameter denoting precision of variables (float for calculations/double for testing).
+ */
+template <typename eT=float>
+class ShardedEvaluator {
+public:
+	/// Type of the function building the network - it must push the same layers (and set the same loss function) as in the evaluated network.
+	typedef std::function<void (BackpropagationNeuralNetwork<eT> &)> NetworkBuilder;
+
+	/*!
+	 * Constructor. Remembers the parameters - copies of the network will be built during the first evaluation.
+	 * @param builder_ Function building the network.
+	 * @param classes_ Number of classes (i.e. size of the outputs of the network).
+	 * @param batch_size_ Size of batches processed by the shards - might be much bigger than the one used during the training (DEFAULT=1000).
+	 * @param shards_ Number of shards (DEFAULT=0 - number of hardware threads).
+	 * @param top_k_ Number of the most probable classes taken into account by top-k accuracy (DEFAULT=5).
+	 */
+	ShardedEvaluator(NetworkBuilder builder_, size_t classes_, size_t batch_size_ = 1000, size_t shards_ = 0, size_t top_k_ = 5) :
+		builder(builder_),
+		classes(classes_),
+		batch_size(batch_size_),
+		shards(shards_ ? shards_ : std::max<size_t>(1, std::thread::hardware_concurrency())),
+		top_k(top_k_)
+	{
+		assert(batch_size > 0);
+	}
+
+	/*!
+	 * Evaluates the network on a dataset.
+	 * @param net_ Evaluated network.
+	 * @param data_ Vector of pointers to samples, each being a matrix of size equal to the input size of the network.
+	 * @param labels_ Vector of pointers to labels, i.e. indices of the target classes.
+	 * @param samples_ Number of evaluated samples (DEFAULT=0 - all).
+	 * @tparam DataVector Type of the vector of samples (e.g. std::vector<mic::types::MatrixPtr<eT> >).
+	 * @tparam LabelVector Type of the vector of labels (e.g. std::vector<mic::types::UIntPtr>).
+	 * @return Results of the evaluation.
+	 * Throws std::invalid_argument if the copies of network differ from the evaluated one.
+	 */
+	template <typename DataVector, typename LabelVector>
+	EvaluationResults evaluate(BackpropagationNeuralNetwork<eT> & net_, const DataVector & data_, const LabelVector & labels_, size_t samples_ = 0) {
+		assert(data_.size() == labels_.size());
+		size_t samples = ((samples_ == 0) || (samples_ > data_.size())) ? data_.size() : samples_;
+		size_t batches = (samples + batch_size - 1) / batch_size;
+
+		// Build the workspaces - in the calling thread.
+		while (workers.size() < shards) {
+			std::shared_ptr<BackpropagationNeuralNetwork<eT> > worker = std::make_shared<BackpropagationNeuralNetwork<eT> >("evaluator");
+			builder(*worker);
+			workers.push_back(worker);
+			inputs.push_back(MAKE_MATRIX_PTR(eT, worker->getLayer(0)->inputSize(), batch_size));
+			targets.push_back(MAKE_MATRIX_PTR(eT, classes, batch_size));
+			worker->bindInput(inputs.back());
+		}//: while
+
+		// Results of shards - reduced afterwards.
+		std::vector<double> batch_losses(batches, 0.0);
+		std::vector<size_t> correct(shards, 0), correct_top_k(shards, 0);
+		std::vector<EvaluationResults::ConfusionMatrix> confusion(shards, EvaluationResults::ConfusionMatrix::Zero(classes, classes));
+
+		// Synchronize the copies - in the calling thread, so it receives the exception if the architectures differ.
+		for (auto & worker : workers)
+			worker->copyParameters(net_);
+
+		// Shard processing every shards-th batch.
+		auto shard = [&](size_t w) {
+			for (size_t b = w; b < batches; b += shards)
+				evaluateBatch(w, b * batch_size, std::min(batch_size, samples - b * batch_size), data_, labels_, batch_losses[b], correct[w], correct_top_k[w], confusion[w]);
+		};
+
+		// Run the shards on separate threads - the last one on the calling thread.
+		std::vector<std::thread> threads;
+		for (size_t w = 0; w + 1 < shards; w++)
+			threads.push_back(std::thread([&, w]() {
+#ifdef _OPENMP
+				// Shards already run in parallel - their layers do not start teams of OpenMP threads.
+				omp_set_num_threads(1);
+#endif
+				shard(w);
+			}));
+		shard(shards - 1);
+		for (auto& thread: threads)
+			thread.join();
+
+		// Reduce the results.
+		EvaluationResults results;
+		results.samples = samples;
+		results.top_k = top_k;
+		results.confusion = EvaluationResults::ConfusionMatrix::Zero(classes, classes);
+		for (size_t w = 0; w < shards; w++) {
+			results.correct += correct[w];
+			results.correct_top_k += correct_top_k[w];
+			results.confusion += confusion[w];
+		}//: for
+		for (size_t b = 0; b < batches; b++)
+			results.loss += batch_losses[b];
+		if (samples)
+			results.loss /= samples;
+
+		return results;
+	}
+
+	/// Returns the number of shards.
+	size_t shardsNumber() {
+		return shards;
+	}
+
+private:
+	/// Function building the copies of network.
+	NetworkBuilder builder;
+
+	/// Number of classes.
+	size_t classes;
+
+	/// Size of batches processed by the shards.
+	size_t batch_size;
+
+	/// Number of shards.
+	size_t shards;
+
+	/// Number of the most probable classes taken into account by top-k accuracy.
+	size_t top_k;
+
+	/// Copies of the network - one for each shard.
+	std::vector<std::shared_ptr<BackpropagationNeuralNetwork<eT> > > workers;
+
+	/// Batches bound as the inputs of the copies of network.
+	std::vector<mic::types::MatrixPtr<eT> > inputs;
+
+	/// Targets (1-out-of-k encoded labels) of the batches.
+	std::vector<mic::types::MatrixPtr<eT> > targets;
+
+	/*!
+	 * Evaluates a single batch with a given copy of the network.
+	 * @param w_ Index of the shard.
+	 * @param first_ Index of the first sample of the batch.
+	 * @param size_ Number of samples in the batch.
+	 * @param data_ Vector of pointers to samples.
+	 * @param labels_ Vector of pointers to labels.
+	 * @param loss_ Sum of losses of the samples of the batch.
+	 * @param correct_ Number of correctly classified samples (accumulated).
+	 * @param correct_top_k_ Number of samples with the target class among the top_k most probable ones (accumulated).
+	 * @param confusion_ Confusion matrix (accumulated).
+	 */
+	template <typename DataVector, typename LabelVector>
+	void evaluateBatch(size_t w_, size_t first_, size_t size_, const DataVector & data_, const LabelVector & labels_,
+			double & loss_, size_t & correct_, size_t & correct_top_k_, EvaluationResults::ConfusionMatrix & confusion_) {
+		mic::types::MatrixPtr<eT> x = inputs[w_];
+		mic::types::MatrixPtr<eT> t = targets[w_];
+		size_t sample_size = x->rows();
+
+		// Assemble the batch directly in the leading columns of the bound input - the last batch might be smaller.
+		t->leftCols(size_).setZero();
+		for (size_t i = 0; i < size_; i++) {
+			assert((size_t)data_[first_ + i]->size() == sample_size);
+			assert((size_t)(*labels_[first_ + i]) < classes);
+			x->col(i) = Eigen::Map<const Eigen::Matrix<eT, Eigen::Dynamic, 1> >(data_[first_ + i]->data(), sample_size);
+			(*t)((size_t)(*labels_[first_ + i]), i) = 1;
+		}//: for
+
+		// Forward the batch (skipping dropouts) - mean loss is converted to the sum.
+		loss_ = (double)workers[w_]->test(x, t, size_) * size_;
+
+		// Compare the predictions (stored in the leading columns of the outputs) with the targets.
+		mic::types::MatrixPtr<eT> predictions = workers[w_]->getOutputs();
+		for (size_t i = 0; i < size_; i++) {
+			size_t label = (size_t)(*labels_[first_ + i]);
+			typename mic::types::Matrix<eT>::Index predicted;
+			predictions->col(i).maxCoeff(&predicted);
+			confusion_(label, predicted)++;
+
+			// Rank of the target class - ties are resolved in favour of lower indices, as in the case of maxCoeff().
+			eT target_score = (*predictions)(label, i);
+			size_t rank = 0;
+			for (size_t c = 0; c < classes; c++)
+				if (((*predictions)(c, i) > target_score) || ((c < label) && ((*predictions)(c, i) == target_score)))
+					rank++;
+			if (rank == 0)
+				correct_++;
+			if (rank < top_k)
+				correct_top_k_++;
+		}//: for
+	}
+
+};
+
+} /* namespace mlnn */
+} /* namespace mic */
+
+#endif /* SRC_MLNN_SHARDEDEVALUATOR_HPP_ */
@@ -71,15 +71,31 @@ public:
 	 */
 	virtual ~ELU() {};
 
+	/*!
+	 * Computes the ELU value of a single element.
+	 * @param x_ Input value.
+	 */
+	static inline eT activation(eT x_) {
+		return x_ > 0.0f ? x_ : (std::exp(x_) - 1.0f);
+	}
+
+	/*!
+	 * Computes the ELU derivative of a single element on the basis of its output value - for negative inputs it is exp(x) = y + 1.
+	 * @param y_ Output value.
+	 */
+	static inline eT derivative(eT y_) {
+		return y_ > 0.0f ? 1.0f : (y_ + 1.0f);
+	}
+
 	void forward(bool test = false) {
 		// Access the data of both matrices.
 		eT* x = s['x']->data();
 		eT* y = s['y']->data();
 
 		// Iterate through elements.
-		size_t size = (size_t) s['x']->rows() * s['x']->cols();
+		size_t size = (size_t) s['x']->rows() * batch_size;
 		for (size_t i = 0; i < size;  i++) {
-			y[i] = x[i] > 0.0f ? x[i] : (expf(x[i]) - 1.0f);
+			y[i] = activation(x[i]);
 		}//: for
 	}
 
@@ -90,10 +106,10 @@ public:
 		eT* y = s['y']->data();
 
 		// Iterate through elements.
-		size_t size = (size_t) g['x']->rows() * g['x']->cols();
+		size_t size = (size_t) g['x']->rows() * batch_size;
 		for (size_t i = 0; i < size;  i++) {
 			// Calculate the ELU y derivative.
-			eT dy = y[i] > 0.0f ? 1.0f : exp(y[i]);
+			eT dy = derivative(y[i]);
 			// Pass the gradient.
 			gx[i] = dy * gy[i];
 
@@ -111,6 +127,7 @@ protected:
 	// Unhiding the template inherited fields via "using" statement.
     using Layer<eT>::g;
     using Layer<eT>::s;
+    using Layer<eT>::batch_size;
 
 private:
 	// Friend class - required for using boost serialization.
@@ -69,15 +69,31 @@ public:
 	 */
 	virtual ~ReLU() {};
 
+	/*!
+	 * Computes the ReLU value of a single element.
+	 * @param x_ Input value.
+	 */
+	static inline eT activation(eT x_) {
+		return fmax(x_, 0.0f); //: floats - fmax
+	}
+
+	/*!
+	 * Computes the ReLU "derivative" of a single element on the basis of its output value.
+	 * @param y_ Output value.
+	 */
+	static inline eT derivative(eT y_) {
+		return (eT)(y_ > 0.0);
+	}
+
 	void forward(bool apply_dropout = false) {
 		// Access the data of both matrices.
 		eT* x = s['x']->data();
 		eT* y = s['y']->data();
 
 		// Iterate through elements.
-		size_t size = s['x']->rows() * s['x']->cols();
+		size_t size = s['x']->rows() * batch_size;
 		for (size_t i = 0; i < size;  i++) {
-			y[i] = fmax(x[i], 0.0f); //: floats - fmax
+			y[i] = activation(x[i]);
 		}//: for
 
 /*		std::cout << "ReLU forward: s['x'] = \n" << (*s['x']) << std::endl;
@@ -91,10 +107,10 @@ public:
 		eT* y = s['y']->data();
 
 		// Iterate through elements.
-		size_t size = g['x']->rows() * g['x']->cols();
+		size_t size = g['x']->rows() * batch_size;
 		for (size_t i = 0; i < size; i++) {
 			// Calculate the ReLU "derivative".
-			eT dy = (eT)(y[i] > 0.0);
+			eT dy = derivative(y[i]);
 			// Pass the gradient.
 			gx[i] = dy * gy[i];
 
@@ -115,6 +131,7 @@ protected:
 	// Unhiding the template inherited fields via "using" statement.
     using Layer<eT>::g;
     using Layer<eT>::s;
+    using Layer<eT>::batch_size;
 
 private:
 	// Friend class - required for using boost serialization.
@@ -69,13 +69,29 @@ public:
 	 */
 	virtual ~Sigmoid() {};
 
+	/*!
+	 * Computes the sigmoid value of a single element.
+	 * @param x_ Input value.
+	 */
+	static inline eT activation(eT x_) {
+		return 1.0f / (1.0f +::exp(-x_)); //: float -> expf
+	}
+
+	/*!
+	 * Computes the sigmoid derivative of a single element on the basis of its output value.
+	 * @param y_ Output value.
+	 */
+	static inline eT derivative(eT y_) {
+		return (y_ * (1.0 - y_));
+	}
+
 	void forward(bool test = false) {
 		// Access the data of both matrices.
 		eT* x = s['x']->data();
 		eT* y = s['y']->data();
 
-		for (size_t i = 0; i < (size_t)s['x']->rows() * s['x']->cols(); i++) {
-			y[i] = 1.0f / (1.0f +::exp(-x[i])); //: float -> expf
+		for (size_t i = 0; i < (size_t)s['x']->rows() * batch_size; i++) {
+			y[i] = activation(x[i]);
 		}//: for
 	}
 
@@ -85,9 +101,9 @@ public:
 		eT* gy = g['y']->data();
 		eT* y = s['y']->data();
 
-		for (size_t i = 0; i < (size_t)g['x']->rows() * g['x']->cols(); i++) {
+		for (size_t i = 0; i < (size_t)g['x']->rows() * batch_size; i++) {
 			// "Pass" the gradient multiplied by the sigmoid derivative.
-			gx[i] = gy[i]* (y[i] * (1.0 - y[i]));
+			gx[i] = gy[i]* derivative(y[i]);
 		}//: for
 	}
 
@@ -102,6 +118,7 @@ protected:
 	// Unhiding the template inherited fields via "using" statement.
     using Layer<eT>::g;
     using Layer<eT>::s;
+    using Layer<eT>::batch_size;
 
 private:
 	// Friend class - required for using boost serialization.
@@ -28,12 +28,27 @@
 #include<types/MatrixTypes.hpp>
 #include<types/MatrixArray.hpp>
 
+#include <mlnn/convolution/Winograd.hpp>
+#include <mlnn/convolution/FFT.hpp>
+#include <mlnn/convolution/DirectKernels.hpp>
+
 namespace mic {
 namespace mlnn {
 namespace convolution {
 
+/*!
+ * \brief Enumeration of algorithms that can be used for computing the convolution.
+ */
+enum class ConvolutionAlgorithm : short {
+	Auto = 0, ///< Algorithm selected automatically, on the basis of filter size, stride and the estimated costs.
+	Direct, ///< Direct computation, by iterating through receptive fields (with kernels specialized for 1x1, 3x3 and 5x5 filters with stride 1 or 2).
+	Winograd, ///< Winograd F(2x2,3x3) - 3x3 filters with stride 1 only.
+	FFT ///< Multiplication of spectra computed with Fast Fourier Transform - stride 1 only.
+};
+
 /*!
  * \brief Class representing a convolution layer, with "valid padding" and variable stride.
+ * Optionally the input channels can be (implicitly) padded with zeros or cropped - borders are handled inside the kernels, without copying the batches.
  * \author tkornuta
  * \tparam eT Template parameter denoting precision of variables (float for calculations/double for testing).
  */
@@ -52,16 +67,37 @@ public:
 	 * @param name_ Name of the layer.
 	 */
 	Convolution(size_t input_height_, size_t input_width_, size_t input_channels_, size_t number_of_filters_, size_t filter_size_, size_t stride_, std::string name_ = "Convolution") :
+		Convolution(input_height_, input_width_, input_channels_, number_of_filters_, filter_size_, stride_, 0, name_) { }
+
+	/*!
+	 * Creates a convolutional layer with (implicitly) padded or cropped input.
+	 * @param input_height_ Height of the input / rows (e.g. 28 for MNIST).
+	 * @param input_width_ Width of the input / columns (e.g. 28 for MNIST).
+	 * @param input_channels_ Number of channels of the input (e.g. 3 for RGB images).
+	 * @param number_of_filters_ Number of filters = Length of the output vector.
+	 * @param filter_size_ Size of filters (assuming square filters).
+	 * @param stride_ Stride (assuming equal vertical and horizontal strides).
+	 * @param padding_ Number of zeros added to (positive) or pixels removed from (negative) each side of the input channels.
+	 * @param name_ Name of the layer.
+	 */
+	Convolution(size_t input_height_, size_t input_width_, size_t input_channels_, size_t number_of_filters_, size_t filter_size_, size_t stride_, int padding_, std::string name_ = "Convolution") :
 		Layer<eT>::Layer(input_height_, input_width_, input_channels_,
 				/* height, width: temporary output values to be set in constructor!*/
 				1, 1, number_of_filters_,
 				LayerTypes::Convolution, name_),
 				filter_size(filter_size_),
-				stride(stride_)
+				stride(stride_),
+				padding(padding_),
+				algorithm(ConvolutionAlgorithm::Auto),
+				transformed_filters_valid(false),
+				filter_spectra_valid(false),
+				interleaved_filters_valid(false),
+				direct_kernels(DirectKernels<eT>::select(filter_size_, stride_)),
+				gathered_filters_valid(false)
 	{
-		// Calculate number of receptive fields within a "single input channel".
-		assert(input_height >= filter_size);
-		int height_rest = (int)input_height-filter_size;
+		// Calculate number of receptive fields within a "single input channel" (padded or cropped).
+		assert((int)input_height + 2*padding >= (int)filter_size);
+		int height_rest = (int)input_height + 2*padding - (int)filter_size;
 		output_height = 1;
 		while(height_rest >= (int)stride){
 			output_height++;
@@ -74,8 +110,8 @@ public:
 			exit(-1);
 		}
 
-		assert(input_width >= filter_size);
-		int width_rest = (int)input_width-filter_size;
+		assert((int)input_width + 2*padding >= (int)filter_size);
+		int width_rest = (int)input_width + 2*padding - (int)filter_size;
 		output_width= 1;
 		while(width_rest >= (int)stride){
 			output_width++;
@@ -149,6 +185,14 @@ public:
 		// Allocate memory for "filter similarity".
 		m.add ("fs", input_depth*output_depth, input_depth*output_depth);
 
+		// Allocate memory for Winograd transformed filters (forward and backward) and workspaces.
+		if ((filter_size == 3) && (stride == 1)) {
+			m.add ("wU", output_depth, 16*input_depth);
+			m.add ("wUt", input_depth, 16*output_depth);
+			m.add ("wV", 1, 1);
+			m.add ("wM", 1, 1);
+		}//: if
+
 		// Set gradient descent as default optimization function.
 		Layer<eT>::template setOptimization<mic::neural_nets::optimization::GradientDescent<eT> > ();
 	};
@@ -173,6 +217,7 @@ public:
 		os_<<"    * input_channels = " << input_depth <<std::endl;
 		os_<<"    * filter_size = " << filter_size <<std::endl;
 		os_<<"    * stride = " << stride <<std::endl;
+		os_<<"    * padding = " << padding <<std::endl;
 		os_<<"    * output_height = " << output_height <<std::endl;
 		os_<<"    * output_width = " << output_width <<std::endl;
 		os_<<"    * output_channels = " << output_depth;
@@ -180,10 +225,114 @@ public:
 		return os_.str();
 	}
 
+	/*!
+	 * Absorbs a border (padding or cropping) previously applied to the input by a separate layer - the layer will then accept the original (i.e. not padded/cropped) inputs.
+	 * The output size does not change.
+	 * @param border_ Number of zeros added to (positive) or pixels removed from (negative) each side of the input channels.
+	 */
+	void absorbBorder(int border_) {
+		assert((int)input_height > 2*border_ && (int)input_width > 2*border_);
+		padding += border_;
+		input_height -= 2*border_;
+		input_width -= 2*border_;
+
+		// Resize the inputs - keeping their capacity.
+		s["x"]->resize(Layer<eT>::inputSize(), s["x"]->cols());
+		g["x"]->resize(Layer<eT>::inputSize(), g["x"]->cols());
+		m["xs"]->resize(Layer<eT>::inputSize(), 1);
+		m["xc"]->resize(input_height*input_width, 1);
+	}
+
+	/// Returns number of zeros added to (positive) or pixels removed from (negative) each side of the input channels.
+	inline int getPadding() {
+		return padding;
+	}
+
+	/*!
+	 * Sets the algorithm used for computing the convolution (forward and backpropagation to dx).
+	 * If the algorithm cannot be used for the given filter size and stride, the direct one is used instead.
+	 * @param algorithm_ Algorithm.
+	 */
+	void setAlgorithm(ConvolutionAlgorithm algorithm_) {
+		algorithm = algorithm_;
+	}
+
+	/*!
+	 * Returns the algorithm that will be used for computing the convolution.
+	 */
+	ConvolutionAlgorithm selectedAlgorithm() {
+		// Winograd F(2x2,3x3) can be used only for 3x3 filters with stride 1.
+		bool winograd_possible = (filter_size == 3) && (stride == 1);
+		// FFT requires stride 1 (and pays off only for bigger filters).
+		bool fft_possible = (stride == 1);
+
+		switch(algorithm) {
+		case(ConvolutionAlgorithm::Winograd):
+			return (winograd_possible ? ConvolutionAlgorithm::Winograd : ConvolutionAlgorithm::Direct);
+		case(ConvolutionAlgorithm::FFT):
+			return (fft_possible ? ConvolutionAlgorithm::FFT : ConvolutionAlgorithm::Direct);
+		case(ConvolutionAlgorithm::Auto):
+			if (winograd_possible && (winogradCost() < directCost()))
+				return ConvolutionAlgorithm::Winograd;
+			if (fft_possible && (filter_size >= 5) && (fftCost() < directCost()))
+				return ConvolutionAlgorithm::FFT;
+			return ConvolutionAlgorithm::Direct;
+		default:
+			return ConvolutionAlgorithm::Direct;
+		}//: switch
+	}
+
+	/*!
+	 * Invalidates the cached transformed filters, filter spectra, interleaved and gathered filters - they will be recalculated during the next pass.
+	 */
+	virtual void invalidateCaches() {
+		transformed_filters_valid = false;
+		filter_spectra_valid = false;
+		interleaved_filters_valid = false;
+		gathered_filters_valid = false;
+	}
+
+	/*!
+	 * Convolution supports the channel-interleaved layout - the selected algorithm is then ignored.
+	 */
+	virtual bool supportsInterleavedLayout() { return true; }
+
+	/*!
+	 * Returns true if a given layer is a convolution with the same dimensions, filter size, stride, padding and algorithm.
+	 * @param layer_ Compared layer.
+	 */
+	virtual bool sameStructure(Layer<eT> & layer_) {
+		Convolution<eT>* other = dynamic_cast<Convolution<eT>*>(&layer_);
+		return Layer<eT>::sameStructure(layer_) && (other != nullptr) &&
+			(filter_size == other->filter_size) && (stride == other->stride) && (padding == other->padding) && (algorithm == other->algorithm);
+	}
+
 	/*!
 	 * Performs forward pass through the filters. Can process batches.
 	 */
 	void forward(bool test = false) {
+		// Process channel-interleaved batches.
+		if (Layer<eT>::interleaved()) {
+			forwardInterleaved();
+			return;
+		}//: if
+
+		// Use the fast algorithm - if possible.
+		if (selectedAlgorithm() == ConvolutionAlgorithm::Winograd) {
+			transformFilters();
+			Winograd<eT>::correlate((*s['x']), batch_size, input_depth, input_height, input_width, padding,
+					(*m["wU"]), p["b"]->data(), (*s['y']), (*m["wV"]), (*m["wM"]));
+			return;
+		} else if (selectedAlgorithm() == ConvolutionAlgorithm::FFT) {
+			forwardFFT();
+			return;
+		} else if (direct_kernels != nullptr) {
+			gatherFilters();
+			direct_kernels->correlate((*s['x']), batch_size, input_depth, input_height, input_width, padding,
+					(*m["wD"]), p["b"]->data(), (*s['y']));
+			return;
+		}//: else
+
 //		std::cout << "forward()\n";
 		// Get input matrix.
 		mic::types::MatrixPtr<eT> batch_x = s['x'];
@@ -192,7 +341,7 @@ public:
 
 		// Get output pointer - so the results will be stored!
 		mic::types::MatrixPtr<eT> batch_y = s['y'];
-		batch_y->setZero();
+		batch_y->leftCols(batch_size).setZero();
 
 		// Iterate through samples in the input batch.
 //#pragma omp parallel for
@@ -224,6 +373,8 @@ public:
 				(*ichannel) = sample->block(ic*input_height*input_width, 0, input_height*input_width, 1);
 				// Resize channel using the given dimensions.
 				ichannel->resize(input_height, input_width);
+				// Pad or crop it.
+				applyBorder(ichannel);
 				//std::cout<< "======  switching input channel = " << ic <<" ichannel=\n" << (*ichannel) << std::endl;
 
 				// 3.2. Fill receptive fields from given input channel.
@@ -294,6 +445,12 @@ public:
 	 * Back-propagates the gradients through the layer.
 	 */
 	void backward() {
+		// Process channel-interleaved batches.
+		if (Layer<eT>::interleaved()) {
+			backwardInterleaved();
+			return;
+		}//: if
+
 		mic::types::MatrixPtr<eT> batch_dy = g['y'];
 		//std::cout << "backward gradient dy: min:" << (*batch_dy).minCoeff() <<" max: " << (*batch_dy).maxCoeff() << std::endl;
 
@@ -340,6 +497,28 @@ public:
 		// Get output pointers - so the results will be stored!
 		mic::types::MatrixPtr<eT> batch_dx = g['x'];
 
+		// Use the fast algorithm - if possible: dx is a "full" correlation of dy with filters rotated by 180 degrees.
+		if (selectedAlgorithm() == ConvolutionAlgorithm::Winograd) {
+			transformFilters();
+			// Separate workspaces - the sizes differ from the forward ones, so sharing them would reallocate both in every pass.
+			if (!m.keyExists("wVt")) {
+				m.add("wVt", 1, 1);
+				m.add("wMt", 1, 1);
+			}//: if
+			// Padding of dy by 2 gives the gradient of the (padded or cropped) input - so it is shifted by the border.
+			Winograd<eT>::correlate((*batch_dy), batch_size, output_depth, output_height, output_width, 2 - padding,
+					(*m["wUt"]), nullptr, (*batch_dx), (*m["wVt"]), (*m["wMt"]));
+			return;
+		} else if (selectedAlgorithm() == ConvolutionAlgorithm::FFT) {
+			backpropagateFFT_dy_to_dx();
+			return;
+		} else if (direct_kernels != nullptr) {
+			gatherFilters();
+			direct_kernels->backpropagateToInputs((*batch_dy), batch_size, input_depth, input_height, input_width, padding,
+					(*m["wD"]), (*batch_dx));
+			return;
+		}//: else
+
 		// Backpropagate gradient from dy to dx.
 
 
@@ -372,10 +551,10 @@ public:
 
 				// Get pointer to x gradient channel "storage".
 				mic::types::MatrixPtr<eT> gxc = m["xc"];
-				// Clean it up!
-				gxc->setZero();
-				// Resize just in case.
+				// Resize just in case (the forward pass might have padded it)...
 				gxc->resize(input_height, input_width);
+				// ... and clean it up!
+				gxc->setZero();
 
 
 				// For each filter.
@@ -412,8 +591,11 @@ public:
 								for (size_t ix=0; ix<filter_size; ix++) {
 
 									eT conv = (*W)(iy,ix)*(*gyc)(oy,ox);//((*rerf)*(*gyc))(0);//1;
-									size_t y = isby+iy;
-									size_t x = isbx+ix;
+									// Coordinates in the original input - skip the padding.
+									long y = (long)(isby+iy) - padding;
+									long x = (long)(isbx+ix) - padding;
+									if ((y < 0) || (y >= (long)input_height) || (x < 0) || (x >= (long)input_width))
+										continue;
 									//std::cout<< "adding to (*gxc) = \n" << (*gxc) << "\n in: " << " y=" << y<< " x=" << x << std::endl;
 									(*gxc)(y,x) += conv;
 
@@ -463,6 +645,29 @@ public:
 			}//: for ic
 		}//: for fi
 
+		// Use the FFT - if selected: dW is the (valid) correlation of x with dy.
+		if (selectedAlgorithm() == ConvolutionAlgorithm::FFT) {
+			backpropagateFFT_dy_to_dW();
+			return;
+		}//: if
+
+		// Use the kernel specialized for the filter size and stride - if available.
+		if (direct_kernels != nullptr) {
+			if (!m.keyExists("dwD"))
+				m.add("dwD", filter_size*filter_size, output_depth*input_depth);
+			mic::types::MatrixPtr<eT> dWD = m["dwD"];
+			direct_kernels->backpropagateToWeights((*batch_x), (*batch_dy), batch_size, input_depth, input_height, input_width, padding, output_depth, (*dWD));
+			// Scatter to gradients of filters.
+			for (size_t fi=0; fi< output_depth; fi++) {
+				for (size_t ic=0; ic< input_depth; ic++) {
+					mic::types::MatrixPtr<eT> dW = g["W"+std::to_string(fi)+"x"+std::to_string(ic)];
+					for (size_t i=0; i< filter_size*filter_size; i++)
+						(*dW)[i] = (*dWD)(i, fi*input_depth + ic);
+				}//: for input channels
+			}//: for filters
+			return;
+		}//: if
+
 
 		// Iterate through samples in the input batch.
 		for (size_t ib=0; ib< batch_size; ib++) {
@@ -484,6 +689,8 @@ public:
 				(*x_channel) = xs->block(ic*input_height*input_width, 0, input_height*input_width, 1);
 				// Resize channel using the given dimensions.
 				x_channel->resize(input_height, input_width);
+				// Pad or crop it.
+				applyBorder(x_channel);
 				//std::cout<< "======  switching input channel = " << ic << " x_channel=\n" << (*x_channel) << std::endl;
 
 				// Fill "inverse input receptive fields" from given input channel.
@@ -599,6 +806,9 @@ public:
 				(*p[i.first])[j] -= alpha_ * (*g[i.first])[j];*/
 		}//: for
 
+		// Filters have changed.
+		invalidateCaches();
+
 		/*std::string key = "W0x0";
 		std::cout << "* " << key << "\t = < " << (*p[key])[0]  <<",\t " << (*p[key])[1];
 		std::cout << "\t* d" << key << "\t = < " << (*g[key])[0]  <<",\t " << (*g[key])[1] << std::endl;*/
@@ -806,6 +1016,8 @@ protected:
 	using Layer<eT>::output_width;
 	using Layer<eT>::output_depth;
     using Layer<eT>::batch_size;
+    using Layer<eT>::input_layout;
+    using Layer<eT>::output_layout;
 
 	/// Size of filters (assuming square filters). Filter_size^2 = length of the output vector.
 	size_t filter_size;
@@ -813,6 +1025,552 @@ protected:
 	/// Stride (assuming equal vertical and horizontal strides).
 	 size_t stride;
 
+	/// Number of zeros added to (positive) or pixels removed from (negative) each side of the input channels.
+	int padding;
+
+	/// Algorithm used for computing the convolution.
+	ConvolutionAlgorithm algorithm;
+
+	/// Flag denoting whether the transformed filters (used by fast algorithms) are up to date.
+	bool transformed_filters_valid;
+
+	/// Flag denoting whether the filter spectra (used by FFT) are up to date.
+	bool filter_spectra_valid;
+
+	/// Filter spectra - [fft_rows x fft_cols] spectrum for each (filter, input channel) pair.
+	std::vector<typename FFT<eT>::cT> filter_spectra;
+
+	/// Spectra of the input channels - of all samples of the batch in the forward pass, of a single sample during the computation of dW (used by FFT).
+	std::vector<typename FFT<eT>::cT> input_spectra;
+
+	/// Spectra of the dy channels - of all samples of the batch during the computation of dx, of a single sample during the computation of dW (used by FFT).
+	std::vector<typename FFT<eT>::cT> gradient_spectra;
+
+	/// Accumulated products of spectra - one for each sample of the batch (used by FFT in the forward pass and during the computation of dx).
+	std::vector<typename FFT<eT>::cT> accumulated_spectra;
+
+	/// Spectra of dW, accumulated over the batch - spectrum for each (filter, input channel) pair.
+	std::vector<typename FFT<eT>::cT> dW_spectra;
+
+	/// Flag denoting whether the interleaved filters (used in the channel-interleaved layout) are up to date.
+	bool interleaved_filters_valid;
+
+	/// Direct kernels specialized for the filter size and stride (nullptr - the generic direct computation is used).
+	const DirectKernels<eT>* direct_kernels;
+
+	/// Flag denoting whether the gathered filters (used by the specialized direct kernels) are up to date.
+	bool gathered_filters_valid;
+
+	/// Returns height of the padded (or cropped) input channel.
+	inline size_t effectiveHeight() {
+		return input_height + 2*padding;
+	}
+
+	/// Returns width of the padded (or cropped) input channel.
+	inline size_t effectiveWidth() {
+		return input_width + 2*padding;
+	}
+
+	/*!
+	 * Pads (or crops) the input channel matrix, resizing it to the effective input size.
+	 * @param channel_ Channel matrix [input_height x input_width].
+	 */
+	void applyBorder(mic::types::MatrixPtr<eT> channel_) {
+		if (padding == 0)
+			return;
+		mic::types::Matrix<eT> channel = (*channel_);
+		if (padding > 0) {
+			channel_->resize(effectiveHeight(), effectiveWidth());
+			channel_->setZero();
+			channel_->block(padding, padding, input_height, input_width) = channel;
+		} else
+			(*channel_) = channel.block(-padding, -padding, effectiveHeight(), effectiveWidth());
+	}
+
+	/*!
+	 * Estimates the cost of direct computation of the convolution of a single sample (in number of multiplications and additions of the FFT).
+	 * A single operation of the generic direct algorithm (copying receptive fields and accessing them through the memory array) takes roughly 10x longer than an operation of the FFT,
+	 * whereas the kernels specialized for the filter size and stride keep the filter in registers and take roughly 0.3 of an operation of the FFT.
+	 */
+	eT directCost() {
+		return (direct_kernels != nullptr ? 0.3 : 10.0) * 2.0 * output_depth * input_depth * output_height * output_width * filter_size * filter_size;
+	}
+
+	/*!
+	 * Estimates the cost of Winograd F(2x2,3x3) computation of the convolution of a single sample (in the units of directCost()),
+	 * averaged over the forward pass and the backpropagation to dx, which swaps the roles of input and output channels.
+	 */
+	eT winogradCost() {
+		size_t output_tiles = ((output_height + 1) / 2) * ((output_width + 1) / 2);
+		size_t input_tiles = ((input_height + 1) / 2) * ((input_width + 1) / 2);
+		return 0.5 * (winogradPassCost(output_tiles, input_depth, output_depth) + winogradPassCost(input_tiles, output_depth, input_depth));
+	}
+
+	/*!
+	 * Estimates the cost of a single Winograd F(2x2,3x3) pass (in the units of directCost()) - the coefficients were fitted to the measured times of both algorithms.
+	 * The products of the transformed tiles are computed by matrix multiplications, which are cheap, so the cost is dominated by the transforms of tiles of each channel,
+	 * thus the direct kernels are faster when there are few channels (e.g. the first layer processing an image).
+	 * @param tiles_ Number of 2x2 tiles of the output channel.
+	 * @param channels_ Number of input channels.
+	 * @param filters_ Number of output channels.
+	 */
+	eT winogradPassCost(size_t tiles_, size_t channels_, size_t filters_) {
+		return tiles_ * (300.0 + 58.0 * channels_ + 15.0 * filters_ + 1.5 * channels_ * filters_);
+	}
+
+	/*!
+	 * Estimates the cost of FFT-based computation of the convolution of a single sample (in number of multiplications and additions).
+	 */
+	eT fftCost() {
+		size_t rows = FFT<eT>::paddedSize(effectiveHeight());
+		size_t cols = FFT<eT>::paddedSize(effectiveWidth());
+		// Transforms of all input and output channels plus complex multiply-accumulate of all pairs.
+		return (input_depth + output_depth) * FFT<eT>::transformCost(rows, cols) + 8.0 * output_depth * input_depth * rows * cols;
+	}
+
+	/*!
+	 * Calculates spectra of all filters - if they are not valid.
+	 */
+	void computeFilterSpectra() {
+		if (filter_spectra_valid)
+			return;
+		size_t rows = FFT<eT>::paddedSize(effectiveHeight());
+		size_t cols = FFT<eT>::paddedSize(effectiveWidth());
+		size_t P = rows * cols;
+		filter_spectra.resize(output_depth * input_depth * P);
+
+		// Get filters (outside of the parallel region).
+		std::vector<eT*> W(output_depth * input_depth);
+		for (size_t i=0; i< output_depth * input_depth; i++)
+			W[i] = p["W"+std::to_string(i / input_depth)+"x"+std::to_string(i % input_depth)]->data();
+
+		#pragma omp parallel for
+		for (size_t i=0; i< output_depth * input_depth; i++)
+			FFT<eT>::forwardPlane(W[i], filter_size, filter_size, 1, filter_size, &filter_spectra[i*P], rows, cols);
+
+		filter_spectra_valid = true;
+	}
+
+	/*!
+	 * Calculates spectrum of the (padded or cropped) input channel.
+	 * @param channel_ Pointer to the input channel.
+	 * @param spectrum_ Resulting spectrum.
+	 * @param rows_ Number of rows of the spectrum.
+	 * @param cols_ Number of columns of the spectrum.
+	 */
+	void inputSpectrum(const eT* channel_, typename FFT<eT>::cT* spectrum_, size_t rows_, size_t cols_) {
+		if (padding >= 0)
+			FFT<eT>::forwardPlane(channel_, input_height, input_width, 1, input_height, spectrum_, rows_, cols_, padding, padding);
+		else
+			FFT<eT>::forwardPlane(channel_ + (-padding)*(1 + input_height), effectiveHeight(), effectiveWidth(), 1, input_height, spectrum_, rows_, cols_);
+	}
+
+	/*!
+	 * Performs forward pass by multiplying the spectra of input channels with the (conjugated) spectra of filters.
+	 */
+	void forwardFFT() {
+		computeFilterSpectra();
+		mic::types::MatrixPtr<eT> batch_x = s['x'];
+		mic::types::MatrixPtr<eT> batch_y = s['y'];
+		eT* b = p["b"]->data();
+		size_t rows = FFT<eT>::paddedSize(effectiveHeight());
+		size_t cols = FFT<eT>::paddedSize(effectiveWidth());
+		size_t P = rows * cols;
+		// Buffers of all samples - they keep their capacity between passes.
+		input_spectra.resize(batch_size * input_depth * P);
+		accumulated_spectra.resize(batch_size * P);
+
+		#pragma omp parallel for
+		for (size_t ib=0; ib< batch_size; ib++) {
+			typename FFT<eT>::cT* X = &input_spectra[ib * input_depth * P];
+			typename FFT<eT>::cT* acc = &accumulated_spectra[ib * P];
+			const eT* x_sample = batch_x->data() + ib * batch_x->rows();
+			eT* y_sample = batch_y->data() + ib * batch_y->rows();
+
+			// Spectra of input channels.
+			for (size_t ic=0; ic< input_depth; ic++)
+				inputSpectrum(x_sample + ic*input_height*input_width, &X[ic*P], rows, cols);
+
+			// Correlate with filters - sum over the input channels in the frequency domain.
+			for (size_t fi=0; fi< output_depth; fi++) {
+				std::fill(acc, acc + P, typename FFT<eT>::cT(0));
+				for (size_t ic=0; ic< input_depth; ic++)
+					FFT<eT>::multiplyAccumulate(&X[ic*P], &filter_spectra[(fi*input_depth + ic)*P], acc, P, true);
+				FFT<eT>::transform2D(acc, rows, cols, true);
+
+				// Copy the valid part.
+				eT* y_channel = y_sample + fi*output_height*output_width;
+				for (size_t ox=0; ox< output_width; ox++)
+					for (size_t oy=0; oy< output_height; oy++)
+						y_channel[oy + ox*output_height] = acc[oy + ox*rows].real() + b[fi];
+			}//: for filters
+		}//: for batch
+	}
+
+	/*!
+	 * Back-propagates the gradients from dy to dx by multiplying the spectra of dy channels with the spectra of filters ("full" convolution).
+	 */
+	void backpropagateFFT_dy_to_dx() {
+		computeFilterSpectra();
+		mic::types::MatrixPtr<eT> batch_dy = g['y'];
+		mic::types::MatrixPtr<eT> batch_dx = g['x'];
+		size_t rows = FFT<eT>::paddedSize(effectiveHeight());
+		size_t cols = FFT<eT>::paddedSize(effectiveWidth());
+		size_t P = rows * cols;
+		// Buffers of all samples - they keep their capacity between passes.
+		gradient_spectra.resize(batch_size * output_depth * P);
+		accumulated_spectra.resize(batch_size * P);
+
+		#pragma omp parallel for
+		for (size_t ib=0; ib< batch_size; ib++) {
+			typename FFT<eT>::cT* DY = &gradient_spectra[ib * output_depth * P];
+			typename FFT<eT>::cT* acc = &accumulated_spectra[ib * P];
+			const eT* dy_sample = batch_dy->data() + ib * batch_dy->rows();
+			eT* dx_sample = batch_dx->data() + ib * batch_dx->rows();
+
+			// Spectra of dy channels.
+			for (size_t fi=0; fi< output_depth; fi++)
+				FFT<eT>::forwardPlane(dy_sample + fi*output_height*output_width, output_height, output_width, 1, output_height, &DY[fi*P], rows, cols);
+
+			// Convolve with filters - sum over the output channels in the frequency domain.
+			for (size_t ic=0; ic< input_depth; ic++) {
+				std::fill(acc, acc + P, typename FFT<eT>::cT(0));
+				for (size_t fi=0; fi< output_depth; fi++)
+					FFT<eT>::multiplyAccumulate(&DY[fi*P], &filter_spectra[(fi*input_depth + ic)*P], acc, P, false);
+				FFT<eT>::transform2D(acc, rows, cols, true);
+
+				// Copy the part corresponding to the original input - the cropped border gets zero gradient.
+				eT* dx_channel = dx_sample + ic*input_height*input_width;
+				for (size_t ix=0; ix< input_width; ix++) {
+					long ex = (long)ix + padding;
+					for (size_t iy=0; iy< input_height; iy++) {
+						long ey = (long)iy + padding;
+						bool inside = (ex >= 0) && (ex < (long)effectiveWidth()) && (ey >= 0) && (ey < (long)effectiveHeight());
+						dx_channel[iy + ix*input_height] = inside ? acc[ey + ex*rows].real() : 0;
+					}//: for iy
+				}//: for ix
+			}//: for input channels
+		}//: for batch
+	}
+
+	/*!
+	 * Back-propagates the gradients from dy to dW by multiplying the spectra of input channels with the (conjugated) spectra of dy channels.
+	 * The products are summed over the batch in the frequency domain, so only one inverse transform per (filter, input channel) pair is performed.
+	 * Assumes that the weight gradients were reset.
+	 */
+	void backpropagateFFT_dy_to_dW() {
+		mic::types::MatrixPtr<eT> batch_dy = g['y'];
+		mic::types::MatrixPtr<eT> batch_x = s['x'];
+		size_t rows = FFT<eT>::paddedSize(effectiveHeight());
+		size_t cols = FFT<eT>::paddedSize(effectiveWidth());
+		size_t P = rows * cols;
+		std::vector<typename FFT<eT>::cT> & X = input_spectra;
+		std::vector<typename FFT<eT>::cT> & DY = gradient_spectra;
+		X.resize(input_depth * P);
+		DY.resize(output_depth * P);
+		dW_spectra.assign(output_depth * input_depth * P, typename FFT<eT>::cT(0));
+
+		// Get weight gradients (outside of the parallel region).
+		std::vector<eT*> dW(output_depth * input_depth);
+		for (size_t i=0; i< output_depth * input_depth; i++)
+			dW[i] = g["W"+std::to_string(i / input_depth)+"x"+std::to_string(i % input_depth)]->data();
+
+		for (size_t ib=0; ib< batch_size; ib++) {
+			const eT* x_sample = batch_x->data() + ib * batch_x->rows();
+			const eT* dy_sample = batch_dy->data() + ib * batch_dy->rows();
+
+			// Spectra of input and dy channels.
+			#pragma omp parallel for
+			for (size_t i=0; i< input_depth + output_depth; i++) {
+				if (i < input_depth)
+					inputSpectrum(x_sample + i*input_height*input_width, &X[i*P], rows, cols);
+				else
+					FFT<eT>::forwardPlane(dy_sample + (i-input_depth)*output_height*output_width, output_height, output_width, 1, output_height, &DY[(i-input_depth)*P], rows, cols);
+			}//: for
+
+			// Correlate each pair - accumulate the spectra.
+			#pragma omp parallel for
+			for (size_t i=0; i< output_depth * input_depth; i++)
+				FFT<eT>::multiplyAccumulate(&X[(i % input_depth)*P], &DY[(i / input_depth)*P], &dW_spectra[i*P], P, true);
+		}//: for batch
+
+		// Transform the accumulated spectra back and accumulate the filter-sized part.
+		#pragma omp parallel for
+		for (size_t i=0; i< output_depth * input_depth; i++) {
+			typename FFT<eT>::cT* acc = &dW_spectra[i*P];
+			FFT<eT>::transform2D(acc, rows, cols, true);
+
+			for (size_t fx=0; fx< filter_size; fx++)
+				for (size_t fy=0; fy< filter_size; fy++)
+					dW[i][fy + fx*filter_size] += acc[fy + fx*rows].real();
+		}//: for pairs
+	}
+
+	/*!
+	 * Calculates the Winograd transformed filters (for forward and backward passes) - if they are not valid.
+	 */
+	void transformFilters() {
+		if (transformed_filters_valid)
+			return;
+
+		mic::types::MatrixPtr<eT> U = m["wU"];
+		mic::types::MatrixPtr<eT> Ut = m["wUt"];
+		eT u[16];
+		for (size_t fi=0; fi< output_depth; fi++) {
+			for (size_t ic=0; ic< input_depth; ic++) {
+				mic::types::MatrixPtr<eT> W = p["W"+std::to_string(fi)+"x"+std::to_string(ic)];
+				// Forward: filter connecting input channel ic with output channel fi.
+				Winograd<eT>::transformFilter(W->data(), u);
+				for (size_t xi=0; xi< 16; xi++)
+					(*U)(fi, xi*input_depth + ic) = u[xi];
+				// Backward: rotated filter connecting dy channel fi with dx channel ic.
+				Winograd<eT>::transformFilter(W->data(), u, true);
+				for (size_t xi=0; xi< 16; xi++)
+					(*Ut)(ic, xi*output_depth + fi) = u[xi];
+			}//: for input channels
+		}//: for filters
+
+		transformed_filters_valid = true;
+	}
+
+	/// Type of matrix mapped on the data of batches.
+	typedef Eigen::Map<Eigen::Matrix<eT, Eigen::Dynamic, Eigen::Dynamic> > MatrixMap;
+
+	/// Type of (read-only) matrix mapped on the data of batches.
+	typedef Eigen::Map<const Eigen::Matrix<eT, Eigen::Dynamic, Eigen::Dynamic> > ConstMatrixMap;
+
+	/// Type of (read-only) matrix mapped on overlapping receptive fields of interleaved samples.
+	typedef Eigen::Map<const Eigen::Matrix<eT, Eigen::Dynamic, Eigen::Dynamic>, 0, Eigen::OuterStride<> > FieldsMap;
+
+	/*!
+	 * Gathers filters into a single [filter_size*filter_size x filters*input_channels] matrix used by the specialized direct kernels - if they are not valid.
+	 * Column fi*input_channels + ic contains the filter connecting input channel ic with output channel fi.
+	 */
+	void gatherFilters() {
+		if (gathered_filters_valid)
+			return;
+
+		if (!m.keyExists("wD"))
+			m.add("wD", filter_size*filter_size, output_depth*input_depth);
+		mic::types::MatrixPtr<eT> WD = m["wD"];
+		for (size_t fi=0; fi< output_depth; fi++) {
+			for (size_t ic=0; ic< input_depth; ic++) {
+				eT* W = p["W"+std::to_string(fi)+"x"+std::to_string(ic)]->data();
+				for (size_t i=0; i< filter_size*filter_size; i++)
+					(*WD)(i, fi*input_depth + ic) = W[i];
+			}//: for input channels
+		}//: for filters
+
+		gathered_filters_valid = true;
+	}
+
+	/*!
+	 * Gathers filters into a single [filters x filter_size*filter_size*input_channels] matrix - if they are not valid.
+	 * Element (fy, fx) of the filter connecting input channel ic with output channel fi is stored in column ic + input_channels*(fy + filter_size*fx),
+	 * so a column of the receptive field (filter_size pixels of all channels) of an interleaved sample is a contiguous block of the input.
+	 */
+	void interleaveFilters() {
+		if (interleaved_filters_valid)
+			return;
+
+		if (!m.keyExists("wI"))
+			m.add("wI", output_depth, filter_size*filter_size*input_depth);
+		mic::types::MatrixPtr<eT> WI = m["wI"];
+		for (size_t fi=0; fi< output_depth; fi++) {
+			for (size_t ic=0; ic< input_depth; ic++) {
+				eT* W = p["W"+std::to_string(fi)+"x"+std::to_string(ic)]->data();
+				for (size_t i=0; i< filter_size*filter_size; i++)
+					(*WI)(fi, ic + i*input_depth) = W[i];
+			}//: for input channels
+		}//: for filters
+
+		interleaved_filters_valid = true;
+	}
+
+	/*!
+	 * Finds the range of output rows whose receptive fields lie entirely inside the (not padded) input.
+	 * @param first_ First such row.
+	 * @param last_ Row following the last such row (equal to first_ if there are no such rows).
+	 */
+	void innerFieldRows(size_t & first_, size_t & last_) {
+		first_ = output_height;
+		last_ = output_height;
+		for (size_t oy=0; oy< output_height; oy++) {
+			long iy = (long)(oy*stride) - padding;
+			bool inner = (iy >= 0) && (iy + (long)filter_size <= (long)input_height);
+			if (inner && (first_ == output_height))
+				first_ = oy;
+			if (!inner && (first_ != output_height) && (last_ == output_height))
+				last_ = oy;
+		}//: for
+		if (first_ == output_height)
+			last_ = output_height;
+	}
+
+	/*!
+	 * Clips the receptive field of a given output row to the (not padded) input.
+	 * @param oy_ Output row.
+	 * @param iy_ Input row corresponding to the first filter row (can be negative).
+	 * @param fy_begin_ First filter row lying inside the input.
+	 * @param fy_end_ Filter row following the last filter row lying inside the input.
+	 * @return False if the whole field lies in the padding.
+	 */
+	bool clipFieldRows(size_t oy_, long & iy_, size_t & fy_begin_, size_t & fy_end_) {
+		iy_ = (long)(oy_*stride) - padding;
+		long begin = std::max(0L, -iy_);
+		long end = std::min((long)filter_size, (long)input_height - iy_);
+		if (begin >= end)
+			return false;
+		fy_begin_ = begin;
+		fy_end_ = end;
+		return true;
+	}
+
+	/*!
+	 * Performs forward pass on channel-interleaved batches.
+	 * A column of output pixels is computed by filter_size matrix multiplications, each with a matrix mapped directly on (overlapping) receptive field columns of the input.
+	 * Fields crossing the padded border are processed separately, by multiplications with their parts lying inside the input.
+	 */
+	void forwardInterleaved() {
+		interleaveFilters();
+		mic::types::MatrixPtr<eT> batch_x = Layer<eT>::lazyReturnInterleavedBatch(s['x'], input_layout, "xl", input_depth, true);
+		mic::types::MatrixPtr<eT> batch_y = Layer<eT>::lazyReturnInterleavedBatch(s['y'], output_layout, "yl", output_depth, false);
+		mic::types::MatrixPtr<eT> WI = m["wI"];
+		mic::types::MatrixPtr<eT> b = p["b"];
+		size_t field = filter_size*input_depth;
+		size_t inner_first, inner_last;
+		innerFieldRows(inner_first, inner_last);
+
+		#pragma omp parallel for
+		for (size_t ib=0; ib< batch_size; ib++) {
+			const eT* x_sample = batch_x->data() + ib * batch_x->rows();
+			eT* y_sample = batch_y->data() + ib * batch_y->rows();
+
+			for (size_t ox=0; ox< output_width; ox++) {
+				// Output column: [filters x output_height].
+				MatrixMap y(y_sample + ox*output_height*output_depth, output_depth, output_height);
+				y.colwise() = b->col(0);
+				for (size_t fx=0; fx< filter_size; fx++) {
+					// Skip columns lying in the padding.
+					long ix = (long)(ox*stride + fx) - padding;
+					if ((ix < 0) || (ix >= (long)input_width))
+						continue;
+					const eT* x_column = x_sample + ix*input_height*input_depth;
+
+					// Inner receptive field columns: [filter_size*input_channels x rows], next field starts stride pixels below.
+					if (inner_last > inner_first) {
+						FieldsMap x(x_column + ((long)(inner_first*stride) - padding)*input_depth, field, inner_last - inner_first, Eigen::OuterStride<>(stride*input_depth));
+						y.middleCols(inner_first, inner_last - inner_first).noalias() += WI->block(0, fx*field, output_depth, field) * x;
+					}//: if
+
+					// Fields crossing the border.
+					for (size_t oy=0; oy< output_height; oy++) {
+						long iy;
+						size_t fy_begin, fy_end;
+						if (((oy >= inner_first) && (oy < inner_last)) || !clipFieldRows(oy, iy, fy_begin, fy_end))
+							continue;
+						size_t length = (fy_end - fy_begin)*input_depth;
+						y.col(oy).noalias() += WI->block(0, fx*field + fy_begin*input_depth, output_depth, length) *
+								ConstMatrixMap(x_column + (iy + fy_begin)*input_depth, length, 1);
+					}//: for oy
+				}//: for fx
+			}//: for ox
+		}//: for batch
+
+		Layer<eT>::storeInterleavedBatch(batch_y, s['y'], output_depth);
+	}
+
+	/*!
+	 * Back-propagates the gradients (to dx, dW and db) on channel-interleaved batches.
+	 */
+	void backwardInterleaved() {
+		interleaveFilters();
+		mic::types::MatrixPtr<eT> batch_x = Layer<eT>::lazyReturnInterleavedBatch(s['x'], input_layout, "xl", input_depth, true);
+		mic::types::MatrixPtr<eT> batch_dy = Layer<eT>::lazyReturnInterleavedBatch(g['y'], output_layout, "dyl", output_depth, true);
+		mic::types::MatrixPtr<eT> batch_dx = Layer<eT>::lazyReturnInterleavedBatch(g['x'], input_layout, "dxl", input_depth, false);
+		mic::types::MatrixPtr<eT> WI = m["wI"];
+		size_t field = filter_size*input_depth;
+		size_t inner_first, inner_last;
+		innerFieldRows(inner_first, inner_last);
+
+		// dx: scatter W^T dy to the receptive field columns (they overlap, so it cannot be done with a single multiplication).
+		#pragma omp parallel for
+		for (size_t ib=0; ib< batch_size; ib++) {
+			const eT* dy_sample = batch_dy->data() + ib * batch_dy->rows();
+			eT* dx_sample = batch_dx->data() + ib * batch_dx->rows();
+			std::fill(dx_sample, dx_sample + batch_dx->rows(), (eT)0);
+			Eigen::Matrix<eT, Eigen::Dynamic, Eigen::Dynamic> dfields(field, output_height);
+
+			for (size_t ox=0; ox< output_width; ox++) {
+				ConstMatrixMap dy(dy_sample + ox*output_height*output_depth, output_depth, output_height);
+				for (size_t fx=0; fx< filter_size; fx++) {
+					long ix = (long)(ox*stride + fx) - padding;
+					if ((ix < 0) || (ix >= (long)input_width))
+						continue;
+					dfields.noalias() = WI->block(0, fx*field, output_depth, field).transpose() * dy;
+					eT* dx_column = dx_sample + ix*input_height*input_depth;
+					for (size_t oy=0; oy< output_height; oy++) {
+						long iy;
+						size_t fy_begin, fy_end;
+						if (!clipFieldRows(oy, iy, fy_begin, fy_end))
+							continue;
+						size_t length = (fy_end - fy_begin)*input_depth;
+						MatrixMap(dx_column + (iy + fy_begin)*input_depth, length, 1) += dfields.block(fy_begin*input_depth, oy, length, 1);
+					}//: for oy
+				}//: for fx
+			}//: for ox
+		}//: for batch
+
+		// dW: dy (x receptive fields)^T - blocks related to different filter columns are independent.
+		mic::types::Matrix<eT> dWI(output_depth, filter_size*field);
+		#pragma omp parallel for
+		for (size_t fx=0; fx< filter_size; fx++) {
+			dWI.block(0, fx*field, output_depth, field).setZero();
+			for (size_t ib=0; ib< batch_size; ib++) {
+				const eT* x_sample = batch_x->data() + ib * batch_x->rows();
+				const eT* dy_sample = batch_dy->data() + ib * batch_dy->rows();
+				for (size_t ox=0; ox< output_width; ox++) {
+					long ix = (long)(ox*stride + fx) - padding;
+					if ((ix < 0) || (ix >= (long)input_width))
+						continue;
+					const eT* x_column = x_sample + ix*input_height*input_depth;
+					ConstMatrixMap dy(dy_sample + ox*output_height*output_depth, output_depth, output_height);
+
+					// Inner fields.
+					if (inner_last > inner_first) {
+						FieldsMap x(x_column + ((long)(inner_first*stride) - padding)*input_depth, field, inner_last - inner_first, Eigen::OuterStride<>(stride*input_depth));
+						dWI.block(0, fx*field, output_depth, field).noalias() += dy.middleCols(inner_first, inner_last - inner_first) * x.transpose();
+					}//: if
+
+					// Fields crossing the border.
+					for (size_t oy=0; oy< output_height; oy++) {
+						long iy;
+						size_t fy_begin, fy_end;
+						if (((oy >= inner_first) && (oy < inner_last)) || !clipFieldRows(oy, iy, fy_begin, fy_end))
+							continue;
+						size_t length = (fy_end - fy_begin)*input_depth;
+						dWI.block(0, fx*field + fy_begin*input_depth, output_depth, length).noalias() +=
+								dy.col(oy) * ConstMatrixMap(x_column + (iy + fy_begin)*input_depth, length, 1).transpose();
+					}//: for oy
+				}//: for ox
+			}//: for batch
+		}//: for fx
+
+		// Scatter to gradients of filters.
+		for (size_t fi=0; fi< output_depth; fi++) {
+			for (size_t ic=0; ic< input_depth; ic++) {
+				mic::types::MatrixPtr<eT> dW = g["W"+std::to_string(fi)+"x"+std::to_string(ic)];
+				for (size_t i=0; i< filter_size*filter_size; i++)
+					(*dW)[i] = dWI(fi, ic + i*input_depth);
+			}//: for input channels
+		}//: for filters
+
+		// db: sum of all pixels of a given output channel - these are rows of the interleaved batch.
+		(*g['b']) = ConstMatrixMap(batch_dy->data(), output_depth, batch_dy->rows() * batch_size / output_depth).rowwise().sum();
+
+		Layer<eT>::storeInterleavedBatch(batch_dx, g['x'], input_depth);
+	}
+
 	 // Uncover methods useful in visualization.
 	 using Layer<eT>::lazyAllocateMatrixVector;
 
@@ -835,7 +1593,8 @@ private:
 	/*!
 	 * Private constructor, used only during the serialization.
 	 */
-	Convolution<eT>() : Layer<eT> () { }
+	Convolution<eT>() : Layer<eT> (), padding(0), algorithm(ConvolutionAlgorithm::Auto), transformed_filters_valid(false), filter_spectra_valid(false), interleaved_filters_valid(false),
+		direct_kernels(nullptr), gathered_filters_valid(false) { }
 
 };
 
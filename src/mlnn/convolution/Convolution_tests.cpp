@@ -71,6 +71,183 @@ TEST(Convolutions, LayerDimensions) {
 }
 
 
+/*!
+ * Checks whether the Winograd F(2x2,3x3) algorithm (forward and backward dx) gives the same results as the direct one - for input of size 9x8x3, 4 filters of size 3x3 with stride 1 and batch of size 3.
+ * Checks also whether the transformed filters are recalculated after the update.
+ */
+TEST(Convolutions, WinogradEquivalence) {
+	// Layers.
+	mic::mlnn::convolution::Convolution<double> direct(9,8,3,4,3,1);
+	mic::mlnn::convolution::Convolution<double> winograd(9,8,3,4,3,1);
+	direct.setAlgorithm(mic::mlnn::convolution::ConvolutionAlgorithm::Direct);
+	winograd.setAlgorithm(mic::mlnn::convolution::ConvolutionAlgorithm::Winograd);
+	ASSERT_EQ(direct.selectedAlgorithm(), mic::mlnn::convolution::ConvolutionAlgorithm::Direct);
+	ASSERT_EQ(winograd.selectedAlgorithm(), mic::mlnn::convolution::ConvolutionAlgorithm::Winograd);
+
+	// Use the same parameters.
+	direct.p["b"]->rand(-1.0, 1.0);
+	for (auto& i: direct.p.keys())
+		(*winograd.p[i.first]) = (*direct.p[i.first]);
+
+	direct.resizeBatch(3);
+	winograd.resizeBatch(3);
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 9*8*3, 3);
+	mic::types::MatrixPtr<double> dy = MAKE_MATRIX_PTR(double, 7*6*4, 3);
+
+	double eps = 1e-10;
+	for (size_t it=0; it<2; it++) {
+		x->rand(-1.0, 1.0);
+		dy->rand(-1.0, 1.0);
+
+		// Forward.
+		mic::types::MatrixPtr<double> y1 = direct.forward(x);
+		mic::types::MatrixPtr<double> y2 = winograd.forward(x);
+		for (size_t i=0; i< (size_t)y1->size(); i++)
+			ASSERT_LE(fabs((*y1)[i] - (*y2)[i]), eps) << "y at position " << i;
+
+		// Backward.
+		mic::types::MatrixPtr<double> dx1 = direct.backward(dy);
+		mic::types::MatrixPtr<double> dx2 = winograd.backward(dy);
+		for (size_t i=0; i< (size_t)dx1->size(); i++)
+			ASSERT_LE(fabs((*dx1)[i] - (*dx2)[i]), eps) << "dx at position " << i;
+
+		// Update filters - transformed filters must be recalculated.
+		direct.update(0.1);
+		winograd.update(0.1);
+	}//: for
+}
+
+
+/*!
+ * Checks whether the FFT-based algorithm (forward, backward dx and dW) gives the same results as the direct one - for input of size 12x10x2, 3 filters of size 5x5 with stride 1 and batch of size 2.
+ */
+TEST(Convolutions, FFTEquivalence) {
+	// Layers.
+	mic::mlnn::convolution::Convolution<double> direct(12,10,2,3,5,1);
+	mic::mlnn::convolution::Convolution<double> fft(12,10,2,3,5,1);
+	direct.setAlgorithm(mic::mlnn::convolution::ConvolutionAlgorithm::Direct);
+	fft.setAlgorithm(mic::mlnn::convolution::ConvolutionAlgorithm::FFT);
+	ASSERT_EQ(fft.selectedAlgorithm(), mic::mlnn::convolution::ConvolutionAlgorithm::FFT);
+
+	// Use the same parameters.
+	direct.p["b"]->rand(-1.0, 1.0);
+	for (auto& i: direct.p.keys())
+		(*fft.p[i.first]) = (*direct.p[i.first]);
+
+	direct.resizeBatch(2);
+	fft.resizeBatch(2);
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 12*10*2, 2);
+	mic::types::MatrixPtr<double> dy = MAKE_MATRIX_PTR(double, 8*6*3, 2);
+
+	double eps = 1e-10;
+	for (size_t it=0; it<2; it++) {
+		x->rand(-1.0, 1.0);
+		dy->rand(-1.0, 1.0);
+
+		// Forward.
+		mic::types::MatrixPtr<double> y1 = direct.forward(x);
+		mic::types::MatrixPtr<double> y2 = fft.forward(x);
+		for (size_t i=0; i< (size_t)y1->size(); i++)
+			ASSERT_LE(fabs((*y1)[i] - (*y2)[i]), eps) << "y at position " << i;
+
+		// Backward.
+		mic::types::MatrixPtr<double> dx1 = direct.backward(dy);
+		mic::types::MatrixPtr<double> dx2 = fft.backward(dy);
+		for (size_t i=0; i< (size_t)dx1->size(); i++)
+			ASSERT_LE(fabs((*dx1)[i] - (*dx2)[i]), eps) << "dx at position " << i;
+		for (auto& k: direct.p.keys())
+			for (size_t i=0; i< (size_t)direct.g[k.first]->size(); i++)
+				ASSERT_LE(fabs((*direct.g[k.first])[i] - (*fft.g[k.first])[i]), eps) << "d" << k.first << " at position " << i;
+
+		// Update filters - spectra must be recalculated.
+		direct.update(0.1);
+		fft.update(0.1);
+	}//: for
+}
+
+
+/*!
+ * Checks whether the direct kernels specialized for filter sizes 1, 3, 5 and strides 1, 2 give the same results (forward, backward dx and dW) as the generic direct computation.
+ * Covers inputs with implicit padding and cropping, so fields crossing the border and the incomplete tiles of rows are also checked.
+ */
+TEST(Convolutions, SpecializedKernelsEquivalence) {
+	using mic::mlnn::convolution::ConvolutionAlgorithm;
+	size_t filter_sizes[] = { 1, 3, 5 };
+	size_t strides[] = { 1, 2 };
+	int paddings[] = { 0, 2, -1 };
+	double eps = 1e-10;
+
+	for (auto filter_size : filter_sizes)
+	for (auto stride : strides)
+	for (auto padding : paddings) {
+		// Input of size 13x11x2 (+ padding) - sizes fitting the filter and stride.
+		size_t height = 13 + ((13 + 2*padding - filter_size) % stride);
+		size_t width = 11 + ((11 + 2*padding - filter_size) % stride);
+		mic::mlnn::convolution::Convolution<double> generic(height, width, 2, 3, filter_size, stride, padding);
+		mic::mlnn::convolution::Convolution<double> specialized(height, width, 2, 3, filter_size, stride, padding);
+		generic.setAlgorithm(ConvolutionAlgorithm::Direct);
+		specialized.setAlgorithm(ConvolutionAlgorithm::Direct);
+		ASSERT_TRUE(specialized.direct_kernels != nullptr);
+		generic.direct_kernels = nullptr;
+
+		// Use the same parameters.
+		generic.p["b"]->rand(-1.0, 1.0);
+		for (auto& i: generic.p.keys())
+			(*specialized.p[i.first]) = (*generic.p[i.first]);
+
+		generic.resizeBatch(3);
+		specialized.resizeBatch(3);
+		mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, height*width*2, 3);
+		mic::types::MatrixPtr<double> dy = MAKE_MATRIX_PTR(double, generic.outputSize(), 3);
+
+		for (size_t it=0; it<2; it++) {
+			x->rand(-1.0, 1.0);
+			dy->rand(-1.0, 1.0);
+
+			mic::types::MatrixPtr<double> y1 = generic.forward(x);
+			mic::types::MatrixPtr<double> y2 = specialized.forward(x);
+			for (size_t i=0; i< (size_t)y1->size(); i++)
+				ASSERT_LE(fabs((*y1)[i] - (*y2)[i]), eps) << "filter " << filter_size << " stride " << stride << " padding " << padding << " y at position " << i;
+
+			mic::types::MatrixPtr<double> dx1 = generic.backward(dy);
+			mic::types::MatrixPtr<double> dx2 = specialized.backward(dy);
+			for (size_t i=0; i< (size_t)dx1->size(); i++)
+				ASSERT_LE(fabs((*dx1)[i] - (*dx2)[i]), eps) << "filter " << filter_size << " stride " << stride << " padding " << padding << " dx at position " << i;
+			for (auto& k: generic.p.keys())
+				for (size_t i=0; i< (size_t)generic.g[k.first]->size(); i++)
+					ASSERT_LE(fabs((*generic.g[k.first])[i] - (*specialized.g[k.first])[i]), eps) << "d" << k.first << " at position " << i;
+
+			// Update filters - gathered filters must be recalculated.
+			generic.update(0.1);
+			specialized.update(0.1);
+		}//: for
+	}//: for
+
+	// Other filter sizes and strides use the generic computation.
+	mic::mlnn::convolution::Convolution<double> other(8, 8, 1, 1, 4, 2);
+	ASSERT_TRUE(other.direct_kernels == nullptr);
+}
+
+
+/*!
+ * Checks whether the automatic selection of the algorithm for 3x3 filters with stride 1 compares the costs of Winograd and the specialized direct kernels
+ * - on the layers of mnist_convnet: the first layer (with a single input channel) should use the direct kernels, the second one Winograd.
+ */
+TEST(Convolutions, AutomaticAlgorithmSelection) {
+	using mic::mlnn::convolution::ConvolutionAlgorithm;
+	mic::mlnn::convolution::Convolution<float> conv1(26, 26, 1, 16, 3, 1);
+	mic::mlnn::convolution::Convolution<float> conv2(12, 12, 16, 32, 3, 1);
+	ASSERT_LT(conv1.directCost(), conv1.winogradCost());
+	ASSERT_EQ(conv1.selectedAlgorithm(), ConvolutionAlgorithm::Direct);
+	ASSERT_LT(conv2.winogradCost(), conv2.directCost());
+	ASSERT_EQ(conv2.selectedAlgorithm(), ConvolutionAlgorithm::Winograd);
+
+	// The explicitly set algorithm is used regardless of the costs.
+	conv1.setAlgorithm(ConvolutionAlgorithm::Winograd);
+	ASSERT_EQ(conv1.selectedAlgorithm(), ConvolutionAlgorithm::Winograd);
+}
+
+
 /*!
  * Checks whether the forward is working for layer of input size 2x2x2 and with filter bank of 2 filters of size 1x1 with stride 1.
  * \author tkornuta
@@ -354,6 +531,304 @@ TEST_F(Conv7x7x3Filter3x3x3s2Float, Forward) {
 
 
 
+
+/*!
+ * Compares convolutions with implicit padding/cropping (for all algorithms) with convolutions of explicitly padded/cropped inputs.
+ */
+TEST(Convolutions, BorderEquivalence) {
+	using mic::mlnn::convolution::ConvolutionAlgorithm;
+	ConvolutionAlgorithm algorithms[] = { ConvolutionAlgorithm::Direct, ConvolutionAlgorithm::Winograd, ConvolutionAlgorithm::FFT };
+	int paddings[] = { 2, -1 };
+	size_t filter_sizes[] = { 3, 5 };
+	size_t strides[] = { 1, 2 };
+	double eps = 1e-10;
+
+	for (auto algorithm : algorithms)
+	for (auto padding : paddings)
+	for (auto filter_size : filter_sizes)
+	for (auto stride : strides) {
+		size_t height = 9 + 2*padding, width = 8 + 2*padding;
+		mic::mlnn::convolution::Convolution<double> ref(height, width, 2, 3, filter_size, stride);
+		mic::mlnn::convolution::Convolution<double> layer(9, 8, 2, 3, filter_size, stride, padding);
+		ref.setAlgorithm(ConvolutionAlgorithm::Direct);
+		layer.setAlgorithm(algorithm);
+		ASSERT_EQ(layer.outputSize(), ref.outputSize());
+
+		// Use the same parameters.
+		ref.p["b"]->rand(-1.0, 1.0);
+		for (auto& i: ref.p.keys())
+			(*layer.p[i.first]) = (*ref.p[i.first]);
+
+		ref.resizeBatch(2);
+		layer.resizeBatch(2);
+		mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 9*8*2, 2);
+		mic::types::MatrixPtr<double> xe = MAKE_MATRIX_PTR(double, height*width*2, 2);
+		mic::types::MatrixPtr<double> dy = MAKE_MATRIX_PTR(double, ref.outputSize(), 2);
+		x->rand(-1.0, 1.0);
+		dy->rand(-1.0, 1.0);
+		// Pad or crop the input.
+		xe->setZero();
+		for (size_t ib=0; ib<2; ib++)
+			for (size_t ic=0; ic<2; ic++)
+				for (size_t ix=0; ix<8; ix++)
+					for (size_t iy=0; iy<9; iy++) {
+						long ey = (long)iy + padding, ex = (long)ix + padding;
+						if ((ey >= 0) && (ey < (long)height) && (ex >= 0) && (ex < (long)width))
+							(*xe)(ic*height*width + ey + ex*height, ib) = (*x)(ic*72 + iy + ix*9, ib);
+					}//: for
+
+		mic::types::MatrixPtr<double> y1 = ref.forward(xe);
+		mic::types::MatrixPtr<double> y2 = layer.forward(x);
+		for (size_t i=0; i< (size_t)y1->size(); i++)
+			ASSERT_LE(fabs((*y1)[i] - (*y2)[i]), eps) << "padding " << padding << " filter " << filter_size << " stride " << stride << " y at position " << i;
+
+		mic::types::MatrixPtr<double> dx1 = ref.backward(dy);
+		mic::types::MatrixPtr<double> dx2 = layer.backward(dy);
+		for (size_t ib=0; ib<2; ib++)
+			for (size_t ic=0; ic<2; ic++)
+				for (size_t ix=0; ix<8; ix++)
+					for (size_t iy=0; iy<9; iy++) {
+						long ey = (long)iy + padding, ex = (long)ix + padding;
+						bool inside = (ey >= 0) && (ey < (long)height) && (ex >= 0) && (ex < (long)width);
+						double dx_ref = inside ? (*dx1)(ic*height*width + ey + ex*height, ib) : 0;
+						ASSERT_LE(fabs((*dx2)(ic*72 + iy + ix*9, ib) - dx_ref), eps) << "padding " << padding << " filter " << filter_size << " stride " << stride;
+					}//: for
+		for (auto& k: ref.p.keys())
+			for (size_t i=0; i< (size_t)ref.g[k.first]->size(); i++)
+				ASSERT_LE(fabs((*ref.g[k.first])[i] - (*layer.g[k.first])[i]), eps) << "d" << k.first << " at position " << i;
+	}//: for
+}
+
+/*!
+ * Compares max pooling with various window sizes and strides (including overlapping and "wide" windows) with a naive implementation.
+ */
+TEST(MaxPoolings, WindowsAndStrides) {
+	size_t params[][2] = { {2, 2}, {3, 2}, {3, 1}, {17, 3} };
+	for (auto& wp : params) {
+		size_t window = wp[0], stride = wp[1];
+		size_t out = (20 - window) / stride + 1;
+		mic::mlnn::convolution::MaxPooling<double> layer(20, 20, 2, window, stride);
+		ASSERT_EQ(layer.outputSize(), out*out*2);
+		layer.resizeBatch(2);
+
+		mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 20*20*2, 2);
+		mic::types::MatrixPtr<double> dy = MAKE_MATRIX_PTR(double, out*out*2, 2);
+		x->rand(-1.0, 1.0);
+		dy->rand(-1.0, 1.0);
+		mic::types::MatrixPtr<double> y = layer.forward(x);
+		mic::types::MatrixPtr<double> dx = layer.backward(dy);
+
+		// Naive max pooling - dx accumulates gradients of overlapping windows.
+		mic::types::Matrix<double> dx_ref(20*20*2, 2);
+		dx_ref.setZero();
+		for (size_t ib=0; ib<2; ib++)
+			for (size_t ic=0; ic<2; ic++)
+				for (size_t ow=0; ow<out; ow++)
+					for (size_t oh=0; oh<out; oh++) {
+						size_t oa = ic*out*out + oh + ow*out;
+						size_t best = ic*400 + (oh*stride) + (ow*stride)*20;
+						for (size_t wx=0; wx<window; wx++)
+							for (size_t wy=0; wy<window; wy++) {
+								size_t ia = ic*400 + (oh*stride + wy) + (ow*stride + wx)*20;
+								if ((*x)(ia, ib) > (*x)(best, ib))
+									best = ia;
+							}//: for
+						ASSERT_EQ((*y)(oa, ib), (*x)(best, ib)) << "window " << window << " stride " << stride;
+						dx_ref(best, ib) += (*dy)(oa, ib);
+					}//: for
+		for (size_t i=0; i< (size_t)dx->size(); i++)
+			ASSERT_LE(fabs((*dx)[i] - dx_ref(i)), 1e-12) << "window " << window << " stride " << stride << " dx at position " << i;
+	}//: for
+}
+
+/*!
+ * Checks the constructor without stride (with name) - windows do not overlap.
+ */
+TEST(MaxPoolings, NamedWithoutStride) {
+	mic::mlnn::convolution::MaxPooling<double> layer(8, 6, 2, 2, "pool1");
+	ASSERT_EQ(layer.name(), "pool1");
+	ASSERT_EQ(layer.stride, 2);
+	ASSERT_EQ(layer.outputSize(), 4*3*2);
+}
+
+/*!
+ * Checks max pooling with overlapping windows producing outputs in the channel-interleaved layout.
+ */
+TEST(MaxPoolings, InterleavedEquivalence) {
+	mic::mlnn::convolution::MaxPooling<double> planar(7, 6, 3, 3, 1);
+	mic::mlnn::convolution::MaxPooling<double> interleaved(7, 6, 3, 3, 1);
+	interleaved.setLayouts(mic::mlnn::TensorLayout::NCHW, mic::mlnn::TensorLayout::NHWC);
+	planar.resizeBatch(2);
+	interleaved.resizeBatch(2);
+	size_t pixels = 5*4;
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 7*6*3, 2);
+	mic::types::MatrixPtr<double> dy = MAKE_MATRIX_PTR(double, pixels*3, 2);
+	mic::types::MatrixPtr<double> dyi = MAKE_MATRIX_PTR(double, pixels*3, 2);
+	x->rand(-1.0, 1.0);
+	dy->rand(-1.0, 1.0);
+	for (size_t ib=0; ib<2; ib++)
+		for (size_t ic=0; ic<3; ic++)
+			for (size_t px=0; px<pixels; px++)
+				(*dyi)(ic + px*3, ib) = (*dy)(px + ic*pixels, ib);
+
+	mic::types::MatrixPtr<double> y1 = planar.forward(x);
+	mic::types::MatrixPtr<double> y2 = interleaved.forward(x);
+	for (size_t ib=0; ib<2; ib++)
+		for (size_t ic=0; ic<3; ic++)
+			for (size_t px=0; px<pixels; px++)
+				ASSERT_EQ((*y1)(px + ic*pixels, ib), (*y2)(ic + px*3, ib));
+
+	mic::types::MatrixPtr<double> dx1 = planar.backward(dy);
+	mic::types::MatrixPtr<double> dx2 = interleaved.backward(dyi);
+	for (size_t i=0; i< (size_t)dx1->size(); i++)
+		ASSERT_LE(fabs((*dx1)[i] - (*dx2)[i]), 1e-12) << "dx at position " << i;
+}
+
+/*!
+ * Checks whether the batched forward pass of the convolutional hebbian layer (for both algorithms) is equal to forward passes of separate samples.
+ */
+TEST(ConvHebbians, BatchedForwardEqualsPerSample) {
+	using mic::mlnn::convolution::ConvolutionAlgorithm;
+	ConvolutionAlgorithm algorithms[] = { ConvolutionAlgorithm::Direct, ConvolutionAlgorithm::FFT };
+	size_t strides[] = { 1, 2 };
+	double eps = 1e-10;
+
+	for (auto algorithm : algorithms)
+	for (auto stride : strides) {
+		mic::mlnn::experimental::ConvHebbian<double> layer(12, 10, 1, 4, 3, stride);
+		layer.setAlgorithm(algorithm);
+		size_t patches = layer.output_width * layer.output_height;
+
+		mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 12*10, 3);
+		x->rand(-1.0, 1.0);
+		// Copy the outputs, as the same matrix is reused in the following passes.
+		mic::types::Matrix<double> y = (*layer.forward(x));
+		ASSERT_EQ(y.rows(), 4);
+		ASSERT_EQ(y.cols(), patches*3);
+
+		for (size_t ib=0; ib<3; ib++) {
+			mic::types::MatrixPtr<double> xs = MAKE_MATRIX_PTR(double, 12*10, 1);
+			(*xs) = x->col(ib);
+			mic::types::MatrixPtr<double> ys = layer.forward(xs);
+			for (size_t i=0; i<4; i++)
+				for (size_t j=0; j<patches; j++)
+					ASSERT_LE(fabs(y(i, j + patches*ib) - (*ys)(i, j)), eps) << "stride " << stride << " sample " << ib;
+		}//: for
+	}//: for
+}
+
+/*!
+ * Checks whether the hebbian rule consumes patches of the whole batch and keeps the filters zero-sum and normalized.
+ */
+TEST(ConvHebbians, BatchedUpdate) {
+	mic::mlnn::experimental::ConvHebbian<double> layer(8, 8, 1, 3, 3);
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 8*8, 4);
+	x->rand(0.0, 1.0);
+	mic::types::Matrix<double> W = (*layer.p["W"]);
+
+	layer.setAlgorithm(mic::mlnn::convolution::ConvolutionAlgorithm::FFT);
+	layer.forward(x);
+	layer.update(0.1);
+
+	// Patches of all samples were collected.
+	ASSERT_EQ(layer.x2col->cols(), layer.s["y"]->cols());
+	ASSERT_EQ(layer.x2col->cols(), 5*5*4);
+	ASSERT_GT(((*layer.p["W"]) - W).norm(), 1e-6);
+	for (size_t i=0; i<3; i++) {
+		ASSERT_LE(fabs(layer.p["W"]->row(i).norm() - 1.0), 1e-10);
+		ASSERT_LE(fabs(layer.p["W"]->row(i).sum()), 1e-10);
+	}//: for
+}
+
+/*!
+ * Compares the reconstruction (transposed convolution) of the convolutional hebbian layer with a naive implementation.
+ */
+TEST(ConvHebbians, Reconstruction) {
+	size_t strides[] = { 1, 2 };
+	for (auto stride : strides) {
+		mic::mlnn::experimental::ConvHebbian<double> layer(12, 10, 1, 4, 3, stride);
+		size_t ow = layer.output_width, oh = layer.output_height;
+		mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 12*10, 2);
+		x->rand(-1.0, 1.0);
+		layer.forward(x);
+		mic::types::Matrix<double> & y = (*layer.s["y"]);
+		mic::types::Matrix<double> & W = (*layer.p["W"]);
+
+		std::vector< std::shared_ptr <mic::types::Matrix<double> > > & r = layer.getOutputReconstruction();
+		ASSERT_EQ(r.size(), 2);
+		double error = 0;
+		for (size_t ib=0; ib<2; ib++) {
+			mic::types::Matrix<double> ref(12*10, 1);
+			ref.setZero();
+			for (size_t oy=0; oy<oh; oy++)
+				for (size_t ox=0; ox<ow; ox++)
+					for (size_t k=0; k<4; k++)
+						for (size_t py=0; py<3; py++)
+							for (size_t px=0; px<3; px++)
+								ref((oy*stride + py)*12 + ox*stride + px) +=
+										std::max(y(k, ox + ow*oy + ow*oh*ib), 0.0) * std::max(W(k, py*3 + px), 0.0);
+			for (size_t i=0; i<12*10; i++)
+				ASSERT_LE(fabs((*r[ib])[i] - ref(i)), 1e-10) << "stride " << stride << " sample " << ib << " at position " << i;
+			error += (ref.normalized() - x->col(ib).normalized()).squaredNorm();
+		}//: for
+		ASSERT_LE(fabs(layer.getOutputReconstructionError() - error/2), 1e-10);
+	}//: for
+}
+
+/*!
+ * Compares similarities of filters of the convolutional hebbian layer (computed fully and incrementally) with cosine similarities of filters.
+ * Filters are modified directly (invalidating the whole Gram matrix) and by the hebbian rule (reporting the updated filters).
+ */
+TEST(ConvHebbians, WeightSimilarity) {
+	bool modes[] = { false, true };
+	for (auto incremental : modes) {
+		mic::mlnn::experimental::ConvHebbian<double> layer(12, 10, 1, 6, 3);
+		layer.setIncrementalSimilarity(incremental);
+		mic::types::Matrix<double> & W = (*layer.p["W"]);
+		std::shared_ptr<mic::neural_nets::learning::NormalizedZerosumHebbianRule<double> > rule =
+				std::dynamic_pointer_cast<mic::neural_nets::learning::NormalizedZerosumHebbianRule<double> >(layer.opt["W"]);
+		ASSERT_TRUE((bool)rule);
+		mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 12*10, 1);
+
+		for (size_t step=0; step<6; step++) {
+			// Modify two filters.
+			if ((step > 0) && (step < 3)) {
+				W.row(step).setRandom();
+				W.row(5).setRandom();
+				layer.invalidateCaches();
+			}//: if
+			// Update the filters winning any patch (and normalize the other ones, at first).
+			if (step >= 3) {
+				x->rand(0.0, 1.0);
+				mic::types::Matrix<double> previous = W;
+				layer.forward(x);
+				layer.update(0.1);
+				std::set<size_t> updated(rule->updatedRows().begin(), rule->updatedRows().end());
+				ASSERT_EQ(layer.modified_filters, updated) << "step " << step;
+				// Other filters are left exactly as they were.
+				for (size_t i=0; i<6; i++) {
+					if (updated.count(i))
+						continue;
+					ASSERT_TRUE(W.row(i) == previous.row(i)) << "step " << step << " filter " << i;
+				}//: for
+			}//: if
+			mic::types::Matrix<double> sim = (*layer.getWeightSimilarity()[0]);
+			mic::types::Matrix<double> dis = (*layer.getWeightDissimilarity()[0]);
+			for (size_t i=0; i<6; i++)
+				for (size_t j=0; j<6; j++) {
+					double cos = W.row(i).dot(W.row(j)) / (W.row(i).norm() * W.row(j).norm());
+					ASSERT_LE(fabs(dis(j, i) - std::sqrt(std::max(0.0, 1 - cos*cos))), 1e-7) << "step " << step;
+					if (j >= i)
+						continue;
+					// Positive similarities above the diagonal, negative below.
+					ASSERT_LE(fabs(sim(j, i) - (cos > 0 ? cos : 0)), 1e-10) << "step " << step;
+					ASSERT_LE(fabs(sim(i, j) - (cos > 0 ? 0 : cos)), 1e-10) << "step " << step;
+				}//: for
+		}//: for
+	}//: for
+}
+
 } } } //: namespaces
 
 int main(int argc, char **argv) {
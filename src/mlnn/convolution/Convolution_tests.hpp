@@ -31,6 +31,8 @@
 #define private public
 #define protected public
 #include <mlnn/convolution/Convolution.hpp>
+#include <mlnn/convolution/MaxPooling.hpp>
+#include <mlnn/experimental/ConvHebbian.hpp>
 #include <loss/LossTypes.hpp>
 
 namespace mic { namespace neural_nets { namespace unit_tests {
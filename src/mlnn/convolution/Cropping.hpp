@@ -66,6 +66,11 @@ public:
 	 * Performs forward pass - add padding.
 	 */
 	void forward(bool test = false) {
+		// Process channel-interleaved batches.
+		if (Layer<eT>::interleaved()) {
+			forwardInterleaved();
+			return;
+		}//: if
 
 		// Get pointer to input batch.
 		mic::types::MatrixPtr<eT> batch_x = s['x'];
@@ -73,7 +78,7 @@ public:
 
 		// Get pointer to output batch - so the results will be stored!
 		mic::types::MatrixPtr<eT> batch_y = s['y'];
-		batch_y->setZero();
+		batch_y->leftCols(batch_size).setZero();
 
 		// TODO: should work for more channels - but requires testing!
 		assert(input_depth == 1);
@@ -110,6 +115,12 @@ public:
 	 */
 	void backward() {
 		LOG(LTRACE) << "Cropping::backward\n";
+
+		// Process channel-interleaved batches.
+		if (Layer<eT>::interleaved()) {
+			backwardInterleaved();
+			return;
+		}//: if
 		// Get pointer to dy batch.
 		mic::types::MatrixPtr<eT> batch_dy = g['y'];
 
@@ -118,7 +129,8 @@ public:
 
 		// Get pointer to dx batch.
 		mic::types::MatrixPtr<eT> batch_dx = g['x'];
-		//batch_dx->setZero();
+		// Cropped margins get zero gradients.
+		batch_dx->leftCols(batch_size).setZero();
 
 		// Iterate through batch.
 		//#pragma omp parallel for
@@ -155,6 +167,11 @@ public:
 	 */
 	void update(eT alpha_, eT decay_  = 0.0f) { }
 
+	/*!
+	 * Cropping supports the channel-interleaved layout (with any number of channels).
+	 */
+	virtual bool supportsInterleavedLayout() { return true; }
+
 	// Unhide the overloaded methods inherited from the template class Layer fields via "using" statement.
 	using Layer<eT>::forward;
 	using Layer<eT>::backward;
@@ -174,10 +191,51 @@ protected:
 	using Layer<eT>::output_width;
 	using Layer<eT>::output_depth;
     using Layer<eT>::batch_size;
+    using Layer<eT>::input_layout;
+    using Layer<eT>::output_layout;
 
     /// Cropping size - number of pixels removed in each channel (width and height)
 	size_t cropping;
 
+	/*!
+	 * Performs forward pass on channel-interleaved batches - a column of the output (all channels) is a single contiguous block.
+	 */
+	void forwardInterleaved() {
+		mic::types::MatrixPtr<eT> batch_x = Layer<eT>::lazyReturnInterleavedBatch(s['x'], input_layout, "xl", input_depth, true);
+		mic::types::MatrixPtr<eT> batch_y = Layer<eT>::lazyReturnInterleavedBatch(s['y'], output_layout, "yl", output_depth, false);
+
+		#pragma omp parallel for
+		for (size_t ib = 0; ib < batch_size; ib++) {
+			for (size_t iw=0; iw< output_width; iw++) {
+				size_t ia = ((iw + cropping) * input_height + cropping) * input_depth;
+				size_t oa = iw * output_height * output_depth;
+				batch_y->block(oa, ib, output_height * output_depth, 1) = batch_x->block(ia, ib, output_height * output_depth, 1);
+			}//: for width
+		}//: for batch
+
+		Layer<eT>::storeInterleavedBatch(batch_y, s['y'], output_depth);
+	}
+
+	/*!
+	 * Performs backward pass on channel-interleaved batches - gradients of the cropped margins are set to zero.
+	 */
+	void backwardInterleaved() {
+		mic::types::MatrixPtr<eT> batch_dy = Layer<eT>::lazyReturnInterleavedBatch(g['y'], output_layout, "dyl", output_depth, true);
+		mic::types::MatrixPtr<eT> batch_dx = Layer<eT>::lazyReturnInterleavedBatch(g['x'], input_layout, "dxl", input_depth, false);
+		batch_dx->leftCols(batch_size).setZero();
+
+		#pragma omp parallel for
+		for (size_t ib = 0; ib < batch_size; ib++) {
+			for (size_t iw=0; iw< output_width; iw++) {
+				size_t ia = ((iw + cropping) * input_height + cropping) * input_depth;
+				size_t oa = iw * output_height * output_depth;
+				batch_dx->block(ia, ib, output_height * output_depth, 1) = batch_dy->block(oa, ib, output_height * output_depth, 1);
+			}//: for width
+		}//: for batch
+
+		Layer<eT>::storeInterleavedBatch(batch_dx, g['x'], input_depth);
+	}
+
 private:
 	// Friend class - required for using boost serialization.
 	template<typename tmp> friend class mic::mlnn::MultiLayerNeuralNetwork;
@@ -0,0 +1,400 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file DirectKernels.hpp
+ * \brief Direct convolution kernels specialized (at compile time) for the filter size and stride.
+ * \date Oct 18, 2026
+ */
+
+#ifndef SRC_MLNN_DIRECTKERNELS_HPP_
+#define SRC_MLNN_DIRECTKERNELS_HPP_
+
+#include<types/MatrixTypes.hpp>
+
+#include <algorithm>
+
+namespace mic {
+namespace mlnn {
+namespace convolution {
+
+/*!
+ * \brief Class implementing the direct computation of the convolution (forward, backward dx and dW) for a given filter size and stride.
+ * As both are known at compile time, the filter is kept in a fixed-size array and the loops over the receptive field are unrolled.
+ * The forward pass additionally computes tiles of T output rows at once, reusing each filter element for all of them.
+ * Receptive fields crossing the (virtual) border are processed separately, with bound checks.
+ *
+ * Images are stored as in the convolutional layers: each sample is a column containing concatenated column-major channel planes.
+ * Filters are gathered into a single matrix [F*F x filters*channels], column k*channels + c containing the (column-major) filter connecting input channel c with output channel k.
+ * \tparam eT Template parameter denoting precision of variables (float for calculations/double for testing).
+ * \tparam F Size of filters (assuming square filters).
+ * \tparam S Stride (assuming equal vertical and horizontal strides).
+ */
+template <typename eT, size_t F, size_t S>
+class DirectKernel {
+public:
+	/// Number of output rows computed at once by the forward pass.
+	static const size_t T = 4;
+
+	/*!
+	 * Computes the cross-correlation of a batch of multi-channel images with a bank of filters.
+	 * @param x_ Input batch [channels_*height_*width_ x (at least) batch_size_].
+	 * @param batch_size_ Number of samples - leading columns of the batches.
+	 * @param channels_ Number of input channels.
+	 * @param height_ Height of the input channel.
+	 * @param width_ Width of the input channel.
+	 * @param padding_ Number of (virtual) zeros added on each side of the input channel - negative values crop the input channel instead.
+	 * @param W_ Gathered filters [F*F x filters*channels_].
+	 * @param bias_ Pointer to bias added to each output channel (or nullptr).
+	 * @param y_ Output batch [filters*output_height*output_width x (at least) batch_size_] (enlarged if required).
+	 */
+	static void correlate(const mic::types::Matrix<eT> & x_, size_t batch_size_, size_t channels_, size_t height_, size_t width_, long padding_,
+			const mic::types::Matrix<eT> & W_, const eT* bias_, mic::types::Matrix<eT> & y_) {
+		// Get dimensions.
+		size_t filters = W_.cols() / channels_;
+		size_t batch_size = batch_size_;
+		size_t output_height = outputSize(height_, padding_);
+		size_t output_width = outputSize(width_, padding_);
+		size_t oy_first, oy_last, ox_first, ox_last;
+		innerRange(height_, padding_, output_height, oy_first, oy_last);
+		innerRange(width_, padding_, output_width, ox_first, ox_last);
+		if (((size_t)y_.rows() != filters*output_height*output_width) || ((size_t)y_.cols() < batch_size))
+			y_.resize(filters*output_height*output_width, batch_size);
+
+		// Output channels of all samples are independent.
+		#pragma omp parallel for
+		for (size_t n=0; n < batch_size*filters; n++) {
+			size_t ib = n / filters;
+			size_t k = n % filters;
+			eT* y = y_.data() + ib*y_.rows() + k*output_height*output_width;
+			std::fill(y, y + output_height*output_width, (bias_ != nullptr) ? bias_[k] : (eT)0);
+
+			for (size_t c=0; c < channels_; c++) {
+				const eT* x = x_.data() + ib*x_.rows() + c*height_*width_;
+				eT w[F*F];
+				for (size_t i=0; i < F*F; i++)
+					w[i] = W_(i, k*channels_ + c);
+
+				for (size_t ox=0; ox < output_width; ox++) {
+					long ix = (long)(ox*S) - padding_;
+					eT* y_column = y + ox*output_height;
+					// Whole column lies in the border.
+					if ((ox < ox_first) || (ox >= ox_last)) {
+						for (size_t oy=0; oy < output_height; oy++)
+							y_column[oy] += borderField(x, w, (long)(oy*S) - padding_, ix, height_, width_);
+						continue;
+					}//: if
+
+					size_t oy = 0;
+					for (; oy < oy_first; oy++)
+						y_column[oy] += borderField(x, w, (long)(oy*S) - padding_, ix, height_, width_);
+					// Tiles of inner fields.
+					for (; oy + T <= oy_last; oy += T) {
+						const eT* field = x + ((long)(oy*S) - padding_) + ix*height_;
+						eT acc[T] = {};
+						for (size_t fx=0; fx < F; fx++)
+							for (size_t fy=0; fy < F; fy++) {
+								eT wv = w[fy + F*fx];
+								for (size_t t=0; t < T; t++)
+									acc[t] += wv * field[t*S + fy + fx*height_];
+							}//: for fy
+						for (size_t t=0; t < T; t++)
+							y_column[oy + t] += acc[t];
+					}//: for tiles
+					for (; oy < oy_last; oy++)
+						y_column[oy] += innerField(x + ((long)(oy*S) - padding_) + ix*height_, w, height_);
+					for (; oy < output_height; oy++)
+						y_column[oy] += borderField(x, w, (long)(oy*S) - padding_, ix, height_, width_);
+				}//: for ox
+			}//: for channels
+		}//: for output channels
+	}
+
+	/*!
+	 * Back-propagates the gradients from dy to dx, i.e. scatters the gradients of outputs, multiplied by filters, to their receptive fields.
+	 * @param dy_ Gradients of outputs [filters*output_height*output_width x (at least) batch_size_].
+	 * @param batch_size_ Number of samples - leading columns of the batches.
+	 * @param channels_ Number of input channels.
+	 * @param height_ Height of the input channel.
+	 * @param width_ Width of the input channel.
+	 * @param padding_ Number of (virtual) zeros added on each side of the input channel - negative values crop the input channel instead.
+	 * @param W_ Gathered filters [F*F x filters*channels_].
+	 * @param dx_ Gradients of inputs [channels_*height_*width_ x (at least) batch_size_] (enlarged if required).
+	 */
+	static void backpropagateToInputs(const mic::types::Matrix<eT> & dy_, size_t batch_size_, size_t channels_, size_t height_, size_t width_, long padding_,
+			const mic::types::Matrix<eT> & W_, mic::types::Matrix<eT> & dx_) {
+		// Get dimensions.
+		size_t filters = W_.cols() / channels_;
+		size_t batch_size = batch_size_;
+		size_t output_height = outputSize(height_, padding_);
+		size_t output_width = outputSize(width_, padding_);
+		size_t oy_first, oy_last, ox_first, ox_last;
+		innerRange(height_, padding_, output_height, oy_first, oy_last);
+		innerRange(width_, padding_, output_width, ox_first, ox_last);
+		if (((size_t)dx_.rows() != channels_*height_*width_) || ((size_t)dx_.cols() < batch_size))
+			dx_.resize(channels_*height_*width_, batch_size);
+
+		// Input channels of all samples are independent.
+		#pragma omp parallel for
+		for (size_t n=0; n < batch_size*channels_; n++) {
+			size_t ib = n / channels_;
+			size_t c = n % channels_;
+			eT* dx = dx_.data() + ib*dx_.rows() + c*height_*width_;
+			std::fill(dx, dx + height_*width_, (eT)0);
+
+			for (size_t k=0; k < filters; k++) {
+				const eT* dy = dy_.data() + ib*dy_.rows() + k*output_height*output_width;
+				eT w[F*F];
+				for (size_t i=0; i < F*F; i++)
+					w[i] = W_(i, k*channels_ + c);
+
+				for (size_t ox=0; ox < output_width; ox++) {
+					long ix = (long)(ox*S) - padding_;
+					bool inner_column = (ox >= ox_first) && (ox < ox_last);
+					for (size_t oy=0; oy < output_height; oy++) {
+						eT g = dy[oy + ox*output_height];
+						long iy = (long)(oy*S) - padding_;
+						// Inner field.
+						if (inner_column && (oy >= oy_first) && (oy < oy_last)) {
+							eT* field = dx + iy + ix*height_;
+							for (size_t fx=0; fx < F; fx++)
+								for (size_t fy=0; fy < F; fy++)
+									field[fy + fx*height_] += w[fy + F*fx] * g;
+							continue;
+						}//: if
+						// Field crossing the border.
+						for (size_t fx=0; fx < F; fx++) {
+							long x = ix + (long)fx;
+							if ((x < 0) || (x >= (long)width_))
+								continue;
+							for (size_t fy=0; fy < F; fy++) {
+								long y = iy + (long)fy;
+								if ((y >= 0) && (y < (long)height_))
+									dx[y + x*height_] += w[fy + F*fx] * g;
+							}//: for fy
+						}//: for fx
+					}//: for oy
+				}//: for ox
+			}//: for filters
+		}//: for input channels
+	}
+
+	/*!
+	 * Back-propagates the gradients from dy to dW, i.e. correlates the inputs with the gradients of outputs - summed over the whole batch.
+	 * @param x_ Input batch [channels_*height_*width_ x (at least) batch_size_].
+	 * @param dy_ Gradients of outputs [filters_*output_height*output_width x (at least) batch_size_].
+	 * @param batch_size_ Number of samples - leading columns of the batches.
+	 * @param channels_ Number of input channels.
+	 * @param height_ Height of the input channel.
+	 * @param width_ Width of the input channel.
+	 * @param padding_ Number of (virtual) zeros added on each side of the input channel - negative values crop the input channel instead.
+	 * @param filters_ Number of filters.
+	 * @param dW_ Gradients of the gathered filters [F*F x filters_*channels_] (resized if required).
+	 */
+	static void backpropagateToWeights(const mic::types::Matrix<eT> & x_, const mic::types::Matrix<eT> & dy_, size_t batch_size_, size_t channels_, size_t height_, size_t width_, long padding_,
+			size_t filters_, mic::types::Matrix<eT> & dW_) {
+		// Get dimensions.
+		size_t batch_size = batch_size_;
+		size_t output_height = outputSize(height_, padding_);
+		size_t output_width = outputSize(width_, padding_);
+		size_t oy_first, oy_last, ox_first, ox_last;
+		innerRange(height_, padding_, output_height, oy_first, oy_last);
+		innerRange(width_, padding_, output_width, ox_first, ox_last);
+		dW_.resize(F*F, filters_*channels_);
+
+		// Filters are independent - each sums its gradient over the whole batch.
+		#pragma omp parallel for
+		for (size_t n=0; n < filters_*channels_; n++) {
+			size_t k = n / channels_;
+			size_t c = n % channels_;
+			eT dw[F*F] = {};
+
+			for (size_t ib=0; ib < batch_size; ib++) {
+				const eT* x = x_.data() + ib*x_.rows() + c*height_*width_;
+				const eT* dy = dy_.data() + ib*dy_.rows() + k*output_height*output_width;
+				for (size_t ox=0; ox < output_width; ox++) {
+					long ix = (long)(ox*S) - padding_;
+					bool inner_column = (ox >= ox_first) && (ox < ox_last);
+					for (size_t oy=0; oy < output_height; oy++) {
+						eT g = dy[oy + ox*output_height];
+						long iy = (long)(oy*S) - padding_;
+						// Inner field.
+						if (inner_column && (oy >= oy_first) && (oy < oy_last)) {
+							const eT* field = x + iy + ix*height_;
+							for (size_t fx=0; fx < F; fx++)
+								for (size_t fy=0; fy < F; fy++)
+									dw[fy + F*fx] += field[fy + fx*height_] * g;
+							continue;
+						}//: if
+						// Field crossing the border.
+						for (size_t fx=0; fx < F; fx++) {
+							long xx = ix + (long)fx;
+							if ((xx < 0) || (xx >= (long)width_))
+								continue;
+							for (size_t fy=0; fy < F; fy++) {
+								long yy = iy + (long)fy;
+								if ((yy >= 0) && (yy < (long)height_))
+									dw[fy + F*fx] += x[yy + xx*height_] * g;
+							}//: for fy
+						}//: for fx
+					}//: for oy
+				}//: for ox
+			}//: for batch
+
+			for (size_t i=0; i < F*F; i++)
+				dW_(i, n) = dw[i];
+		}//: for filters
+	}
+
+private:
+	/*!
+	 * Returns the size of the output (in a given dimension).
+	 * @param input_ Size of the input.
+	 * @param padding_ Padding (or cropping, if negative).
+	 */
+	static size_t outputSize(size_t input_, long padding_) {
+		return ((long)input_ + 2*padding_ - (long)F) / S + 1;
+	}
+
+	/*!
+	 * Finds the range of outputs (in a given dimension) whose receptive fields lie entirely inside the (not padded) input.
+	 * @param input_ Size of the input.
+	 * @param padding_ Padding (or cropping, if negative).
+	 * @param output_ Size of the output.
+	 * @param first_ First such output.
+	 * @param last_ Output following the last such output (equal to first_ if there are no such outputs).
+	 */
+	static void innerRange(size_t input_, long padding_, size_t output_, size_t & first_, size_t & last_) {
+		first_ = output_;
+		last_ = output_;
+		for (size_t o=0; o < output_; o++) {
+			long i = (long)(o*S) - padding_;
+			bool inner = (i >= 0) && (i + (long)F <= (long)input_);
+			if (inner && (first_ == output_))
+				first_ = o;
+			if (!inner && (first_ != output_) && (last_ == output_))
+				last_ = o;
+		}//: for
+		if (first_ == output_)
+			last_ = output_;
+	}
+
+	/*!
+	 * Correlates the filter with a receptive field lying entirely inside the input.
+	 * @param field_ Pointer to the first (upper left) element of the field.
+	 * @param w_ Filter.
+	 * @param height_ Height of the input channel.
+	 */
+	static inline eT innerField(const eT* field_, const eT* w_, size_t height_) {
+		eT sum = 0;
+		for (size_t fx=0; fx < F; fx++)
+			for (size_t fy=0; fy < F; fy++)
+				sum += w_[fy + F*fx] * field_[fy + fx*height_];
+		return sum;
+	}
+
+	/*!
+	 * Correlates the filter with a receptive field crossing the border - elements lying outside of the input are zeros.
+	 * @param channel_ Input channel.
+	 * @param w_ Filter.
+	 * @param iy_ Input row corresponding to the first filter row (can be negative).
+	 * @param ix_ Input column corresponding to the first filter column (can be negative).
+	 * @param height_ Height of the input channel.
+	 * @param width_ Width of the input channel.
+	 */
+	static eT borderField(const eT* channel_, const eT* w_, long iy_, long ix_, size_t height_, size_t width_) {
+		eT sum = 0;
+		for (size_t fx=0; fx < F; fx++) {
+			long x = ix_ + (long)fx;
+			if ((x < 0) || (x >= (long)width_))
+				continue;
+			for (size_t fy=0; fy < F; fy++) {
+				long y = iy_ + (long)fy;
+				if ((y >= 0) && (y < (long)height_))
+					sum += w_[fy + F*fx] * channel_[y + x*height_];
+			}//: for fy
+		}//: for fx
+		return sum;
+	}
+
+};
+
+
+/*!
+ * \brief Table of direct kernels specialized for a given filter size and stride - selected at runtime, on the basis of the parameters of the layer.
+ * \tparam eT Template parameter denoting precision of variables (float for calculations/double for testing).
+ */
+template <typename eT=float>
+struct DirectKernels {
+	/// Type of the forward kernel.
+	typedef void (*Correlate)(const mic::types::Matrix<eT> &, size_t, size_t, size_t, size_t, long, const mic::types::Matrix<eT> &, const eT*, mic::types::Matrix<eT> &);
+
+	/// Type of the kernel back-propagating the gradients from dy to dx.
+	typedef void (*BackpropagateToInputs)(const mic::types::Matrix<eT> &, size_t, size_t, size_t, size_t, long, const mic::types::Matrix<eT> &, mic::types::Matrix<eT> &);
+
+	/// Type of the kernel back-propagating the gradients from dy to dW.
+	typedef void (*BackpropagateToWeights)(const mic::types::Matrix<eT> &, const mic::types::Matrix<eT> &, size_t, size_t, size_t, size_t, long, size_t, mic::types::Matrix<eT> &);
+
+	/// Forward kernel.
+	Correlate correlate;
+
+	/// Kernel back-propagating the gradients from dy to dx.
+	BackpropagateToInputs backpropagateToInputs;
+
+	/// Kernel back-propagating the gradients from dy to dW.
+	BackpropagateToWeights backpropagateToWeights;
+
+	/*!
+	 * Selects the kernels specialized for a given filter size and stride.
+	 * @param filter_size_ Size of filters.
+	 * @param stride_ Stride.
+	 * @return Pointer to the kernels or nullptr if there are no kernels specialized for such parameters.
+	 */
+	static const DirectKernels<eT>* select(size_t filter_size_, size_t stride_) {
+		if (stride_ == 1) {
+			switch(filter_size_) {
+			case 1: return instance<1, 1>();
+			case 3: return instance<3, 1>();
+			case 5: return instance<5, 1>();
+			}//: switch
+		} else if (stride_ == 2) {
+			switch(filter_size_) {
+			case 1: return instance<1, 2>();
+			case 3: return instance<3, 2>();
+			case 5: return instance<5, 2>();
+			}//: switch
+		}//: else
+		return nullptr;
+	}
+
+private:
+	/*!
+	 * Returns the kernels for a given filter size and stride.
+	 */
+	template <size_t F, size_t S>
+	static const DirectKernels<eT>* instance() {
+		static const DirectKernels<eT> kernels = {
+				&DirectKernel<eT, F, S>::correlate,
+				&DirectKernel<eT, F, S>::backpropagateToInputs,
+				&DirectKernel<eT, F, S>::backpropagateToWeights };
+		return &kernels;
+	}
+};
+
+} /* convolution */
+} /* namespace mlnn */
+} /* namespace mic */
+
+#endif /* SRC_MLNN_DIRECTKERNELS_HPP_ */
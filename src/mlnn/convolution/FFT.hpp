@@ -0,0 +1,175 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file FFT.hpp
+ * \brief Radix-2 Fast Fourier Transform used for computing convolutions with large filters.
+ * \date Oct 18, 2026
+ */
+
+#ifndef SRC_MLNN_FFT_HPP_
+#define SRC_MLNN_FFT_HPP_
+
+#include <algorithm>
+#include <complex>
+#include <vector>
+#include <cmath>
+
+namespace mic {
+namespace mlnn {
+namespace convolution {
+
+/*!
+ * \brief Class implementing a radix-2 (iterative, in-place) Fast Fourier Transform and helpers for computing 2D correlations and convolutions of image planes.
+ * Planes are zero-padded to power of 2 sizes, so the results are circular - but as long as the padded size is not smaller than the input,
+ * the "valid" part of a correlation (and the "full" convolution of a smaller plane) contains no wrapped-around elements.
+ *
+ * Spectra are stored as column-major [rows x cols] arrays of complex numbers.
+ * \tparam eT Template parameter denoting precision of variables (float for calculations/double for testing).
+ */
+template <typename eT=float>
+class FFT {
+public:
+	/// Type of complex numbers.
+	typedef std::complex<eT> cT;
+
+	/*!
+	 * Returns the smallest power of 2 not smaller than given size.
+	 * @param size_ Size.
+	 */
+	static size_t paddedSize(size_t size_) {
+		size_t n = 1;
+		while (n < size_)
+			n <<= 1;
+		return n;
+	}
+
+	/*!
+	 * Estimates the cost (number of real multiplications and additions) of a forward or inverse 2D transform.
+	 * @param rows_ Number of rows (power of 2).
+	 * @param cols_ Number of columns (power of 2).
+	 */
+	static eT transformCost(size_t rows_, size_t cols_) {
+		// 5 N log2(N) - standard estimate of radix-2 complexity.
+		return 5.0 * rows_ * cols_ * std::log2((double)rows_ * cols_);
+	}
+
+	/*!
+	 * Performs in-place 1D transform of a sequence of length n (power of 2), with given stride between the consecutive elements.
+	 * @param data_ Pointer to the first element.
+	 * @param n_ Length of the sequence.
+	 * @param stride_ Stride between elements.
+	 * @param inverse_ Flag denoting the inverse transform (not normalized).
+	 */
+	static void transform(cT* data_, size_t n_, size_t stride_, bool inverse_) {
+		// Bit reversal permutation.
+		for (size_t i = 1, j = 0; i < n_; i++) {
+			size_t bit = n_ >> 1;
+			for (; j & bit; bit >>= 1)
+				j ^= bit;
+			j ^= bit;
+			if (i < j)
+				std::swap(data_[i*stride_], data_[j*stride_]);
+		}//: for
+
+		// Butterflies - twiddles are calculated in double precision.
+		for (size_t len = 2; len <= n_; len <<= 1) {
+			double angle = 2.0 * M_PI / len * (inverse_ ? 1.0 : -1.0);
+			std::complex<double> wlen(cos(angle), sin(angle));
+			for (size_t i = 0; i < n_; i += len) {
+				std::complex<double> w(1.0, 0.0);
+				for (size_t j = 0; j < len/2; j++) {
+					cT u = data_[(i+j)*stride_];
+					cT v = data_[(i+j+len/2)*stride_] * cT((eT)w.real(), (eT)w.imag());
+					data_[(i+j)*stride_] = u + v;
+					data_[(i+j+len/2)*stride_] = u - v;
+					w *= wlen;
+				}//: for j
+			}//: for i
+		}//: for len
+	}
+
+	/*!
+	 * Performs in-place 2D transform of a column-major [rows x cols] array. The inverse transform is normalized.
+	 * @param data_ Pointer to the array.
+	 * @param rows_ Number of rows (power of 2).
+	 * @param cols_ Number of columns (power of 2).
+	 * @param inverse_ Flag denoting the inverse transform.
+	 */
+	static void transform2D(cT* data_, size_t rows_, size_t cols_, bool inverse_) {
+		// Columns.
+		for (size_t j = 0; j < cols_; j++)
+			transform(data_ + j*rows_, rows_, 1, inverse_);
+		// Rows.
+		for (size_t i = 0; i < rows_; i++)
+			transform(data_ + i, cols_, rows_, inverse_);
+
+		// Normalize.
+		if (inverse_) {
+			eT scale = 1.0 / (rows_ * cols_);
+			for (size_t i = 0; i < rows_ * cols_; i++)
+				data_[i] *= scale;
+		}//: if
+	}
+
+	/*!
+	 * Copies a real [height x width] plane to a zero-padded complex array and calculates its spectrum.
+	 * The plane element (i,j) is taken from data_[i*row_stride_ + j*col_stride_] and placed at (i + row_offset_, j + col_offset_).
+	 * @param data_ Pointer to the plane.
+	 * @param height_ Height of the plane.
+	 * @param width_ Width of the plane.
+	 * @param row_stride_ Distance between consecutive rows.
+	 * @param col_stride_ Distance between consecutive columns.
+	 * @param spectrum_ Resulting spectrum [rows x cols].
+	 * @param rows_ Number of rows of the spectrum (power of 2, not smaller than height + row offset).
+	 * @param cols_ Number of columns of the spectrum (power of 2, not smaller than width + column offset).
+	 * @param row_offset_ Number of zero rows placed above the plane (DEFAULT=0).
+	 * @param col_offset_ Number of zero columns placed left of the plane (DEFAULT=0).
+	 */
+	static void forwardPlane(const eT* data_, size_t height_, size_t width_, size_t row_stride_, size_t col_stride_,
+			cT* spectrum_, size_t rows_, size_t cols_, size_t row_offset_ = 0, size_t col_offset_ = 0) {
+		std::fill(spectrum_, spectrum_ + rows_*cols_, cT(0));
+		for (size_t j = 0; j < width_; j++)
+			for (size_t i = 0; i < height_; i++)
+				spectrum_[(i + row_offset_) + (j + col_offset_)*rows_] = cT(data_[i*row_stride_ + j*col_stride_]);
+		transform2D(spectrum_, rows_, cols_, false);
+	}
+
+	/*!
+	 * Multiplies two spectra element-wise and adds the result to the accumulator: acc += a .* b (or acc += a .* conj(b)).
+	 * Multiplication by conjugate corresponds to the correlation, whereas plain multiplication to the convolution.
+	 * @param a_ First spectrum.
+	 * @param b_ Second spectrum.
+	 * @param acc_ Accumulator.
+	 * @param size_ Number of elements.
+	 * @param conjugate_ Flag denoting whether b should be conjugated.
+	 */
+	static void multiplyAccumulate(const cT* a_, const cT* b_, cT* acc_, size_t size_, bool conjugate_) {
+		if (conjugate_) {
+			for (size_t i = 0; i < size_; i++)
+				acc_[i] += a_[i] * std::conj(b_[i]);
+		} else {
+			for (size_t i = 0; i < size_; i++)
+				acc_[i] += a_[i] * b_[i];
+		}//: else
+	}
+
+};
+
+} /* convolution */
+} /* namespace mlnn */
+} /* namespace mic */
+
+#endif /* SRC_MLNN_FFT_HPP_ */
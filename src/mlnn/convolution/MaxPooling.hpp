@@ -25,13 +25,17 @@
 
 #include <mlnn/layer/Layer.hpp>
 
+#include <cstdint>
+#include <vector>
+
 namespace mic {
 namespace mlnn {
 namespace convolution {
 
 
 /*!
- * \brief Layer performing max pooling.
+ * \brief Layer performing max pooling, with independent window size and stride (windows can overlap).
+ * Location of the maximum is stored as its (column-major) index in the window - as uint8 for windows of up to 16x16 elements and as int32 for bigger ones.
  * \author tkornuta
  * \tparam eT Template parameter denoting precision of variables (float for calculations/double for testing).
  */
@@ -46,18 +50,33 @@ public:
 	 * @param input_width_ Width of the input sample.
 	 * @param depth_ Depth of the input/output sample.
 	 * @param window_size_ Max pooling window in each channel (width and height).
+	 * @param stride_ Distance between consecutive windows (width and height). Zero (default) means stride equal to window size (i.e. non-overlapping windows).
 	 * @param name_ Name of the layer.
 	 */
 	MaxPooling(size_t input_height_, size_t input_width_, size_t depth_,
-			size_t window_size_,
+			size_t window_size_, size_t stride_ = 0,
 			std::string name_ = "MaxPooling") :
 		Layer<eT>::Layer(input_height_, input_width_, depth_,
-				(input_height_ /window_size_), (input_width_ / window_size_), depth_,
+				outputDimension(input_height_, window_size_, stride_), outputDimension(input_width_, window_size_, stride_), depth_,
 				LayerTypes::MaxPooling, name_),
-				window_size(window_size_)
+				window_size(window_size_),
+				stride(stride_ == 0 ? window_size_ : stride_)
+	{
+		assert((window_size > 0) && (input_height_ >= window_size) && (input_width_ >= window_size));
+	};
+
+	/*!
+	 * Creates a max pooling layer with non-overlapping windows (i.e. stride equal to window size).
+	 * @param input_height_ Height of the input sample.
+	 * @param input_width_ Width of the input sample.
+	 * @param depth_ Depth of the input/output sample.
+	 * @param window_size_ Max pooling window in each channel (width and height).
+	 * @param name_ Name of the layer.
+	 */
+	MaxPooling(size_t input_height_, size_t input_width_, size_t depth_,
+			size_t window_size_, std::string name_) :
+		MaxPooling(input_height_, input_width_, depth_, window_size_, 0, name_)
 	{
-		// Mapping from input to output - every cell will contain address of input image.
-		m.add("pooling_map", Layer<eT>::outputSize(), 1);
 	};
 
 	/*!
@@ -66,111 +85,41 @@ public:
 	virtual ~MaxPooling() {};
 
 	/*!
-	 * Changes the size of the batch - calls base Layer class resize and additionally resizes the cache size.
-	 * @param New size of the batch.
+	 * Max pooling supports the channel-interleaved layout.
 	 */
-	virtual void resizeBatch(size_t batch_size_) {
-		// Call base Layer resize.
-		Layer<eT>::resizeBatch(batch_size_);
-
-		// Reshape pooling mask and map.
-		m["pooling_map"]->resize(Layer<eT>::outputSize(), batch_size_);
+	virtual bool supportsInterleavedLayout() { return true; }
 
+	/*!
+	 * Returns true if a given layer is a max pooling with the same dimensions, window size and stride.
+	 * @param layer_ Compared layer.
+	 */
+	virtual bool sameStructure(Layer<eT> & layer_) {
+		MaxPooling<eT>* other = dynamic_cast<MaxPooling<eT>*>(&layer_);
+		return Layer<eT>::sameStructure(layer_) && (other != nullptr) &&
+			(window_size == other->window_size) && (stride == other->stride);
 	}
 
-
+	/*!
+	 * Performs forward pass - finds maxima in all windows and remembers their locations.
+	 */
 	void forward(bool test_ = false) {
 		LOG(LTRACE) << "MaxPooling::forward\n";
-
-		// Get pointer to input batch.
-		mic::types::MatrixPtr<eT> batch_x = s['x'];
-		//std::cout<< "forward batch_x=\n" << (*batch) << std::endl;
-		//std::cout << "forward input x activation: min:" << (*batch_x).minCoeff() <<" max: " << (*batch_x).maxCoeff() << std::endl;
-
-		// Get pointer to output batch - so the results will be stored!
-		mic::types::MatrixPtr<eT> batch_y = s['y'];
-		// Reset the whole batch.
-		batch_y->setZero();
-
-		// Get pointer to the mask.
-		mic::types::MatrixPtr<eT> pooling_map = m["pooling_map"];
-		pooling_map->setZero();
-
-		// TODO: should work for more channels - but requires testing!
-		//assert(input_depth == 1);
-
-		// Iterate through batch - cannot be done in parallel:
-		// * pooling mask is shared (ok)
-		// * tmp variables storing input samples/channels are multiplied and OMP secured (ok)
-		// * pooling mask and output batch are edited on different addresses - OMP secured (ok)
-		#pragma omp parallel for
-		for (size_t ib = 0; ib < batch_size; ib++) {
-			// Get input sample from batch.
-			mic::types::MatrixPtr<eT> xs = lazyReturnInputSample(batch_x, ib);
-
-			// Iterate through input/output channels.
-			for (size_t ic=0; ic< input_depth; ic++) {
-				// Get input channel from input sample.
-				mic::types::MatrixPtr<eT> xc = lazyReturnInputChannel(xs, ib, ic);
-
-				// Iterate through "blocks" in a given channel.
-				for (size_t ih=0, oh=0; ih< input_height; ih+=window_size, oh++) {
-					for (size_t iw=0, ow=0; iw< input_width; iw+=window_size, ow++) {
-
-					#pragma omp critical
-					{
-						// Get location of max element.
-						size_t maxRow, maxCol;
-						eT max_val = xc->block(ih, iw, window_size, window_size).maxCoeff(&maxRow, &maxCol);
-
-						//std::cout << "xc->block(ih, iw, window_size, window_size) = " <<xc->block(ih, iw, window_size, window_size) <<std::endl;
-						//std::cout << " maxRow = " << maxRow << " maxCol = "<< maxCol << " max_val = "<< max_val << std::endl;
-
-						// Calculate "absolute addresses.
-						size_t ia = (ib * Layer<eT>::inputSize()) + ic * input_height * input_width + (iw + maxCol) * input_height + (ih + maxRow);
-						size_t oa = (ib * Layer<eT>::outputSize()) + ic * output_height * output_width + (ow) * output_height + (oh);
-						/*std::cout << " ih = " << ih << " iw = " << iw << " ia = " << ia << std::endl;
-						std::cout << " oh = " << oh << " ow = " << ow << " oa = " << oa << std::endl;*/
-
-						// Map output to input.
-						(*pooling_map)[oa] = ia;
-
-						// Copy value to output.
-						(*batch_y)[oa] = max_val;
-					}
-
-					}//: for width
-				}//: for width
-			}//: for channels
-		}//: for batch
+		if (compactArgmax())
+			forwardPooling(argmax_compact);
+		else
+			forwardPooling(argmax_wide);
 		LOG(LTRACE) << "MaxPooling::forward end\n";
 	}
 
 	/*!
-	 * Backward pass.
+	 * Backward pass - passes the gradients to locations of maxima (summing them in the case of overlapping windows).
 	 */
 	void backward() {
 		LOG(LTRACE) << "MaxPooling::backward\n";
-
-		// Get pointer to dy batch.
-		mic::types::MatrixPtr<eT> batch_dy = g['y'];
-
-		// Get pointer to dx batch.
-		mic::types::MatrixPtr<eT> batch_dx = g['x'];
-		batch_dx->setZero();
-
-		mic::types::MatrixPtr<eT> pooling_map = m["pooling_map"];
-
-		// Iterate through batch.
-		#pragma omp parallel for
-		for (size_t oi = 0; oi < batch_size * Layer<eT>::outputSize(); oi++) {
-
-			// Map outputs to inputs.
-			//std::cout << " oi = " << oi << " (*pooling_map)[oi] = " << (*pooling_map)[oi] << std::endl;
-			(*batch_dx)[(size_t)(*pooling_map)[oi]] = (*batch_dy)[oi];
-
-		}//: for batch
-
+		if (compactArgmax())
+			backwardPooling(argmax_compact);
+		else
+			backwardPooling(argmax_wide);
 		LOG(LTRACE) << "MaxPooling::backward end\n";
 	}
 
@@ -202,16 +151,210 @@ protected:
 	using Layer<eT>::output_depth;
     using Layer<eT>::batch_size;
 
-    using Layer<eT>::lazyReturnInputSample;
-    using Layer<eT>::lazyReturnOutputSample;
-    using Layer<eT>::lazyReturnInputChannel;
-    using Layer<eT>::lazyReturnOutputChannel;
+    using Layer<eT>::lazyReturnInterleavedBatch;
+    using Layer<eT>::storeInterleavedBatch;
+    using Layer<eT>::input_layout;
+    using Layer<eT>::output_layout;
 
 	/*!
 	 * Size of the pooling window.
 	 */
 	size_t window_size;
 
+	/*!
+	 * Stride - distance between consecutive windows.
+	 */
+	size_t stride;
+
+	/// Locations of maxima (indices in windows) - used when the window has up to 256 elements.
+	std::vector<uint8_t> argmax_compact;
+
+	/// Locations of maxima (indices in windows) - used for bigger windows.
+	std::vector<int32_t> argmax_wide;
+
+	/*!
+	 * Calculates the number of windows fitting in a given dimension.
+	 */
+	static size_t outputDimension(size_t input_, size_t window_size_, size_t stride_) {
+		if (stride_ == 0)
+			stride_ = window_size_;
+		return (input_ < window_size_) ? 0 : (input_ - window_size_) / stride_ + 1;
+	}
+
+	/// Returns true if indices in windows fit in uint8.
+	inline bool compactArgmax() {
+		return window_size * window_size <= 256;
+	}
+
+	/*!
+	 * Performs forward pass.
+	 * @param argmax_ Vector where locations of maxima will be stored.
+	 * @tparam IndexT Type of the indices.
+	 */
+	template <typename IndexT>
+	void forwardPooling(std::vector<IndexT> & argmax_) {
+		argmax_.resize(Layer<eT>::outputSize() * batch_size);
+
+		// Process channel-interleaved batches.
+		if (Layer<eT>::interleaved()) {
+			forwardInterleaved(argmax_);
+			return;
+		}//: if
+
+		mic::types::MatrixPtr<eT> batch_x = s['x'];
+		mic::types::MatrixPtr<eT> batch_y = s['y'];
+		// Number of rows covered by windows.
+		size_t rows = (output_height - 1) * stride + window_size;
+
+		// Channels are processed independently.
+		#pragma omp parallel
+		{
+			// Maxima of rows of windows in a given window column and their locations.
+			std::vector<eT> row_max(rows);
+			std::vector<IndexT> row_argmax(rows);
+
+			#pragma omp for
+			for (size_t i = 0; i < batch_size * input_depth; i++) {
+				const eT* x_channel = batch_x->data() + i * input_height * input_width;
+				eT* y_channel = batch_y->data() + i * output_height * output_width;
+				IndexT* argmax_channel = argmax_.data() + i * output_height * output_width;
+
+				for (size_t ow = 0; ow < output_width; ow++) {
+					// 1. Maxima across the window columns - for all rows at once.
+					const eT* x_column = x_channel + ow * stride * input_height;
+					std::copy(x_column, x_column + rows, row_max.begin());
+					std::fill(row_argmax.begin(), row_argmax.end(), 0);
+					for (size_t wx = 1; wx < window_size; wx++) {
+						const eT* x_next = x_column + wx * input_height;
+						for (size_t iy = 0; iy < rows; iy++) {
+							if (x_next[iy] > row_max[iy]) {
+								row_max[iy] = x_next[iy];
+								row_argmax[iy] = wx;
+							}//: if
+						}//: for rows
+					}//: for wx
+
+					// 2. Maxima across the window rows.
+					for (size_t oh = 0; oh < output_height; oh++) {
+						size_t iy = oh * stride;
+						size_t wy_max = 0;
+						for (size_t wy = 1; wy < window_size; wy++)
+							if (row_max[iy + wy] > row_max[iy + wy_max])
+								wy_max = wy;
+						y_channel[oh + ow * output_height] = row_max[iy + wy_max];
+						argmax_channel[oh + ow * output_height] = wy_max + row_argmax[iy + wy_max] * window_size;
+					}//: for height
+				}//: for width
+			}//: for batch x channels
+		}//: omp parallel
+	}
+
+	/*!
+	 * Performs backward pass.
+	 * @param argmax_ Vector with locations of maxima.
+	 * @tparam IndexT Type of the indices.
+	 */
+	template <typename IndexT>
+	void backwardPooling(std::vector<IndexT> & argmax_) {
+		// Process channel-interleaved batches.
+		if (Layer<eT>::interleaved()) {
+			backwardInterleaved(argmax_);
+			return;
+		}//: if
+
+		mic::types::MatrixPtr<eT> batch_dy = g['y'];
+		mic::types::MatrixPtr<eT> batch_dx = g['x'];
+
+		// Channels are processed independently.
+		#pragma omp parallel for
+		for (size_t i = 0; i < batch_size * input_depth; i++) {
+			const eT* dy_channel = batch_dy->data() + i * output_height * output_width;
+			eT* dx_channel = batch_dx->data() + i * input_height * input_width;
+			const IndexT* argmax_channel = argmax_.data() + i * output_height * output_width;
+			std::fill(dx_channel, dx_channel + input_height * input_width, (eT)0);
+
+			for (size_t ow = 0; ow < output_width; ow++) {
+				for (size_t oh = 0; oh < output_height; oh++) {
+					size_t oa = oh + ow * output_height;
+					size_t ia = (oh * stride + argmax_channel[oa] % window_size) + (ow * stride + argmax_channel[oa] / window_size) * input_height;
+					dx_channel[ia] += dy_channel[oa];
+				}//: for height
+			}//: for width
+		}//: for batch x channels
+	}
+
+	/*!
+	 * Performs forward pass on channel-interleaved batches - all channels of a given pixel are compared at once.
+	 * @param argmax_ Vector where locations of maxima will be stored.
+	 * @tparam IndexT Type of the indices.
+	 */
+	template <typename IndexT>
+	void forwardInterleaved(std::vector<IndexT> & argmax_) {
+		mic::types::MatrixPtr<eT> batch_x = lazyReturnInterleavedBatch(s['x'], input_layout, "xl", input_depth, true);
+		mic::types::MatrixPtr<eT> batch_y = lazyReturnInterleavedBatch(s['y'], output_layout, "yl", output_depth, false);
+
+		// Output columns are processed independently.
+		#pragma omp parallel for
+		for (size_t i = 0; i < batch_size * output_width; i++) {
+			size_t ib = i / output_width;
+			size_t ow = i % output_width;
+			const eT* x_sample = batch_x->data() + ib * Layer<eT>::inputSize();
+			eT* y_sample = batch_y->data() + ib * Layer<eT>::outputSize();
+			IndexT* argmax_sample = argmax_.data() + ib * Layer<eT>::outputSize();
+
+			for (size_t oh = 0; oh < output_height; oh++) {
+				size_t oa = (oh + ow * output_height) * input_depth;
+				for (size_t wx = 0; wx < window_size; wx++) {
+					for (size_t wy = 0; wy < window_size; wy++) {
+						const eT* x_pixel = x_sample + ((oh * stride + wy) + (ow * stride + wx) * input_height) * input_depth;
+						IndexT wi = wy + wx * window_size;
+						for (size_t ic = 0; ic < input_depth; ic++) {
+							if ((wi == 0) || (x_pixel[ic] > y_sample[oa + ic])) {
+								y_sample[oa + ic] = x_pixel[ic];
+								argmax_sample[oa + ic] = wi;
+							}//: if
+						}//: for channels
+					}//: for wy
+				}//: for wx
+			}//: for height
+		}//: for batch x width
+
+		storeInterleavedBatch(batch_y, s['y'], output_depth);
+	}
+
+	/*!
+	 * Performs backward pass on channel-interleaved batches.
+	 * @param argmax_ Vector with locations of maxima.
+	 * @tparam IndexT Type of the indices.
+	 */
+	template <typename IndexT>
+	void backwardInterleaved(std::vector<IndexT> & argmax_) {
+		mic::types::MatrixPtr<eT> batch_dy = lazyReturnInterleavedBatch(g['y'], output_layout, "dyl", output_depth, true);
+		mic::types::MatrixPtr<eT> batch_dx = lazyReturnInterleavedBatch(g['x'], input_layout, "dxl", input_depth, false);
+
+		// Samples are processed independently (windows of neighbouring columns might overlap).
+		#pragma omp parallel for
+		for (size_t ib = 0; ib < batch_size; ib++) {
+			const eT* dy_sample = batch_dy->data() + ib * Layer<eT>::outputSize();
+			eT* dx_sample = batch_dx->data() + ib * Layer<eT>::inputSize();
+			const IndexT* argmax_sample = argmax_.data() + ib * Layer<eT>::outputSize();
+			std::fill(dx_sample, dx_sample + Layer<eT>::inputSize(), (eT)0);
+
+			for (size_t ow = 0; ow < output_width; ow++) {
+				for (size_t oh = 0; oh < output_height; oh++) {
+					size_t oa = (oh + ow * output_height) * input_depth;
+					for (size_t ic = 0; ic < input_depth; ic++) {
+						size_t wi = argmax_sample[oa + ic];
+						size_t ia = ((oh * stride + wi % window_size) + (ow * stride + wi / window_size) * input_height) * input_depth;
+						dx_sample[ia + ic] += dy_sample[oa + ic];
+					}//: for channels
+				}//: for height
+			}//: for width
+		}//: for batch
+
+		storeInterleavedBatch(batch_dx, g['x'], input_depth);
+	}
+
 private:
 	// Friend class - required for using boost serialization.
 	template<typename tmp> friend class mic::mlnn::MultiLayerNeuralNetwork;
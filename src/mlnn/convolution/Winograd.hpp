@@ -0,0 +1,197 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file Winograd.hpp
+ * \brief Winograd minimal filtering F(2x2,3x3) used by convolutional layers.
+ * \date Oct 18, 2026
+ */
+
+#ifndef SRC_MLNN_WINOGRAD_HPP_
+#define SRC_MLNN_WINOGRAD_HPP_
+
+#include<types/MatrixTypes.hpp>
+
+namespace mic {
+namespace mlnn {
+namespace convolution {
+
+/*!
+ * \brief Class implementing the Winograd minimal filtering algorithm F(2x2,3x3).
+ * Computes 2x2 output tiles of a (valid, stride 1) cross-correlation with 3x3 filters from 4x4 input tiles,
+ * using 16 instead of 36 multiplications per tile and channel pair: Y = A^T [ (G g G^T) .* (B^T d B) ] A.
+ * The sum over input channels is performed in the transformed domain, as 16 independent matrix products.
+ *
+ * Images are stored as in the convolutional layers: each sample is a column containing concatenated column-major channel planes.
+ * \tparam eT Template parameter denoting precision of variables (float for calculations/double for testing).
+ */
+template <typename eT=float>
+class Winograd {
+public:
+
+	/*!
+	 * Transforms a single 3x3 filter: u = G g G^T.
+	 * @param g_ Pointer to the filter (9 elements, column-major).
+	 * @param u_ Pointer to the resulting transformed filter (16 elements, column-major).
+	 * @param rotate_ If set, the filter is rotated by 180 degrees before the transformation (used for back-propagation).
+	 */
+	static void transformFilter(const eT* g_, eT* u_, bool rotate_ = false) {
+		// Get filter, rotated if required.
+		eT g[3][3];
+		for (size_t i=0; i<3; i++)
+			for (size_t j=0; j<3; j++)
+				g[i][j] = rotate_ ? g_[(2-i) + 3*(2-j)] : g_[i + 3*j];
+
+		// tmp = G g.
+		eT t[4][3];
+		for (size_t j=0; j<3; j++) {
+			t[0][j] = g[0][j];
+			t[1][j] = (g[0][j] + g[1][j] + g[2][j]) * 0.5;
+			t[2][j] = (g[0][j] - g[1][j] + g[2][j]) * 0.5;
+			t[3][j] = g[2][j];
+		}//: for
+
+		// u = tmp G^T.
+		for (size_t i=0; i<4; i++) {
+			u_[i + 0] = t[i][0];
+			u_[i + 4] = (t[i][0] + t[i][1] + t[i][2]) * 0.5;
+			u_[i + 8] = (t[i][0] - t[i][1] + t[i][2]) * 0.5;
+			u_[i + 12] = t[i][2];
+		}//: for
+	}
+
+	/*!
+	 * Computes the cross-correlation of a batch of multi-channel images with a bank of transformed filters.
+	 * The output size is (height_ + 2*padding_ - 2) x (width_ + 2*padding_ - 2).
+	 * @param x_ Input batch [channels_*height_*width_ x (at least) batch_size_].
+	 * @param batch_size_ Number of samples - leading columns of the batches.
+	 * @param channels_ Number of input channels.
+	 * @param height_ Height of the input channel.
+	 * @param width_ Width of the input channel.
+	 * @param padding_ Number of (virtual) zeros added on each side of the input channel - negative values crop the input channel instead.
+	 * @param U_ Transformed filters [filters x 16*channels_], U(k, xi*channels_ + c) being the xi-th element of a filter connecting input channel c with output channel k.
+	 * @param bias_ Pointer to bias added to each output channel (or nullptr).
+	 * @param y_ Output batch [filters*output_height*output_width x (at least) batch_size_] (enlarged if required).
+	 * @param V_ Workspace for transformed input tiles (enlarged if required).
+	 * @param M_ Workspace for transformed output tiles (enlarged if required).
+	 */
+	static void correlate(const mic::types::Matrix<eT> & x_, size_t batch_size_, size_t channels_, size_t height_, size_t width_, long padding_,
+			const mic::types::Matrix<eT> & U_, const eT* bias_,
+			mic::types::Matrix<eT> & y_, mic::types::Matrix<eT> & V_, mic::types::Matrix<eT> & M_) {
+		// Get dimensions.
+		size_t filters = U_.rows();
+		size_t batch_size = batch_size_;
+		size_t output_height = (long)height_ + 2*padding_ - 2;
+		size_t output_width = (long)width_ + 2*padding_ - 2;
+		size_t tiles_y = (output_height + 1) / 2;
+		size_t tiles_x = (output_width + 1) / 2;
+		size_t tiles = tiles_y * tiles_x;
+		size_t N = tiles * batch_size;
+
+		// Enlarge workspaces and outputs - they are never shrunk, so smaller batches do not reallocate them.
+		if (((size_t)V_.rows() != channels_) || ((size_t)V_.cols() < 16*N))
+			V_.resize(channels_, 16*N);
+		if (((size_t)M_.rows() != filters) || ((size_t)M_.cols() < 16*N))
+			M_.resize(filters, 16*N);
+		if (((size_t)y_.rows() != filters*output_height*output_width) || ((size_t)y_.cols() < batch_size))
+			y_.resize(filters*output_height*output_width, batch_size);
+
+		// 1. Transform input tiles: v = B^T d B.
+		#pragma omp parallel for
+		for (size_t n=0; n < N; n++) {
+			size_t ib = n / tiles;
+			size_t ty = (n % tiles) % tiles_y;
+			size_t tx = (n % tiles) / tiles_y;
+			const eT* sample = x_.data() + ib * x_.rows();
+
+			for (size_t c=0; c < channels_; c++) {
+				const eT* channel = sample + c*height_*width_;
+				// Get tile - with zeros outside of the input.
+				eT d[4][4];
+				for (size_t j=0; j<4; j++) {
+					long ix = (long)(2*tx + j) - padding_;
+					for (size_t i=0; i<4; i++) {
+						long iy = (long)(2*ty + i) - padding_;
+						d[i][j] = ((iy >= 0) && (iy < (long)height_) && (ix >= 0) && (ix < (long)width_)) ?
+								channel[iy + ix*height_] : 0;
+					}//: for i
+				}//: for j
+
+				// tmp = B^T d.
+				eT t[4][4];
+				for (size_t j=0; j<4; j++) {
+					t[0][j] = d[0][j] - d[2][j];
+					t[1][j] = d[1][j] + d[2][j];
+					t[2][j] = d[2][j] - d[1][j];
+					t[3][j] = d[1][j] - d[3][j];
+				}//: for
+
+				// v = tmp B - stored as 16 "planes" of size [channels x N].
+				for (size_t i=0; i<4; i++) {
+					V_(c, (i + 0)*N + n) = t[i][0] - t[i][2];
+					V_(c, (i + 4)*N + n) = t[i][1] + t[i][2];
+					V_(c, (i + 8)*N + n) = t[i][2] - t[i][1];
+					V_(c, (i + 12)*N + n) = t[i][1] - t[i][3];
+				}//: for
+			}//: for channels
+		}//: for tiles
+
+		// 2. Multiply in the transformed domain - sums over input channels.
+		for (size_t xi=0; xi < 16; xi++)
+			M_.block(0, xi*N, filters, N).noalias() = U_.block(0, xi*channels_, filters, channels_) * V_.block(0, xi*N, channels_, N);
+
+		// 3. Transform output tiles: Y = A^T m A.
+		#pragma omp parallel for
+		for (size_t n=0; n < N; n++) {
+			size_t ib = n / tiles;
+			size_t ty = (n % tiles) % tiles_y;
+			size_t tx = (n % tiles) / tiles_y;
+			eT* sample = y_.data() + ib * y_.rows();
+
+			for (size_t k=0; k < filters; k++) {
+				eT m[4][4];
+				for (size_t j=0; j<4; j++)
+					for (size_t i=0; i<4; i++)
+						m[i][j] = M_(k, (i + 4*j)*N + n);
+
+				// tmp = A^T m.
+				eT t[2][4];
+				for (size_t j=0; j<4; j++) {
+					t[0][j] = m[0][j] + m[1][j] + m[2][j];
+					t[1][j] = m[1][j] - m[2][j] - m[3][j];
+				}//: for
+
+				// Y = tmp A, plus bias.
+				eT b = (bias_ != nullptr) ? bias_[k] : 0;
+				eT* channel = sample + k*output_height*output_width;
+				for (size_t i=0; i<2; i++) {
+					size_t oy = 2*ty + i;
+					if (oy >= output_height)
+						continue;
+					channel[oy + 2*tx*output_height] = t[i][0] + t[i][1] + t[i][2] + b;
+					if (2*tx + 1 < output_width)
+						channel[oy + (2*tx + 1)*output_height] = t[i][1] - t[i][2] - t[i][3] + b;
+				}//: for
+			}//: for filters
+		}//: for tiles
+	}
+
+};
+
+} /* convolution */
+} /* namespace mlnn */
+} /* namespace mic */
+
+#endif /* SRC_MLNN_WINOGRAD_HPP_ */
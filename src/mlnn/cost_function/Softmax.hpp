@@ -83,10 +83,10 @@ public:
 		// Call parent resize.
 		Layer<eT>::resizeBatch(batch_size_);
 
-		// Reshape the temporary matrices.
-		m["e"]->resize(m["e"]->rows(), batch_size_);
-		m["sum"]->resize(m["sum"]->rows(), batch_size_);
-		m["max"]->resize(m["max"]->rows(), batch_size_);
+		// Reserve the temporary matrices.
+		Layer<eT>::reserveColumns(m["e"], batch_size_);
+		Layer<eT>::reserveColumns(m["sum"], batch_size_);
+		Layer<eT>::reserveColumns(m["max"], batch_size_);
 	}
 
 
@@ -101,19 +101,19 @@ public:
 		//std::cout << "Softmax forward: s['x'] = \n" << (*s['x']) << std::endl;
 
 		// Prevent overflow according to: http://eric-yuan.me/softmax/
-		(*max) = x->colwise().maxCoeff();
+		max->leftCols(batch_size) = x->leftCols(batch_size).colwise().maxCoeff();
 
 		// Calculate the e matrix - with overflow prevention.
 		for (size_t i = 0; i < (size_t)y->rows(); i++)
-			for (size_t j = 0; j < (size_t)y->cols(); j++)
+			for (size_t j = 0; j < batch_size; j++)
 				(*e)(i, j) = std::exp( (*x)(i, j) - (*max)(j) );
 
 		// Sum the values in columns (single batch), one by one.
-		(*sum) = e->colwise().sum();
+		sum->leftCols(batch_size) = e->leftCols(batch_size).colwise().sum();
 
 		// Iterate through elements.
 		for (size_t i = 0; i < (size_t)y->rows(); i++) {
-			for (size_t j = 0; j < (size_t)y->cols(); j++) {
+			for (size_t j = 0; j < batch_size; j++) {
 				(*y)(i, j) = (*e)(i, j) / (*sum)(j);
 			}//: for
 		}//: for
@@ -127,7 +127,7 @@ public:
 		mic::types::MatrixPtr<eT> dy = g["y"];
 
 		// Pass the gradient.
-		for (size_t i = 0; i < (size_t)y->size(); i++)
+		for (size_t i = 0; i < (size_t)y->rows() * batch_size; i++)
 			// dx = dy *  derivative of softmax, i.e. y * (1 - y);
 			(*dx)[i] = (*dy)[i] * (*y)[i] * (1 - (*y)[i]);
 
@@ -151,6 +151,7 @@ protected:
     using Layer<eT>::g;
     using Layer<eT>::s;
     using Layer<eT>::m;
+    using Layer<eT>::batch_size;
 
 
 private:
@@ -27,6 +27,10 @@
 #define SRC_MLNN_CONVHEBBIAN_HPP_
 
 #include <mlnn/layer/Layer.hpp>
+#include <mlnn/convolution/Convolution.hpp>
+#include <optimization/NormalizedZerosumHebbianRule.hpp>
+
+#include <set>
 
 namespace mic {
 namespace mlnn {
@@ -52,7 +56,8 @@ public:
         filter_size(filter_size),
         stride(stride),
         x2col(new mic::types::Matrix<eT>(filter_size * filter_size, output_width * output_height)),
-        conv2col(new mic::types::Matrix<eT>(filter_size * filter_size, output_width * output_height))
+        conv2col(new mic::types::Matrix<eT>(filter_size * filter_size, output_width * output_height)),
+        rectified_weights(new mic::types::Matrix<eT>(nfilters, filter_size * filter_size))
     {
         // Create the weights matrix, each row is a filter kernel
         p.add("W", nfilters, filter_size * filter_size);
@@ -79,35 +84,65 @@ public:
     virtual ~ConvHebbian() {}
 
     /*!
-     * Forward pass.
+     * Sets the algorithm used for computing the convolution. Supported are Direct (im2col + matrix multiplication) and FFT (stride 1 only).
+     * @param algorithm_ Algorithm.
+     */
+    void setAlgorithm(convolution::ConvolutionAlgorithm algorithm_) {
+        algorithm = algorithm_;
+    }
+
+    /*!
+     * Returns the algorithm that will be used for computing the convolution.
+     */
+    convolution::ConvolutionAlgorithm selectedAlgorithm() {
+        // FFT can be used only with stride 1.
+        if ((stride != 1) || (algorithm == convolution::ConvolutionAlgorithm::Direct) || (algorithm == convolution::ConvolutionAlgorithm::Winograd))
+            return convolution::ConvolutionAlgorithm::Direct;
+        if (algorithm == convolution::ConvolutionAlgorithm::FFT)
+            return convolution::ConvolutionAlgorithm::FFT;
+        // Auto - FFT pays off only for bigger filters.
+        if ((filter_size >= 5) && (fftCost() < gemmCost()))
+            return convolution::ConvolutionAlgorithm::FFT;
+        return convolution::ConvolutionAlgorithm::Direct;
+    }
+
+    /*!
+     * Invalidates the cached filter spectra - they will be recalculated during the next pass.
+     */
+    virtual void invalidateCaches() {
+        filter_spectra_valid = false;
+        rectified_weights_valid = false;
+        gram_valid = false;
+    }
+
+    /*!
+     * Forward pass. Processes the whole batch at once: y is a [nfilters x (output_height*output_width*batch_size)] matrix,
+     * in which the responses of each sample occupy a contiguous block of columns.
      * @param test_ It is set to true in test mode (network verification).
      */
     void forward(bool test_ = false) {
-        // Get input matrices.
-        mic::types::Matrix<eT> x = (*s["x"]);
-        mic::types::Matrix<eT> W = (*p["W"]);
-        // Get output pointer - so the results will be stored!
-        mic::types::MatrixPtr<eT> y = s["y"];
-
-        // IM2COL
-        // Iterate over the output matrix (number of image patches)
-        for(size_t oy = 0 ; oy < output_height ; oy++){
-            for(size_t ox = 0 ; ox < output_width ; ox++){
-                // Iterate over the rows of the patch
-                for(size_t patch_y = 0 ; patch_y < filter_size ; patch_y++){
-                    // Copy each row of the image patch into appropriate position in x2col
-                    x2col->block(patch_y * filter_size, ox + (output_width * oy), filter_size, 1) =
-                            x.block((((oy * stride) + patch_y) * input_width) + (ox * stride), 0, filter_size, 1);
-                }
-            }
-        }
-        // Forward pass.
-        (*y) = W * (*x2col);
+        if (selectedAlgorithm() == convolution::ConvolutionAlgorithm::FFT) {
+            forwardFFT();
+            // Patches will be collected when required by the update.
+            x2col_valid = false;
+        } else {
+            im2col();
+            // Forward pass - a single matrix multiplication for the whole batch.
+            s["y"]->noalias() = (*p["W"]) * (*x2col);
+        }//: else
         o_reconstruction_updated = false;
         // ReLU
         //(*y) = (*y).cwiseMax(0);
     }
 
+    /*!
+     * Returns a copy of the whole buffer - outputs of the layer are [nfilters x (output_height*output_width*batch_size)] matrices, resized in every forward pass.
+     * @param batch_ptr_ Pointer to the buffer.
+     */
+    mic::types::MatrixPtr<eT> copyBatch(mic::types::MatrixPtr<eT> batch_ptr_) {
+        return std::make_shared<mic::types::Matrix<eT> >(*batch_ptr_);
+    }
+
     /*!
      * Backward pass.
      */
@@ -117,17 +152,139 @@ public:
 
     /*!
      * Applies the gradient update, using the selected hebbian rule.
+     * The rule gets the patches of all samples of the batch (columns of x2col) along with the corresponding responses (columns of y).
      * @param alpha_ Learning rate - passed to the optimization functions of all layers.
      * @param decay_ Weight decay rate (determining that the "unused/unupdated" weights will decay to 0) (DEFAULT=0.0 - no decay).
      */
     void update(eT alpha_, eT decay_  = 0.0f) {
+        // Make sure that the patches correspond to the current input.
+        if (!x2col_valid)
+            im2col();
         opt["W"]->update(p["W"], x2col, s["y"], alpha_);
+        // Filters have changed - the normalized zero-sum rule reports which ones, so only their rows and columns of the Gram matrix will be refreshed.
+        std::shared_ptr<mic::neural_nets::learning::NormalizedZerosumHebbianRule<eT> > rule =
+                std::dynamic_pointer_cast<mic::neural_nets::learning::NormalizedZerosumHebbianRule<eT> >(opt["W"]);
+        filter_spectra_valid = false;
+        rectified_weights_valid = false;
+        if (rule)
+            modified_filters.insert(rule->updatedRows().begin(), rule->updatedRows().end());
+        else
+            gram_valid = false;
     }
 
+    /*!
+     * Copies the image patches (receptive fields) of all samples of the batch to the columns of x2col.
+     * Patch (ox, oy) of sample ib is stored in column ox + output_width * oy + output_width * output_height * ib.
+     */
+    void im2col() {
+        // Get input matrix.
+        mic::types::Matrix<eT> & x = (*s["x"]);
+        size_t samples = batch_size;
+        size_t patches = output_width * output_height;
+        size_t patch_length = filter_size * filter_size;
+
+        // Resize the matrix - does nothing if the batch size has not changed.
+        x2col->resize(patch_length, patches * samples);
+        const eT* xd = x.data();
+        eT* cd = x2col->data();
 
+        // IM2COL
+        // Iterate over the rows of patches of all samples.
+        #pragma omp parallel for
+        for(size_t n = 0 ; n < samples * output_height ; n++){
+            size_t ib = n / output_height;
+            size_t oy = n % output_height;
+            const eT* sample = xd + ib * x.rows();
+            for(size_t ox = 0 ; ox < output_width ; ox++){
+                eT* patch = cd + (ox + (output_width * oy) + (patches * ib)) * patch_length;
+                // Copy each row of the image patch into appropriate position in x2col
+                for(size_t patch_y = 0 ; patch_y < filter_size ; patch_y++){
+                    const eT* image_row = sample + (((oy * stride) + patch_y) * input_width) + (ox * stride);
+                    std::copy(image_row, image_row + filter_size, patch + patch_y * filter_size);
+                }
+            }
+        }//: for
+        x2col_valid = true;
+    }
 
     /*!
-     * Returns activations of weights.
+     * Estimates the cost of computing the output with im2col and matrix multiplication (in number of multiplications and additions of the FFT).
+     * Blocked and vectorized matrix multiplication performs roughly 6x more operations in the same time than the FFT.
+     */
+    eT gemmCost() {
+        return 2.0 * nfilters * output_height * output_width * filter_size * filter_size / 6.0;
+    }
+
+    /*!
+     * Estimates the cost of computing the output with FFT (in number of multiplications and additions).
+     */
+    eT fftCost() {
+        size_t rows = convolution::FFT<eT>::paddedSize(input_width);
+        size_t cols = convolution::FFT<eT>::paddedSize(input_height);
+        return (1 + nfilters) * convolution::FFT<eT>::transformCost(rows, cols) + 8.0 * nfilters * rows * cols;
+    }
+
+    /*!
+     * Calculates spectra of all filters - if they are not valid.
+     * Images and filters are stored in row-major order, thus they are transformed as transposed (column-major) planes.
+     */
+    void computeFilterSpectra() {
+        if (filter_spectra_valid)
+            return;
+        size_t rows = convolution::FFT<eT>::paddedSize(input_width);
+        size_t cols = convolution::FFT<eT>::paddedSize(input_height);
+        size_t P = rows * cols;
+        filter_spectra.resize(nfilters * P);
+
+        // Filter element (y,x) is stored in W(filter, y*filter_size + x).
+        eT* W = p["W"]->data();
+        #pragma omp parallel for
+        for (size_t i = 0 ; i < nfilters ; i++)
+            convolution::FFT<eT>::forwardPlane(W + i, filter_size, filter_size, nfilters, filter_size*nfilters, &filter_spectra[i*P], rows, cols);
+
+        filter_spectra_valid = true;
+    }
+
+    /*!
+     * Performs forward pass by multiplying the spectra of the inputs with the (conjugated) spectra of filters.
+     */
+    void forwardFFT() {
+        computeFilterSpectra();
+        size_t rows = convolution::FFT<eT>::paddedSize(input_width);
+        size_t cols = convolution::FFT<eT>::paddedSize(input_height);
+        size_t P = rows * cols;
+        mic::types::Matrix<eT> & x = (*s["x"]);
+        size_t samples = batch_size;
+        size_t patches = output_width * output_height;
+
+        // Output: each row is an output channel in row-major order, consecutive samples in consecutive blocks of columns.
+        mic::types::MatrixPtr<eT> y = s["y"];
+        y->resize(nfilters, patches * samples);
+        eT* yd = y->data();
+
+        // Spectra of the inputs and their products with spectra of all filters - samples are processed in parallel, each with its own buffers.
+        std::vector<typename convolution::FFT<eT>::cT> & X = input_spectra;
+        X.resize(samples * P);
+        output_spectra.resize(samples * P);
+        #pragma omp parallel for
+        for (size_t ib = 0 ; ib < samples ; ib++) {
+            convolution::FFT<eT>::forwardPlane(x.data() + ib * x.rows(), input_width, input_height, 1, input_width, &X[ib*P], rows, cols);
+            typename convolution::FFT<eT>::cT* acc = &output_spectra[ib*P];
+            for (size_t i = 0 ; i < nfilters ; i++) {
+                std::fill(acc, acc + P, typename convolution::FFT<eT>::cT(0));
+                convolution::FFT<eT>::multiplyAccumulate(&X[ib*P], &filter_spectra[i*P], acc, P, true);
+                convolution::FFT<eT>::transform2D(acc, rows, cols, true);
+                for(size_t oy = 0 ; oy < output_height ; oy++)
+                    for(size_t ox = 0 ; ox < output_width ; ox++)
+                        yd[i + (ox + output_width * oy + patches * ib) * nfilters] = acc[ox + oy * rows].real();
+            }//: for filters
+        }//: for batch
+    }
+
+
+
+    /*!
+     * Returns activations of neurons (feature maps) for the first sample of the batch.
      */
     std::vector< std::shared_ptr <mic::types::Matrix<eT> > > & getOutputActivations() {
 
@@ -140,8 +297,8 @@ public:
         for (size_t i = 0 ; i < nfilters ; i++) {
             // Get row.
             mic::types::MatrixPtr<eT> row = o_activations[i];
-            // Copy data.
-            (*row) = W->row(i);
+            // Copy data of the first sample.
+            (*row) = W->block(i, 0, 1, output_width * output_height);
             // Resize row.
             row->resize(output_width, output_height);
 
@@ -152,42 +309,50 @@ public:
     }
 
     /*!
-     * Returns reconstruction from feature maps and filters
+     * Returns reconstructions of all samples of the batch from feature maps and filters.
+     * Reconstruction is a transposed convolution of the rectified feature maps with the rectified filters:
+     * a single multiplication max(W,0)^T * max(y,0) followed by col2im.
+     * It is computed once per forward pass - following calls return the cached result.
      */
     std::vector< std::shared_ptr <mic::types::Matrix<eT> > > & getOutputReconstruction() {
+        mic::types::Matrix<eT> & y = (*s["y"]);
+        size_t patches = output_width * output_height;
+        size_t samples = y.cols() / patches;
 
         // Allocate memory.
-        lazyAllocateMatrixVector(o_reconstruction, 1, input_width, input_height);
-        o_reconstruction[0]->zeros();
-        conv2col->zeros();
-
-        mic::types::MatrixPtr<eT> o = s["y"];
-        mic::types::MatrixPtr<eT> w = p["W"];
-
-        //Reconstruct in im2col format
-        for(size_t i = 0 ; i < output_width * output_height ; i++){
-            for(size_t ker = 0 ; ker < nfilters ; ker++){
-                // ReLU on the filters and feature maps
-                mic::types::Matrix<eT> k;
-                k = (w->row(ker)).transpose();
-                k = k.array().max(0.);
-                conv2col->col(i) += ((*o)(ker, i) > 0 ? (*o)(ker, i) : 0) * k;
-                // No ReLU at all
-                //                conv2col->col(i) += ((*o)(ker, i) > 0 ? (*o)(ker, i) : 0)
-                //                        * w->row(ker);
-            }
-        }
-
-        for(size_t x = 0 ; x < output_width ; x ++){
-            for(size_t y = 0 ; y < output_height ; y ++){
-                for(size_t ker = 0 ; ker < nfilters ; ker++){
-                    mic::types::Matrix<eT> temp;
-                    temp = conv2col->col(y + (x * output_height));
-                    temp.resize(filter_size, filter_size);
-                    o_reconstruction[0]->block(y * stride, x * stride, filter_size, filter_size) += temp;
+        lazyAllocateMatrixVector(o_reconstruction, samples, input_width, input_height);
+        if (o_reconstruction_updated)
+            return o_reconstruction;
+
+        // Rectify the filters - only when they have changed.
+        if (!rectified_weights_valid) {
+            (*rectified_weights) = p["W"]->cwiseMax((eT)0);
+            rectified_weights_valid = true;
+        }//: if
+
+        // Reconstruct in im2col format.
+        conv2col->noalias() = rectified_weights->transpose() * y.cwiseMax((eT)0);
+
+        // COL2IM - each sample in a separate image, thus they can be processed in parallel.
+        const eT* cd = conv2col->data();
+        size_t patch_length = filter_size * filter_size;
+        #pragma omp parallel for
+        for(size_t ib = 0 ; ib < samples ; ib++){
+            // Image is stored in the same (row-major) order as the input.
+            eT* image = o_reconstruction[ib]->data();
+            std::fill(image, image + input_width * input_height, (eT)0);
+            for(size_t oy = 0 ; oy < output_height ; oy++){
+                for(size_t ox = 0 ; ox < output_width ; ox++){
+                    const eT* patch = cd + (ox + (output_width * oy) + (patches * ib)) * patch_length;
+                    // Add each row of the patch into appropriate position in the image.
+                    for(size_t patch_y = 0 ; patch_y < filter_size ; patch_y++){
+                        eT* image_row = image + (((oy * stride) + patch_y) * input_width) + (ox * stride);
+                        for(size_t patch_x = 0 ; patch_x < filter_size ; patch_x++)
+                            image_row[patch_x] += patch[patch_y * filter_size + patch_x];
+                    }
                 }
             }
-        }
+        }//: for samples
 
         // Return reconstruction
         o_reconstruction_updated = true;
@@ -196,20 +361,19 @@ public:
 
     /*!
      * \brief getOutputReconstructionError
-     * \return Squared reconstruction error
-     * \details If the reconstruction hasn't been updated, will call getOutputReconstruction(). To avoid computing the reconstruction twice, remember to call getOutputReconstruction() first if you need it.
+     * \return Squared reconstruction error, averaged over the samples of the batch
+     * \details Uses the reconstruction cached since the last forward pass (computing it if required).
      */
     eT getOutputReconstructionError() {
-        if(!o_reconstruction_updated) {
-            getOutputReconstruction();
-        }
-
-        Eigen::Map<Eigen::Matrix<eT, Eigen::Dynamic, 1> > r(o_reconstruction[0]->data(), o_reconstruction[0]->size());
-
-        mic::types::Matrix<eT> diff;
-        diff = r.normalized() - (*s["x"]).normalized();
-        eT error = diff.squaredNorm();
-        return error;
+        getOutputReconstruction();
+
+        mic::types::Matrix<eT> & x = (*s["x"]);
+        eT error = 0;
+        for(size_t ib = 0 ; ib < o_reconstruction.size() ; ib++) {
+            Eigen::Map<Eigen::Matrix<eT, Eigen::Dynamic, 1> > r(o_reconstruction[ib]->data(), o_reconstruction[ib]->size());
+            error += (r.normalized() - x.col(ib).normalized()).squaredNorm();
+        }//: for
+        return error / o_reconstruction.size();
     }
 
     /*!
@@ -236,6 +400,56 @@ public:
         return w_activations;
     }
 
+    /*!
+     * Sets the mode of refreshing the Gram matrix of filters (used in similarity computations).
+     * @param incremental_ If set, only the products of filters updated by the hebbian rule since the last refresh are recalculated.
+     */
+    void setIncrementalSimilarity(bool incremental_) {
+        incremental_similarity = incremental_;
+    }
+
+    /*!
+     * Refreshes the Gram matrix of filters (W * W^T) and the cached norms of filters - if filters have changed since the last refresh.
+     * In incremental mode only rows and columns of the filters updated by the hebbian rule are recalculated,
+     * whereas filters modified in any other way (see invalidateCaches()) require recalculation of the whole matrix.
+     */
+    void refreshWeightGram() {
+        if (gram_valid && modified_filters.empty())
+            return;
+        mic::types::Matrix<eT> & W = (*p["W"]);
+
+        if (!gram_valid || !incremental_similarity) {
+            // Single multiplication for all pairs of filters.
+            gram.noalias() = W * W.transpose();
+        } else {
+            std::vector<size_t> changed(modified_filters.begin(), modified_filters.end());
+            mic::types::Matrix<eT> Wc(changed.size(), W.cols());
+            for (size_t c = 0 ; c < changed.size() ; c++)
+                Wc.row(c) = W.row(changed[c]);
+            // Products of the changed filters with all filters.
+            mic::types::Matrix<eT> Gc;
+            Gc.noalias() = Wc * W.transpose();
+            for (size_t c = 0 ; c < changed.size() ; c++) {
+                gram.row(changed[c]) = Gc.row(c);
+                gram.col(changed[c]) = Gc.row(c).transpose();
+            }//: for
+        }//: else
+
+        modified_filters.clear();
+        filter_norms = gram.diagonal().cwiseSqrt();
+        gram_valid = true;
+    }
+
+    /*!
+     * Returns cosine similarity of two filters, basing on the (refreshed) Gram matrix.
+     * @param i Index of the first filter.
+     * @param j Index of the second filter.
+     */
+    eT weightSimilarity(size_t i, size_t j) {
+        eT norms = filter_norms(i) * filter_norms(j);
+        return (norms != 0) ? gram(i, j) / norms : 0;
+    }
+
     /*!
      * \brief Returns cosine similarity matrix of filters.
      * \details Give only positive similarities above the diagonal, and negative ones below, else 0.
@@ -246,15 +460,16 @@ public:
         // Allocate memory.
         lazyAllocateMatrixVector(w_similarity, 1, nfilters * nfilters, 1);
 
-        mic::types::MatrixPtr<eT> W = p["W"];
+        refreshWeightGram();
         mic::types::MatrixPtr<eT> row = w_similarity[0];
+        row->resize(nfilters * nfilters, 1);
+        row->setZero();
 
         // Iterate through "neurons" and generate "activation image" for each one.
         for (size_t i = 0 ; i < nfilters ; i++) {
             for(size_t j = 0 ; j < i ; j++) {
-                // Compute cosine similarity between filter i and j
-                eT sim = W->row(j).dot(W->row(i));
-                sim /= W->row(i).norm() * W->row(j).norm();
+                // Cosine similarity between filter i and j
+                eT sim = weightSimilarity(i, j);
                 if(sim > 0.)    // positive similarity above diagonal
                     (*row)(j + (nfilters * i)) = sim;
                 else            // negative similarity below diagonal
@@ -283,17 +498,16 @@ public:
         // Allocate memory.
         lazyAllocateMatrixVector(w_dissimilarity, 1, nfilters * nfilters, 1);
 
-        mic::types::MatrixPtr<eT> W = p["W"];
+        refreshWeightGram();
         mic::types::MatrixPtr<eT> row = w_dissimilarity[0];
+        row->resize(nfilters * nfilters, 1);
 
         // Iterate through "neurons" and generate "activation image" for each one.
         for (size_t i = 0 ; i < nfilters ; i++) {
             for(size_t j = 0 ; j < nfilters ; j++){
-                // Compute cosine similarity between filter i and j
-                (*row)(j + (nfilters * i)) = std::abs(W->row(j).dot(W->row(i)));
-                (*row)(j + (nfilters * i)) /= W->row(i).norm() * W->row(j).norm();
-                // Convert to sine
-                (*row)(j + (nfilters * i)) = std::sqrt(1 - std::pow((*row)(j + (nfilters * i)), 2));
+                // Convert cosine similarity between filter i and j to sine
+                eT sim = weightSimilarity(i, j);
+                (*row)(j + (nfilters * i)) = std::sqrt(std::max((eT)0, 1 - sim * sim));
             }
         }
 
@@ -340,6 +554,45 @@ protected:
     mic::types::MatrixPtr<eT> x2col;
     mic::types::MatrixPtr<eT> conv2col;
 
+    /// Filters with negative weights set to zero - used in reconstruction.
+    mic::types::MatrixPtr<eT> rectified_weights;
+
+    /// Flag denoting whether the rectified filters are up to date.
+    bool rectified_weights_valid = false;
+
+    /// Gram matrix of filters (W * W^T) - used in similarity computations.
+    mic::types::Matrix<eT> gram;
+
+    /// Filters updated by the hebbian rule since the last refresh of the Gram matrix.
+    std::set<size_t> modified_filters;
+
+    /// Norms of filters (square root of the diagonal of the Gram matrix).
+    mic::types::Matrix<eT> filter_norms;
+
+    /// Flag denoting whether the Gram matrix is up to date (apart from the rows and columns of the modified filters).
+    bool gram_valid = false;
+
+    /// Flag denoting whether the Gram matrix is refreshed incrementally.
+    bool incremental_similarity = false;
+
+    /// Flag denoting whether x2col contains patches of the current input.
+    bool x2col_valid = false;
+
+    /// Algorithm used for computing the convolution.
+    convolution::ConvolutionAlgorithm algorithm = convolution::ConvolutionAlgorithm::Auto;
+
+    /// Flag denoting whether the filter spectra (used by FFT) are up to date.
+    bool filter_spectra_valid = false;
+
+    /// Filter spectra - one for each filter.
+    std::vector<typename convolution::FFT<eT>::cT> filter_spectra;
+
+    /// Spectra of the inputs of the batch (used by FFT).
+    std::vector<typename convolution::FFT<eT>::cT> input_spectra;
+
+    /// Products of the spectra of the inputs and filters - one accumulator for each sample of the batch (used by FFT).
+    std::vector<typename convolution::FFT<eT>::cT> output_spectra;
+
 private:
     // Friend class - required for using boost serialization.
     template<typename tmp> friend class mic::mlnn::MultiLayerNeuralNetwork;
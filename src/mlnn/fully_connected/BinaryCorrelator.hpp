@@ -28,12 +28,21 @@
 
 #include <mlnn/layer/Layer.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <typeinfo>
+#include <vector>
+
 namespace mic {
 namespace mlnn {
 namespace fully_connected {
 
 /*!
  * \brief Class implementing a linear, fully connected layer.
+ * The binary connectivity (permanences above threshold) and the binarized inputs are stored as bitsets packed into 64-bit words,
+ * so overlaps are computed with AND and popcount, 64 synapses at once.
+ * Note: inputs are binarized (values above the input threshold, 0.5 by default, are active), i.e. the overlap is the number of connected active inputs.
+ * Unlike the former product of connectivity and raw inputs, non-binary inputs (e.g. grayscale images) thus contribute 0 or 1 - see setInputThreshold().
  * \author tkornuta
   * \tparam eT Template parameter denoting precision of variables (float for calculations/double for testing).
  */
@@ -71,24 +80,19 @@ public:
 				output_height_, output_width_, output_depth_,
 				LayerTypes::BinaryCorrelator, name_),
 				permanence_threshold(permanence_threshold_),
-				proximal_threshold(proximal_threshold_)
+				proximal_threshold(proximal_threshold_),
+				input_threshold(0.5),
+				connectivity_valid(false)
 	{
 		// Create the permanence matrix.
 		p.add ("p", Layer<eT>::outputSize(), Layer<eT>::inputSize());
-		// Create "connectivity" matrix.
-		m.add ("c", Layer<eT>::outputSize(), Layer<eT>::inputSize());
 
 		// Initialize permanence matrix.
 		//double range = sqrt(6.0 / double(inputs_ + outputs_));
 		p['p']->rand(0, 1);
 
 		// Initialize connectivity.
-		mic::types::MatrixPtr<eT> c = m['c'];
-		mic::types::MatrixPtr<eT> perm = p['p'];
-		// Threshold.
-		for (size_t i = 0; i < (size_t)c->size(); i++) {
-			(*c)[i] = ((*perm)[i] > permanence_threshold) ? 1.0f : 0.0f;
-		}//: for
+		updateConnectivity();
 
 		// Set hebbian learning as default optimization function.
 		Layer<eT>::template setOptimization<mic::neural_nets::learning::HebbianRule<eT> > ();
@@ -105,17 +109,36 @@ public:
 	 * @param test_ It ise set to true in test mode (network verification).
 	 */
 	void forward(bool test_ = false) {
-		// Get input matrices.
-		mic::types::Matrix<eT> x = (*s['x']);
-		mic::types::Matrix<eT> c = (*m['c']);
+		// Get input matrix.
+		mic::types::MatrixPtr<eT> x = s['x'];
 		// Get output pointer - so the results will be stored!
 		mic::types::MatrixPtr<eT> y = s['y'];
 
-		// Forward pass.
-		(*y) = c * x;
-		for (size_t i = 0; i < (size_t)y->size(); i++) {
-			// Threshold.
-			(*y)[i] = ((*y)[i] > proximal_threshold) ? 1.0f : 0.0f;
+		// Permanences might have been changed from the outside (e.g. by deserialization).
+		if (!connectivity_valid)
+			updateConnectivity();
+
+		size_t inputs = inputSize();
+		size_t outputs = outputSize();
+		size_t batch = batch_size;
+
+		// Binarize and pack inputs - sample by sample.
+		packed_x.resize(batch * words);
+		#pragma omp parallel for
+		for (size_t b = 0; b < batch; b++)
+			packRow(x->data() + b*inputs, 1, inputs, input_threshold, packed_x.data() + b*words);
+
+		// Overlaps of connectivity and inputs, thresholded.
+		#pragma omp parallel for
+		for (size_t n = 0; n < batch * outputs; n++) {
+			size_t b = n / outputs;
+			size_t i = n % outputs;
+			const uint64_t* c = connectivity.data() + i*words;
+			const uint64_t* xb = packed_x.data() + b*words;
+			size_t overlap = 0;
+			for (size_t w = 0; w < words; w++)
+				overlap += __builtin_popcountll(c[w] & xb[w]);
+			(*y)(i, b) = (overlap > proximal_threshold) ? 1.0f : 0.0f;
 		}//: for
 	}
 
@@ -134,18 +157,97 @@ public:
 	void update(eT alpha_, eT decay_ = 0.0f) {
 		//std::cout<<"p before update: " << (*p['p']) << std::endl;
 		// Update permanence using the learning rule.
-		opt["p"]->update(p['p'], s['x'], s['y'], alpha_);
+		opt["p"]->update(p['p'], Layer<eT>::exactBatch(s['x']), Layer<eT>::exactBatch(s['y']), alpha_);
 		//std::cout<<"p after update: " << (*p['p']) << std::endl;
 
-		// Update connectivity matrix.
-		mic::types::MatrixPtr<eT> c = m['c'];
+		// Update connectivity - the hebbian and binary correlator rules change only synapses of active neurons or (nonzero) inputs,
+		// other rules (e.g. the normalized ones) might change all permanences.
+		bool incremental = (typeid(*opt["p"]) == typeid(mic::neural_nets::learning::HebbianRule<eT>)) ||
+				(typeid(*opt["p"]) == typeid(mic::neural_nets::learning::BinaryCorrelatorLearningRule<eT>));
+		if (!connectivity_valid || !incremental) {
+			updateConnectivity();
+			return;
+		}//: if
+		mic::types::MatrixPtr<eT> x = s['x'];
+		mic::types::MatrixPtr<eT> y = s['y'];
 		mic::types::MatrixPtr<eT> perm = p['p'];
-		//std::cout<<"C before threshold: " << (*c) << std::endl;
-		// Threshold.
-		for (size_t i = 0; i < (size_t)c->size(); i++) {
-			(*c)[i] = ((*perm)[i] > permanence_threshold) ? 1.0f : 0.0f;
+		size_t inputs = inputSize();
+		size_t outputs = outputSize();
+		size_t batch = batch_size;
+
+		// Inputs active (i.e. nonzero - as in the learning rules, not binarized) in any sample of the batch.
+		std::vector<uint64_t> active_inputs(words, 0);
+		for (size_t b = 0; b < batch; b++)
+			for (size_t j = 0; j < inputs; j++)
+				if ((*x)(j, b) != 0)
+					active_inputs[j / 64] |= (uint64_t)1 << (j % 64);
+
+		#pragma omp parallel for
+		for (size_t i = 0; i < outputs; i++) {
+			uint64_t* c = connectivity.data() + i*words;
+			// Active neuron - the whole row might change.
+			if (y->row(i).head(batch).maxCoeff() > 0) {
+				packRow(perm->data() + i, outputs, inputSize(), permanence_threshold, c);
+				continue;
+			}//: if
+			// Otherwise check only the synapses of active inputs.
+			for (size_t w = 0; w < words; w++) {
+				for (uint64_t bits = active_inputs[w]; bits != 0; bits &= bits - 1) {
+					size_t j = w*64 + __builtin_ctzll(bits);
+					uint64_t mask = (uint64_t)1 << (j % 64);
+					if ((*perm)(i, j) > permanence_threshold)
+						c[w] |= mask;
+					else
+						c[w] &= ~mask;
+				}//: for bits
+			}//: for words
 		}//: for
-		//std::cout<<"C after threshold: " << (*c) << std::endl;
+	}
+
+	/*!
+	 * Sets the threshold used for binarization of inputs - values above it are active.
+	 * @param input_threshold_ Input threshold.
+	 */
+	void setInputThreshold(eT input_threshold_) {
+		input_threshold = input_threshold_;
+	}
+
+	/*!
+	 * Returns the threshold used for binarization of inputs.
+	 */
+	eT getInputThreshold() {
+		return input_threshold;
+	}
+
+	/*!
+	 * Recalculates the whole binary connectivity from the permanences.
+	 */
+	void updateConnectivity() {
+		size_t outputs = outputSize();
+		words = (inputSize() + 63) / 64;
+		connectivity.resize(outputs * words);
+		mic::types::MatrixPtr<eT> perm = p['p'];
+
+		#pragma omp parallel for
+		for (size_t i = 0; i < outputs; i++)
+			packRow(perm->data() + i, outputs, inputSize(), permanence_threshold, connectivity.data() + i*words);
+		connectivity_valid = true;
+	}
+
+	/*!
+	 * Forces recalculation of the connectivity - after permanences were changed from the outside.
+	 */
+	virtual void invalidateCaches() {
+		connectivity_valid = false;
+	}
+
+	/*!
+	 * Returns the binary connectivity of the given synapse.
+	 * @param i_ Index of neuron (output).
+	 * @param j_ Index of input.
+	 */
+	bool connected(size_t i_, size_t j_) {
+		return (connectivity[i_*words + j_/64] >> (j_ % 64)) & 1;
 	}
 
 	/*!
@@ -212,10 +314,43 @@ private:
 	// Proximal threshold - used for activation of a given dendrite segment.
 	eT proximal_threshold;
 
+	/// Input threshold - used for binarization of inputs.
+	eT input_threshold;
+
+	/// Number of 64-bit words required for storing a packed row of connectivity (or a packed sample).
+	size_t words;
+
+	/// Binary connectivity (permanences above threshold) - one packed row of bits per neuron.
+	std::vector<uint64_t> connectivity;
+
+	/// Binarized inputs of the last forward pass - one packed row of bits per sample.
+	std::vector<uint64_t> packed_x;
+
+	/// Flag denoting whether the connectivity is consistent with the permanences.
+	bool connectivity_valid;
+
+	/*!
+	 * Packs a row of values into bits - bit is set when the value exceeds the threshold.
+	 * @param values_ Pointer to the first value.
+	 * @param stride_ Distance between consecutive values.
+	 * @param length_ Number of values.
+	 * @param threshold_ Threshold.
+	 * @param bits_ Resulting words.
+	 */
+	static void packRow(const eT* values_, size_t stride_, size_t length_, eT threshold_, uint64_t* bits_) {
+		for (size_t w = 0; w*64 < length_; w++) {
+			uint64_t word = 0;
+			size_t end = std::min(length_, w*64 + 64);
+			for (size_t j = w*64; j < end; j++)
+				word |= (uint64_t)(values_[j*stride_] > threshold_) << (j % 64);
+			bits_[w] = word;
+		}//: for
+	}
+
 	/*!
 	 * Private constructor, used only during the serialization.
 	 */
-	BinaryCorrelator<eT>() : Layer<eT> () { }
+	BinaryCorrelator<eT>() : Layer<eT> (), input_threshold(0.5), words(0), connectivity_valid(false) { }
 
 };
 
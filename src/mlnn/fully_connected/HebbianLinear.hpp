@@ -28,6 +28,8 @@
 
 #include <mlnn/layer/Layer.hpp>
 
+#include <typeinfo>
+
 namespace mic {
 namespace mlnn {
 namespace fully_connected {
@@ -45,9 +47,11 @@ public:
 	 * Creates a Hebbian (fully connected) layer - reduced number of parameters.
 	 * @param inputs_ Length of the input vector.
 	 * @param outputs_ Length of the output vector.
+	 * @param permanence_threshold_ Permanence threshold (unused).
+	 * @param proximal_threshold_ Threshold of activation of neurons (DEFAULT=0.8).
 	 * @param name_ Name of the layer.
 	 */
-	HebbianLinear(size_t inputs_, size_t outputs_, eT permanence_threshold_ = 0.5, eT proximal_threshold_ = 0.5, std::string name_ = "HebbianLinear") :
+	HebbianLinear(size_t inputs_, size_t outputs_, eT permanence_threshold_ = 0.5, eT proximal_threshold_ = 0.8, std::string name_ = "HebbianLinear") :
 		HebbianLinear(inputs_, 1, 1, outputs_, 1, 1, permanence_threshold_, proximal_threshold_, name_)
 	{
 
@@ -61,15 +65,18 @@ public:
 	 * @param output_height_ Width of the output sample.
 	 * @param output_width_ Height of the output sample.
 	 * @param output_depth_ Depth of the output sample.
+	 * @param permanence_threshold_ Permanence threshold (unused).
+	 * @param proximal_threshold_ Threshold of activation of neurons (DEFAULT=0.8).
 	 * @param name_ Name of the layer.
 	 */
 	HebbianLinear(size_t input_height_, size_t input_width_, size_t input_depth_,
 			size_t output_height_, size_t output_width_, size_t output_depth_,
-			eT permanence_threshold_ = 0.5, eT proximal_threshold_ = 0.5,
+			eT permanence_threshold_ = 0.5, eT proximal_threshold_ = 0.8,
 			std::string name_ = "HebbianLinear") :
 		Layer<eT>::Layer(input_height_, input_width_, input_depth_,
 				output_height_, output_width_, output_depth_,
-				LayerTypes::HebbianLinear, name_)
+				LayerTypes::HebbianLinear, name_),
+				proximal_threshold(proximal_threshold_)
 	{
 		// Create the weights matrix.
 		p.add ("W", Layer<eT>::outputSize(), Layer<eT>::inputSize());
@@ -78,6 +85,10 @@ public:
 		double range = sqrt(6.0 / double(Layer<eT>::outputSize() + Layer<eT>::inputSize()));
 		Layer<eT>::p['W']->rand(-range, range);
 
+		// Inputs and outputs of samples with active neurons - used in the update.
+		m.add ("xa", Layer<eT>::inputSize(), 1);
+		m.add ("ya", Layer<eT>::outputSize(), 1);
+
 		// Set hebbian learning as default optimization function.
 		Layer<eT>::template setOptimization<mic::neural_nets::learning::HebbianRule<eT> > ();
 	};
@@ -93,20 +104,17 @@ public:
 	 * @param test_ It ise set to true in test mode (network verification).
 	 */
 	void forward(bool test_ = false) {
-		// Get input matrices.
-		mic::types::Matrix<eT> x = (*s['x']);
-		mic::types::Matrix<eT> W = (*p['W']);
 		// Get output pointer - so the results will be stored!
 		mic::types::MatrixPtr<eT> y = s['y'];
 
-		// Forward pass.
-		(*y) = W * x;
-		for (size_t i = 0; i < (size_t)s['x']->rows() * s['x']->cols(); i++) {
-			// Sigmoid.
-			//(*y)[i] = 1.0f / (1.0f +::exp(-(*y)[i]));
-			// Threshold.
-			(*y)[i] = ((*y)[i] > 0.8) ? 1.0f : 0.0f;
-		}//: for
+		// Forward pass - directly into y.
+		y->leftCols(batch_size).noalias() = (*p['W']) * s['x']->leftCols(batch_size);
+		// Threshold - in place.
+		eT* data = y->data();
+		size_t size = y->rows() * batch_size;
+		#pragma omp parallel for
+		for (size_t i = 0; i < size; i++)
+			data[i] = (data[i] > proximal_threshold) ? 1.0f : 0.0f;
 	}
 
 	/*!
@@ -122,7 +130,54 @@ public:
 	 * @param decay_ Weight decay rate (determining that the "unused/unupdated" weights will decay to 0) (DEFAULT=0.0 - no decay).
 	 */
 	void update(eT alpha_, eT decay_  = 0.0f) {
-		opt["W"]->update(p['W'], s['x'], s['y'], alpha_);
+		// The classical rule is applied directly.
+		if (typeid(*opt["W"]) == typeid(mic::neural_nets::learning::HebbianRule<eT>))
+			hebbianUpdate(alpha_);
+		else
+			opt["W"]->update(p['W'], Layer<eT>::exactBatch(s['x']), Layer<eT>::exactBatch(s['y']), alpha_);
+	}
+
+	/*!
+	 * Applies the classical Hebbian rule W += alpha * y * x^T directly to W, as a single matrix product restricted to the samples with active neurons.
+	 * Rows of W are updated in parallel blocks, skipping blocks of neurons that were not active at all.
+	 * @param alpha_ Learning rate.
+	 */
+	void hebbianUpdate(eT alpha_) {
+		mic::types::MatrixPtr<eT> W = p['W'];
+		mic::types::MatrixPtr<eT> x = s['x'];
+		mic::types::MatrixPtr<eT> y = s['y'];
+
+		// Find samples with active neurons.
+		std::vector<size_t> active;
+		for (size_t b = 0; b < batch_size; b++)
+			if (!y->col(b).isZero())
+				active.push_back(b);
+		if (active.empty())
+			return;
+
+		// Gather them (if required) into the leading columns of buffers enlarged to the batch size - the product uses only the leading columns.
+		size_t samples = active.size();
+		if (samples < batch_size) {
+			x = m["xa"];
+			y = m["ya"];
+			Layer<eT>::reserveColumns(x, batch_size);
+			Layer<eT>::reserveColumns(y, batch_size);
+			for (size_t i = 0; i < samples; i++) {
+				x->col(i) = s['x']->col(active[i]);
+				y->col(i) = s['y']->col(active[i]);
+			}//: for
+		}//: if
+
+		// Rank-B update, parallel over blocks of rows.
+		size_t block = 64;
+		size_t blocks = (outputSize() + block - 1) / block;
+		#pragma omp parallel for
+		for (size_t bl = 0; bl < blocks; bl++) {
+			size_t rows = std::min(block, outputSize() - bl*block);
+			if (y->block(bl*block, 0, rows, samples).isZero())
+				continue;
+			W->middleRows(bl*block, rows).noalias() += alpha_ * y->block(bl*block, 0, rows, samples) * x->leftCols(samples).transpose();
+		}//: for
 	}
 
 	/*!
@@ -183,10 +238,13 @@ private:
 	/// Vector containing activations of neurons.
 	std::vector< std::shared_ptr <mic::types::Matrix<eT> > > neuron_activations;
 
+	/// Threshold of activation of neurons.
+	eT proximal_threshold;
+
 	/*!
 	 * Private constructor, used only during the serialization.
 	 */
-	HebbianLinear<eT>() : Layer<eT> () { }
+	HebbianLinear<eT>() : Layer<eT> (), proximal_threshold(0.8) { }
 
 };
 
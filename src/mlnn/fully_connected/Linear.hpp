@@ -111,7 +111,7 @@ public:
 		mic::types::MatrixPtr<eT> y = s['y'];
 
 		// Forward pass.
-		(*y) = (*W) * (*x) + (*b).replicate(1, (*x).cols());
+		y->leftCols(batch_size) = (*W) * x->leftCols(batch_size) + (*b).replicate(1, batch_size);
 
 /*		std::cout << "Linear forward: s['x'] = \n" << (*s['x']) << std::endl;
 		std::cout << "Linear forward: p['W'] = \n" << (*p['W']) << std::endl;
@@ -134,9 +134,9 @@ public:
 		mic::types::MatrixPtr<eT> dx = g['x'];
 
 		// Backward pass.
-		(*dW) = (*dy) * (*x).transpose();
-		(*db) = (*dy).rowwise().sum(); // Sum for all samples in batch, similarly as it is done for dW.
-		(*dx) = (*W).transpose() * (*dy);
+		(*dW) = dy->leftCols(batch_size) * x->leftCols(batch_size).transpose();
+		(*db) = dy->leftCols(batch_size).rowwise().sum(); // Sum for all samples in batch, similarly as it is done for dW.
+		dx->leftCols(batch_size) = (*W).transpose() * dy->leftCols(batch_size);
 
 /*		std::cout << "Linear backward: g['y'] = \n" << (*g['y']) << std::endl;
 		std::cout << "Linear backward: g['x'] = \n" << (*g['x']) << std::endl;*/
@@ -331,6 +331,297 @@ TEST_F(Linear50x100Double, NumericalGradientCheck_dx) {
 }
 
 
+/*!
+ * \brief Tests whether the magnitude pruning keeps the requested number of the biggest weights.
+ */
+TEST(PrunedLinear20x10Double, MagnitudePruning) {
+	mic::mlnn::fully_connected::Linear<double> linear(20, 10);
+	linear.p["b"]->rand(-1, 1);
+	mic::mlnn::fully_connected::PrunedLinear<double> layer(linear, 0.3);
+
+	ASSERT_EQ(layer.nonzeros(), (size_t)60);
+	ASSERT_EQ(layer.p["W"]->size(), 60);
+	ASSERT_EQ(layer.g["W"]->size(), 60);
+
+	mic::types::Matrix<double> W = layer.denseWeights();
+	mic::types::Matrix<double> & Wl = (*linear.p["W"]);
+	// The smallest kept magnitude.
+	double smallest = layer.p["W"]->cwiseAbs().minCoeff();
+	for (size_t i=0; i<(size_t)W.size(); i++) {
+		if (W(i) != 0.0)
+			ASSERT_EQ(W(i), Wl(i));
+		else
+			ASSERT_LE(fabs(Wl(i)), smallest);
+	}//: for
+	for (size_t i=0; i<10; i++)
+		ASSERT_EQ((*layer.p["b"])[i], (*linear.p["b"])[i]);
+}
+
+/*!
+ * \brief Compares the forward and backward passes with a linear layer having the pruned weights set to zero.
+ */
+TEST(PrunedLinear20x10Double, EquivalenceWithMaskedLinear) {
+	mic::mlnn::fully_connected::Linear<double> linear(20, 10);
+	linear.p["b"]->rand(-1, 1);
+	mic::mlnn::fully_connected::PrunedLinear<double> layer(linear, 0.25);
+	(*linear.p["W"]) = layer.denseWeights();
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 20, 4);
+	mic::types::MatrixPtr<double> dy = MAKE_MATRIX_PTR(double, 10, 4);
+	x->rand(-1, 1);
+	dy->rand(-1, 1);
+
+	mic::types::MatrixPtr<double> y = MAKE_MATRIX_PTR(double, *linear.forward(x));
+	mic::types::MatrixPtr<double> dx = MAKE_MATRIX_PTR(double, *linear.backward(dy));
+	mic::types::MatrixPtr<double> py = layer.forward(x);
+	mic::types::MatrixPtr<double> pdx = layer.backward(dy);
+
+	double eps = 1e-12;
+	for (size_t i=0; i<(size_t)y->size(); i++)
+		EXPECT_LE( fabs((*y)[i] - (*py)[i]), eps) << "Too big difference between y and pruned y at position i=" << i;
+	for (size_t i=0; i<(size_t)dx->size(); i++)
+		EXPECT_LE( fabs((*dx)[i] - (*pdx)[i]), eps) << "Too big difference between dx and pruned dx at position i=" << i;
+	for (size_t i=0; i<10; i++)
+		EXPECT_LE( fabs((*linear.g["b"])[i] - (*layer.g["b"])[i]), eps) << "Too big difference between db and pruned db at position i=" << i;
+	// Gradients of nonzeros only.
+	for (size_t r=0; r<10; r++)
+		for (int32_t k=layer.row_offsets[r]; k<layer.row_offsets[r+1]; k++)
+			EXPECT_LE( fabs((*linear.g["W"])(r, layer.column_indices[k]) - (*layer.g["W"])[k]), eps) << "Too big difference between dW and pruned dW at position k=" << k;
+}
+
+/*!
+ * \brief Numerical gradient test of dW (nonzeros) and dx of the pruned layer.
+ */
+TEST(PrunedLinear20x10Double, NumericalGradientCheck) {
+	mic::mlnn::fully_connected::PrunedLinear<double> layer(20, 10, 0.2);
+	mic::neural_nets::loss::SquaredErrorLoss<double> loss;
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 20, 3);
+	mic::types::MatrixPtr<double> target_y = MAKE_MATRIX_PTR(double, 10, 3);
+	x->rand(-1, 1);
+	target_y->rand(-1, 1);
+
+	// Calculate gradients.
+	mic::types::MatrixPtr<double> predicted_y = layer.forward(x);
+	mic::types::MatrixPtr<double> dy = loss.calculateGradient(target_y, predicted_y);
+	mic::types::MatrixPtr<double> dx = MAKE_MATRIX_PTR(double, *layer.backward(dy));
+	mic::types::MatrixPtr<double> dW = MAKE_MATRIX_PTR(double, *layer.g["W"]);
+
+	// Calculate numerical gradients.
+	double delta = 1e-5;
+	mic::types::MatrixPtr<double> nW = layer.calculateNumericalGradient<mic::neural_nets::loss::SquaredErrorLoss<double> >(x, target_y, layer.p["W"], loss, delta);
+	mic::types::MatrixPtr<double> nx = layer.calculateNumericalGradient<mic::neural_nets::loss::SquaredErrorLoss<double> >(x, target_y, x, loss, delta);
+
+	// Compare gradients.
+	double eps = 1e-8;
+	for (size_t i=0; i<(size_t)dW->size(); i++)
+		EXPECT_LE( fabs((*dW)[i] - (*nW)[i]), eps) << "Too big difference between dW and numerical dW at position i=" << i;
+	for (size_t i=0; i<(size_t)dx->size(); i++)
+		EXPECT_LE( fabs((*dx)[i] - (*nx)[i]), eps) << "Too big difference between dx and numerical dx at position i=" << i;
+}
+
+/*!
+ * \brief Tests whether the sparsity penalty is incorporated in the gradients (and thus in the update) of the sparse linear layer.
+ */
+TEST(SparseLinear5x3Double, PenaltyInGradients) {
+	mic::mlnn::fully_connected::SparseLinear<double> layer(5, 3);
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 5, 2);
+	mic::types::MatrixPtr<double> dy = MAKE_MATRIX_PTR(double, 3, 2);
+	x->rand(0, 1);
+	dy->setZero();
+
+	layer.forward(x);
+	layer.backward(dy);
+
+	// With zero dy only the penalty (of both samples) remains.
+	mic::types::MatrixPtr<double> penalty = layer.m["penalty"];
+	ASSERT_GT(penalty->cwiseAbs().maxCoeff(), 0.0);
+	for (size_t i=0; i<3; i++)
+		EXPECT_LE( fabs((*layer.g["b"])[i] - 2 * (*penalty)[i]), 1e-12);
+	mic::types::Matrix<double> dx = (*layer.p["W"]).transpose() * (*penalty).replicate(1, 2);
+	for (size_t i=0; i<(size_t)dx.size(); i++)
+		EXPECT_LE( fabs((*layer.g["x"])[i] - dx(i)), 1e-12);
+
+	// Update must move the biases against the penalty.
+	mic::types::Matrix<double> b = (*layer.p["b"]);
+	layer.update(0.1);
+	for (size_t i=0; i<3; i++)
+		EXPECT_LE( fabs((*layer.p["b"])[i] - (b(i) - 0.1 * 2 * (*penalty)[i])), 1e-12);
+}
+
+/*!
+ * \brief Numerical check of the gradients of the sparse linear layer - of the summed squared error loss plus batch_size * beta * KL(desired_ro || ro) of all neurons.
+ */
+TEST(SparseLinear5x3Double, NumericalGradientCheck) {
+	mic::mlnn::fully_connected::SparseLinear<double> layer(5, 3);
+	size_t batch_size = 4;
+	layer.resizeBatch(batch_size);
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 5, batch_size);
+	mic::types::MatrixPtr<double> target_y = MAKE_MATRIX_PTR(double, 3, batch_size);
+	x->rand(0, 1);
+	target_y->rand(0, 1);
+	// Keep the activations in (0,1), so the mean activations are valid probabilities.
+	layer.p["W"]->rand(0, 0.2);
+	layer.p["b"]->setConstant(0.05);
+	mic::neural_nets::loss::SquaredErrorLoss<double> loss;
+
+	// Objective - computed for the current parameters and inputs.
+	auto objective = [&]() {
+		layer.forward(x);
+		mic::types::MatrixPtr<double> y = layer.s["y"];
+		double value = loss.calculateLoss(target_y, y);
+		for (size_t i=0; i<3; i++) {
+			double ro = y->row(i).mean();
+			value += batch_size * layer.beta * (layer.desired_ro * log(layer.desired_ro / ro) + (1 - layer.desired_ro) * log((1 - layer.desired_ro) / (1 - ro)));
+		}//: for
+		return value;
+	};
+
+	// Analytical gradients.
+	layer.forward(x);
+	layer.backward(loss.calculateGradient(target_y, layer.s["y"]));
+	mic::types::Matrix<double> dW = (*layer.g["W"]);
+	mic::types::Matrix<double> db = (*layer.g["b"]);
+	mic::types::Matrix<double> dx = (*layer.g["x"]);
+
+	// Central differences.
+	double delta = 1e-5;
+	double eps = 1e-7;
+	mic::types::MatrixPtr<double> params[3] = { layer.p["W"], layer.p["b"], x };
+	mic::types::Matrix<double>* grads[3] = { &dW, &db, &dx };
+	for (size_t k=0; k<3; k++) {
+		for (size_t i=0; i<(size_t)params[k]->size(); i++) {
+			double original = (*params[k])[i];
+			(*params[k])[i] = original + delta;
+			double plus = objective();
+			(*params[k])[i] = original - delta;
+			double minus = objective();
+			(*params[k])[i] = original;
+			EXPECT_LE( fabs((*grads[k])(i) - (plus - minus) / (2 * delta)), eps) << "Too big difference between the gradient " << k << " and the numerical one at position i=" << i;
+		}//: for
+	}//: for
+}
+
+
+/*!
+ * \brief Compares the packed forward pass and the incremental connectivity updates of the binary correlator with the thresholded float computations.
+ */
+TEST(BinaryCorrelator130x20Float, PackedForwardAndUpdate) {
+	mic::mlnn::fully_connected::BinaryCorrelator<float> layer(130, 20, 0.5, 6);
+	mic::types::MatrixPtr<float> x = MAKE_MATRIX_PTR(float, 130, 5);
+
+	for (size_t it=0; it<6; it++) {
+		// The second rule changes also permanences of inactive neurons.
+		if (it == 3)
+			layer.setOptimization<mic::neural_nets::learning::BinaryCorrelatorLearningRule<float> >();
+		// Random binary inputs.
+		x->rand(0, 1);
+		for (size_t i=0; i<(size_t)x->size(); i++)
+			(*x)[i] = ((*x)[i] > 0.7) ? 1.0 : 0.0;
+
+		// Reference: float connectivity and product.
+		mic::types::Matrix<float> c = (*layer.p["p"]);
+		for (size_t i=0; i<(size_t)c.size(); i++)
+			c(i) = (c(i) > 0.5) ? 1.0 : 0.0;
+		mic::types::Matrix<float> y = c * (*x);
+
+		mic::types::MatrixPtr<float> py = layer.forward(x);
+		for (size_t i=0; i<(size_t)y.size(); i++)
+			ASSERT_EQ((*py)[i], (y(i) > 6) ? 1.0 : 0.0) << "Wrong output at position i=" << i;
+
+		// Update with big learning rate, so many permanences cross the threshold.
+		layer.update(0.2);
+		for (size_t i=0; i<20; i++)
+			for (size_t j=0; j<130; j++)
+				ASSERT_EQ(layer.connected(i, j), (*layer.p["p"])(i, j) > 0.5) << "Wrong connectivity of synapse (" << i << "," << j << ")";
+	}//: for
+}
+
+/*!
+ * \brief Checks the binarization of non-binary inputs and the connectivity updates of the binary correlator for rules changing also synapses of inactive inputs and neurons.
+ */
+TEST(BinaryCorrelator130x20Float, NonBinaryInputsAndNormalizedRule) {
+	// Proximal threshold high enough, so only some of the neurons are active.
+	mic::mlnn::fully_connected::BinaryCorrelator<float> layer(130, 20, 0.5, 28);
+	layer.setOptimization<mic::neural_nets::learning::BinaryCorrelatorLearningRule<float> >();
+	mic::types::MatrixPtr<float> x = MAKE_MATRIX_PTR(float, 130, 5);
+
+	for (size_t it=0; it<6; it++) {
+		// The normalized rule changes all permanences.
+		if (it == 3)
+			layer.setOptimization<mic::neural_nets::learning::NormalizedHebbianRule<float> >();
+		if (it == 4)
+			layer.setInputThreshold(0.25);
+		// Random inputs - some of them nonzero, but below the input threshold, the last ones inactive in all samples.
+		x->rand(0, 1);
+		for (size_t i=0; i<(size_t)x->size(); i++)
+			if ((*x)[i] < 0.2)
+				(*x)[i] = 0.0;
+		x->bottomRows(30).setZero();
+
+		// Reference: float connectivity and product with binarized inputs.
+		mic::types::Matrix<float> c = (*layer.p["p"]);
+		for (size_t i=0; i<(size_t)c.size(); i++)
+			c(i) = (c(i) > 0.5) ? 1.0 : 0.0;
+		mic::types::Matrix<float> xb = (*x);
+		for (size_t i=0; i<(size_t)xb.size(); i++)
+			xb(i) = (xb(i) > layer.getInputThreshold()) ? 1.0 : 0.0;
+		mic::types::Matrix<float> y = c * xb;
+
+		mic::types::MatrixPtr<float> py = layer.forward(x);
+		for (size_t i=0; i<(size_t)y.size(); i++)
+			ASSERT_EQ((*py)[i], (y(i) > 28) ? 1.0 : 0.0) << "Wrong output at position i=" << i;
+
+		layer.update(0.2);
+		for (size_t i=0; i<20; i++)
+			for (size_t j=0; j<130; j++)
+				ASSERT_EQ(layer.connected(i, j), (*layer.p["p"])(i, j) > 0.5) << "Wrong connectivity of synapse (" << i << "," << j << ") in iteration " << it;
+	}//: for
+}
+
+/*!
+ * \brief Tests the thresholded forward pass and the direct Hebbian update of a layer having more outputs than inputs.
+ */
+TEST(HebbianLinear10x150Double, ForwardAndUpdate) {
+	mic::mlnn::fully_connected::HebbianLinear<double> layer(10, 150);
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 10, 4);
+	x->rand(0, 1);
+	// Last sample activates no neurons.
+	x->col(3).setZero();
+	layer.p["W"]->rand(-0.1, 0.3);
+
+	mic::types::Matrix<double> W = (*layer.p["W"]);
+	mic::types::Matrix<double> y = W * (*x);
+	mic::types::MatrixPtr<double> py = layer.forward(x);
+	size_t active = 0;
+	for (size_t i=0; i<(size_t)y.size(); i++) {
+		ASSERT_EQ((*py)[i], (y(i) > 0.8) ? 1.0 : 0.0) << "Wrong output at position i=" << i;
+		active += (*py)[i];
+	}//: for
+	ASSERT_GT(active, 0);
+
+	layer.update(0.01);
+	mic::types::Matrix<double> W2 = W + 0.01 * (*py) * (*x).transpose();
+	for (size_t i=0; i<(size_t)W2.size(); i++)
+		ASSERT_LE(fabs((*layer.p["W"])[i] - W2(i)), 1e-12) << "Wrong weight at position i=" << i;
+
+	// Smaller batch - processed in the leading columns, gathering the active samples into the same buffers in every update.
+	mic::types::MatrixPtr<double> xs = MAKE_MATRIX_PTR(double, 10, 2);
+	(*xs) = x->rightCols(2);
+	for (size_t it=0; it<2; it++) {
+		W = (*layer.p["W"]);
+		py = layer.forward(xs);
+		ASSERT_EQ(py->cols(), 2);
+		W2 = W + 0.01 * (*py) * (*xs).transpose();
+		double* xa = layer.m["xa"]->data();
+		layer.update(0.01);
+		for (size_t i=0; i<(size_t)W2.size(); i++)
+			ASSERT_LE(fabs((*layer.p["W"])[i] - W2(i)), 1e-12) << "Wrong weight at position i=" << i;
+		if (it > 0) {
+			ASSERT_EQ(layer.m["xa"]->data(), xa);
+		}//: if
+	}//: for
+}
+
 } } } //: namespaces
 
 
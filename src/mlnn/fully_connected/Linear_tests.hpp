@@ -31,6 +31,10 @@
 #define private public
 #define protected public
 #include <mlnn/fully_connected/Linear.hpp>
+#include <mlnn/fully_connected/SparseLinear.hpp>
+#include <mlnn/fully_connected/PrunedLinear.hpp>
+#include <mlnn/fully_connected/BinaryCorrelator.hpp>
+#include <mlnn/fully_connected/HebbianLinear.hpp>
 #include <loss/SquaredErrorLoss.hpp>
 
 namespace mic { namespace neural_nets { namespace unit_tests {
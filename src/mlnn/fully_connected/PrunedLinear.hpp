@@ -0,0 +1,390 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file PrunedLinear.hpp
+ * \brief Fully connected layer with magnitude-pruned weights stored in the Compressed Sparse Row format.
+ * \date Oct 18, 2026
+ */
+
+#ifndef SRC_MLNN_PRUNEDLINEAR_HPP_
+#define SRC_MLNN_PRUNEDLINEAR_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// include this header to serialize vectors
+#include <boost/serialization/vector.hpp>
+
+#include <mlnn/fully_connected/Linear.hpp>
+
+namespace mic {
+namespace mlnn {
+namespace fully_connected {
+
+/*!
+ * \brief Class implementing a linear, fully connected layer with sparse (pruned) weights.
+ * The nonzero weights are kept in the Compressed Sparse Row (CSR) format: p["W"] is a [nnz x 1] vector of values,
+ * whereas the column indices and row offsets are stored separately. In result the optimization functions update only the existing nonzeros
+ * and the sparsity pattern is fixed for the whole life of the layer.
+ * Batches are processed in the transposed form [batch x size], so the products gather contiguous columns instead of strided rows.
+ * The product with the transposed weights (dx) uses a column-wise index (CSC) built at pruning time, so it can be parallelized without races.
+ * \tparam eT Template parameter denoting precision of variables (float for calculations/double for testing).
+ */
+template <typename eT=float>
+class PrunedLinear : public mic::mlnn::Layer<eT> {
+public:
+	/*!
+	 * Creates a pruned linear layer with random weights, keeping a random subset of connections.
+	 * @param inputs_ Length of the input vector.
+	 * @param outputs_ Length of the output vector.
+	 * @param density_ Fraction of weights that will be kept (0..1].
+	 * @param name_ Name of the layer.
+	 */
+	PrunedLinear(size_t inputs_, size_t outputs_, eT density_, std::string name_ = "PrunedLinear") :
+		Layer<eT>::Layer(inputs_, 1, 1, outputs_, 1, 1, LayerTypes::PrunedLinear, name_)
+	{
+		// Random weights with random magnitudes - pruning selects a random pattern.
+		mic::types::Matrix<eT> W(outputs_, inputs_);
+		eT range = sqrt(6.0 / eT(inputs_ * density_ + outputs_ * density_));
+		W.rand(-range, range);
+		prune(W, density_);
+	}
+
+	/*!
+	 * Creates a pruned layer from a (trained) linear layer, keeping the weights with the biggest magnitudes (magnitude pruning).
+	 * @param linear_ Linear layer - its sizes, weights and biases are copied.
+	 * @param density_ Fraction of weights that will be kept (0..1].
+	 * @param name_ Name of the layer.
+	 */
+	PrunedLinear(Linear<eT> & linear_, eT density_, std::string name_ = "PrunedLinear") :
+		Layer<eT>::Layer(linear_.inputSize(), 1, 1, linear_.outputSize(), 1, 1, LayerTypes::PrunedLinear, name_)
+	{
+		prune(*linear_.getParam("W"), density_);
+		(*p['b']) = (*linear_.getParam("b"));
+	}
+
+	/*!
+	 * Virtual destructor - empty.
+	 */
+	virtual ~PrunedLinear() {};
+
+	/*!
+	 * Forward pass: sparse-dense product y = W * x + b.
+	 * @param test_ It is set to true in test mode (network verification).
+	 */
+	void forward(bool test_ = false) {
+		// Get pointers to data matrices.
+		mic::types::MatrixPtr<eT> x = s['x'];
+		mic::types::MatrixPtr<eT> b = p['b'];
+		// Get output pointer - so the results will be stored!
+		mic::types::MatrixPtr<eT> y = s['y'];
+
+		// Get pointers to transposed batches.
+		mic::types::MatrixPtr<eT> xt = m["xt"];
+		mic::types::MatrixPtr<eT> yt = m["yt"];
+		mic::types::MatrixPtr<eT> W = p['W'];
+		size_t batch = batch_size;
+		reserveRows(xt, batch);
+		reserveRows(yt, batch);
+		xt->topRows(batch) = x->leftCols(batch).transpose();
+		size_t ldx = xt->rows();
+		size_t ldy = yt->rows();
+
+		// Forward pass: yt.col(r) = sum_k W[k] * xt.col(c_k) + b[r].
+		#pragma omp parallel for
+		for (size_t r = 0; r < output_height; r++) {
+			eT* out = (*yt).data() + r*ldy;
+			// Single sample - plain sparse matrix-vector product.
+			if (batch == 1) {
+				eT sum = (*b)[r];
+				for (int32_t k = row_offsets[r]; k < row_offsets[r+1]; k++)
+					sum += (*W)[k] * (*xt)(0, column_indices[k]);
+				*out = sum;
+				continue;
+			}//: if
+			std::fill(out, out + batch, (*b)[r]);
+			for (int32_t k = row_offsets[r]; k < row_offsets[r+1]; k++) {
+				const eT* in = (*xt).data() + column_indices[k]*ldx;
+				eT w = (*W)[k];
+				for (size_t j = 0; j < batch; j++)
+					out[j] += w * in[j];
+			}//: for k
+		}//: for r
+
+		y->leftCols(batch) = yt->topRows(batch).transpose();
+	}
+
+	/*!
+	 * Backward pass. The gradient of W is calculated only for the existing nonzeros.
+	 */
+	void backward() {
+		// Get pointer to data matrices.
+		mic::types::MatrixPtr<eT> dy = g['y'];
+		mic::types::MatrixPtr<eT> x = s['x'];
+		// Get output pointers - so the results will be stored!
+		mic::types::MatrixPtr<eT> dW = g['W'];
+		mic::types::MatrixPtr<eT> db = g['b'];
+		mic::types::MatrixPtr<eT> dx = g['x'];
+
+		mic::types::MatrixPtr<eT> W = p['W'];
+
+		// Transpose dy (xt is already set by the forward pass), so rows of dy and x become contiguous columns.
+		mic::types::MatrixPtr<eT> dyt = m["dyt"];
+		mic::types::MatrixPtr<eT> xt = m["xt"];
+		mic::types::MatrixPtr<eT> dxt = m["dxt"];
+		size_t batch = batch_size;
+		reserveRows(dyt, batch);
+		reserveRows(dxt, batch);
+		dyt->topRows(batch) = dy->leftCols(batch).transpose();
+		size_t lddy = dyt->rows();
+		size_t lddx = dxt->rows();
+
+		// dW(r,c) = dy.row(r) * x.row(c)^T - for nonzeros only.
+		#pragma omp parallel for
+		for (size_t r = 0; r < output_height; r++)
+			for (int32_t k = row_offsets[r]; k < row_offsets[r+1]; k++)
+				(*dW)[k] = (*dyt).col(r).head(batch).dot((*xt).col(column_indices[k]).head(batch));
+
+		(*db) = dy->leftCols(batch).rowwise().sum(); // Sum for all samples in batch, similarly as it is done for dW.
+
+		// dxt.col(c) = sum_k W[k] * dyt.col(r_k) - over the column-wise index.
+		#pragma omp parallel for
+		for (size_t c = 0; c < input_height; c++) {
+			eT* out = (*dxt).data() + c*lddx;
+			std::fill(out, out + batch, (eT)0);
+			for (int32_t k = column_offsets[c]; k < column_offsets[c+1]; k++) {
+				const eT* in = (*dyt).data() + row_indices[k]*lddy;
+				eT w = (*W)[value_indices[k]];
+				for (size_t j = 0; j < batch; j++)
+					out[j] += w * in[j];
+			}//: for k
+		}//: for c
+
+		dx->leftCols(batch) = dxt->topRows(batch).transpose();
+	}
+
+	/*!
+	 * Resets the gradients for W and b.
+	 */
+	void resetGrads() {
+		g['W']->setZero();
+		g['b']->setZero();
+	}
+
+	/*!
+	 * Applies the gradient update to the nonzero weights and biases, using the selected optimization method.
+	 * @param alpha_ Learning rate - passed to the optimization functions of all layers.
+	 * @param decay_ Weight decay rate (determining that the "unused/unupdated" weights will decay to 0) (DEFAULT=0.0 - no decay).
+	 */
+	void update(eT alpha_, eT decay_  = 0.0f) {
+		opt["W"]->update(p['W'], g['W'], alpha_, decay_);
+		opt["b"]->update(p['b'], g['b'], alpha_, 0.0);
+	}
+
+	/*!
+	 * Returns true if a given layer is a pruned linear layer with the same dimensions and sparsity pattern, so its nonzeros are stored in the same order.
+	 * @param layer_ Compared layer.
+	 */
+	virtual bool sameStructure(Layer<eT> & layer_) {
+		PrunedLinear<eT>* other = dynamic_cast<PrunedLinear<eT>*>(&layer_);
+		return Layer<eT>::sameStructure(layer_) && (other != nullptr) &&
+			(column_indices == other->column_indices) && (row_offsets == other->row_offsets);
+	}
+
+	/*!
+	 * Returns the number of stored (nonzero) weights.
+	 */
+	size_t nonzeros() {
+		return column_indices.size();
+	}
+
+	/*!
+	 * Returns the fraction of stored weights.
+	 */
+	eT density() {
+		return (eT)nonzeros() / (Layer<eT>::inputSize() * Layer<eT>::outputSize());
+	}
+
+	/*!
+	 * Returns the dense [outputs x inputs] weight matrix, with zeros in place of the pruned weights.
+	 */
+	mic::types::Matrix<eT> denseWeights() {
+		mic::types::Matrix<eT> W(Layer<eT>::outputSize(), Layer<eT>::inputSize());
+		W.setZero();
+		for (size_t r = 0; r < output_height; r++)
+			for (int32_t k = row_offsets[r]; k < row_offsets[r+1]; k++)
+				W(r, column_indices[k]) = (*p['W'])[k];
+		return W;
+	}
+
+	/*!
+	 * Stream layer parameters - adds the sparsity to the ones displayed by the base class.
+	 * @return Ostream object.
+	 */
+	virtual std::string streamLayerParameters() {
+		std::ostringstream os_;
+		os_ << Layer<eT>::streamLayerParameters();
+		os_ << "    * nonzeros = " << nonzeros() << " (density = " << density() << ")" << std::endl;
+		return os_.str();
+	}
+
+	/*!
+	 * Serializes the sparsity pattern (CSR arrays and the column-wise index) - called by the network after serialization of the layer,
+	 * as the nonzero values themselves are stored in p["W"].
+	 * @param ar Used archive.
+	 */
+	template<class Archive>
+	void serializeSparsityPattern(Archive & ar) {
+		ar & column_indices;
+		ar & row_offsets;
+		ar & column_offsets;
+		ar & row_indices;
+		ar & value_indices;
+	}
+
+	// Unhide the overloaded methods inherited from the template class Layer fields via "using" statement.
+	using Layer<eT>::forward;
+	using Layer<eT>::backward;
+
+protected:
+	// Unhide the fields inherited from the template class Layer via "using" statement.
+	using Layer<eT>::g;
+	using Layer<eT>::s;
+	using Layer<eT>::p;
+	using Layer<eT>::m;
+	using Layer<eT>::opt;
+	using Layer<eT>::input_height;
+	using Layer<eT>::output_height;
+	using Layer<eT>::batch_size;
+
+	/*!
+	 * Enlarges a transposed batch, so that it holds (at least) the given number of samples - it is never shrunk.
+	 * @param batch_ptr_ Transposed batch (samples in rows).
+	 * @param rows_ Required number of rows.
+	 */
+	static void reserveRows(mic::types::MatrixPtr<eT> batch_ptr_, size_t rows_) {
+		if ((size_t)batch_ptr_->rows() < rows_)
+			batch_ptr_->resize(rows_, batch_ptr_->cols());
+	}
+
+	/*!
+	 * Keeps the given fraction of weights with the biggest magnitudes and stores them in the CSR format.
+	 * Allocates parameters, gradients and the optimization functions.
+	 * @param W_ Dense [outputs x inputs] weight matrix.
+	 * @param density_ Fraction of weights that will be kept (0..1].
+	 */
+	void prune(const mic::types::Matrix<eT> & W_, eT density_) {
+		size_t size = W_.size();
+		size_t keep = std::min(size, std::max((size_t)1, (size_t)std::lround(density_ * size)));
+
+		// Find the magnitude threshold.
+		std::vector<eT> magnitudes(size);
+		for (size_t i = 0; i < size; i++)
+			magnitudes[i] = std::abs(W_(i));
+		std::nth_element(magnitudes.begin(), magnitudes.begin() + (size - keep), magnitudes.end());
+		eT threshold = magnitudes[size - keep];
+		// Number of weights equal to the threshold that will be kept (ties).
+		size_t ties = keep;
+		for (size_t i = 0; i < size; i++)
+			if (std::abs(W_(i)) > threshold)
+				ties--;
+
+		// Build the CSR arrays - row by row.
+		std::vector<eT> values;
+		values.reserve(keep);
+		column_indices.clear();
+		column_indices.reserve(keep);
+		row_offsets.assign(1, 0);
+		for (size_t r = 0; r < (size_t)W_.rows(); r++) {
+			for (size_t c = 0; c < (size_t)W_.cols(); c++) {
+				eT magnitude = std::abs(W_(r, c));
+				if ((magnitude > threshold) || ((magnitude == threshold) && (ties > 0))) {
+					if (magnitude == threshold)
+						ties--;
+					values.push_back(W_(r, c));
+					column_indices.push_back(c);
+				}//: if
+			}//: for c
+			row_offsets.push_back(column_indices.size());
+		}//: for r
+
+		// Build the column-wise index - counting sort of the nonzeros by columns.
+		column_offsets.assign(W_.cols() + 1, 0);
+		for (size_t k = 0; k < column_indices.size(); k++)
+			column_offsets[column_indices[k] + 1]++;
+		for (size_t c = 0; c < (size_t)W_.cols(); c++)
+			column_offsets[c + 1] += column_offsets[c];
+		row_indices.resize(column_indices.size());
+		value_indices.resize(column_indices.size());
+		std::vector<int32_t> next(column_offsets.begin(), column_offsets.end() - 1);
+		for (size_t r = 0; r < (size_t)W_.rows(); r++)
+			for (int32_t k = row_offsets[r]; k < row_offsets[r+1]; k++) {
+				int32_t pos = next[column_indices[k]]++;
+				row_indices[pos] = r;
+				value_indices[pos] = k;
+			}//: for
+
+		// Create the weights, bias and their gradients.
+		p.add ("W", values.size(), 1);
+		std::copy(values.begin(), values.end(), p['W']->data());
+		p.add ("b", Layer<eT>::outputSize(), 1);
+		p['b']->setZero();
+		g.add ("W", values.size(), 1);
+		g.add ("b", Layer<eT>::outputSize(), 1);
+
+		// Transposed batches - enlarged in the forward and backward passes.
+		m.add ("xt", 1, Layer<eT>::inputSize());
+		m.add ("yt", 1, Layer<eT>::outputSize());
+		m.add ("dxt", 1, Layer<eT>::inputSize());
+		m.add ("dyt", 1, Layer<eT>::outputSize());
+
+		// Set gradient descent as default optimization function.
+		Layer<eT>::template setOptimization<mic::neural_nets::optimization::GradientDescent<eT> > ();
+	}
+
+private:
+	// Friend class - required for using boost serialization.
+	template<typename tmp> friend class mic::mlnn::MultiLayerNeuralNetwork;
+
+	/// Column indices of the nonzero weights.
+	std::vector<int32_t> column_indices;
+
+	/// Offsets of rows in the vector of nonzeros - outputs + 1 elements.
+	std::vector<int32_t> row_offsets;
+
+	/// Offsets of columns in the column-wise index - inputs + 1 elements.
+	std::vector<int32_t> column_offsets;
+
+	/// Row indices of the nonzeros, sorted by columns.
+	std::vector<int32_t> row_indices;
+
+	/// Positions (in p["W"]) of the nonzeros, sorted by columns.
+	std::vector<int32_t> value_indices;
+
+	/*!
+	 * Private constructor, used only during the deserialization.
+	 */
+	PrunedLinear<eT>() : Layer<eT> () { }
+
+};
+
+} /* namespace fully_connected */
+} /* namespace mlnn */
+} /* namespace mic */
+
+#endif /* SRC_MLNN_PRUNEDLINEAR_HPP_ */
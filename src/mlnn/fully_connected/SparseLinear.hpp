@@ -57,6 +57,8 @@ public:
 		m.add ("ro", outputSize(), 1 );
 		// For penalty.
 		m.add ("penalty", outputSize(), 1 );
+		// For gradient incorporating the penalty.
+		m.add ("dy", outputSize(), 1 );
 
 		// Set desired sparsity and penalty term.
 		desired_ro = 0.1; // 10 %
@@ -69,6 +71,18 @@ public:
 	 */
 	virtual ~SparseLinear() {};
 
+	/*!
+	 * Changes the size of the batch - calls base Layer class resize and additionally resizes the gradient incorporating the penalty.
+	 * @param New size of the batch.
+	 */
+	virtual void resizeBatch(size_t batch_size_) {
+		// Call base Layer resize.
+		Linear<eT>::resizeBatch(batch_size_);
+
+		// Reserve the gradient.
+		Layer<eT>::reserveColumns(m["dy"], batch_size_);
+	}
+
 	/*!
 	 * Backward pass.
 	 */
@@ -76,7 +90,7 @@ public:
 		eT eps = 1e-10;
 		// Calculate the current "activation sparsity".
 		mic::types::MatrixPtr<eT> ro = m["ro"];
-		(*ro) = ((*s['y']).rowwise().sum()/batch_size);
+		(*ro) = (s['y']->leftCols(batch_size).rowwise().sum()/batch_size);
 
 		// Calculate the sparsity penalty - for every output neuron.
 		mic::types::MatrixPtr<eT> penalty = m["penalty"];
@@ -84,10 +98,15 @@ public:
 			(*penalty)[i] = beta*(-desired_ro/((*ro)[i] + eps) + (1-desired_ro)/(1-(*ro)[i] + eps));
 
 
-		// Calculate derivatives of W,b and x.
-		(*g['W']) = (*g['y']) * ((*s['x']).transpose());
-		(*g['b']) = (*g['y']).rowwise().mean();
-		(*g['x']) = (*p['W']).transpose() * (*g['y']);
+		// Add the derivative of the penalty to the gradient of every sample (as in the classic sparse autoencoder),
+		// so it is applied to W and b by the optimization functions and propagated to the lower layers.
+		mic::types::MatrixPtr<eT> dy = m["dy"];
+		dy->leftCols(batch_size) = g['y']->leftCols(batch_size) + (*penalty).replicate(1, batch_size);
+
+		// Calculate derivatives of W,b and x - sums for all samples in batch, as in Linear.
+		(*g['W']) = dy->leftCols(batch_size) * (s['x']->leftCols(batch_size).transpose());
+		(*g['b']) = dy->leftCols(batch_size).rowwise().sum();
+		g['x']->leftCols(batch_size) = (*p['W']).transpose() * dy->leftCols(batch_size);
 	}
 
 	/*!
@@ -102,9 +121,7 @@ public:
 		// Apply selected learning rule to W.
 		opt["W"]->update(p['W'], g['W'], alpha_, decay_);
 
-		// Apply sparsity learning rule to b, incorporating the KL-divergence term.
-		mic::types::MatrixPtr<eT> penalty = m["penalty"];
-		// (*p['b']) -=  alpha_ * beta * (*penalty);
+		// Apply selected learning rule to b - the gradient already incorporates the KL-divergence term.
 		opt["b"]->update(p['b'], g['b'], alpha_, 0.0);
 
 		//std::cout << "p['W'] after update= \n" << (*p['W']) << std::endl;
@@ -24,12 +24,14 @@
 #define SRC_MLNN_LAYER_HPP_
 
 #include <iostream>
+#include <map>
 #include <string>
 
 #include<types/MatrixTypes.hpp>
 #include<types/MatrixArray.hpp>
 #include <optimization/OptimizationFunctionTypes.hpp>
 #include <optimization/OptimizationArray.hpp>
+#include <mlnn/layer/SnapshotBuffer.hpp>
 
 #include <boost/serialization/serialization.hpp>
 // include this header to serialize vectors
@@ -76,7 +78,19 @@ enum class LayerTypes : short
 	// regularization
     Dropout,
     // Experimental
-    ConvHebbian
+    ConvHebbian,
+	// fully_connected (appended, so the serialized values of other types do not change)
+	PrunedLinear
+};
+
+/*!
+ * \brief Enumeration of possible layouts of samples (i.e. columns of batches) of convolutional layers.
+ * \author tkornuta
+ */
+enum class TensorLayout : short
+{
+	NCHW = 0, ///< Planar - concatenated column-major channels (default).
+	NHWC ///< Channel-interleaved - column-major pixels, each consisting of values of all channels stored contiguously.
 };
 
 
@@ -161,16 +175,19 @@ public:
 
 	/*!
 	 * Forwards the activations of the neural network.
+	 * Returns a copy of the outputs of the batch (see copyBatch()) - it is not changed by the next passes.
 	 */
 	mic::types::MatrixPtr<eT> forward(mic::types::MatrixPtr<eT> x_, bool test = false) {
-		// Copy "input" sample/batch.
-		(*s["x"]) = (*x_);
+		// Copy "input" sample/batch - changing the size of the batch if required.
+		if ((size_t)x_->cols() != batch_size)
+			resizeBatch(x_->cols());
+		s["x"]->leftCols(batch_size) = (*x_);
 
 		// Call the (abstract, implemented by a given layer) forward pass.
 		forward(test);
 
-		// Return "output".
-		return s["y"];
+		// Return (a copy of the) "output".
+		return copyBatch(s["y"]);
 	}
 
 	/*!
@@ -180,31 +197,66 @@ public:
 
 	/*!
 	 * Backward pass - backpropagation.
+	 * Returns a copy of the input gradients of the batch (see copyBatch()) - it is not changed by the next passes.
 	 */
 	mic::types::MatrixPtr<eT> backward(mic::types::MatrixPtr<eT> dy_) {
 		// Copy "output" sample/batch gradient.
-		(*g["y"]) = (*dy_);
+		assert((size_t)dy_->cols() == batch_size);
+		g["y"]->leftCols(batch_size) = (*dy_);
 
 		// Call the (abstract, implemented by a given layer) backward pass.
 		backward();
 
-		// Return "input" gradient.
-		return g["x"];
+		// Return (a copy of the) "input" gradient.
+		return copyBatch(g["x"]);
 	}
 
 	/*!
 	 * Changes the size of the batch. By default it resizes state (x,y) and gradients (x,y).
+	 * The buffers are only enlarged - they keep the capacity of the biggest batch and the passes process only their leading columns,
+	 * so switching between batches of different sizes does not reallocate the memory.
 	 * @param New size of the batch.
 	 */
 	virtual void resizeBatch(size_t batch_size_) {
 		// Change the "value". (depricated)
 		batch_size = batch_size_;
-		// Reshape the inputs...
-		s["x"]->resize(s["x"]->rows(), batch_size_);
-		g["x"]->resize(g["x"]->rows(), batch_size_);
+		// Reserve the inputs...
+		reserveColumns(s["x"], batch_size_);
+		reserveColumns(g["x"], batch_size_);
 		// ... and outputs.
-		s["y"]->resize(s["y"]->rows(), batch_size_);
-		g["y"]->resize(g["y"]->rows(), batch_size_);
+		reserveColumns(s["y"], batch_size_);
+		reserveColumns(g["y"], batch_size_);
+	}
+
+	/*!
+	 * Enlarges the buffer (e.g. batch), so it will have at least a given number of columns. Buffers are never shrunk, so their content is lost only when they are enlarged.
+	 * @param matrix_ Pointer to the buffer.
+	 * @param cols_ Required number of columns.
+	 */
+	static void reserveColumns(mic::types::MatrixPtr<eT> matrix_, size_t cols_) {
+		if ((size_t)matrix_->cols() < cols_)
+			matrix_->resize(matrix_->rows(), cols_);
+	}
+
+	/*!
+	 * Returns a copy of the samples of the current batch, stored in the leading columns of a given buffer (e.g. outputs).
+	 * The copy is always a new matrix of size [rows x batch_size], so it never aliases the buffer.
+	 * Passes do not need it - they process the leading columns of the buffers directly.
+	 * @param batch_ptr_ Pointer to the buffer.
+	 */
+	virtual mic::types::MatrixPtr<eT> copyBatch(mic::types::MatrixPtr<eT> batch_ptr_) {
+		mic::types::MatrixPtr<eT> batch = MAKE_MATRIX_PTR(eT, batch_ptr_->rows(), batch_size);
+		(*batch) = batch_ptr_->leftCols(batch_size);
+		return batch;
+	}
+
+	/*!
+	 * Returns the samples of the current batch as a matrix of size [rows x batch_size], to be read at once by functions that process whole matrices (e.g. the Hebbian rules).
+	 * Returns the buffer itself if it holds exactly the current batch - so the result might alias the buffer and must not be kept, otherwise a copy of its leading columns (see copyBatch()).
+	 * @param batch_ptr_ Pointer to the buffer.
+	 */
+	mic::types::MatrixPtr<eT> exactBatch(mic::types::MatrixPtr<eT> batch_ptr_) {
+		return ((size_t)batch_ptr_->cols() == batch_size) ? batch_ptr_ : copyBatch(batch_ptr_);
 	}
 
 	/*!
@@ -222,10 +274,12 @@ public:
 		for (size_t i=0; i<(size_t)param_->size(); i++) {
 			// Add delta.
 			(*param_)[i] += delta_;
+			invalidateCaches();
 			// Calculate loss.
 			eT p = loss_.calculateLoss(target_y_, forward(x_));
 			// Substract delta.
 			(*param_)[i] -= 2*delta_;
+			invalidateCaches();
 			// Calculate loss.
 			eT m = loss_.calculateLoss(target_y_, forward(x_));
 
@@ -233,6 +287,7 @@ public:
 			(*nGrad)[i] = (p-m)/(2*delta_);
 			// Set original value.
 			(*param_)[i] += delta_;
+			invalidateCaches();
 
 		}//: for
 		return nGrad;
@@ -244,6 +299,51 @@ public:
 	 */
 	virtual void resetGrads() {};
 
+	/*!
+	 * Invalidates data cached on the basis of parameters (e.g. transformed filters) - must be called when parameters are modified outside of update().
+	 * Virtual empty method - to be implemented by the inherited classes using such caches.
+	 */
+	virtual void invalidateCaches() {};
+
+	/*!
+	 * Returns true if a given layer has the same type, dimensions and hyper-parameters, i.e. it computes the same function of the same parameters.
+	 * Virtual method - to be extended by the inherited classes with additional hyper-parameters.
+	 * @param layer_ Compared layer.
+	 */
+	virtual bool sameStructure(Layer<eT> & layer_) {
+		return (layer_type == layer_.layer_type) &&
+			(input_height == layer_.input_height) && (input_width == layer_.input_width) && (input_depth == layer_.input_depth) &&
+			(output_height == layer_.output_height) && (output_width == layer_.output_width) && (output_depth == layer_.output_depth);
+	}
+
+	/*!
+	 * Returns true if the layer can process batches stored in the channel-interleaved (NHWC) layout.
+	 * Virtual method - to be overridden by the inherited classes supporting such layout.
+	 */
+	virtual bool supportsInterleavedLayout() { return false; }
+
+	/*!
+	 * Sets layouts of the input (x, dx) and output (y, dy) batches. Ignored by layers that do not support the interleaved layout.
+	 * @param input_layout_ Layout of the input batches.
+	 * @param output_layout_ Layout of the output batches.
+	 */
+	void setLayouts(TensorLayout input_layout_, TensorLayout output_layout_) {
+		if (!supportsInterleavedLayout())
+			return;
+		input_layout = input_layout_;
+		output_layout = output_layout_;
+	}
+
+	/// Returns layout of the input batches.
+	inline TensorLayout inputLayout() {
+		return input_layout;
+	}
+
+	/// Returns layout of the output batches.
+	inline TensorLayout outputLayout() {
+		return output_layout;
+	}
+
 	/*!
 	 * Performs the update according to the calculated gradients and injected optimization method. Abstract.
 	 * @param alpha_ Learning rate - passed to the optimization functions of all layers.
@@ -344,6 +444,8 @@ public:
 			return "Linear";
 		case(LayerTypes::SparseLinear):
 			return "SparseLinear";
+		case(LayerTypes::PrunedLinear):
+			return "PrunedLinear";
 		case(LayerTypes::HebbianLinear):
 			return "HebbianLinear";
 		case(LayerTypes::BinaryCorrelator):
@@ -531,6 +633,67 @@ public:
 		return lazyReturnChannelFromSample(sample_ptr_, m, "yc", sample_number_, channel_number_, output_height, output_width);
 	}
 
+	/// Returns true if the layer processes batches in the channel-interleaved layout.
+	inline bool interleaved() {
+		return (input_layout == TensorLayout::NHWC) || (output_layout == TensorLayout::NHWC);
+	}
+
+	/*!
+	 * Returns batch stored in the channel-interleaved (NHWC) layout.
+	 * A planar batch is converted into a (lazy allocated) memory matrix, unless it has only one channel (as both layouts are then identical).
+	 * Must not be called from parallel regions.
+	 * @param batch_ptr_ Pointer to a batch.
+	 * @param layout_ Layout of the batch.
+	 * @param id_ Id of the memory matrix used for the conversion.
+	 * @param channels_ Number of channels.
+	 * @param copy_ If false, the data are not copied - the returned matrix is only a buffer to be filled and stored with storeInterleavedBatch().
+	 */
+	mic::types::MatrixPtr<eT> lazyReturnInterleavedBatch (mic::types::MatrixPtr<eT> batch_ptr_, TensorLayout layout_, std::string id_, size_t channels_, bool copy_){
+		if ((layout_ == TensorLayout::NHWC) || (channels_ == 1))
+			return batch_ptr_;
+
+		if (!m.keyExists(id_))
+			m.add(id_, batch_ptr_->rows(), batch_size);
+		mic::types::MatrixPtr<eT> buffer = m[id_];
+		if (buffer->rows() != batch_ptr_->rows())
+			buffer->resize(batch_ptr_->rows(), batch_size);
+		reserveColumns(buffer, batch_size);
+
+		if (copy_) {
+			size_t pixels = batch_ptr_->rows() / channels_;
+			#pragma omp parallel for
+			for (size_t ib = 0; ib < batch_size; ib++) {
+				const eT* src = batch_ptr_->data() + ib * batch_ptr_->rows();
+				eT* dst = buffer->data() + ib * buffer->rows();
+				for (size_t px = 0; px < pixels; px++)
+					for (size_t c = 0; c < channels_; c++)
+						dst[c + px*channels_] = src[px + c*pixels];
+			}//: for batch
+		}//: if
+		return buffer;
+	}
+
+	/*!
+	 * Stores the channel-interleaved buffer (returned by lazyReturnInterleavedBatch()) in the batch, converting it back to the planar layout if required.
+	 * @param buffer_ Interleaved buffer.
+	 * @param batch_ptr_ Pointer to the batch.
+	 * @param channels_ Number of channels.
+	 */
+	void storeInterleavedBatch (mic::types::MatrixPtr<eT> buffer_, mic::types::MatrixPtr<eT> batch_ptr_, size_t channels_){
+		if (buffer_ == batch_ptr_)
+			return;
+
+		size_t pixels = buffer_->rows() / channels_;
+		#pragma omp parallel for
+		for (size_t ib = 0; ib < batch_size; ib++) {
+			const eT* src = buffer_->data() + ib * buffer_->rows();
+			eT* dst = batch_ptr_->data() + ib * batch_ptr_->rows();
+			for (size_t c = 0; c < channels_; c++)
+				for (size_t px = 0; px < pixels; px++)
+					dst[px + c*pixels] = src[c + px*channels_];
+		}//: for batch
+	}
+
 
 
 	/*!
@@ -719,6 +882,73 @@ public:
 		return dy_activations;
 	}
 
+	/*!
+	 * Returns activations of weights - empty for layers without weights.
+	 */
+	virtual std::vector< std::shared_ptr <mic::types::Matrix<eT> > > & getWeightActivations() {
+		return empty_activations;
+	}
+
+	/*!
+	 * Returns activations of gradients of weights - empty for layers without weights.
+	 */
+	virtual std::vector< std::shared_ptr <mic::types::Matrix<eT> > > & getWeightGradientActivations() {
+		return empty_activations;
+	}
+
+	/*!
+	 * Sets the snapshots that will be published by publishSnapshots().
+	 * @param kinds_ Kinds of published snapshots.
+	 * @param interval_ Snapshots will be published every interval_ calls of publishSnapshots() (0 - never).
+	 */
+	void setSnapshots(std::vector<SnapshotKind> kinds_, size_t interval_ = 1) {
+		for (size_t i=0; i < snapshot_kinds; i++)
+			snapshot_enabled[i] = false;
+		for (auto kind : kinds_)
+			snapshot_enabled[(size_t)kind] = true;
+		snapshot_interval = interval_;
+		snapshot_counter = 0;
+	}
+
+	/*!
+	 * Publishes snapshots of the current activations - called by the training thread, e.g. after every learning step.
+	 * Copying is done without any locks, so the visualization can be still displaying the previous snapshots.
+	 * @param force_ If set, snapshots are published regardless of the interval.
+	 * @return True if the snapshots were published.
+	 */
+	bool publishSnapshots(bool force_ = false) {
+		if (!force_) {
+			if (snapshot_interval == 0)
+				return false;
+			if ((snapshot_counter++ % snapshot_interval) != 0)
+				return false;
+		}//: if
+
+		for (size_t i=0; i < snapshot_kinds; i++) {
+			if (!snapshot_enabled[i])
+				continue;
+			switch((SnapshotKind)i) {
+				case SnapshotKind::Input: snapshots[i].publish(getInputActivations()); break;
+				case SnapshotKind::InputGradient: snapshots[i].publish(getInputGradientActivations()); break;
+				case SnapshotKind::Weight: snapshots[i].publish(getWeightActivations()); break;
+				case SnapshotKind::WeightGradient: snapshots[i].publish(getWeightGradientActivations()); break;
+				case SnapshotKind::Output: snapshots[i].publish(getOutputActivations()); break;
+				case SnapshotKind::OutputGradient: snapshots[i].publish(getOutputGradientActivations()); break;
+			}//: switch
+		}//: for
+		return true;
+	}
+
+	/*!
+	 * Returns the latest complete snapshot - called by the (single) visualization thread.
+	 * The returned matrices will not be modified by the training thread as long as they are kept.
+	 * @param kind_ Kind of the snapshot.
+	 * @return Vector of matrices (empty if nothing was published yet).
+	 */
+	std::vector< std::shared_ptr <mic::types::Matrix<eT> > > & getSnapshot(SnapshotKind kind_) {
+		snapshots[(size_t)kind_].read(snapshot_views[(size_t)kind_]);
+		return snapshot_views[(size_t)kind_];
+	}
 
 protected:
 
@@ -749,6 +979,12 @@ protected:
 	/// Name (identifier of the type) of the layer.
 	std::string layer_name;
 
+	/// Layout of the input batches (x, dx).
+	TensorLayout input_layout = TensorLayout::NCHW;
+
+	/// Layout of the output batches (y, dy).
+	TensorLayout output_layout = TensorLayout::NCHW;
+
 	/// States - contains input [x] and output [y] matrices.
 	mic::types::MatrixArray<eT> s;
 
@@ -776,6 +1012,27 @@ protected:
 	/// Vector containing activations of gradients of outputs (dy) - used in visualization.
 	std::vector< std::shared_ptr <mic::types::Matrix<eT> > > dy_activations;
 
+	/// Empty vector - returned by layers that do not have particular activations.
+	std::vector< std::shared_ptr <mic::types::Matrix<eT> > > empty_activations;
+
+	/// Number of kinds of snapshots.
+	static const size_t snapshot_kinds = 6;
+
+	/// Buffers of published snapshots - one for each kind.
+	SnapshotBuffer<eT> snapshots[snapshot_kinds];
+
+	/// Snapshots read by the visualization thread - one for each kind.
+	std::vector< std::shared_ptr <mic::types::Matrix<eT> > > snapshot_views[snapshot_kinds];
+
+	/// Flags denoting which kinds of snapshots are published.
+	bool snapshot_enabled[snapshot_kinds] = { false, false, false, false, false, false };
+
+	/// Snapshots are published every snapshot_interval calls of publishSnapshots() (0 - never).
+	size_t snapshot_interval = 0;
+
+	/// Number of calls of publishSnapshots().
+	size_t snapshot_counter = 0;
+
 
 	/*!
 	 * Protected constructor, used only by the derived classes during the serialization. Empty!!
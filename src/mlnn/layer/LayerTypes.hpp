@@ -52,6 +52,8 @@
 
 #include <mlnn/fully_connected/SparseLinear.hpp>
 
+#include <mlnn/fully_connected/PrunedLinear.hpp>
+
 // Regularisation layers.
 
 #include <mlnn/regularisation/Dropout.hpp>
@@ -0,0 +1,179 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file SnapshotBuffer.hpp
+ * \brief Lock-free, triple-buffered snapshots of vectors of matrices, passed from the training to the visualization.
+ * \date Oct 18, 2026
+ */
+
+#ifndef SRC_MLNN_SNAPSHOTBUFFER_HPP_
+#define SRC_MLNN_SNAPSHOTBUFFER_HPP_
+
+#include <vector>
+#include <atomic>
+
+#include<types/MatrixTypes.hpp>
+
+namespace mic {
+namespace mlnn {
+
+/*!
+ * \brief Enumeration of kinds of snapshots published by layers.
+ * \author tkornuta
+ */
+enum class SnapshotKind : short
+{
+	Input = 0, ///< Activations of input neurons (x).
+	InputGradient, ///< Gradients of inputs (dx).
+	Weight, ///< Weights (W).
+	WeightGradient, ///< Gradients of weights (dW).
+	Output, ///< Activations of output neurons (y).
+	OutputGradient ///< Gradients of outputs (dy).
+};
+
+/*!
+ * \brief Triple buffer of snapshots - vectors of matrices, e.g. activations of neurons.
+ * A single (training) thread publishes snapshots, whereas other (visualization) threads read the latest complete one - without locks.
+ * Matrices of a read snapshot are shared (not copied), thus they will not be overwritten as long as the reader keeps them.
+ * \author tkornuta
+ * \tparam eT Template parameter denoting precision of variables (float for calculations/double for testing).
+ */
+template <typename eT=float>
+class SnapshotBuffer {
+public:
+	/*!
+	 * Constructor. Empty buffer - nothing was published yet.
+	 */
+	SnapshotBuffer() : latest(slots_number), published(0) {
+		for (size_t i=0; i < slots_number; i++)
+			readers[i] = 0;
+	}
+
+	/*!
+	 * Copy constructor - creates an empty buffer, as snapshots are not shared between objects.
+	 */
+	SnapshotBuffer(const SnapshotBuffer<eT> &) : SnapshotBuffer() { }
+
+	/*!
+	 * Assignment operator - does nothing, as snapshots are not shared between objects.
+	 */
+	SnapshotBuffer<eT> & operator=(const SnapshotBuffer<eT> &) {
+		return *this;
+	}
+
+	/*!
+	 * Publishes a snapshot: copies the matrices to a slot that is neither the latest nor used by readers, then makes it the latest one.
+	 * Memory of the slot is reused if none of its matrices is kept by a reader, otherwise new matrices are allocated.
+	 * Must be called by a single (writer) thread.
+	 * @param source_ Vector of matrices.
+	 */
+	void publish(const std::vector< mic::types::MatrixPtr<eT> > & source_) {
+		size_t current = latest.load();
+		size_t slot = slots_number;
+		// Readers pin slots only for a moment, thus there will be a free one soon.
+		while (slot == slots_number) {
+			for (size_t i=0; i < slots_number; i++) {
+				if ((i == current) || (readers[i].load() != 0))
+					continue;
+				// Slot that can be written - remember it, but look for one with matrices that are not kept by readers.
+				if (slot == slots_number)
+					slot = i;
+				if (unused(slots[i])) {
+					slot = i;
+					break;
+				}//: if
+			}//: for
+		}//: while
+
+		// Matrices kept by readers cannot be overwritten - allocate new ones.
+		std::vector< mic::types::MatrixPtr<eT> > & target = slots[slot];
+		if (!unused(target))
+			target.clear();
+
+		// Copy the matrices - reusing the memory if possible.
+		target.resize(source_.size());
+		for (size_t i=0; i < source_.size(); i++) {
+			if (!target[i])
+				target[i] = MAKE_MATRIX_PTR(eT, source_[i]->rows(), source_[i]->cols());
+			(*target[i]) = (*source_[i]);
+		}//: for
+
+		// Make the snapshot visible.
+		latest.store(slot);
+		published++;
+	}
+
+	/*!
+	 * Reads the latest snapshot, i.e. shares its matrices.
+	 * @param target_ Vector to which the pointers to matrices will be copied (left unchanged if nothing was published).
+	 * @return True if the snapshot was read.
+	 */
+	bool read(std::vector< mic::types::MatrixPtr<eT> > & target_) {
+		while (true) {
+			size_t slot = latest.load();
+			if (slot == slots_number)
+				return false;
+			// Pin the slot, making sure it is still the latest one (i.e. the writer has not picked it in the meantime).
+			readers[slot]++;
+			if (latest.load() == slot) {
+				target_ = slots[slot];
+				readers[slot]--;
+				return true;
+			}//: if
+			readers[slot]--;
+		}//: while
+	}
+
+	/*!
+	 * Returns the number of published snapshots.
+	 */
+	size_t version() {
+		return published.load();
+	}
+
+private:
+	/// Number of slots (triple buffering).
+	static const size_t slots_number = 3;
+
+	/// Slots containing snapshots.
+	std::vector< mic::types::MatrixPtr<eT> > slots[slots_number];
+
+	/// Number of readers currently copying each of the slots.
+	std::atomic<size_t> readers[slots_number];
+
+	/// Index of slot with the latest snapshot (slots_number if nothing was published).
+	std::atomic<size_t> latest;
+
+	/// Number of published snapshots.
+	std::atomic<size_t> published;
+
+	/*!
+	 * Checks whether the matrices of the slot are not kept by any reader.
+	 * @param slot_ Slot.
+	 */
+	static bool unused(const std::vector< mic::types::MatrixPtr<eT> > & slot_) {
+		for (auto & matrix : slot_)
+			if (matrix.use_count() > 1)
+				return false;
+		return true;
+	}
+
+};
+
+} /* namespace mlnn */
+} /* namespace mic */
+
+#endif /* SRC_MLNN_SNAPSHOTBUFFER_HPP_ */
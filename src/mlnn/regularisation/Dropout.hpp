@@ -46,11 +46,12 @@ public:
 		Layer<eT>(inputs_, 1, 1,
 				inputs_, 1, 1,
 				LayerTypes::Dropout, name_),
-				keep_ratio(ratio_)
+				keep_ratio(ratio_),
+				replay_mask(false)
 	{
-		// Create matrices with temporary variables: random and dropout of size [inputxinput], so we can simply calculate: y=mask*x.
-		m.add ("random", inputs_, inputs_);
-		m.add ("dropout_mask", inputs_, inputs_);
+		// Create matrices with temporary variables: random and dropout mask of size [input x batch], so we can simply calculate: y=mask.*x.
+		m.add ("random", inputs_, 1);
+		m.add ("dropout_mask", inputs_, 1);
 	}
 
 	virtual ~Dropout() {};
@@ -63,37 +64,70 @@ public:
 		// Call base Layer resize.
 		Layer<eT>::resizeBatch(batch_size_);
 
-		// Reshape pooling mask and map.
-		m["dropout_mask"]->resize(Layer<eT>::inputSize(), batch_size_);
+		// Reserve random matrix and dropout mask.
+		Layer<eT>::reserveColumns(m["random"], batch_size_);
+		Layer<eT>::reserveColumns(m["dropout_mask"], batch_size_);
+	}
+
+	/*!
+	 * Generates a new dropout mask for the current batch - ones for the passed activations, zeros for the dropped ones.
+	 */
+	void generateMask() {
+		// Generate random matrix (the whole buffer, only its leading columns are used).
+		mic::types::MatrixPtr<eT> rand = m["random"];
+		rand->rand(0.0f, 1.0f);
+
+		// Generate the dropout mask.
+		mic::types::MatrixPtr<eT> mask = m["dropout_mask"];
+
+		#pragma omp parallel for
+		for(size_t i=0; i< (size_t)mask->rows() * batch_size; i++)
+			(*mask)[i] = ((*rand)[i] < keep_ratio);
+	}
+
+	/*!
+	 * Returns the keep ratio.
+	 */
+	eT keepRatio() {
+		return keep_ratio;
+	}
+
+	/*!
+	 * Sets the replay mode, in which the forward pass reuses the current dropout mask instead of generating a new one (e.g. when activations are recomputed).
+	 * @param replay_ Replay flag (DEFAULT=true).
+	 */
+	void replayMask(bool replay_ = true) {
+		replay_mask = replay_;
+	}
+
+	/*!
+	 * Returns true if the forward pass reuses the current dropout mask.
+	 */
+	bool replaysMask() {
+		return replay_mask;
 	}
 
 
 	void forward(bool test = false) {
 		if (test) {
 			// In test run copy data as it is.
-			(*s['y']) = (*s['x']);
+			s['y']->leftCols(batch_size) = s['x']->leftCols(batch_size);
 
 		} else {
 			// Get pointers to input and output batches.
 			mic::types::MatrixPtr<eT> batch_x = s['x'];
 			mic::types::MatrixPtr<eT> batch_y = s['y'];
 
-			// Generate random matrix.
-			mic::types::MatrixPtr<eT> rand = m["random"];
-			rand->rand(0.0f, 1.0f);
-
-			// Generate the dropout mask.
+			// Generate the dropout mask - unless the previous one is replayed.
+			if (!replay_mask)
+				generateMask();
 			mic::types::MatrixPtr<eT> mask = m["dropout_mask"];
 
-			#pragma omp parallel for
-			for(size_t i=0; i< (size_t)mask->size(); i++)
-				(*mask)[i] = ((*rand)[i] < keep_ratio);
-
 			// Apply the dropout_mask - discard the elements where mask is 0.
-			(*batch_y) =  (*mask) * (*batch_x);
+			batch_y->leftCols(batch_size) = mask->leftCols(batch_size).cwiseProduct(batch_x->leftCols(batch_size));
 
 			// Normalize, so that we don't have to do anything at test time.
-			(*batch_y) /= keep_ratio;
+			batch_y->leftCols(batch_size) /= keep_ratio;
 
 		}
 	}
@@ -105,7 +139,10 @@ public:
 		mic::types::MatrixPtr<eT> mask = m["dropout_mask"];
 
 		// Always use dropout mask as backward pass is used only during learning.
-		(*batch_dy) =  (*mask).transpose() * (*batch_dx);
+		batch_dx->leftCols(batch_size) = mask->leftCols(batch_size).cwiseProduct(batch_dy->leftCols(batch_size));
+
+		// Normalize - as in the forward pass.
+		batch_dx->leftCols(batch_size) /= keep_ratio;
 	}
 
 	/*!
@@ -133,6 +170,11 @@ protected:
 	 */
 	eT keep_ratio;
 
+	/*!
+	 * Flag denoting whether the forward pass reuses the current dropout mask.
+	 */
+	bool replay_mask;
+
 private:
 	// Friend class - required for using boost serialization.
 	template<typename tmp> friend class mic::mlnn::MultiLayerNeuralNetwork;
@@ -140,7 +182,7 @@ private:
 	/*!
 	 * Private constructor, used only during the serialization.
 	 */
-	Dropout<eT>() : Layer<eT> () { }
+	Dropout<eT>() : Layer<eT> (), replay_mask(false) { }
 
 
 };
@@ -96,6 +96,13 @@ public:
 		return delta;
 	}
 
+	/*!
+	 * Returns the number of elements of the matrices storing the state of the optimization function.
+	 */
+	size_t stateSize() {
+		return EG->size() + ED->size() + delta->size();
+	}
+
 protected:
 	/// Decay ratio, similar to momentum.
 	eT decay;
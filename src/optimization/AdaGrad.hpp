@@ -76,6 +76,13 @@ public:
 		return delta;
 	}
 
+	/*!
+	 * Returns the number of elements of the matrices storing the state of the optimization function.
+	 */
+	size_t stateSize() {
+		return G->size() + delta->size();
+	}
+
 protected:
 	/// Smoothing term that avoids division by zero.
 	eT eps;
@@ -91,6 +91,13 @@ public:
 		return delta;
 	}
 
+	/*!
+	 * Returns the number of elements of the matrices storing the state of the optimization function.
+	 */
+	size_t stateSize() {
+		return m->size() + v->size() + delta->size();
+	}
+
 protected:
 	/// Exponentially decaying average of past gradients.
 	mic::types::MatrixPtr<eT> m;
@@ -113,6 +113,13 @@ public:
 		return delta;
 	}
 
+	/*!
+	 * Returns the number of elements of the matrices storing the state of the optimization function.
+	 */
+	size_t stateSize() {
+		return Edx->size() + Edx2->size() + dx_prev->size() + delta->size();
+	}
+
 protected:
 	/// Decay rate 1 (momentum for past gradients).
 	eT beta1;
@@ -53,6 +53,40 @@ public:
 	// Abstract method responsible for calculation of the a gradient in a given point.
 	virtual mic::types::MatrixPtr<eT> calculateGradient(mic::types::MatrixPtr<eT> x_) = 0;
 
+	/*!
+	 * Calculates values of the function for a batch of points, i.e. columns of the matrix - by default one by one.
+	 * @param x_ Points [dims x batch_size].
+	 * @return Row vector of values [1 x batch_size].
+	 */
+	virtual mic::types::MatrixPtr<eT> calculateValues(mic::types::MatrixPtr<eT> x_) {
+		assert((size_t)x_->rows() == dims);
+		mic::types::MatrixPtr<eT> values = MAKE_MATRIX_PTR(eT, 1, x_->cols());
+		mic::types::MatrixPtr<eT> point = MAKE_MATRIX_PTR(eT, dims, 1);
+		for (size_t c=0; c<(size_t)x_->cols(); c++) {
+			(*point) = x_->col(c);
+			(*values)(0, c) = calculateValue(point);
+		}//: for
+		return values;
+	}
+
+	/*!
+	 * Calculates gradients of the function for a batch of points, i.e. columns of the matrix - by default one by one.
+	 * @param x_ Points [dims x batch_size].
+	 * @param dx_ Resulting gradients [dims x batch_size].
+	 */
+	virtual void calculateGradients(mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> dx_) {
+		assert((size_t)x_->rows() == dims);
+		dx_->resize(x_->rows(), x_->cols());
+		mic::types::MatrixPtr<eT> point = MAKE_MATRIX_PTR(eT, dims, 1);
+		for (size_t c=0; c<(size_t)x_->cols(); c++) {
+			(*point) = x_->col(c);
+			dx_->col(c) = (*calculateGradient(point));
+		}//: for
+	}
+
+	/// Returns the number of function dimensions.
+	size_t dimensions() { return dims; }
+
 	/// Returns the vector of arguments being the function minimum.
 	mic::types::MatrixPtr<eT> minArguments () { return min_arguments; }
 
@@ -113,6 +147,24 @@ public:
 
 		return dx;
 	}
+
+	/*!
+	 * Calculates values of the function for a batch of points.
+	 */
+	mic::types::MatrixPtr<eT> calculateValues(mic::types::MatrixPtr<eT> x_) {
+		assert((size_t)x_->rows() == this->dims);
+		mic::types::MatrixPtr<eT> values = MAKE_MATRIX_PTR(eT, 1, x_->cols());
+		(*values) = x_->colwise().squaredNorm();
+		return values;
+	}
+
+	/*!
+	 * Calculates gradients of the function for a batch of points.
+	 */
+	void calculateGradients(mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> dx_) {
+		assert((size_t)x_->rows() == this->dims);
+		(*dx_) = 2 * (*x_);
+	}
 };
 
 
@@ -244,6 +296,79 @@ private:
 };
 
 
+/*!
+ * \brief Rosenbrock function generalized to n dimensions: sum of b*(x[i+1]-x[i]^2)^2 + (1-x[i])^2, for i = 0..n-2. The minimum is in (1, ..., 1).
+ * \author tkornuta
+ */
+template <typename eT=float>
+class RosenbrockFunction  : public DifferentiableFunction<eT> {
+public:
+
+	/// Constructor. Asserts whether there are at least 2 dimensions.
+	RosenbrockFunction(size_t dims_, eT b_ = 100) : DifferentiableFunction<eT>(dims_), a(1), b(b_) {
+		assert(dims_ > 1);
+		// Set minimum.
+		this->min_arguments = MAKE_MATRIX_PTR(eT, this->dims, 1);
+		this->min_arguments->setOnes();
+		this->min_value = 0.0;
+	}
+
+	/*!
+	 * Calculates value of a function for a given point.
+	 */
+	eT calculateValue(mic::types::MatrixPtr<eT> x_) {
+		assert((size_t)x_->size() == this->dims);
+		return (*calculateValues(x_))(0, 0);
+	}
+
+	/*!
+	 * Calculates gradient of a function in a given point.
+	 */
+	mic::types::MatrixPtr<eT> calculateGradient(mic::types::MatrixPtr<eT> x_) {
+		assert((size_t)x_->size() == this->dims);
+		mic::types::MatrixPtr<eT> dx = MAKE_MATRIX_PTR(eT, this->dims, 1);
+		calculateGradients(x_, dx);
+		return dx;
+	}
+
+	/*!
+	 * Calculates values of the function for a batch of points.
+	 */
+	mic::types::MatrixPtr<eT> calculateValues(mic::types::MatrixPtr<eT> x_) {
+		assert((size_t)x_->rows() == this->dims);
+		size_t n = this->dims - 1;
+		mic::types::MatrixPtr<eT> values = MAKE_MATRIX_PTR(eT, 1, x_->cols());
+		for (size_t c=0; c<(size_t)x_->cols(); c++) {
+			auto head = x_->col(c).head(n).array();
+			auto tail = x_->col(c).tail(n).array();
+			(*values)(0, c) = b * (tail - head.square()).square().sum() + (a - head).square().sum();
+		}//: for
+		return values;
+	}
+
+	/*!
+	 * Calculates gradients of the function for a batch of points.
+	 */
+	void calculateGradients(mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> dx_) {
+		assert((size_t)x_->rows() == this->dims);
+		size_t n = this->dims - 1;
+		dx_->resize(x_->rows(), x_->cols());
+		for (size_t c=0; c<(size_t)x_->cols(); c++) {
+			auto head = x_->col(c).head(n).array();
+			auto tail = x_->col(c).tail(n).array();
+			// Derivatives of both terms with respect to x[i] (first n elements) and of the first term with respect to x[i+1] (last n elements).
+			dx_->col(c)(this->dims - 1) = 0;
+			dx_->col(c).head(n).array() = -2 * (a - head) - 4 * b * head * (tail - head.square());
+			dx_->col(c).tail(n).array() += 2 * b * (tail - head.square());
+		}//: for
+	}
+
+private:
+	/// Coefficients (a is fixed to 1).
+	eT a, b;
+};
+
+
 } //: artificial_landscapes
 } //: optimization
 } //: neural_nets
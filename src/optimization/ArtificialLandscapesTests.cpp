@@ -197,6 +197,72 @@ TEST_F(Rosenbrock2DLandscape, Gradient) {
 
 
 
+/*!
+ * Checks whether the n-dimensional Rosenbrock function reduces to the 2D one and whether its gradient is correct (numerically).
+ * \author tkornuta
+ */
+TEST(RosenbrockNDLandscape, ValueAndGradient) {
+	double eps = 1e-6;
+	mic::neural_nets::optimization::artificial_landscapes::RosenbrockFunction<double> fun2(2);
+	mic::neural_nets::optimization::artificial_landscapes::Rosenbrock2DFunction<double> fun2d(1, 100);
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 2, 1);
+	(*x)[0] = 2;
+	(*x)[1] = 0;
+	ASSERT_LE(std::abs(fun2.calculateValue(x) - fun2d.calculateValue(x)), eps);
+	ASSERT_LE(std::abs((*fun2.calculateGradient(x))[0] - 3202.0), eps);
+	ASSERT_LE(std::abs((*fun2.calculateGradient(x))[1] + 800.0), eps);
+
+	// Minimum.
+	mic::neural_nets::optimization::artificial_landscapes::RosenbrockFunction<double> fun(7);
+	ASSERT_LE(std::abs(fun.calculateValue(fun.minArguments()) - fun.minValue()), eps);
+
+	// Numerical gradient.
+	x = MAKE_MATRIX_PTR(double, 7, 1);
+	x->rand(-2.0, 2.0);
+	mic::types::MatrixPtr<double> dx = fun.calculateGradient(x);
+	double delta = 1e-6;
+	for (size_t i=0; i<7; i++) {
+		(*x)[i] += delta;
+		double p = fun.calculateValue(x);
+		(*x)[i] -= 2*delta;
+		double m = fun.calculateValue(x);
+		(*x)[i] += delta;
+		ASSERT_LE(std::abs((*dx)[i] - (p - m) / (2*delta)), 1e-3) << "at position i=" << i;
+	}//: for
+}
+
+/*!
+ * Checks whether values and gradients computed for batches of points are equal to those computed point by point.
+ * \author tkornuta
+ */
+TEST(BatchedLandscapes, EquivalenceWithSinglePoints) {
+	double eps = 1e-10;
+	mic::neural_nets::optimization::artificial_landscapes::SphereFunction<double> sphere(5);
+	mic::neural_nets::optimization::artificial_landscapes::RosenbrockFunction<double> rosenbrock(5);
+	mic::neural_nets::optimization::artificial_landscapes::Beale2DFunction<double> beale;
+	mic::neural_nets::optimization::artificial_landscapes::DifferentiableFunction<double>* funs[] = { &sphere, &rosenbrock, &beale };
+
+	for (auto fun : funs) {
+		size_t dims = fun->dimensions();
+		mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, dims, 3);
+		mic::types::MatrixPtr<double> dx = MAKE_MATRIX_PTR(double, dims, 3);
+		x->rand(-2.0, 2.0);
+		mic::types::MatrixPtr<double> values = fun->calculateValues(x);
+		fun->calculateGradients(x, dx);
+
+		mic::types::MatrixPtr<double> point = MAKE_MATRIX_PTR(double, dims, 1);
+		for (size_t c=0; c<3; c++) {
+			(*point) = x->col(c);
+			ASSERT_LE(std::abs((*values)(0, c) - fun->calculateValue(point)), eps);
+			mic::types::MatrixPtr<double> dpoint = fun->calculateGradient(point);
+			for (size_t i=0; i<dims; i++)
+				ASSERT_LE(std::abs((*dx)(i, c) - (*dpoint)[i]), eps);
+		}//: for
+	}//: for
+}
+
+
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -86,6 +86,13 @@ public:
 	}
 
 
+	/*!
+	 * Returns the number of elements of the matrices storing the state of the optimization function.
+	 */
+	size_t stateSize() {
+		return delta->size();
+	}
+
 protected:
 	/// Calculated update.
 	mic::types::MatrixPtr<eT> delta;
@@ -133,6 +133,13 @@ public:
 		return delta;
 	}
 
+	/*!
+	 * Returns the number of elements of the matrices storing the state of the optimization function.
+	 */
+	size_t stateSize() {
+		return Edx->size() + dx_prev->size() + deltaP->size() + deltaI->size() + deltaD->size() + delta->size();
+	}
+
 protected:
 
 	/// Decay ratio, similar to momentum.
@@ -332,6 +339,13 @@ public:
 //		std::cout << "-------------------" <<  std::endl;
 	}
 
+	/*!
+	 * Returns the number of elements of the matrices storing the state of the optimization function.
+	 */
+	size_t stateSize() {
+		return p_rate->size() + i_rate->size() + d_rate->size() + Edx->size() + dx_prev->size() + deltaP->size() + deltaI->size() + deltaD->size() + delta->size();
+	}
+
 protected:		// Initialize ratios and variables.
 
 	/// Decay ratio, similar to momentum.
@@ -66,6 +66,13 @@ public:
 		return delta;
 	}
 
+	/*!
+	 * Returns the number of elements of the matrices storing the state of the optimization function.
+	 */
+	size_t stateSize() {
+		return delta->size();
+	}
+
 private:
 	/// Calculated update.
 	mic::types::MatrixPtr<eT> delta;
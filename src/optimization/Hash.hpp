@@ -0,0 +1,49 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file Hash.hpp
+ * \brief Hash generating reproducible pseudo-random numbers from a seed and indices.
+ * \date Oct 18, 2026
+ */
+
+#ifndef SRC_OPTIMIZATION_HASH_HPP_
+#define SRC_OPTIMIZATION_HASH_HPP_
+
+#include <cstdint>
+
+namespace mic {
+namespace neural_nets {
+namespace optimization {
+
+/*!
+ * Mixes the seed and two indices into a pseudo-random number (splitmix64 finalizer).
+ * The result depends on the arguments only, so numbers can be generated in any order, e.g. by many threads.
+ * @param seed_ Seed.
+ * @param first_ First index (e.g. number of the step).
+ * @param second_ Second index (e.g. number of the element).
+ */
+inline uint64_t hash(uint64_t seed_, uint64_t first_, uint64_t second_) {
+	uint64_t z = seed_ + 0x9E3779B97F4A7C15ULL * (first_ + 1) + 0xBF58476D1CE4E5B9ULL * (second_ + 1);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+} //: namespace optimization
+} //: namespace neural_nets
+} //: namespace mic
+
+#endif /* SRC_OPTIMIZATION_HASH_HPP_ */
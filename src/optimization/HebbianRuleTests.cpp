@@ -29,7 +29,9 @@
 
 // Redefine word "public" so every class field/method will be accessible for tests.
 #define private public
+#define protected public
 #include <optimization/HebbianRule.hpp>
+#include <optimization/NormalizedZerosumHebbianRule.hpp>
 
 
 /*!
@@ -72,6 +74,69 @@ TEST(HebbianRule, Weight3x4Update) {
 }
 
 
+/*!
+ * Tests whether all winning patches of a filter contribute to its update (and not only the last one).
+ */
+TEST(NormalizedZerosumHebbianRule, AccumulatesAllWinners) {
+	// Three patches - filter 0 wins the first two, all filters respond equally to the third.
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 3, 3);
+	(*x) << 1, 0, 5,
+			0, 2, 5,
+			0, 0, 1;
+	mic::types::MatrixPtr<double> y = MAKE_MATRIX_PTR(double, 2, 3);
+	(*y) << 1, 3, 0.5,
+			0, 1, 0.5;
+
+	mic::neural_nets::learning::NormalizedZerosumHebbianRule<double> rule(2, 3);
+	mic::types::MatrixPtr<double> delta = rule.calculateUpdate(x, y, 0.1);
+
+	// Sum of zero-summed and normalized patches: (2,-1,-1)/sqrt(6) + (-1,2,-1)/sqrt(6), normalized and scaled.
+	double expected[] = { 0.1/std::sqrt(2.0), 0.1/std::sqrt(2.0), -0.2/std::sqrt(2.0) };
+	for (size_t i=0; i<3; i++) {
+		ASSERT_LE(std::fabs((*delta)(0, i) - expected[i] / std::sqrt(3.0)), 1e-12) << " at element i=" << i;
+		ASSERT_EQ((*delta)(1, i), 0);
+	}//: for
+}
+
+/*!
+ * Tests whether updates (including ties) are reproducible and the updated weights are normalized.
+ */
+TEST(NormalizedZerosumHebbianRule, ReproducibleUpdate) {
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 9, 200);
+	x->rand(0.0, 1.0);
+	mic::types::MatrixPtr<double> y = MAKE_MATRIX_PTR(double, 4, 200);
+	y->rand(0.0, 1.0);
+	// Ties between first two filters.
+	for (size_t i=0; i<200; i+=2)
+		(*y)(1, i) = (*y)(0, i) = 2.0;
+
+	mic::types::MatrixPtr<double> W1 = MAKE_MATRIX_PTR(double, 4, 9);
+	W1->rand(-1.0, 1.0);
+	mic::types::MatrixPtr<double> W2 = MAKE_MATRIX_PTR(double, 4, 9);
+	(*W2) = (*W1);
+
+	mic::neural_nets::learning::NormalizedZerosumHebbianRule<double> rule1(4, 9, 7);
+	mic::neural_nets::learning::NormalizedZerosumHebbianRule<double> rule2(4, 9, 7);
+	for (size_t s=0; s<3; s++) {
+		rule1.update(W1, x, y, 0.01);
+		rule2.update(W2, x, y, 0.01);
+	}//: for
+	for (size_t i=0; i< (size_t)W1->size(); i++)
+		ASSERT_EQ((*W1)[i], (*W2)[i]) << " at element i=" << i;
+	for (size_t i=0; i<4; i++)
+		ASSERT_LE(std::fabs(W1->row(i).norm() - 1.0), 1e-12);
+
+	// Ties are split between both filters.
+	size_t first = 0, second = 0;
+	for (size_t i=0; i<200; i+=2) {
+		first += (rule1.winners[i] == 0);
+		second += (rule1.winners[i] == 1);
+	}//: for
+	ASSERT_EQ(first + second, 100);
+	ASSERT_GT(first, 0);
+	ASSERT_GT(second, 0);
+}
+
 
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
@@ -68,6 +68,13 @@ public:
 		return v;
 	}
 
+	/*!
+	 * Returns the number of elements of the matrices storing the state of the optimization function.
+	 */
+	size_t stateSize() {
+		return v->size();
+	}
+
 protected:
 	/// Update vector.
 	mic::types::MatrixPtr<eT> v;
@@ -26,7 +26,12 @@
 #define NORMALIZEDZEROSUMHEBBIANRULE_HPP_
 
 #include <optimization/OptimizationFunction.hpp>
-#include <random>
+#include <optimization/Hash.hpp>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 namespace mic {
 namespace neural_nets {
@@ -44,8 +49,9 @@ public:
      * Constructor. Sets dimensions.
      * @param rows_ Number of rows of the update matrix.
      * @param cols_ Number of columns of the update matrix.
+     * @param seed_ Seed used for breaking ties between equally responding filters (default=0).
      */
-    NormalizedZerosumHebbianRule(size_t rows_, size_t cols_) {
+    NormalizedZerosumHebbianRule(size_t rows_, size_t cols_, uint64_t seed_ = 0) : seed(seed_), steps(0) {
         delta = MAKE_MATRIX_PTR(eT, rows_, cols_);
         delta->zeros();
     }
@@ -53,9 +59,19 @@ public:
     // Virtual destructor - empty.
     virtual ~NormalizedZerosumHebbianRule() { }
 
+    /*!
+     * Sets the seed used for breaking ties and restarts the sequence of updates.
+     * @param seed_ Seed.
+     */
+    void setSeed(uint64_t seed_) {
+        seed = seed_;
+        steps = 0;
+    }
 
     /*!
      * Updates the weight matrix according to the hebbian rule with normalization (l2 norm).
+     * Rows that are not updated (i.e. filters that did not win any patch) are normalized only if they are not normalized already, so they remain unchanged in the following updates.
+     * The rows changed by the last update are listed by updatedRows().
      * @param p_ Pointer to the parameter (weight) matrix.
      * @param x_ Pointer to the input data matrix.
      * @param y_ Pointer to the output data matrix.
@@ -69,18 +85,42 @@ public:
         // Calculate the update using hebbian "fire together, wire together".
         mic::types::MatrixPtr<eT> delta = calculateUpdate(x_, y_, learning_rate_);
 
-        // weight += delta;
-        (*p_) += (*delta);
-        // Eigen doesn't check for div by 0 (the doc lies...)
-        for(auto i = 0 ; i < p_->rows() ; i++){
-            if(p_->row(i).norm() != 0){
-                p_->row(i) = p_->row(i).normalized();
-            }
-        }
+        // weight += delta, followed by normalization - in a single pass over each row.
+        size_t rows = p_->rows();
+        std::vector<char> updated(rows, 0);
+        eT tolerance = std::sqrt(std::numeric_limits<eT>::epsilon());
+        #pragma omp parallel for
+        for(size_t i = 0 ; i < rows ; i++){
+            if (winning[i]) {
+                p_->row(i) += delta->row(i);
+                updated[i] = 1;
+            }//: if
+            eT norm = p_->row(i).norm();
+            // Eigen doesn't check for div by 0 (the doc lies...)
+            if ((norm == 0) || (!winning[i] && (std::abs(norm - 1) <= tolerance)))
+                continue;
+            p_->row(i) /= norm;
+            updated[i] = 1;
+        }//: for
+
+        updated_rows.clear();
+        for(size_t i = 0 ; i < rows ; i++)
+            if (updated[i])
+                updated_rows.push_back(i);
+    }
+
+    /*!
+     * Returns the indices of rows of the weight matrix changed by the last update().
+     */
+    const std::vector<size_t> & updatedRows() {
+        return updated_rows;
     }
 
     /*!
      * Calculates the update according to the hebbian rule.
+     * Every column (image patch) is assigned to the filter responding with the highest value, unless all filters respond equally.
+     * Ties between filters are broken in a pseudo-random, but reproducible way (depending on the seed, the number of the update and the column).
+     * Each filter then learns the normalized sum of all its (zero-summed and normalized) winning patches, accumulated in the order of columns.
      * @param x_ Pointer to the input data matrix.
      * @param y_ Pointer to the output data matrix.
      * @param learning_rate_ Learning rate (default=0.001).
@@ -88,40 +128,101 @@ public:
     virtual mic::types::MatrixPtr<eT> calculateUpdate(mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> y_, eT learning_rate_) {
         // delta based on winner take all: Best corresponding kernel gets to learn for each slice
         // Winner take all happens for each column of the output matrix, between the rows of the kernels matrix
-
-        // Iterate over the output columns
-        delta->zeros();
-        typename mic::types::Matrix<eT>::Index argmax, argmin;
-
-        //Randomize access to the indices of image patches
-        std::vector<typename mic::types::Matrix<eT>::Index> shuffled_indices;
-        for(auto i = 0 ; i < y_->cols() ; i++) shuffled_indices.push_back(i);
-        std::random_shuffle(std::begin(shuffled_indices), std::end(shuffled_indices));
-
-        for(auto i: shuffled_indices){
-            y_->col(i).maxCoeff(&argmax);
-            y_->col(i).minCoeff(&argmin);
-            //argmax = am(y_->col(i));
-            if(argmin != argmax){ // If all filters respond equally, then do nothing about this input patch
-                // Pick the image slice and apply it to best matching filter (ie: row of p['W'])
-                delta->row(argmax) = x_->col(i);
-                // Make the vector zero-sum
-                delta->row(argmax).array() -= delta->row(argmax).sum() / delta->cols();
-                // Eigen doesn't check for div by 0 (the doc lies...)
-                if(delta->row(argmax).norm() != 0){
-                    delta->row(argmax) = delta->row(argmax).normalized();
-                }
+        size_t filters = y_->rows();
+        size_t patches = y_->cols();
+        size_t length = x_->rows();
+
+        // Find winners of all columns.
+        winners.resize(patches);
+        const eT* yd = y_->data();
+        #pragma omp parallel for
+        for(size_t i = 0 ; i < patches ; i++) {
+            const eT* col = yd + i * filters;
+            // Column-wise max and min.
+            eT max = col[0], min = col[0];
+            for(size_t k = 1 ; k < filters ; k++) {
+                max = std::max(max, col[k]);
+                min = std::min(min, col[k]);
+            }//: for
+            // If all filters respond equally, then do nothing about this input patch
+            if (max == min) {
+                winners[i] = -1;
+                continue;
             }
-
-        }
-        (*delta) *= learning_rate_;
+            // Count the ties.
+            size_t ties = 0;
+            for(size_t k = 0 ; k < filters ; k++)
+                ties += (col[k] == max);
+            // Pick the tied filter.
+            size_t pick = (ties > 1) ? mic::neural_nets::optimization::hash(seed, steps, i) % ties : 0;
+            for(size_t k = 0 ; k < filters ; k++) {
+                if (col[k] == max) {
+                    if (pick == 0) {
+                        winners[i] = k;
+                        break;
+                    }
+                    pick--;
+                }//: if
+            }//: for
+        }//: for patches
+
+        // Accumulate patches in each filter.
+        winning.assign(filters, 0);
+        const eT* xd = x_->data();
+        #pragma omp parallel for
+        for(size_t k = 0 ; k < filters ; k++) {
+            mic::types::Matrix<eT> acc(length, 1);
+            acc.setZero();
+            for(size_t i = 0 ; i < patches ; i++) {
+                if (winners[i] != (long)k)
+                    continue;
+                // Pick the image slice and make it zero-sum and normalized.
+                Eigen::Map<const Eigen::Matrix<eT, Eigen::Dynamic, 1> > patch(xd + i * length, length);
+                eT mean = patch.mean();
+                eT norm = std::sqrt((patch.array() - mean).square().sum());
+                // Eigen doesn't check for div by 0 (the doc lies...)
+                if (norm != 0)
+                    acc.array() += (patch.array() - mean) / norm;
+            }//: for patches
+            // Apply it to the matching filter (ie: row of p['W']).
+            eT norm = acc.norm();
+            if (norm != 0) {
+                delta->row(k) = acc.transpose() * (learning_rate_ / norm);
+                winning[k] = 1;
+            } else
+                delta->row(k).setZero();
+        }//: for filters
+
+        steps++;
         return delta;
     }
 
 
+    /*!
+     * Returns the number of elements of the matrices storing the state of the optimization function.
+     */
+    size_t stateSize() {
+        return delta->size();
+    }
+
 protected:
     /// Calculated update.
     mic::types::MatrixPtr<eT> delta;
+
+    /// Filter winning for each of the columns (or -1 if all filters responded equally).
+    std::vector<long> winners;
+
+    /// Flags denoting the filters with a nonzero update (i.e. nonzero rows of delta).
+    std::vector<char> winning;
+
+    /// Rows of the weight matrix changed by the last update.
+    std::vector<size_t> updated_rows;
+
+    /// Seed used for breaking ties.
+    uint64_t seed;
+
+    /// Number of calculated updates - makes ties be broken differently in consecutive updates.
+    uint64_t steps;
 };
 
 } //: namespace learning
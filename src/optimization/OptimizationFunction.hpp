@@ -96,6 +96,11 @@ public:
 	 */
 	virtual mic::types::MatrixPtr<eT> calculateUpdate(mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> dx_, eT learning_rate_) = 0;
 
+	/*!
+	 * Abstract method returning the number of elements of the matrices storing the state of the optimization function.
+	 */
+	virtual size_t stateSize() = 0;
+
 
 
 };
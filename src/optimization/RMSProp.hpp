@@ -78,6 +78,13 @@ public:
 		return delta;
 	}
 
+	/*!
+	 * Returns the number of elements of the matrices storing the state of the optimization function.
+	 */
+	size_t stateSize() {
+		return EG->size() + delta->size();
+	}
+
 protected:
 	/// Decay ratio, similar to momentum.
 	eT decay;
@@ -77,7 +77,7 @@ mic::encoders::ColMatrixEncoder<double>* mnist_encoder;
 //mic::encoders::UIntMatrixXfEncoder* label_encoder;
 
 const size_t patch_size = 28;
-const size_t batch_size = 1;
+const size_t batch_size = 16;
 const size_t input_channels = 1;
 const size_t filter_size[] = {5};
 const size_t filters[] = {16};
@@ -103,6 +103,12 @@ void batch_function (void) {
     std::shared_ptr<mic::mlnn::experimental::ConvHebbian<double> > layer1 =
             neural_net.getLayer<mic::mlnn::experimental::ConvHebbian<double> >(0);
 
+    // Publish snapshots of activations every 10th iteration.
+    layer1->setSnapshots({ SnapshotKind::Input, SnapshotKind::Weight, SnapshotKind::Output }, 10);
+    // Snapshots of filter similarities and reconstructions, along with their latest versions passed to the windows.
+    SnapshotBuffer<double> similarity_snapshots, reconstruction_snapshots;
+    std::vector<mic::types::MatrixPtr<double> > similarity, reconstruction;
+
     size_t iteration = 0;
     // Set training parameters.
     const double learning_rate = 5e-3;
@@ -117,35 +123,38 @@ void batch_function (void) {
             if (APP_STATE->isSingleStepModeOn())
                 APP_STATE->pressPause();
 
-            { // Enter critical section - with the use of scoped lock from AppState!
-                APP_DATA_SYNCHRONIZATION_SCOPED_LOCK();
-
-                // Retrieve the next minibatch.
-                mic::types::MNISTBatch<double> bt = importer->getRandomBatch();
-
-                // Encode data.
-                mic::types::MatrixPtr<double> encoded_batch = mnist_encoder->encodeBatch(bt.data());
-
-                MNISTBatch<double> next_batch = importer->getNextBatch();
-                encoded_batch  = mnist_encoder->encodeBatch(next_batch.data());
-
-                neural_net.train(encoded_batch, learning_rate);
-
-                if (iteration % 10 == 0) {
-                    //Visualize the weights.
-                    // Set batch to be displayed.
-                    w_input->setBatchUnsynchronized(layer1->getInputActivations());
-                    w_weights1->setBatchUnsynchronized(layer1->getWeightActivations());
-                    w_similarity->setBatchUnsynchronized(layer1->getWeightSimilarity(true));
-                    w_output->setBatchUnsynchronized(layer1->getOutputActivations());
-                    w_reconstruction->setBatchUnsynchronized(layer1->getOutputReconstruction());
-                    collector_ptr->addDataToContainer("Reconstruction error", layer1->getOutputReconstructionError());
-                    LOG(LINFO) << "Iteration: " << iteration;
-                }//: if
-
-                iteration++;
-            }//: end of critical section
-
+            // Retrieve the next minibatch.
+            MNISTBatch<double> next_batch = importer->getNextBatch();
+
+            // Encode data.
+            mic::types::MatrixPtr<double> encoded_batch = mnist_encoder->encodeBatch(next_batch.data());
+
+            // All patches of the whole batch are processed at once - outside of the critical section, the visualization displays the published snapshots.
+            neural_net.train(encoded_batch, learning_rate);
+
+            // Publish snapshots - every 10th iteration (set by setSnapshots).
+            if (layer1->publishSnapshots()) {
+                similarity_snapshots.publish(layer1->getWeightSimilarity(true));
+                reconstruction_snapshots.publish(layer1->getOutputReconstruction());
+                double reconstruction_error = layer1->getOutputReconstructionError();
+
+                { // Enter critical section - with the use of scoped lock from AppState!
+                    APP_DATA_SYNCHRONIZATION_SCOPED_LOCK();
+
+                    // Set batches to be displayed.
+                    w_input->setBatchUnsynchronized(layer1->getSnapshot(SnapshotKind::Input));
+                    w_weights1->setBatchUnsynchronized(layer1->getSnapshot(SnapshotKind::Weight));
+                    similarity_snapshots.read(similarity);
+                    w_similarity->setBatchUnsynchronized(similarity);
+                    w_output->setBatchUnsynchronized(layer1->getSnapshot(SnapshotKind::Output));
+                    reconstruction_snapshots.read(reconstruction);
+                    w_reconstruction->setBatchUnsynchronized(reconstruction);
+                    collector_ptr->addDataToContainer("Reconstruction error", reconstruction_error);
+                }//: end of critical section
+                LOG(LINFO) << "Iteration: " << iteration;
+            }//: if
+
+            iteration++;
         }//: if
 
         // Sleep.
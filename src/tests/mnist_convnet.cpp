@@ -29,12 +29,43 @@ using namespace mic::logger;
 #include <encoders/UIntMatrixXfEncoder.hpp>
 
 #include <mlnn/BackpropagationNeuralNetwork.hpp>
+#include <mlnn/ShardedEvaluator.hpp>
 
 using namespace mic::types;
 // Using multi layer neural networks
 using namespace mic::mlnn;
 using namespace mic::mlnn::convolution;
 
+/*!
+ * Builds the convolutional network - used both for the trained network and its copies evaluating the datasets.
+ * @param nn_ Network.
+ */
+void buildConvNet(BackpropagationNeuralNetwork<float> & nn_) {
+	// Convolution 1
+	nn_.pushLayer(new mic::mlnn::convolution::Cropping<float>(28, 28, 1, 1));
+	nn_.pushLayer(new mic::mlnn::convolution::Convolution<float>(26, 26, 1, 16, 3, 1));
+	nn_.pushLayer(new ELU<float>(24, 24, 16));
+	nn_.pushLayer(new mic::mlnn::convolution::MaxPooling<float>(24, 24, 16, 2));
+
+	// Convolution 2
+	nn_.pushLayer(new mic::mlnn::convolution::Convolution<float>(12, 12, 16, 32, 3, 1));
+	nn_.pushLayer(new ELU<float>(10, 10, 32));
+	nn_.pushLayer(new mic::mlnn::convolution::MaxPooling<float>(10, 10, 32, 2));
+
+	// Linear + dropout
+	nn_.pushLayer(new Linear<float>(5, 5, 32, 100, 1, 1));
+	nn_.pushLayer(new ELU<float>(100, 1, 1));
+	nn_.pushLayer(new Dropout<float>(100, 0.5f));
+
+	// Softmax
+	nn_.pushLayer(new Linear<float>(100, 10));
+	nn_.pushLayer(new Softmax<float>(10));
+	if (!nn_.verify())
+		exit(-1);
+	// Let the first convolution crop its inputs by itself.
+	nn_.absorbBorders();
+}
+
 int main() {
 	// Task parameters.
 	size_t 	epochs = 100;
@@ -76,28 +107,7 @@ int main() {
 
 	// Neural net.
 	BackpropagationNeuralNetwork<float> nn("ConvNet");
-
-	// Convolution 1
-	nn.pushLayer(new mic::mlnn::convolution::Cropping<float>(28, 28, 1, 1));
-	nn.pushLayer(new mic::mlnn::convolution::Convolution<float>(26, 26, 1, 16, 3, 1));
-	nn.pushLayer(new ELU<float>(24, 24, 16));
-	nn.pushLayer(new mic::mlnn::convolution::MaxPooling<float>(24, 24, 16, 2));
-
-	// Convolution 2
-	nn.pushLayer(new mic::mlnn::convolution::Convolution<float>(12, 12, 16, 32, 3, 1));
-	nn.pushLayer(new ELU<float>(10, 10, 32));
-	nn.pushLayer(new mic::mlnn::convolution::MaxPooling<float>(10, 10, 32, 2));
-
-	// Linear + dropout
-	nn.pushLayer(new Linear<float>(5, 5, 32, 100, 1, 1));
-	nn.pushLayer(new ELU<float>(100, 1, 1));
-	nn.pushLayer(new Dropout<float>(100, 0.5f));
-
-	// Softmax
-	nn.pushLayer(new Linear<float>(100, 10));
-	nn.pushLayer(new Softmax<float>(10));
-	if (!nn.verify())
-		exit(-1);
+	buildConvNet(nn);
 
 	// Set batch size.
 	nn.resizeBatch(batch_size);
@@ -110,6 +120,9 @@ int main() {
 	double 	weight_decay = 1e-5;
 	size_t iterations = training.size() / batch_size;
 
+	// Evaluator of the datasets.
+	ShardedEvaluator<float> evaluator(buildConvNet, 10);
+
 	MatrixXfPtr encoded_batch, encoded_targets;
 	// For all epochs.
 	for (size_t e = 0; e < epochs; e++) {
@@ -133,41 +146,18 @@ int main() {
 
 		LOG(LSTATUS) << "Training finished";
 
-		// Check performance on the test dataset.
+		// Check performance on the test dataset - in batches of 1000 samples sharded across all threads.
 		LOG(LSTATUS) << "Calculating performance for test dataset...";
-		size_t correct = 0;
-		test.setNextSampleIndex(0);
-		while(!test.isLastBatch()) {
-
-			// Get next batch [784 x batch_size].
-            MNISTBatch<float> next_batch = test.getNextBatch();
-			encoded_batch  = mnist_encoder.encodeBatch(next_batch.data());
-			encoded_targets  = label_encoder.encodeBatch(next_batch.labels());
-
-			// Test network response.
-			correct += nn.test(encoded_batch, encoded_targets);
-
-		}
-		double test_acc = (double)correct / (double)(test.size());
-		LOG(LINFO) << "Test accuracy  : " << std::setprecision(3) << 100.0 * test_acc << " %";
+		EvaluationResults test_results = evaluator.evaluate(nn, test.data(), test.labels());
+		LOG(LINFO) << "Test accuracy  : " << std::setprecision(3) << 100.0 * test_results.accuracy() << " % (top-" << test_results.top_k << ": "
+				<< 100.0 * test_results.topKAccuracy() << " %, loss = " << test_results.loss << ")";
+		LOG(LINFO) << "Test confusion matrix:\n" << test_results.confusion;
 
 		// Check performance on the training dataset.
 		LOG(LSTATUS) << "Calculating performance for the training dataset...";
-		correct = 0;
-		training.setNextSampleIndex(0);
-		while(!training.isLastBatch()) {
-
-			// Get next batch [784 x batch_size].
-            MNISTBatch<float> next_batch = training.getNextBatch();
-			encoded_batch  = mnist_encoder.encodeBatch(next_batch.data());
-			encoded_targets  = label_encoder.encodeBatch(next_batch.labels());
-
-			// Test network response.
-			correct += nn.test(encoded_batch, encoded_targets);
-
-		}
-		double train_acc = (double)correct / (double)(training.size());
-		LOG(LINFO) << "Trainin accuracy : " << std::setprecision(3) << 100.0 * train_acc << " %";
+		EvaluationResults train_results = evaluator.evaluate(nn, training.data(), training.labels());
+		LOG(LINFO) << "Trainin accuracy : " << std::setprecision(3) << 100.0 * train_results.accuracy() << " % (top-" << train_results.top_k << ": "
+				<< 100.0 * train_results.topKAccuracy() << " %, loss = " << train_results.loss << ")";
 
 	}//: for epoch
 
@@ -113,6 +113,21 @@ void batch_function (void) {
 
 	size_t iteration = 0;
 
+	// Layers that will be visualized - they publish snapshots every 10th iteration.
+	std::shared_ptr<mic::mlnn::convolution::Convolution<float> > conv1 =
+			neural_net.getLayer<mic::mlnn::convolution::Convolution<float> >(1);
+	std::shared_ptr<mic::mlnn::convolution::Convolution<float> > conv2 =
+			neural_net.getLayer<mic::mlnn::convolution::Convolution<float> >(4);
+	std::shared_ptr<mic::mlnn::fully_connected::Linear<float> > lin1 =
+			neural_net.getLayer<mic::mlnn::fully_connected::Linear<float> >(7);
+	std::shared_ptr<Layer<float> > sm1 = neural_net.getLayer(8);
+	std::vector<SnapshotKind> all_kinds = { SnapshotKind::Input, SnapshotKind::InputGradient, SnapshotKind::Weight,
+			SnapshotKind::WeightGradient, SnapshotKind::Output, SnapshotKind::OutputGradient };
+	conv1->setSnapshots(all_kinds, 10);
+	conv2->setSnapshots(all_kinds, 10);
+	lin1->setSnapshots({ SnapshotKind::Input, SnapshotKind::InputGradient, SnapshotKind::Weight, SnapshotKind::WeightGradient }, 10);
+	sm1->setSnapshots({ SnapshotKind::Output, SnapshotKind::OutputGradient }, 10);
+
 	// Retrieve the next minibatch.
 	//mic::types::MNISTBatch bt = importer->getNextBatch();
 	//importer->setNextSampleIndex(5);
@@ -127,101 +142,76 @@ void batch_function (void) {
 			if (APP_STATE->isSingleStepModeOn())
 				APP_STATE->pressPause();
 
-			{ // Enter critical section - with the use of scoped lock from AppState!
+			// Retrieve the next minibatch.
+			mic::types::MNISTBatch<float> bt = importer->getRandomBatch();
+
+			// Encode data.
+			mic::types::MatrixXfPtr encoded_batch = mnist_encoder->encodeBatch(bt.data());
+			mic::types::MatrixXfPtr encoded_labels = label_encoder->encodeBatch(bt.labels());
+
+			// Train the network - outside of the critical section, the visualization displays the published snapshots.
+			float loss = neural_net.train (encoded_batch, encoded_labels, 0.001, 0.0001);
+
+			// Publish snapshots of activations - every 10th iteration (set by setSnapshots).
+			bool published = conv1->publishSnapshots();
+			conv2->publishSnapshots();
+			lin1->publishSnapshots();
+			sm1->publishSnapshots();
+
+			if (published) { // Enter critical section - with the use of scoped lock from AppState!
 				APP_DATA_SYNCHRONIZATION_SCOPED_LOCK();
 
-				// Retrieve the next minibatch.
-				mic::types::MNISTBatch<float> bt = importer->getRandomBatch();
-
-				// Encode data.
-				mic::types::MatrixXfPtr encoded_batch = mnist_encoder->encodeBatch(bt.data());
-				mic::types::MatrixXfPtr encoded_labels = label_encoder->encodeBatch(bt.labels());
-
-/*				mic::types::MatrixPtr<float> encoded_batch = MAKE_MATRIX_PTR(float, patch_size*patch_size, 1);
-				for (size_t i=0; i<patch_size*patch_size; i++)
-					(*encoded_batch)[i]= 1.0 -(float)i/(patch_size*patch_size);*/
-				/*mic::types::MatrixPtr<float> encoded_labels = MAKE_MATRIX_PTR(float, output_size, 1);
-				encoded_labels->setZero();
-				(*encoded_labels)[0]= 1.0;*/
-				/*(*encoded_labels)[6]= 1.0;
-				(*encoded_labels)[9]= 1.0;
-				(*encoded_labels)[15]= 1.0;*/
-
-				// Train the autoencoder.
-				float loss = neural_net.train (encoded_batch, encoded_labels, 0.001, 0.0001);
-
-				// Get reconstruction.
-				/*mic::types::MatrixXfPtr encoded_reconstruction = neural_net.getPredictions();
-				std::vector<mic::types::MatrixXfPtr> decoded_reconstruction = mnist_encoder->decodeBatch(encoded_reconstruction);
-				w_reconstruction->setBatchUnsynchronized(decoded_reconstruction);*/
-
-				if (iteration%10 == 0) {
-					// Visualize the weights.
-					//std::shared_ptr<Layer<float> > layer1 = neural_net.getLayer(3);
-
-					std::shared_ptr<mic::mlnn::convolution::Convolution<float> > conv1 =
-							neural_net.getLayer<mic::mlnn::convolution::Convolution<float> >(1);
-					w_conv10->setBatchUnsynchronized(conv1->getInputActivations());
-					w_conv11->setBatchUnsynchronized(conv1->getInputGradientActivations());
-					w_conv12->setBatchUnsynchronized(conv1->getWeightActivations());
-					w_conv13->setBatchUnsynchronized(conv1->getWeightGradientActivations());
-					w_conv14->setBatchUnsynchronized(conv1->getOutputActivations());
-                    w_conv15->setBatchUnsynchronized(conv1->getOutputGradientActivations());
-
-					// Similarity.
-					mic::types::MatrixPtr<float> similarity = conv1->getFilterSimilarityMatrix();
-					w_conv16->setSampleUnsynchronized(similarity);
-
-					float max_similarity = 0;
-					float mean_similarity = 0;
-					for (size_t i=0; i<9; i++)
-						for (size_t j=0; j<i; j++) {
-							std::string label = "Similarity " + std::to_string(i) + "-" +std::to_string(j);
-							collector_ptr->addDataToContainer(label, (*similarity)(i,j));
-							mean_similarity += (*similarity)(i,j);
-							max_similarity = ((*similarity)(i,j) > max_similarity) ? (*similarity)(i,j) : max_similarity;
-						}//: for
-
-					collector_ptr->addDataToContainer("Similarity max", max_similarity);
-					mean_similarity /= (1+2+3+4+5+6+7+8);
-					collector_ptr->addDataToContainer("Similarity mean", mean_similarity);
-
-
-					std::shared_ptr<mic::mlnn::convolution::Convolution<float> > conv2 =
-							neural_net.getLayer<mic::mlnn::convolution::Convolution<float> >(4);
-					w_conv20->setBatchUnsynchronized(conv2->getInputActivations());
-					w_conv21->setBatchUnsynchronized(conv2->getInputGradientActivations());
-					w_conv22->setBatchUnsynchronized(conv2->getWeightActivations());
-					w_conv23->setBatchUnsynchronized(conv2->getWeightGradientActivations());
-					w_conv24->setBatchUnsynchronized(conv2->getOutputActivations());
-					w_conv25->setBatchUnsynchronized(conv2->getOutputGradientActivations());
-
-					std::shared_ptr<mic::mlnn::fully_connected::Linear<float> > lin1 =
-							neural_net.getLayer<mic::mlnn::fully_connected::Linear<float> >(7);
-					w_conv30->setBatchUnsynchronized(lin1->getInputActivations());
-					w_conv31->setBatchUnsynchronized(lin1->getInputGradientActivations());
-					w_conv32->setBatchUnsynchronized(lin1->getWeightActivations());
-					w_conv33->setBatchUnsynchronized(lin1->getWeightGradientActivations());
-
-					std::shared_ptr<Layer<float> > sm1 = neural_net.getLayer(7);
-					w_conv34->setBatchUnsynchronized(sm1->getOutputActivations());
-					w_conv35->setBatchUnsynchronized(sm1->getOutputGradientActivations());
-
-					// Add data to chart window.
-					collector_ptr->addDataToContainer("Loss", loss);
-					//float reconstruction_error = neural_net.getLayer<mic::mlnn::fully_connected::Linear<float> >(1)->calculateMeanReconstructionError();
-					//collector_ptr->addDataToContainer("Reconstruction Error", reconstruction_error);
-
-					// Export to file.
-					collector_ptr->exportDataToCsv(convnet_log);
-				}//: if
-
-				iteration++;
-				//float reconstruction_error = neural_net.getLayer<mic::mlnn::fully_connected::Linear<float> >(1)->calculateMeanReconstructionError();
-
-				LOG(LINFO) << "Iteration: " << iteration << " loss =" << loss;// << " reconstruction error =" << reconstruction_error;
+				// Pass the latest snapshots to the windows.
+				w_conv10->setBatchUnsynchronized(conv1->getSnapshot(SnapshotKind::Input));
+				w_conv11->setBatchUnsynchronized(conv1->getSnapshot(SnapshotKind::InputGradient));
+				w_conv12->setBatchUnsynchronized(conv1->getSnapshot(SnapshotKind::Weight));
+				w_conv13->setBatchUnsynchronized(conv1->getSnapshot(SnapshotKind::WeightGradient));
+				w_conv14->setBatchUnsynchronized(conv1->getSnapshot(SnapshotKind::Output));
+				w_conv15->setBatchUnsynchronized(conv1->getSnapshot(SnapshotKind::OutputGradient));
+
+				// Similarity.
+				mic::types::MatrixPtr<float> similarity = conv1->getFilterSimilarityMatrix();
+				w_conv16->setSampleUnsynchronized(similarity);
+
+				float max_similarity = 0;
+				float mean_similarity = 0;
+				for (size_t i=0; i<9; i++)
+					for (size_t j=0; j<i; j++) {
+						std::string label = "Similarity " + std::to_string(i) + "-" +std::to_string(j);
+						collector_ptr->addDataToContainer(label, (*similarity)(i,j));
+						mean_similarity += (*similarity)(i,j);
+						max_similarity = ((*similarity)(i,j) > max_similarity) ? (*similarity)(i,j) : max_similarity;
+					}//: for
+
+				collector_ptr->addDataToContainer("Similarity max", max_similarity);
+				mean_similarity /= (1+2+3+4+5+6+7+8);
+				collector_ptr->addDataToContainer("Similarity mean", mean_similarity);
+
+				w_conv20->setBatchUnsynchronized(conv2->getSnapshot(SnapshotKind::Input));
+				w_conv21->setBatchUnsynchronized(conv2->getSnapshot(SnapshotKind::InputGradient));
+				w_conv22->setBatchUnsynchronized(conv2->getSnapshot(SnapshotKind::Weight));
+				w_conv23->setBatchUnsynchronized(conv2->getSnapshot(SnapshotKind::WeightGradient));
+				w_conv24->setBatchUnsynchronized(conv2->getSnapshot(SnapshotKind::Output));
+				w_conv25->setBatchUnsynchronized(conv2->getSnapshot(SnapshotKind::OutputGradient));
+
+				w_conv30->setBatchUnsynchronized(lin1->getSnapshot(SnapshotKind::Input));
+				w_conv31->setBatchUnsynchronized(lin1->getSnapshot(SnapshotKind::InputGradient));
+				w_conv32->setBatchUnsynchronized(lin1->getSnapshot(SnapshotKind::Weight));
+				w_conv33->setBatchUnsynchronized(lin1->getSnapshot(SnapshotKind::WeightGradient));
+
+				w_conv34->setBatchUnsynchronized(sm1->getSnapshot(SnapshotKind::Output));
+				w_conv35->setBatchUnsynchronized(sm1->getSnapshot(SnapshotKind::OutputGradient));
+
+				// Add data to chart window.
+				collector_ptr->addDataToContainer("Loss", loss);
+
+				// Export to file.
+				collector_ptr->exportDataToCsv(convnet_log);
 			}//: end of critical section
 
+			iteration++;
+			LOG(LINFO) << "Iteration: " << iteration << " loss =" << loss;
+
 		}//: if
 
 		// Sleep.
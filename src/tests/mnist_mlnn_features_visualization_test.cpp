@@ -108,6 +108,15 @@ void batch_function (void) {
 
 	size_t iteration = 0;
 
+	// Visualized layer - publishes snapshots every 10th iteration.
+	std::shared_ptr<mic::mlnn::fully_connected::Linear<float> > lin1 =
+			neural_net.getLayer<mic::mlnn::fully_connected::Linear<float> >(1);
+	lin1->setSnapshots({ SnapshotKind::Input, SnapshotKind::InputGradient, SnapshotKind::Weight,
+			SnapshotKind::WeightGradient, SnapshotKind::Output, SnapshotKind::OutputGradient }, 10);
+	// Snapshots of inverse activations, along with their latest versions passed to the windows.
+	SnapshotBuffer<float> inverse_w_snapshots, inverse_y_snapshots;
+	std::vector<mic::types::MatrixPtr<float> > inverse_w, inverse_y;
+
 	// Retrieve the next minibatch.
 	//mic::types::MNISTBatch bt = importer->getNextBatch();
 	//importer->setNextSampleIndex(5);
@@ -122,48 +131,46 @@ void batch_function (void) {
 			if (APP_STATE->isSingleStepModeOn())
 				APP_STATE->pressPause();
 
-			{ // Enter critical section - with the use of scoped lock from AppState!
-				APP_DATA_SYNCHRONIZATION_SCOPED_LOCK();
-
-				// Retrieve the next minibatch.
-				mic::types::MNISTBatch<float> bt = importer->getRandomBatch();
+			// Retrieve the next minibatch.
+			mic::types::MNISTBatch<float> bt = importer->getRandomBatch();
 
-				// Encode data.
-				mic::types::MatrixXfPtr encoded_batch = mnist_encoder->encodeBatch(bt.data());
-				mic::types::MatrixXfPtr encoded_labels = label_encoder->encodeBatch(bt.labels());
+			// Encode data.
+			mic::types::MatrixXfPtr encoded_batch = mnist_encoder->encodeBatch(bt.data());
+			mic::types::MatrixXfPtr encoded_labels = label_encoder->encodeBatch(bt.labels());
 
-				// Train the autoencoder.
-				float loss = neural_net.train (encoded_batch, encoded_batch, 0.001, 0.0001);
+			// Train the autoencoder - outside of the critical section, the visualization displays the published snapshots.
+			float loss = neural_net.train (encoded_batch, encoded_batch, 0.001, 0.0001);
 
-				if (iteration%10 == 0) {
+			// Publish snapshots of activations - every 10th iteration (set by setSnapshots).
+			if (lin1->publishSnapshots()) {
+				inverse_w_snapshots.publish(lin1->getInverseWeightActivations());
+				inverse_y_snapshots.publish(lin1->getInverseOutputActivations());
+				float reconstruction_error = lin1->calculateMeanReconstructionError();
 
-					std::shared_ptr<mic::mlnn::fully_connected::Linear<float> > lin1 =
-							neural_net.getLayer<mic::mlnn::fully_connected::Linear<float> >(1);
-					w_conv10->setBatchUnsynchronized(lin1->getInputActivations());
-					w_conv11->setBatchUnsynchronized(lin1->getInputGradientActivations());
-					w_conv12->setBatchUnsynchronized(lin1->getWeightActivations());
-					w_conv13->setBatchUnsynchronized(lin1->getWeightGradientActivations());
-					w_conv14->setBatchUnsynchronized(lin1->getOutputActivations());
-					w_conv15->setBatchUnsynchronized(lin1->getOutputGradientActivations());
+				{ // Enter critical section - with the use of scoped lock from AppState!
+					APP_DATA_SYNCHRONIZATION_SCOPED_LOCK();
 
-					w_conv20->setBatchUnsynchronized(lin1->getInverseWeightActivations());
-					w_conv21->setBatchUnsynchronized(lin1->getInverseOutputActivations());
+					// Pass the latest snapshots to the windows.
+					w_conv10->setBatchUnsynchronized(lin1->getSnapshot(SnapshotKind::Input));
+					w_conv11->setBatchUnsynchronized(lin1->getSnapshot(SnapshotKind::InputGradient));
+					w_conv12->setBatchUnsynchronized(lin1->getSnapshot(SnapshotKind::Weight));
+					w_conv13->setBatchUnsynchronized(lin1->getSnapshot(SnapshotKind::WeightGradient));
+					w_conv14->setBatchUnsynchronized(lin1->getSnapshot(SnapshotKind::Output));
+					w_conv15->setBatchUnsynchronized(lin1->getSnapshot(SnapshotKind::OutputGradient));
 
-					/*std::shared_ptr<Layer<float> > sm1 = neural_net.getLayer(2);
-					w_conv34->setBatchUnsynchronized(sm1->getOutputActivations());
-					w_conv35->setBatchUnsynchronized(sm1->getOutputGradientActivations());*/
+					inverse_w_snapshots.read(inverse_w);
+					w_conv20->setBatchUnsynchronized(inverse_w);
+					inverse_y_snapshots.read(inverse_y);
+					w_conv21->setBatchUnsynchronized(inverse_y);
 
 					// Add data to chart window.
 					collector_ptr->addDataToContainer("Loss", loss);
-					float reconstruction_error = neural_net.getLayer<mic::mlnn::fully_connected::Linear<float> >(1)->calculateMeanReconstructionError();
 					collector_ptr->addDataToContainer("Reconstruction Error", reconstruction_error);
-				}//: if
-
-				iteration++;
-				//float reconstruction_error = neural_net.getLayer<mic::mlnn::fully_connected::Linear<float> >(1)->calculateMeanReconstructionError();
+				}//: end of critical section
+			}//: if
 
-				LOG(LINFO) << "Iteration: " << iteration << " loss =" << loss;// << " reconstruction error =" << reconstruction_error;
-			}//: end of critical section
+			iteration++;
+			LOG(LINFO) << "Iteration: " << iteration << " loss =" << loss;
 
 		}//: if
 
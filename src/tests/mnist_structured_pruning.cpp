@@ -0,0 +1,164 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file mnist_structured_pruning.cpp
+ * \brief Application shrinking a multi-layer neural network trained on MNIST digits by structured pruning of its hidden layers,
+ * reporting the accuracy and latency before and after pruning.
+ * \date Oct 18, 2026
+ */
+
+#include <logger/Log.hpp>
+#include <logger/ConsoleOutput.hpp>
+using namespace mic::logger;
+
+#include <chrono>
+#include <iomanip>
+
+#include <data_io/MNISTMatrixImporter.hpp>
+#include <encoders/MatrixXfMatrixXfEncoder.hpp>
+#include <encoders/UIntMatrixXfEncoder.hpp>
+
+#include <mlnn/BackpropagationNeuralNetwork.hpp>
+
+// Using multi layer neural networks
+using namespace mic::mlnn;
+using namespace mic::types;
+
+/*!
+ * Calculates the accuracy and the mean latency of a forward pass (per batch) on the whole dataset.
+ */
+void evaluate(BackpropagationNeuralNetwork<float> & nn_, mic::data_io::MNISTMatrixImporter<float> & dataset_,
+		mic::encoders::MatrixXfMatrixXfEncoder & mnist_encoder_, mic::encoders::UIntMatrixXfEncoder & label_encoder_, std::string label_) {
+	size_t correct = 0;
+	size_t batches = 0;
+	double seconds = 0.0;
+	dataset_.setNextSampleIndex(0);
+	while(!dataset_.isLastBatch()) {
+		// Get next batch [784 x batch_size].
+		MNISTBatch<float> next_batch = dataset_.getNextBatch();
+		MatrixXfPtr encoded_batch  = mnist_encoder_.encodeBatch(next_batch.data());
+		MatrixXfPtr encoded_targets  = label_encoder_.encodeBatch(next_batch.labels());
+
+		// Measure only the forward pass - skip dropout layers at test time.
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		nn_.forward(encoded_batch, true);
+		seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		batches++;
+
+		correct += nn_.countCorrectPredictions(encoded_targets, nn_.getPredictions());
+	}//: while
+
+	LOG(LINFO) << label_ << ": accuracy = " << std::setprecision(4) << 100.0 * correct / dataset_.size() << " %, latency = "
+			<< std::setprecision(4) << 1000.0 * seconds / batches << " ms/batch";
+}
+
+/*!
+ * Trains the network for a given number of iterations.
+ */
+void train(BackpropagationNeuralNetwork<float> & nn_, mic::data_io::MNISTMatrixImporter<float> & dataset_,
+		mic::encoders::MatrixXfMatrixXfEncoder & mnist_encoder_, mic::encoders::UIntMatrixXfEncoder & label_encoder_, size_t iterations_, float learning_rate_) {
+	for (size_t ii = 0; ii < iterations_; ii++) {
+		// Get random batch [784 x batch_size].
+		MNISTBatch<float> rand_batch = dataset_.getRandomBatch();
+		MatrixXfPtr encoded_batch  = mnist_encoder_.encodeBatch(rand_batch.data());
+		MatrixXfPtr encoded_targets  = label_encoder_.encodeBatch(rand_batch.labels());
+
+		float loss = nn_.train (encoded_batch, encoded_targets, learning_rate_);
+		if (ii % 500 == 0)
+			LOG(LINFO) << "Batch " << std::setw(4) << ii << "/" << std::setw(4) << iterations_ << ": loss = " << std::setprecision(8) << loss;
+	}//: for
+}
+
+int main() {
+	// Task parameters.
+	size_t batch_size = 20;
+	size_t iterations = 60000/batch_size;
+	float learning_rate = 0.001;
+	// Fraction of neurons of the hidden layers that will be kept.
+	float keep_ratio = 0.25;
+
+	// Set console output.
+	LOGGER->addOutput(new ConsoleOutput());
+
+	//[60000, 784]
+	// Load the MNIST training...
+	mic::data_io::MNISTMatrixImporter<float> training;
+	// Manually set paths. DEPRICATED! Used here only for simplification of the test.
+	training.setDataFilename("../data/mnist/train-images.idx3-ubyte");
+	training.setLabelsFilename("../data/mnist/train-labels.idx1-ubyte");
+	training.setBatchSize(batch_size);
+
+	if (!training.importData())
+		return -1;
+
+	// ... and test datasets.
+	mic::data_io::MNISTMatrixImporter<float> test;
+	// Manually set paths. DEPRICATED! Used here only for simplification of the test.
+	test.setDataFilename("../data/mnist/t10k-images.idx3-ubyte");
+	test.setLabelsFilename("../data/mnist/t10k-labels.idx1-ubyte");
+	test.setBatchSize(batch_size);
+
+	if (!test.importData())
+		return -1;
+
+	// Initialize the encoders.
+	mic::encoders::MatrixXfMatrixXfEncoder mnist_encoder(28, 28);
+	mic::encoders::UIntMatrixXfEncoder label_encoder(10);
+
+	// Load the previously trained network - or train a new one.
+	//MNIST - 28x28 -> 256 -> 100 -> 10
+	BackpropagationNeuralNetwork<float> nn("3layerReLUSofmax");
+	if (!nn.load("mnist_pruning_base")) {
+		nn.pushLayer(new Linear<float>(28 * 28, 256));
+		nn.pushLayer(new ReLU<float>(256));
+		nn.pushLayer(new Linear<float>(256, 100));
+		nn.pushLayer(new ReLU<float>(100));
+		nn.pushLayer(new Linear<float>(100, 10));
+		nn.pushLayer(new Softmax<float>(10));
+		if (!nn.verify())
+			return -1;
+		nn.setOptimization<mic::neural_nets::optimization::Adam<float> >();
+
+		LOG(LSTATUS) << "Starting the training of neural network...";
+		train(nn, training, mnist_encoder, label_encoder, iterations, learning_rate);
+		nn.save("mnist_pruning_base");
+	}//: if
+	nn.resizeBatch(batch_size);
+
+	LOG(LSTATUS) << "Calculating performance of the original network...";
+	evaluate(nn, test, mnist_encoder, label_encoder, "Original");
+
+	// Rank neurons by their mean activations on a training batch.
+	MNISTBatch<float> rand_batch = training.getRandomBatch();
+	nn.forward(mnist_encoder.encodeBatch(rand_batch.data()), true);
+	size_t removed = nn.pruneUnits(0, keep_ratio * nn.getLayer(0)->outputSize(), PruningCriterion::MeanActivation);
+	// The second hidden layer is ranked on the activations of the already pruned network.
+	nn.forward(mnist_encoder.encodeBatch(rand_batch.data()), true);
+	removed += nn.pruneUnits(2, keep_ratio * nn.getLayer(2)->outputSize(), PruningCriterion::MeanActivation);
+	LOG(LSTATUS) << "Removed " << removed << " neurons";
+	if (!nn.verify())
+		return -1;
+	evaluate(nn, test, mnist_encoder, label_encoder, "Pruned");
+
+	// Fine-tune the pruned network.
+	LOG(LSTATUS) << "Fine-tuning the pruned network...";
+	nn.setOptimization<mic::neural_nets::optimization::Adam<float> >();
+	train(nn, training, mnist_encoder, label_encoder, iterations / 5, learning_rate);
+	evaluate(nn, test, mnist_encoder, label_encoder, "Fine-tuned");
+
+	// The pruned network consists of ordinary (smaller) layers.
+	nn.save("mnist_pruned");
+}
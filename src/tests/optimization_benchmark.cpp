@@ -0,0 +1,196 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file optimization_benchmark.cpp
+ * \brief Benchmark of optimization functions on n-dimensional artificial landscapes.
+ * Every optimization function is run from a batch of random starting points (columns of a single matrix - the optimization functions operate elementwise),
+ * measuring iterations needed to reach the tolerance, wall time of a step and memory used by the state of the optimization function per parameter.
+ * Usage: optimization_benchmark [dims] [starts] [max_iterations] [tolerance] [output_prefix]
+ * \date Oct 18, 2026
+ */
+
+#include <logger/Log.hpp>
+#include <logger/ConsoleOutput.hpp>
+using namespace mic::logger;
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <optimization/ArtificialLandscapes.hpp>
+#include <optimization/GradientDescent.hpp>
+#include <optimization/Momentum.hpp>
+#include <optimization/AdaGrad.hpp>
+#include <optimization/RMSProp.hpp>
+#include <optimization/AdaDelta.hpp>
+#include <optimization/Adam.hpp>
+#include <optimization/GradPID.hpp>
+#include <optimization/AdamID.hpp>
+
+using namespace mic::neural_nets::optimization;
+using namespace mic::neural_nets::optimization::artificial_landscapes;
+
+/// Type of the function creating the optimization function for a matrix of parameters of a given size.
+typedef std::function<std::shared_ptr<OptimizationFunction<float> > (size_t, size_t)> OptimizationFunctionFactory;
+
+/// Number of iterations between consecutive points of the curves.
+const size_t log_interval = 10;
+
+/*!
+ * Runs a given optimization function on a given landscape, starting from a batch of random points.
+ * @param landscape_name_ Name of the landscape.
+ * @param fun_ Landscape.
+ * @param optimizer_name_ Name of the optimization function.
+ * @param factory_ Function creating the optimization function.
+ * @param learning_rate_ Learning rate.
+ * @param starts_ Number of random starting points.
+ * @param max_iterations_ Maximal number of iterations.
+ * @param tolerance_ Tolerance of the value of the function (relative to the minimum and divided by the number of dimensions).
+ * @param curves_ Stream the curves (mean/min/max values in consecutive iterations) are written to.
+ * @param summary_ Stream the summary is written to.
+ */
+void benchmark(const std::string & landscape_name_, DifferentiableFunction<float> & fun_, const std::string & optimizer_name_, OptimizationFunctionFactory factory_,
+		float learning_rate_, size_t starts_, size_t max_iterations_, double tolerance_, std::ofstream & curves_, std::ofstream & summary_) {
+	size_t dims = fun_.dimensions();
+
+	// Random starting points around the minimum - the same for all optimization functions.
+	std::mt19937 generator(1234);
+	std::uniform_real_distribution<float> distribution(-2.0f, 2.0f);
+	mic::types::MatrixPtr<float> x = MAKE_MATRIX_PTR(float, dims, starts_);
+	mic::types::MatrixPtr<float> dx = MAKE_MATRIX_PTR(float, dims, starts_);
+	for (size_t s=0; s<starts_; s++)
+		for (size_t i=0; i<dims; i++)
+			(*x)(i, s) = (*fun_.minArguments())[i] + distribution(generator);
+
+	// Create the optimization function - the memory used by its state is given by the sizes of its state matrices.
+	std::shared_ptr<OptimizationFunction<float> > opt = factory_(dims, starts_);
+	double bytes_per_parameter = (double)(opt->stateSize() * sizeof(float)) / (dims * starts_);
+
+	std::vector<size_t> iterations_to_tolerance(starts_, 0);
+	double step_time = 0.0, update_time = 0.0;
+	size_t iteration = 0;
+	mic::types::MatrixPtr<float> values = fun_.calculateValues(x);
+	while (iteration < max_iterations_) {
+		iteration++;
+
+		std::chrono::high_resolution_clock::time_point step_start = std::chrono::high_resolution_clock::now();
+		fun_.calculateGradients(x, dx);
+		std::chrono::high_resolution_clock::time_point update_start = std::chrono::high_resolution_clock::now();
+		opt->update(x, dx, learning_rate_);
+		std::chrono::high_resolution_clock::time_point step_end = std::chrono::high_resolution_clock::now();
+		step_time += std::chrono::duration<double, std::micro>(step_end - step_start).count();
+		update_time += std::chrono::duration<double, std::micro>(step_end - update_start).count();
+
+		// Check which starts have reached the tolerance - and whether there is any point in continuing.
+		values = fun_.calculateValues(x);
+		bool active = false;
+		for (size_t s=0; s<starts_; s++) {
+			double error = ((double)(*values)(0, s) - fun_.minValue()) / dims;
+			if ((iterations_to_tolerance[s] == 0) && (error < tolerance_))
+				iterations_to_tolerance[s] = iteration;
+			if ((iterations_to_tolerance[s] == 0) && std::isfinite(error))
+				active = true;
+		}//: for
+
+		if ((iteration % log_interval == 0) || !active)
+			curves_ << landscape_name_ << "," << optimizer_name_ << "," << learning_rate_ << "," << iteration << ","
+				<< values->mean() << "," << values->minCoeff() << "," << values->maxCoeff() << std::endl;
+		if (!active)
+			break;
+	}//: while
+
+	// Summarize - iterations are averaged over the converged starts only.
+	size_t converged = 0, max_iterations = 0;
+	double mean_iterations = 0.0;
+	for (size_t s=0; s<starts_; s++) {
+		if (iterations_to_tolerance[s] == 0)
+			continue;
+		converged++;
+		mean_iterations += iterations_to_tolerance[s];
+		max_iterations = std::max(max_iterations, iterations_to_tolerance[s]);
+	}//: for
+	if (converged)
+		mean_iterations /= converged;
+
+	summary_ << landscape_name_ << "," << optimizer_name_ << "," << learning_rate_ << "," << dims << "," << starts_ << ","
+		<< converged << "," << mean_iterations << "," << max_iterations << ","
+		<< step_time / iteration << "," << update_time / iteration << "," << bytes_per_parameter << "," << values->mean() << std::endl;
+
+	LOG(LINFO) << landscape_name_ << " / " << optimizer_name_ << " (learning rate = " << learning_rate_ << "): converged "
+		<< converged << "/" << starts_ << " starts, mean iterations = " << mean_iterations << ", step time = " << step_time / iteration << "us";
+}
+
+
+/*!
+ * \brief Main program function. Runs all (gradient-based) optimization functions on n-dimensional landscapes.
+ * \author tkornuta
+ * @param[in] argc Number of parameters.
+ * @param[in] argv List of parameters: dims, starts, max_iterations, tolerance and output_prefix.
+ * @return (not used)
+ */
+int main(int argc, char* argv[]) {
+	// Set console output to logger.
+	LOGGER->addOutput(new ConsoleOutput());
+	LOG(LINFO) << "Logger initialized. Starting application";
+
+	size_t dims = (argc > 1) ? std::strtoul(argv[1], NULL, 10) : 1000000;
+	size_t starts = (argc > 2) ? std::strtoul(argv[2], NULL, 10) : 4;
+	size_t max_iterations = (argc > 3) ? std::strtoul(argv[3], NULL, 10) : 1000;
+	double tolerance = (argc > 4) ? std::strtod(argv[4], NULL) : 1e-6;
+	std::string prefix = (argc > 5) ? argv[5] : "optimization_benchmark";
+
+	std::ofstream curves(prefix + "_curves.csv");
+	std::ofstream summary(prefix + "_summary.csv");
+	curves << "landscape,optimizer,learning_rate,iteration,mean_value,min_value,max_value" << std::endl;
+	summary << "landscape,optimizer,learning_rate,dims,starts,converged,mean_iterations_to_tolerance,max_iterations_to_tolerance,"
+		<< "step_time_us,update_time_us,bytes_per_parameter,final_mean_value" << std::endl;
+
+	// Landscapes.
+	std::vector<std::pair<std::string, std::shared_ptr<DifferentiableFunction<float> > > > landscapes;
+	landscapes.push_back(std::make_pair("sphere", std::make_shared<SphereFunction<float> >(dims)));
+	landscapes.push_back(std::make_pair("rosenbrock", std::make_shared<RosenbrockFunction<float> >(dims)));
+
+	// Optimization functions - hebbian rules do not use the gradients, thus are skipped.
+	std::vector<std::pair<std::string, OptimizationFunctionFactory> > optimizers;
+	optimizers.push_back(std::make_pair("GradientDescent", [](size_t r_, size_t c_) { return std::make_shared<GradientDescent<float> >(r_, c_); }));
+	optimizers.push_back(std::make_pair("Momentum", [](size_t r_, size_t c_) { return std::make_shared<Momentum<float> >(r_, c_); }));
+	optimizers.push_back(std::make_pair("AdaGrad", [](size_t r_, size_t c_) { return std::make_shared<AdaGrad<float> >(r_, c_); }));
+	optimizers.push_back(std::make_pair("RMSProp", [](size_t r_, size_t c_) { return std::make_shared<RMSProp<float> >(r_, c_); }));
+	optimizers.push_back(std::make_pair("AdaDelta", [](size_t r_, size_t c_) { return std::make_shared<AdaDelta<float> >(r_, c_); }));
+	optimizers.push_back(std::make_pair("Adam", [](size_t r_, size_t c_) { return std::make_shared<Adam<float> >(r_, c_); }));
+	optimizers.push_back(std::make_pair("GradPID", [](size_t r_, size_t c_) { return std::make_shared<GradPID<float> >(r_, c_); }));
+	optimizers.push_back(std::make_pair("AdaGradPID", [](size_t r_, size_t c_) { return std::make_shared<AdaGradPID<float> >(r_, c_); }));
+	optimizers.push_back(std::make_pair("AdamID", [](size_t r_, size_t c_) { return std::make_shared<AdamID<float> >(r_, c_); }));
+
+	// Learning rates - the optimization functions differ in their preferred ranges.
+	const float learning_rates[] = {0.1f, 0.01f, 0.001f};
+
+	LOG(LINFO) << "Benchmarking " << optimizers.size() << " optimization functions on " << landscapes.size() << " landscapes of " << dims << " dimensions, " << starts << " starts each";
+	for (size_t l=0; l<landscapes.size(); l++)
+		for (size_t o=0; o<optimizers.size(); o++)
+			for (float learning_rate : learning_rates)
+				benchmark(landscapes[l].first, *landscapes[l].second, optimizers[o].first, optimizers[o].second,
+						learning_rate, starts, max_iterations, tolerance, curves, summary);
+
+	LOG(LINFO) << "Results written to " << prefix << "_curves.csv and " << prefix << "_summary.csv";
+}//: main